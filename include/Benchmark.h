@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_BENCHMARK_H
+#define SOLARUS_BENCHMARK_H
+
+#include "Common.h"
+#include "lowlevel/InputEvent.h"
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+/**
+ * @brief Settings and results of a headless, reproducible benchmark run.
+ *
+ * A benchmark is requested with the following command-line options:
+ *   -benchmark=N              runs N frames as fast as possible, then exits
+ *   -benchmark-map=MAP_ID     starts a new game directly on this map
+ *   -benchmark-input=FILE     replays the input events listed in this file
+ *   -benchmark-step=MS        duration of a frame in the simulated clock (default 10)
+ *
+ * A benchmark implies -no-video and -no-audio.
+ * System::now() becomes a simulated clock that advances by the same
+ * duration at each frame and the random number generator is seeded with a
+ * constant, so that two runs of the same benchmark simulate the same frames.
+ *
+ * Each line of the input file is either empty, a comment starting with '#'
+ * or an event to replay at the beginning of a frame:
+ *   FRAME press KEY_NAME
+ *   FRAME release KEY_NAME
+ *   FRAME quit
+ * where FRAME is a frame number starting at 0 and KEY_NAME is the name
+ * of a keyboard key as in the Lua API (e.g. "space", "left", "kp 0").
+ *
+ * If the program is compiled with SOLARUS_COUNT_ALLOCATIONS (CMake option
+ * COUNT_ALLOCATIONS), the global operator new is replaced to count
+ * allocations, and the report also gives the number of memory allocations
+ * made by each frame ("allocs" line).
+ */
+class Benchmark {
+
+  public:
+
+    Benchmark(int argc, char** argv);
+    ~Benchmark();
+
+    static bool is_requested(int argc, char** argv);
+    static uint32_t get_nb_allocations();
+
+    int get_nb_frames();
+    uint32_t get_timestep();
+    const std::string& get_map_id();
+
+    void push_input_events(int frame);
+    void add_frame(uint64_t update_duration, uint64_t draw_duration,
+        uint32_t nb_frame_allocations);
+    void print_report(std::ostream& os);
+
+  private:
+
+    /**
+     * @brief An input event to replay during the benchmark.
+     */
+    struct ScriptedInput {
+      int frame;                       /**< frame when the event occurs */
+      int type;                        /**< SDL event type */
+      InputEvent::KeyboardKey key;     /**< key pressed or released */
+    };
+
+    int nb_frames;                     /**< number of frames to run */
+    uint32_t timestep;                 /**< simulated duration of a frame in milliseconds */
+    std::string map_id;                /**< map to start a game on, or an empty string */
+    std::string input_file_name;       /**< file of input events to replay, or an empty string */
+
+    std::vector<ScriptedInput> inputs; /**< input events to replay, sorted by frame */
+    size_t next_input;                 /**< index of the next input event to replay */
+
+    std::vector<uint32_t> update_durations;  /**< duration of each update in microseconds */
+    std::vector<uint32_t> draw_durations;    /**< duration of each drawing in microseconds */
+    std::vector<uint32_t> frame_allocations; /**< number of memory allocations of each frame */
+
+    void load_inputs();
+    static bool compare_frames(const ScriptedInput& input1, const ScriptedInput& input2);
+    static void print_statistics(std::ostream& os, const std::string& name,
+        std::vector<uint32_t> durations);
+};
+
+#endif
+
@@ -56,6 +56,18 @@
 #  endif
 #endif
 
+/**
+ * @def SOLARUS_HAVE_MMAP
+ * @brief Whether data files of a quest directory can be memory-mapped.
+ */
+#ifndef SOLARUS_HAVE_MMAP
+#  if defined(_WIN32)
+#    define SOLARUS_HAVE_MMAP 0
+#  else
+#    define SOLARUS_HAVE_MMAP 1
+#  endif
+#endif
+
 // Game size.
 
 /**
@@ -50,7 +50,10 @@ class MainLoop {
     bool exiting;               /**< indicates that the program is about to stop */
     Game* game;                 /**< The current game if any, NULL otherwise. */
     Game* next_game;            /**< The game to start at next cycle (NULL means resetting the game). */
+    Benchmark* benchmark;       /**< the benchmark to run instead of the normal loop, or NULL */
 
+    void run_benchmark();
+    void change_game();
     void notify_input(InputEvent& event);
     void draw();
     void update();
@@ -24,6 +24,7 @@
 #include "entities/Obstacle.h"
 #include "lowlevel/Rectangle.h"
 #include "lua/ExportableToLua.h"
+#include <vector>
 
 /**
  * @brief Represents a map where the game can take place.
@@ -89,6 +90,11 @@ class Map: public ExportableToLua {
                                    * to place the hero on a side of the map */
 
     MapEntities* entities;        /**< the entities on the map */
+    std::vector<MapEntity*>
+        obstacle_entities_found;  /**< obstacle entities close to the rectangle being tested
+                                   * by test_collision_with_entities() */
+    PathFindingService*
+        path_finding_service;     /**< computes the paths of path-finding movements */
     bool suspended;               /**< indicates whether the game is suspended */
 
     // light
@@ -98,6 +104,7 @@ class Map: public ExportableToLua {
     void set_suspended(bool suspended);
     void draw_background();
     void draw_foreground();
+    void prefetch_destinations();
 
   public:
 
@@ -146,6 +153,8 @@ class Map: public ExportableToLua {
 
     // entities
     MapEntities& get_entities();
+    PathFindingService& get_path_finding_service();
+    void notify_obstacles_changed();
 
     // presence of the hero
     bool is_started();
@@ -1,16 +1,16 @@
 /*
  * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
- * 
+ *
  * Solarus is free software; you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
  * (at your option) any later version.
- * 
+ *
  * Solarus is distributed in the hope that it will be useful,
  * but WITHOUT ANY WARRANTY; without even the implied warranty of
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
  * GNU General Public License for more details.
- * 
+ *
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
@@ -18,6 +18,13 @@
 #define SOLARUS_MAP_LOADER_H
 
 #include "Common.h"
+#include "entities/Layer.h"
+#include <SDL.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <iosfwd>
 
 struct lua_State;
 
@@ -25,6 +32,31 @@ struct lua_State;
  * @brief Parses a map file.
  *
  * This class loads a map and its content from a map file.
+ *
+ * A map file is a Lua data file (maps/ID.dat). It can also be converted
+ * into a binary file (maps/ID.map) that is much faster to load, because
+ * tiles are created directly from it without any Lua call.
+ * The binary file is used instead of the Lua data file if it was converted
+ * from the current version of the Lua data file.
+ *
+ * A binary map file contains, with all integers stored on 32 bits in
+ * little-endian order:
+ * - a header: "SMP1", the size and the hash of the Lua data file, the
+ *   properties of the map (x, y, width, height, floor, and the indexes of
+ *   the world, tileset and music strings), the number of strings, the
+ *   number of tiles of each layer and the number of other entities,
+ * - the string table: the length and the characters of each string,
+ * - the tiles of each layer: x, y, width, height and pattern,
+ * - the other entities: the type (index of the creation function), the
+ *   number of fields and each field (key string, value type, value).
+ *   Other entities are still created through their Lua creation function,
+ *   so that their fields are checked the same way.
+ *
+ * The maps where the hero may go next can be read in advance by a separate
+ * thread (see prefetch_maps()). This thread reads their files and executes
+ * their Lua code (or parses their binary file) into an independent
+ * description, and load_map() then only has to create the entities.
+ * update() starts decoding the tilesets of the maps read so far.
  */
 class MapLoader {
 
@@ -35,9 +67,121 @@ class MapLoader {
 
     void load_map(Game& game, Map& map);
 
+    static void convert_maps(std::ostream& report);
+
+    static void prefetch_maps(const std::vector<std::string>& map_ids);
+    static void update();
+    static void quit();
+    static int get_nb_prefetch_hits();
+    static int get_nb_prefetch_misses();
+    static int get_nb_prefetch_discarded();
+
   private:
 
+    /**
+     * @brief Type of the value of an entity field in a binary map file.
+     */
+    enum FieldType {
+      FIELD_INTEGER,
+      FIELD_STRING,
+      FIELD_BOOLEAN
+    };
+
+    /**
+     * @brief A field of an entity declared in a map file.
+     */
+    struct FieldData {
+      std::string key;                       /**< name of the field */
+      FieldType type;                        /**< type of the value */
+      int int_value;                         /**< value of an integer or boolean field */
+      std::string string_value;              /**< value of a string field */
+    };
+
+    /**
+     * @brief A tile declared in a map file.
+     */
+    struct TileData {
+      int x;
+      int y;
+      int width;
+      int height;
+      int pattern;
+    };
+
+    /**
+     * @brief An entity other than a tile declared in a map file.
+     */
+    struct EntityData {
+      int type;                              /**< index of its creation function */
+      std::vector<FieldData> fields;         /**< fields of the entity */
+    };
+
+    /**
+     * @brief Everything declared in a map file.
+     */
+    struct MapData {
+      uint32_t source_size;                  /**< size of the Lua data file */
+      uint32_t source_hash;                  /**< hash of the Lua data file */
+      int x;
+      int y;
+      int width;
+      int height;
+      int floor;
+      std::string world;
+      std::string tileset_id;
+      std::string music_id;
+      std::vector<TileData> tiles[LAYER_NB]; /**< tiles of each layer, in their order */
+      std::vector<EntityData> entities;      /**< other entities, in their order */
+    };
+
+    /**
+     * @brief A map requested to the prefetching thread.
+     */
+    struct PrefetchedMap {
+      MapData* data;                         /**< content of the map, or NULL if it could not be read */
+      size_t size;                           /**< memory used by the content */
+      bool done;                             /**< true when the thread has finished reading the map */
+    };
+
+    static const size_t max_prefetched_size = 4 * 1024 * 1024; /**< maximum memory used by maps read in advance */
+
+    static std::map<std::string, PrefetchedMap> prefetched_maps; /**< maps requested to the prefetching thread
+                                                  * (only the main thread adds or removes entries,
+                                                  * values are protected by prefetch_mutex) */
+    static std::list<std::string> prefetch_requests; /**< maps waiting to be read (protected by prefetch_mutex) */
+    static std::vector<std::string> prefetch_tileset_ids; /**< tilesets of the maps read, not decoded in advance yet
+                                                  * (protected by prefetch_mutex) */
+    static std::string prefetch_current;     /**< map being read by the thread, or an empty string */
+    static size_t prefetched_size;           /**< memory used by the maps read in advance */
+    static SDL_Thread* prefetch_thread;      /**< the thread that reads maps in advance, or NULL */
+    static SDL_mutex* prefetch_mutex;        /**< protects the data shared with the prefetching thread */
+    static SDL_cond* prefetch_cond;          /**< signaled when a map is requested or read */
+    static bool prefetch_stopping;           /**< true to make the prefetching thread finish */
+    static int nb_prefetch_hits;             /**< number of maps loaded from data read in advance */
+    static int nb_prefetch_misses;           /**< number of maps loaded without data read in advance */
+    static int nb_prefetch_discarded;        /**< number of maps read in advance but dropped to respect the memory limit */
+
+    static void set_properties(Map& map, int x, int y, int width, int height,
+        const std::string& world, int floor,
+        const std::string& tileset_id, const std::string& music_id);
     static int l_properties(lua_State* l);
+
+    static bool load_binary_map(Map& map, const std::string& file_name,
+        const char* source, size_t source_size);
+    static void create_entities(Map& map, const MapData& data);
+
+    static void read_map_data(lua_State* l, const std::string& file_name,
+        MapData& data);
+    static bool run_map_data(lua_State* l, MapData& data);
+    static int l_read_properties(lua_State* l);
+    static int l_read_entity(lua_State* l);
+    static void write_binary_map(const MapData& data, std::string& output);
+    static bool parse_binary_map(const char* buffer, size_t size, MapData& data);
+
+    static MapData* take_prefetched_map(const std::string& map_id);
+    static bool read_prefetched_map(const std::string& map_id, MapData& data);
+    static size_t get_map_data_size(const MapData& data);
+    static int read_prefetched_maps(void* unused);
 };
 
 #endif
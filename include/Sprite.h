@@ -33,6 +33,9 @@
  *
  * A sprite can be drawn directly on a surface, or it can
  * be attached to a map entity.
+ *
+ * Animations can be designated by their name or by their id
+ * (see SpriteAnimationSet::get_animation_id()), which is faster.
  */
 class Sprite: public Drawable {
 
@@ -62,8 +65,11 @@ class Sprite: public Drawable {
 
     // animation state
     const std::string& get_current_animation() const;
+    int get_current_animation_id() const;
     void set_current_animation(const std::string& animation_name);
+    void set_current_animation(int animation_id);
     bool has_animation(const std::string& animation_name);
+    bool has_animation(int animation_id);
     int get_current_direction() const;
     void set_current_direction(int current_direction);
     int get_current_frame() const;
@@ -114,12 +120,15 @@ class Sprite: public Drawable {
 
     // current state of the sprite
 
-    std::string current_animation_name;  /**< name of the current animation */
+    int current_animation_id;          /**< id of the current animation */
     SpriteAnimation* current_animation;  /**< the current animation */
     int current_direction;             /**< current direction of the animation (the first one is number 0);
                                         * it can be different from the movement direction
                                         * of the entity, because sometimes a sprite can
                                         * go backwards. */
+    const SpriteAnimationDirection*
+        current_animation_direction;   /**< the current direction of the current animation,
+                                        * or NULL if this animation has no such direction */
     int current_frame;                 /**< current frame of the animation (the first one is number 0) */
     bool frame_changed;                /**< indicates that the frame has just changed */
 
@@ -141,6 +150,7 @@ class Sprite: public Drawable {
 
     static SpriteAnimationSet& get_animation_set(const std::string& id);
     int get_next_frame() const;
+    void update_current_animation_direction();
     Surface& get_intermediate_surface();
     void set_frame_changed(bool frame_changed);
 };
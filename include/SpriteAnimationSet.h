@@ -20,6 +20,8 @@
 #include "Common.h"
 #include "lowlevel/Rectangle.h"
 #include <map>
+#include <vector>
+#include <deque>
 
 /**
  * @brief A set of animations representing a sprite.
@@ -28,15 +30,25 @@
  * and is an instance of SpriteAnimation.
  * For example, an NPC usually has an animation "stopped"
  * and an animation "walking".
+ *
+ * Animation names are interned into integer ids shared by all animation
+ * sets: an animation name always has the same id, whatever the sprite.
+ * Code that changes animations often can get the id of a name once
+ * with get_animation_id() and then avoid any string comparison.
  */
 class SpriteAnimationSet {
 
   private:
 
-    std::map<std::string, SpriteAnimation*> animations;  /**< the animations */
-    std::string default_animation_name;                  /**< name of the default animation */
+    std::vector<SpriteAnimation*> animations;            /**< the animations, indexed by animation id
+                                                          * (NULL for ids of other animation sets) */
+    int default_animation_id;                            /**< id of the default animation */
     Rectangle max_size;                                  /**< size of this biggest frame */
 
+    static std::map<std::string, int> animation_ids;     /**< id of each animation name interned */
+    static std::deque<std::string> animation_names;      /**< name of each animation id (a deque
+                                                          * keeps references valid when names are added) */
+
   public:
 
     SpriteAnimationSet(const std::string& id);
@@ -44,15 +56,33 @@ class SpriteAnimationSet {
 
     void set_map(Map &map);
 
+    static int get_animation_id(const std::string& animation_name);
+    static int find_animation_id(const std::string& animation_name);
+    static const std::string& get_animation_name(int animation_id);
+
     bool has_animation(const std::string& animation_name) const;
+    bool has_animation(int animation_id) const;
     const SpriteAnimation* get_animation(const std::string& animation_name) const;
     SpriteAnimation* get_animation(const std::string& animation_name);
+    const SpriteAnimation* get_animation(int animation_id) const;
+    SpriteAnimation* get_animation(int animation_id);
     const std::string& get_default_animation() const;
+    int get_default_animation_id() const;
 
     void enable_pixel_collisions();
     bool are_pixel_collisions_enabled() const;
     const Rectangle& get_max_size() const;
 };
 
+/**
+ * @brief Returns whether this animation set has an animation with the specified id.
+ * @param animation_id an animation id
+ * @return true if this animation exists
+ */
+inline bool SpriteAnimationSet::has_animation(int animation_id) const {
+  return animation_id >= 0 && animation_id < int(animations.size())
+      && animations[animation_id] != NULL;
+}
+
 #endif
 
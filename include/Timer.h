@@ -39,6 +39,7 @@ class Timer: public ExportableToLua {
     bool is_suspended_with_map();
     void set_suspended_with_map(bool suspend_with_map);
     bool is_finished();
+    uint32_t get_next_update_date();
 
     void update();
     void notify_map_suspended(bool suspended);
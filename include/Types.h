@@ -34,11 +34,14 @@ class MainLoop;
 class Screen;
 class QuestProperties;
 class Settings;
+class Benchmark;
 class KeysEffect;
 
 // low level
 class System;
 class FileTools;
+class DataBuffer;
+class ObjectPool;
 class VideoManager;
 class Surface;
 class TextSurface;
@@ -50,6 +53,7 @@ class ItDecoder;
 class Random;
 class Geometry;
 class Rectangle;
+class Scaler;
 class PixelBits;
 class InputEvent;
 class Debug;
@@ -100,6 +104,9 @@ class TransitionScrolling;
 // map entities
 class MapEntities;
 class MapEntity;
+class EntityGrid;
+class EntityNameIndex;
+class NonAnimatedTilesCache;
 class Hero;
 class HeroSprites;
 class Tile;
@@ -152,6 +159,7 @@ class PathMovement;
 class RandomPathMovement;
 class PathFindingMovement;
 class PathFinding;
+class PathFindingService;
 class RandomMovement;
 class FollowMovement;
 class TargetMovement;
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_ENTITY_GRID_H
+#define SOLARUS_ENTITY_GRID_H
+
+#include "Common.h"
+#include "lowlevel/Rectangle.h"
+#include <vector>
+#include <map>
+
+/**
+ * @brief Uniform grid that indexes map entities by the area they cover.
+ *
+ * The map is divided into squares of 16*16 pixels (two squares of the 8*8
+ * map grid in each direction). Each entity is stored in every square
+ * overlapped by the rectangle given when adding it.
+ * Querying a rectangle then only visits the entities of a few squares
+ * instead of all entities of the map.
+ *
+ * The rectangle of an entity is chosen by the owner of the grid: it must
+ * contain everything the queries are interested in (e.g. the facing point
+ * or the sprites of the entity) and be updated with update() when it changes.
+ * Areas outside the map are clamped to the border squares.
+ *
+ * Query results are returned in the order the entities were added,
+ * so that callers behave exactly like when they iterated a list.
+ */
+class EntityGrid {
+
+  public:
+
+    static const int cell_size = 16;        /**< width and height of a square in pixels */
+
+    EntityGrid();
+    ~EntityGrid();
+
+    void initialize(int map_width, int map_height);
+    void clear();
+
+    void add(MapEntity& entity, const Rectangle& area);
+    void remove(MapEntity& entity);
+    void update(MapEntity& entity, const Rectangle& area);
+    bool contains(MapEntity& entity) const;
+    int get_nb_entities() const;
+
+    void get_entities(const Rectangle& area, std::vector<MapEntity*>& result);
+
+  private:
+
+    /**
+     * @brief An entity stored in the grid.
+     */
+    struct Entry {
+      MapEntity* entity;                    /**< the entity */
+      uint32_t sequence;                    /**< order of addition of the entity */
+      uint32_t query_stamp;                 /**< last query that returned this entry */
+      int column1;                          /**< first column of squares covered */
+      int row1;                             /**< first row of squares covered */
+      int column2;                          /**< last column of squares covered */
+      int row2;                             /**< last row of squares covered */
+    };
+
+    int nb_columns;                         /**< number of squares on a row of the grid */
+    int nb_rows;                            /**< number of squares on a column of the grid */
+    std::vector<std::vector<Entry*> > cells; /**< entries overlapping each square */
+    std::map<MapEntity*, Entry> entries;    /**< all entities of the grid */
+    uint32_t next_sequence;                 /**< sequence number of the next entity added */
+    uint32_t query_stamp;                   /**< number of the current query */
+    std::vector<Entry*> found;              /**< entries found by the current query */
+
+    void get_cells(const Rectangle& area,
+        int& column1, int& row1, int& column2, int& row2) const;
+    void insert_in_cells(Entry& entry);
+    void remove_from_cells(Entry& entry);
+    static bool compare_sequences(const Entry* entry1, const Entry* entry2);
+};
+
+#endif
+
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_ENTITY_NAME_INDEX_H
+#define SOLARUS_ENTITY_NAME_INDEX_H
+
+#include "Common.h"
+#include <string>
+#include <vector>
+#include <list>
+
+/**
+ * @brief Index of map entities by their name.
+ *
+ * A hash table finds an entity from its exact name in constant time.
+ * The names are also kept sorted, so that the entities whose name starts
+ * with a prefix are found by a binary search, in a time proportional to
+ * the number of entities returned.
+ *
+ * The names are only sorted again when a query needs it, so that adding
+ * all entities of a map is not quadratic.
+ * Prefix queries return the entities in the order they were added,
+ * so that callers behave exactly like when they iterated a list.
+ * The name of an entity must not change while it is in the index.
+ */
+class EntityNameIndex {
+
+  public:
+
+    EntityNameIndex();
+    ~EntityNameIndex();
+
+    void clear();
+    void add(MapEntity& entity);
+    void remove(MapEntity& entity);
+
+    MapEntity* find(const std::string& name) const;
+    void get_entities_with_prefix(const std::string& prefix,
+        std::list<MapEntity*>& result);
+    bool has_entity_with_prefix(const std::string& prefix);
+
+  private:
+
+    /**
+     * @brief An entity in the sorted names.
+     */
+    struct Entry {
+      MapEntity* entity;                    /**< the entity */
+      uint32_t sequence;                    /**< order of addition of the entity */
+    };
+
+    std::vector<std::vector<MapEntity*> >
+      buckets;                              /**< entities by hash of their name (the number
+                                             * of buckets is a power of 2) */
+    int nb_entities;                        /**< number of entities in the index */
+    std::vector<Entry> sorted_entries;      /**< entities sorted by name when sorted is true */
+    bool sorted;                            /**< false if entities were added since the last sort */
+    uint32_t next_sequence;                 /**< sequence number of the next entity added */
+    std::vector<Entry> found;               /**< entries found by the current prefix query */
+
+    std::vector<MapEntity*>& get_bucket(const std::string& name);
+    const std::vector<MapEntity*>& get_bucket(const std::string& name) const;
+    void rehash();
+    void sort_entries();
+    std::vector<Entry>::iterator find_first_with_prefix(const std::string& prefix);
+
+    static bool compare_names(const Entry& entry1, const Entry& entry2);
+    static bool compare_name_with(const Entry& entry, const std::string& name);
+    static bool compare_sequences(const Entry& entry1, const Entry& entry2);
+    static bool has_prefix(const Entry& entry, const std::string& prefix);
+};
+
+#endif
+
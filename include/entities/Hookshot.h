@@ -59,6 +59,7 @@ class Hookshot: public MapEntity {
 
     // state
     void update();
+    Rectangle get_drawing_area();
     virtual void draw_on_map();
     const Rectangle get_facing_point();
     bool is_flying();
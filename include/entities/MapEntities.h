@@ -23,6 +23,9 @@
 #include "entities/Layer.h"
 #include "entities/EntityType.h"
 #include "entities/Enemy.h"
+#include "entities/EntityGrid.h"
+#include "entities/EntityNameIndex.h"
+#include "entities/NonAnimatedTilesCache.h"
 #include <vector>
 #include <list>
 
@@ -33,6 +36,16 @@
  * a subclass of MapEntity.
  * This class stores all entities of the current map:
  * the tiles, the hero, the enemies and all other entities.
+ *
+ * Entities drawn in the y order are kept sorted in a vector with the
+ * bottom edge of each one. When an entity of a layer moves, the layer is
+ * sorted again at the next update by an insertion sort, which costs little
+ * since only a few entities change their position relative to the others.
+ *
+ * Only the entities whose drawing area is close to the visible area are
+ * drawn. The entities drawn in the normal order and the tiles in animated
+ * regions are indexed by grids, and the entities drawn in the y order are
+ * found by a binary search on their bottom edge.
  */
 class MapEntities {
 
@@ -46,7 +59,9 @@ class MapEntities {
     Hero& get_hero();
     Obstacle get_obstacle_tile(Layer layer, int x, int y);
     std::list<MapEntity*>& get_obstacle_entities(Layer layer);
+    void get_obstacle_entities(Layer layer, const Rectangle& area, std::vector<MapEntity*>& result);
     std::list<Detector*>& get_detectors();
+    void get_detectors(const Rectangle& area, std::vector<Detector*>& result);
     std::list<Stairs*>& get_stairs(Layer layer);
     std::list<CrystalBlock*>& get_crystal_blocks(Layer layer);
 
@@ -66,6 +81,7 @@ class MapEntities {
     void destroy_entity(MapEntity* entity);
     static bool compare_y(MapEntity* first, MapEntity* second);
     void set_entity_layer(MapEntity& entity, Layer layer);
+    void notify_entity_bounding_box_changed(MapEntity& entity);
 
     // specific to some entity types
     bool overlaps_raised_blocks(Layer layer, const Rectangle& rectangle);
@@ -83,17 +99,50 @@ class MapEntities {
     void update();
     void draw();
 
+    static int get_nb_entities_drawn();
+    static int get_nb_entities_total();
+    static int get_nb_y_order_sorts();
+    static int get_nb_y_order_moves();
+    static uint64_t get_y_order_time();
+    static int get_nb_prefix_queries();
+    static uint64_t get_prefix_query_time();
+    static int get_nb_entities_created(EntityType type);
+    static const std::string& get_entity_type_name(EntityType type);
+
   private:
 
+    static const int drawing_margin = 32;           /**< entities are drawn if their drawing area is at most
+                                                     * this number of pixels away from the visible area */
+
+    /**
+     * @brief An entity drawn in the y order, with the y coordinate
+     * of its bottom edge and its drawing area when the order was last computed.
+     */
+    struct YOrderEntry {
+      int y;                                        /**< bottom edge of the entity */
+      MapEntity* entity;                            /**< the entity */
+      int x1;                                       /**< left side of the drawing area */
+      int y1;                                       /**< top side of the drawing area */
+      int x2;                                       /**< right side of the drawing area */
+      int y2;                                       /**< bottom side of the drawing area */
+    };
+
     friend class MapLoader;            /**< the map loader initializes the private fields of MapEntities */
 
     void add_tile(Tile *tile);
     void set_obstacle(int layer, int x8, int y8, Obstacle obstacle);
     void build_non_animated_tiles();
-    void redraw_non_animated_tiles();
     bool overlaps_animated_tile(Tile& tile);
     void remove_marked_entities();
     void update_crystal_blocks();
+    Rectangle get_detection_area(MapEntity& detector);
+    void add_drawn_in_y_order(Layer layer, MapEntity& entity);
+    void remove_drawn_in_y_order(Layer layer, MapEntity& entity);
+    void sort_drawn_in_y_order(Layer layer);
+    void update_y_order_entry(Layer layer, YOrderEntry& entry);
+    static int get_y_order_key(MapEntity& entity);
+    static bool compare_y_order_keys(const YOrderEntry& entry, int y);
+    void draw_entities_y_order(Layer layer, const Rectangle& area);
 
     // map
     Game& game;                                     /**< the game running this map */
@@ -109,7 +158,7 @@ class MapEntities {
                                                      * are obstacles and how */
     bool* animated_tiles[LAYER_NB];                 /**< array of size tiles_grid_size that remembers which squares
                                                      * have animated tiles */
-    Surface* non_animated_tiles_surfaces[LAYER_NB]; /**< all non-animated tiles are rendered once for all on these surfaces
+    NonAnimatedTilesCache non_animated_tiles;       /**< non-animated tiles are rendered once for all by chunks
                                                      * for performance */
     std::vector<Tile*>
         tiles_in_animated_regions[LAYER_NB];        /**< animated tiles and tiles overlapping them */
@@ -117,8 +166,7 @@ class MapEntities {
     // dynamic entities
     Hero& hero;                                     /**< the hero (also stored in Game because it is kept when changing maps) */
 
-    std::map<std::string, MapEntity*>
-      named_entities;                               /**< entities identified by a name */
+    EntityNameIndex named_entities;                 /**< entities identified by a name */
     std::list<MapEntity*> all_entities;             /**< all map entities except the tiles and the hero;
                                                      * this vector is used to delete the entities
                                                      * when the map is unloaded */
@@ -126,17 +174,29 @@ class MapEntities {
 
     std::list<MapEntity*>
       entities_drawn_first[LAYER_NB];               /**< all map entities that are drawn in the normal order */
+    EntityGrid entities_drawn_first_grids[LAYER_NB]; /**< the same entities indexed by their drawing area */
+    EntityGrid tiles_in_animated_regions_grids[LAYER_NB]; /**< tiles_in_animated_regions indexed by their position */
+    std::vector<MapEntity*> entities_to_draw;       /**< entities returned by the last grid query of draw() */
 
-    std::list<MapEntity*>
+    std::vector<YOrderEntry>
       entities_drawn_y_order[LAYER_NB];             /**< all map entities that are drawn in the order
                                                      * defined by their y position, including the hero */
+    bool y_order_changed[LAYER_NB];                 /**< true if an entity of entities_drawn_y_order
+                                                     * has moved since the last sort */
+    int y_order_max_above[LAYER_NB];                /**< maximum distance from the top of a drawing area
+                                                     * to the bottom edge of its entity */
+    int y_order_max_below[LAYER_NB];                /**< maximum distance from the bottom edge of an entity
+                                                     * to the bottom of its drawing area */
 
     std::list<Detector*> detectors;                 /**< all entities able to detect other entities
                                                      * on this map */
+    EntityGrid detectors_grid;                      /**< the same detectors indexed by their detection area */
+    std::vector<MapEntity*> grid_query_result;      /**< entities returned by the last grid query */
 
     std::list<MapEntity*>
       obstacle_entities[LAYER_NB];                  /**< all entities that might be obstacle for other
                                                      * entities on this map, including the hero */
+    EntityGrid obstacle_entities_grids[LAYER_NB];   /**< the same obstacle entities indexed by their bounding box */
 
     std::list<Stairs*> stairs[LAYER_NB];            /**< all stairs of the map */
     std::list<CrystalBlock*>
@@ -144,6 +204,17 @@ class MapEntities {
 
     Boomerang* boomerang;                           /**< the boomerang if present on the map, NULL otherwise */
     std::string music_before_miniboss;              /**< the music that was played before starting a miniboss fight */
+
+    static int nb_entities_drawn;                   /**< number of entities and animated tiles drawn */
+    static int nb_entities_total;                   /**< number of entities and animated tiles that
+                                                     * would have been drawn without culling */
+    static int nb_y_order_sorts;                    /**< number of layers sorted again */
+    static int nb_y_order_moves;                    /**< number of entities moved by these sorts */
+    static uint64_t y_order_time;                   /**< time spent in these sorts in microseconds */
+    static int nb_prefix_queries;                   /**< number of searches of entities by name prefix */
+    static uint64_t prefix_query_time;              /**< time spent in these searches in microseconds */
+    static int nb_entities_created[HOOKSHOT + 1];   /**< number of entities added to maps, for each type */
+    static const std::string entity_type_names[];   /**< name of each type of entity */
 };
 
 /**
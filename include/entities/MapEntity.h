@@ -99,6 +99,7 @@ class MapEntity: public ExportableToLua {
         default_optimization_distance = 400;    /**< default value */
 
     void set_sprites_map(Map& map);
+    void notify_bounding_box_changed();
 
   protected:
 
@@ -127,6 +128,10 @@ class MapEntity: public ExportableToLua {
 
   public:
 
+    // memory
+    static void* operator new(size_t size);
+    static void operator delete(void* memory, size_t size);
+
     // destruction
     virtual ~MapEntity();
     void remove_from_map();
@@ -304,6 +309,7 @@ class MapEntity: public ExportableToLua {
     virtual void set_suspended(bool suspended);
     virtual void update();
     bool is_drawn();
+    virtual Rectangle get_drawing_area();
     virtual void draw_on_map();
 
     virtual const std::string& get_lua_type_name() const;
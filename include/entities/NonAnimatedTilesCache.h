@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_NON_ANIMATED_TILES_CACHE_H
+#define SOLARUS_NON_ANIMATED_TILES_CACHE_H
+
+#include "Common.h"
+#include "entities/Layer.h"
+#include "lowlevel/Rectangle.h"
+#include <vector>
+
+/**
+ * @brief Pre-rendered images of the non-animated tiles of a map.
+ *
+ * Each layer of the map is divided into chunks of 256*256 pixels.
+ * The non-animated tiles of a chunk are rendered on a surface the first
+ * time the chunk is visible, and the squares that contain animated tiles
+ * are left transparent (animated tiles are drawn separately).
+ * Chunks around the visible area are also rendered in advance, one at a time.
+ *
+ * Only a limited number of chunk surfaces are kept: when the limit is
+ * reached, the chunk used least recently is freed. Chunks without any
+ * non-animated tile never have a surface.
+ */
+class NonAnimatedTilesCache {
+
+  public:
+
+    static const int chunk_size = 256;      /**< width and height of a chunk in pixels */
+    static const int max_surfaces = 48;     /**< maximum number of chunk surfaces kept
+                                             * (12 MB in 32-bit mode) */
+
+    NonAnimatedTilesCache();
+    ~NonAnimatedTilesCache();
+
+    void initialize(int map_width, int map_height);
+    void clear();
+    void invalidate();
+
+    void add_tile(Tile& tile);
+    void set_animated_squares(Layer layer, const bool* animated_squares);
+
+    void draw(Layer layer, Surface& dst_surface, const Rectangle& viewport);
+
+    static int get_nb_chunks_built();
+    static int get_nb_chunks_freed();
+
+  private:
+
+    /**
+     * @brief A chunk of a layer.
+     */
+    struct Chunk {
+      std::vector<Tile*> tiles;             /**< non-animated tiles overlapping this chunk */
+      Surface* surface;                     /**< rendering of these tiles, or NULL */
+      uint32_t last_used;                   /**< value of use_counter when this chunk was last used */
+    };
+
+    int map_width;                          /**< width of the map in pixels */
+    int map_height;                         /**< height of the map in pixels */
+    int nb_columns;                         /**< number of chunks on a row */
+    int nb_rows;                            /**< number of chunks on a column */
+    std::vector<Chunk> chunks[LAYER_NB];    /**< chunks of each layer */
+    const bool* animated_squares[LAYER_NB]; /**< for each 8*8 square of each layer,
+                                             * whether it contains an animated tile */
+    int nb_surfaces;                        /**< number of chunks that have a surface */
+    uint32_t use_counter;                   /**< incremented each time a chunk is used */
+
+    static int nb_chunks_built;             /**< number of chunk surfaces rendered */
+    static int nb_chunks_freed;             /**< number of chunk surfaces freed to save memory */
+
+    Rectangle get_chunk_rectangle(int index);
+    void get_chunks(const Rectangle& area,
+        int& column1, int& row1, int& column2, int& row2);
+    void build_chunk(Layer layer, int index);
+    void free_oldest_chunk();
+};
+
+#endif
+
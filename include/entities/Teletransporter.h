@@ -66,6 +66,7 @@ class Teletransporter: public Detector {
 
     EntityType get_type();
     void set_map(Map& map);
+    const std::string& get_destination_map_id();
 
     bool is_obstacle_for(MapEntity& other);
     bool test_collision_custom(MapEntity& entity);
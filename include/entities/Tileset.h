@@ -30,6 +30,12 @@ struct lua_State;
  * A tileset is an image containing a set of elements (tile patterns)
  * that one can use to compose a map.
  * See the directory images/tilesets of the data package.
+ *
+ * Maps get their tileset with acquire() and give it back with release().
+ * Loaded tilesets are shared by the maps that use them, and the ones used
+ * recently are kept loaded after the last map using them is released,
+ * so that going to another map with the same tileset loads nothing.
+ * The images of a tileset can also be decoded in advance by prefetch().
  */
 class Tileset {
 
@@ -41,8 +47,17 @@ class Tileset {
     Color background_color;                           /**< background color of the tileset */
     Surface* tiles_image;                             /**< image from which the tile patterns are extracted */
     Surface* entities_image;                          /**< image from which the skin-dependent entities are extracted */
+    int refcount;                                     /**< number of maps using this tileset */
+    uint32_t last_released;                           /**< value of release_counter when the last map released this tileset */
+
+    static const unsigned int max_unused_tilesets = 4; /**< number of tilesets kept loaded without any map using them */
+    static std::map<std::string, Tileset*> all_tilesets; /**< tilesets that maps can share, by id */
+    static uint32_t release_counter;                  /**< incremented each time a tileset is no longer used */
+    static int nb_tilesets_reused;                    /**< number of tilesets acquired already loaded */
+    static int nb_tilesets_loaded;                    /**< number of tilesets acquired and loaded */
 
     void add_tile_pattern(int id, TilePattern* tile_pattern);
+    static void remove_oldest_unused_tileset();
 
     static int l_background_color(lua_State* l);
     static int l_tile_pattern(lua_State* l);
@@ -52,6 +67,13 @@ class Tileset {
     Tileset(const std::string& id);
     ~Tileset();
 
+    static Tileset& acquire(const std::string& id);
+    static void release(Tileset& tileset);
+    static void prefetch(const std::string& id);
+    static void quit();
+    static int get_nb_tilesets_reused();
+    static int get_nb_tilesets_loaded();
+
     void load();
     void unload();
 
@@ -60,6 +60,44 @@ class HeroSprites {
     static const std::string sword_sound_ids[];         /**< name of each sword sound */
     static const std::string ground_sound_ids[];        /**< name of each ground sound */
 
+    /**
+     * @brief Animations that this class gives to the hero's sprites.
+     */
+    enum Animation {
+      ANIMATION_BIG,
+      ANIMATION_BRANDISH,
+      ANIMATION_CARRYING_STOPPED,
+      ANIMATION_CARRYING_WALKING,
+      ANIMATION_FALLING,
+      ANIMATION_GRABBING,
+      ANIMATION_HURT,
+      ANIMATION_JUMPING,
+      ANIMATION_LIFTING,
+      ANIMATION_LOADING,
+      ANIMATION_PULLING,
+      ANIMATION_PUSHING,
+      ANIMATION_RUNNING,
+      ANIMATION_SPIN_ATTACK,
+      ANIMATION_STOPPED,
+      ANIMATION_STOPPED_WITH_SHIELD,
+      ANIMATION_SUPER_SPIN_ATTACK,
+      ANIMATION_SWIMMING_FAST,
+      ANIMATION_SWIMMING_SLOW,
+      ANIMATION_SWIMMING_STOPPED,
+      ANIMATION_SWORD,
+      ANIMATION_SWORD_LOADING_STOPPED,
+      ANIMATION_SWORD_LOADING_WALKING,
+      ANIMATION_SWORD_TAPPING,
+      ANIMATION_VICTORY,
+      ANIMATION_WALKING,
+      ANIMATION_WALKING_DIAGONAL,
+      ANIMATION_WALKING_WITH_SHIELD,
+      NB_ANIMATIONS
+    };
+
+    static const std::string animation_names[];         /**< name of each animation */
+    static int animation_ids[NB_ANIMATIONS];            /**< id of each animation, interned by the constructor */
+
     int animation_direction_saved;	/**< direction of the hero's sprites, saved before
 					 * showing a sprite animation having only one direction */
     uint32_t when_suspended;		/**< date when the game was suspended */
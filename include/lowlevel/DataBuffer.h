@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_DATA_BUFFER_H
+#define SOLARUS_DATA_BUFFER_H
+
+#include "Common.h"
+#include <string>
+
+/**
+ * @brief Read-only content of a data file, shared without copies.
+ *
+ * Data buffers are obtained from FileTools::data_file_read().
+ * Copying a data buffer does not copy its bytes: all copies share them
+ * through a reference count, and the bytes are freed (or unmapped for a
+ * memory-mapped file) when the last copy is destroyed.
+ * Copies must only be made or destroyed by the main thread,
+ * but other threads can read the bytes of a buffer the main thread keeps.
+ */
+class DataBuffer {
+
+  public:
+
+    DataBuffer();
+    DataBuffer(const DataBuffer& other);
+    ~DataBuffer();
+    DataBuffer& operator=(const DataBuffer& other);
+
+    bool is_empty() const;
+    const char* get_data() const;
+    size_t get_size() const;
+    int get_refcount() const;
+
+  private:
+
+    friend class FileTools;
+
+    /**
+     * @brief The bytes shared by all copies of a data buffer.
+     */
+    struct Content {
+      const char* data;           /**< the bytes */
+      size_t size;                /**< number of bytes */
+      bool mapped;                /**< true if the bytes are a memory-mapped file,
+                                   * false if they were allocated with new[] */
+      int refcount;               /**< number of data buffers sharing these bytes */
+    };
+
+    Content* content;             /**< the shared bytes, or NULL for an empty buffer */
+
+    DataBuffer(char* data, size_t size);
+    static DataBuffer map_file(const std::string& path);
+    void release();
+};
+
+#endif
+
@@ -18,21 +18,69 @@
 #define SOLARUS_DEBUG_H
 
 #include "Common.h"
+#include "lowlevel/StringConcat.h"
 #include <stdexcept>
 #include <iostream>
 #include <fstream>
 #include <string>
 
-#ifndef NDEBUG
-#define SOLARUS_ASSERT(condition, message) Debug::check_assertion(condition, message)
+/**
+ * @brief Levels of runtime verifications, selected at compile time
+ * with SOLARUS_ASSERTION_LEVEL (the ASSERTION_LEVEL CMake option).
+ *
+ * - SOLARUS_ASSERTIONS_OFF: no verification, conditions are not evaluated.
+ * - SOLARUS_ASSERTIONS_CHEAP: SOLARUS_ASSERT() is checked (default).
+ * - SOLARUS_ASSERTIONS_PARANOID: SOLARUS_ASSERT_PARANOID() is also checked.
+ */
+#define SOLARUS_ASSERTIONS_OFF 0
+#define SOLARUS_ASSERTIONS_CHEAP 1
+#define SOLARUS_ASSERTIONS_PARANOID 2
+
+#ifndef SOLARUS_ASSERTION_LEVEL
+#define SOLARUS_ASSERTION_LEVEL SOLARUS_ASSERTIONS_CHEAP
+#endif
+
+/**
+ * @brief Stops the program with an error message if a condition is false.
+ *
+ * The message is a sequence of elements separated by <<, like
+ * SOLARUS_ASSERT(x >= 0, "Invalid x: " << x). It is only built
+ * if the condition is false, so this can be used in code called
+ * at each cycle.
+ */
+#define SOLARUS_CHECK(condition, message) \
+  do { \
+    if (!(condition)) { \
+      Debug::die(StringConcat() << message); \
+    } \
+  } while (false)
+
+/**
+ * @brief Does not evaluate a condition or a message.
+ */
+#define SOLARUS_NO_CHECK(condition, message) \
+  do { \
+    (void) sizeof(condition); \
+  } while (false)
+
+#if SOLARUS_ASSERTION_LEVEL >= SOLARUS_ASSERTIONS_CHEAP
+#define SOLARUS_ASSERT(condition, message) SOLARUS_CHECK(condition, message)
 #else
-#define SOLARUS_ASSERT(condition, message)
+#define SOLARUS_ASSERT(condition, message) SOLARUS_NO_CHECK(condition, message)
+#endif
+
+#if SOLARUS_ASSERTION_LEVEL >= SOLARUS_ASSERTIONS_PARANOID
+#define SOLARUS_ASSERT_PARANOID(condition, message) SOLARUS_CHECK(condition, message)
+#else
+#define SOLARUS_ASSERT_PARANOID(condition, message) SOLARUS_NO_CHECK(condition, message)
 #endif
 
 /**
  * @brief Provides functionalities for printing debug messages or making
  * runtime verifications, especially when the code is compiled in debugging
  * mode.
+ *
+ * Assertions are made with SOLARUS_ASSERT() and SOLARUS_ASSERT_PARANOID().
  */
 class Debug {
 
@@ -43,7 +91,6 @@ class Debug {
   public:
 
     static void print(const std::string& message, std::ostream& os = std::cout);
-    static void check_assertion(bool assertion, const std::string& error_message = "");
     static void die(const std::string& error_message = "");
 };
 
@@ -64,29 +111,13 @@ inline void Debug::print(const std::string& message, std::ostream& os) {
 }
 
 /**
- * @brief Throws an exception if the specified assertion fails.
+ * @brief Throws an exception to stop the program.
  *
- * If the assertion fails, an std::logic_error with the specified error message is thrown.
+ * This function is equivalent to a failed SOLARUS_ASSERT().
  * The error message is saved in error.txt.
  * This function should be used to detect fatal errors only, that is,
  * errors in your code or in the quest (the data files) that require to stop the program.
  *
- * @param assertion the boolean condition to check
- * @param error_message the error message to attach to the exception when the assertion fails
- */
-inline void Debug::check_assertion(bool assertion, const std::string& error_message) {
-
-  if (!assertion) {
-    die(error_message);
-  }
-}
-
-/**
- * @brief Throws an exception to stop the program.
- *
- * This function is equivalent to assert(false, error_message).
- * The error message is saved in error.txt.
- *
  * @param error_message the error message to attach to the exception
  */
 inline void Debug::die(const std::string& error_message) {
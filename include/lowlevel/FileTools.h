@@ -18,8 +18,11 @@
 #define SOLARUS_FILE_TOOLS_H
 
 #include "Common.h"
+#include "lowlevel/DataBuffer.h"
 #include <string>
 #include <map>
+#include <vector>
+#include <iosfwd>
 
 struct lua_State;
 
@@ -32,6 +35,21 @@ struct lua_State;
  * (including the language-specific ones)
  * and is the only one that calls the PHYSFS library to get data files from
  * the data archive when necessary.
+ *
+ * The content of a data file is returned as a DataBuffer, shared without
+ * copies. When the quest is a directory, data files are memory-mapped.
+ * When the quest is an archive, the decompressed content of the small
+ * files is kept in a cache up to a maximum number of bytes, so that
+ * files loaded again (sprites, images, sounds...) are not decompressed
+ * again. Text data files are parsed in place by data_file_open().
+ *
+ * Lua data files (maps, tilesets, dialogs, scripts...) are loaded through
+ * a cache of compiled Lua chunks. A compiled chunk is stored in a
+ * "bytecode" directory, with the same path as its source file, together
+ * with the size and the hash of the source. It can be packaged with the
+ * quest data (see precompile_lua_files()) or stored in the quest write
+ * directory the first time the source is compiled. It is only used if
+ * the source has not changed since then; otherwise the source is compiled.
  */
 class FileTools {
 
@@ -46,12 +64,30 @@ class FileTools {
     static std::istream& data_file_open(const std::string& file_name,
         bool language_specific = false);
     static void data_file_close(const std::istream& data_file);
-    static void data_file_open_buffer(const std::string& file_name,
-        char** buffer, size_t* size, bool language_specific = false);
+    static DataBuffer data_file_read(const std::string& file_name,
+        bool language_specific = false);
+    static DataBuffer data_file_read_uncached(const std::string& file_name);
     static void data_file_save_buffer(const std::string& file_name,
         const char* buffer, size_t size);
-    static void data_file_close_buffer(char* buffer);
+    static void data_file_save_cache(const std::string& file_name,
+        const char* data, size_t size);
     static void data_file_delete(const std::string& file_name);
+    static int data_file_load_lua(lua_State* l, const std::string& file_name,
+        bool language_specific = false);
+    static uint32_t get_hash(const char* data, size_t size);
+
+    static uint64_t get_nb_bytes_read();
+    static uint64_t get_nb_bytes_copied();
+
+    // Writing data files of the quest (only for tools).
+    static std::string start_writing_quest_data();
+    static void stop_writing_quest_data();
+
+    // Compiled Lua chunks.
+    static void precompile_lua_files(std::ostream& report);
+    static int get_nb_bytecode_hits();
+    static int get_nb_bytecode_misses();
+    static uint64_t get_lua_load_time();
 
     static void read(std::istream& is, int& value);
     static void read(std::istream& is, uint32_t& value);
@@ -73,16 +109,48 @@ class FileTools {
 
   private:
 
+    static const size_t archive_cache_max_size = 8 * 1024 * 1024; /**< Maximum number of bytes of files kept in archive_cache. */
+
+    /**
+     * @brief Content of a data file that could not be memory-mapped.
+     */
+    struct CachedFile {
+      DataBuffer buffer;                                 /**< Content of the file. */
+      uint32_t last_used;                                /**< Value of archive_cache_counter when this file was last read. */
+    };
+
     static std::string get_base_write_dir();
+    static void add_cached_file(const std::string& file_name, const DataBuffer& buffer);
+    static void remove_cached_file(const std::string& file_name);
+
     static void initialize_languages();
     static int l_language(lua_State* l);
 
+    static bool load_bytecode(lua_State* l, const std::string& bytecode_file_name,
+        const std::string& chunk_name, const char* source, size_t source_size);
+    static void dump_bytecode(lua_State* l, const char* source, size_t source_size,
+        std::string& bytecode);
+    static int bytecode_writer(lua_State* l, const void* data, size_t size, void* bytecode);
+    static void get_lua_source_files(const std::string& dir_name, const std::string& real_dir,
+        std::vector<std::string>& file_names);
+
     static std::string solarus_write_dir;                /**< Directory where the engine can write files, relative to the user's home. */
     static std::string quest_write_dir;                  /**< Write directory of the current quest, relative to solarus_write_dir. */
 
     static std::map<std::string, std::string> languages; /**< The languages available (code -> language name). */
     static std::string language_code;                    /**< Code of the current language (e.g. "en", "fr", etc.). */
     static std::string default_language_code;            /**< Code of the default language. */
+
+    static const std::string bytecode_dir;               /**< Directory of compiled Lua chunks, relative to the quest data directory or to the quest write directory. */
+    static int nb_bytecode_hits;                         /**< Number of Lua data files loaded from a compiled chunk. */
+    static int nb_bytecode_misses;                       /**< Number of Lua data files compiled from their source. */
+    static uint64_t lua_load_time;                       /**< Time spent loading Lua data files in microseconds. */
+
+    static std::map<std::string, CachedFile> archive_cache; /**< Data files read from the archive, by file name. */
+    static size_t archive_cache_size;                    /**< Total number of bytes in archive_cache. */
+    static uint32_t archive_cache_counter;               /**< Incremented each time a cached file is read. */
+    static uint64_t nb_bytes_read;                       /**< Number of bytes of data files returned. */
+    static uint64_t nb_bytes_copied;                     /**< Number of bytes of data files copied into memory. */
 };
 
 #endif
@@ -179,12 +179,29 @@ class InputEvent {
 
   private:
 
+    static const int event_queue_capacity = 256;  /**< maximum number of events polled and not handled yet */
+    static const int max_joypad_axes = 16;        /**< number of joypad axes whose state is remembered */
+    static const int max_joypad_hats = 8;         /**< number of joypad hats whose state is remembered */
+
     static const KeyboardKey directional_keys[];  /**< array of the keyboard directional keys */
     static SDL_Joystick *joystick;                /**< the joystick object if enabled */
     SDL_Event internal_event;                     /**< the internal event encapsulated */
     static std::map<KeyboardKey, std::string>
       keyboard_key_names;                         /**< Names of all existing keyboard keys. */
 
+    static InputEvent event_queue[event_queue_capacity];  /**< ring buffer of the events polled and not handled yet */
+    static int event_queue_first;                 /**< index of the first event of the ring buffer */
+    static int event_queue_size;                  /**< number of events in the ring buffer */
+    static int joypad_axis_states[max_joypad_axes];  /**< last state of each axis put in the queue (-1, 0 or 1) */
+    static int joypad_hat_values[max_joypad_hats];   /**< last value of each hat put in the queue */
+
+    static uint64_t first_pending_input_date;     /**< date (in microseconds) when the first input not presented
+                                                   * yet was polled, or 0 */
+    static int nb_inputs_presented;               /**< number of frames presented after some input */
+    static uint64_t total_input_latency;          /**< sum of the input-to-present latencies in microseconds */
+    static uint64_t max_input_latency;            /**< highest input-to-present latency in microseconds */
+    static int nb_events_coalesced;               /**< number of redundant events dropped */
+
   public:
 
     static void initialize();
@@ -192,14 +209,25 @@ class InputEvent {
 
   private:
 
+    InputEvent();
     InputEvent(const SDL_Event &event);
 
+    static bool is_redundant(const SDL_Event& event);
+
   public:
 
     ~InputEvent();
 
-    // retrieve the current event
-    static InputEvent* get_event();
+    // retrieve the current events
+    static void poll_events();
+    static InputEvent* get_next_event();
+
+    // latency
+    static void notify_frame_presented();
+    static int get_nb_inputs_presented();
+    static uint64_t get_total_input_latency();
+    static uint64_t get_max_input_latency();
+    static int get_nb_events_coalesced();
 
     // global information
     static void set_key_repeat(int delay, int interval);
@@ -37,7 +37,7 @@ class ItDecoder {
     ItDecoder();
     ~ItDecoder();
 
-    void load(void* sound_data, size_t sound_size);
+    void load(const void* sound_data, size_t sound_size);
     void unload();
     void decode(void* decoded_data, int nb_samples);
 };
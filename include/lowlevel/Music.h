@@ -19,6 +19,7 @@
 
 #include "Common.h"
 #include "lowlevel/Sound.h"
+#include <SDL.h>
 
 /**
  * @brief Represents a music that can be played.
@@ -29,6 +30,12 @@
  * Before using this class, the audio system should have been
  * initialized, by calling Sound::initialize().
  * Sound and Music are the only classes that depends on audio libraries.
+ *
+ * The current music is decoded by a separate thread into a ring of
+ * preallocated PCM blocks. The main thread only copies the blocks ready
+ * into the OpenAL buffers already played. The thread owns the write index
+ * and the main thread the read index; two semaphores count the free and
+ * ready blocks, so that no lock is held while decoding or copying.
  */
 class Music { // TODO make a subclass for each format, or at least make a better separation between them
 
@@ -54,6 +61,35 @@ class Music { // TODO make a subclass for each format, or at least make a better
     static const int nb_buffers = 8;
     ALuint buffers[nb_buffers];                  /**< multiple buffers used to stream the music */
     ALuint source;                               /**< the OpenAL source streaming the buffers */
+    ALuint idle_buffers[nb_buffers];             /**< buffers played and waiting for decoded data */
+    int nb_idle_buffers;                         /**< number of elements in idle_buffers */
+
+    static const int nb_samples_per_block = 4096;  /**< number of samples decoded at a time */
+    static const int nb_pcm_blocks = 16;         /**< number of blocks in the ring of decoded data */
+
+    /**
+     * @brief A block of decoded music ready to be played.
+     */
+    struct PcmBlock {
+      int16_t data[nb_samples_per_block * 2];    /**< the PCM data (up to two channels) */
+      ALsizei size;                              /**< size of the PCM data in bytes */
+      ALenum format;                             /**< OpenAL format of the PCM data */
+      ALsizei sample_rate;                       /**< sample rate of the PCM data */
+      uint32_t decoding_time;                    /**< time spent decoding this block in microseconds */
+    };
+
+    static PcmBlock* pcm_blocks;                 /**< ring of decoded blocks (preallocated) */
+    static int next_block_written;               /**< next block to decode (only used by the thread) */
+    static int next_block_read;                  /**< next block to play (only used by the main thread) */
+    static SDL_sem* free_blocks;                 /**< number of blocks that the thread can decode */
+    static SDL_sem* ready_blocks;                /**< number of blocks that the main thread can play */
+    static SDL_Thread* decoding_thread;          /**< the thread decoding the current music, or NULL */
+    static volatile bool decoding_stopping;      /**< tells the thread to stop */
+
+    static int nb_blocks_played;                 /**< number of decoded blocks given to OpenAL */
+    static uint64_t total_decoding_time;         /**< sum of the decoding time of these blocks in microseconds */
+    static uint32_t max_decoding_time;           /**< highest decoding time of a block in microseconds */
+    static int nb_underruns;                     /**< number of times the source played all its buffers */
 
     static SpcDecoder *spc_decoder;              /**< the SPC decoder */
     static ItDecoder *it_decoder;                /**< the IT decoder */
@@ -63,6 +99,12 @@ class Music { // TODO make a subclass for each format, or at least make a better
     static std::map<std::string, Music> all_musics;   /**< all musics created before */
 
     void update_playing();
+    void start_decoding_thread();
+    void stop_decoding_thread();
+    static int decode_blocks(void* music);
+    void decode_spc(PcmBlock& block, int nb_samples);
+    void decode_it(PcmBlock& block, int nb_samples);
+    void decode_ogg(PcmBlock& block, int nb_samples);
 
   public:
 
@@ -89,9 +131,10 @@ class Music { // TODO make a subclass for each format, or at least make a better
     bool is_paused();
     void set_paused(bool pause);
 
-    void decode_spc(ALuint destination_buffer, ALsizei nb_samples);
-    void decode_it(ALuint destination_buffer, ALsizei nb_samples);
-    void decode_ogg(ALuint destination_buffer, ALsizei nb_samples);
+    static int get_nb_blocks_played();
+    static uint64_t get_total_decoding_time();
+    static uint32_t get_max_decoding_time();
+    static int get_nb_underruns();
 };
 
 #endif
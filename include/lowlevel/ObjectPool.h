@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_OBJECT_POOL_H
+#define SOLARUS_OBJECT_POOL_H
+
+#include "Common.h"
+#include <cstddef>
+
+/**
+ * @brief Recycles the memory of small objects created and destroyed often.
+ *
+ * Map entities and movements allocate their memory here (see their
+ * operator new). Objects are grouped by size, rounded up to a multiple
+ * of 16 bytes. The memory of a destroyed object is kept in a free list
+ * of its size and given to the next object of the same size, so that
+ * entities spawned during the game (arrows, explosions, pickables...)
+ * and their movements do not go through the system allocator.
+ * New memory is taken from big chunks that are never released before
+ * the end of the program.
+ *
+ * Bigger objects use the global operator new.
+ * Only the main thread can create these objects.
+ */
+class ObjectPool {
+
+  public:
+
+    static void* allocate(size_t size);
+    static void release(void* memory, size_t size);
+
+    static int get_nb_allocations();
+    static int get_nb_reuses();
+    static size_t get_nb_bytes_reserved();
+
+  private:
+
+    ObjectPool();    // don't instantiate this class
+
+    static const size_t granularity = 16;              /**< object sizes are rounded up to a multiple of this */
+    static const size_t max_object_size = 1024;        /**< bigger objects are not pooled */
+    static const size_t chunk_size = 64 * 1024;        /**< size of each chunk of new memory */
+    static const int nb_free_lists = max_object_size / granularity;
+
+    /**
+     * @brief A block of memory in a free list.
+     */
+    struct FreeBlock {
+      FreeBlock* next;                                 /**< the next free block of the same size */
+    };
+
+    static FreeBlock* free_lists[nb_free_lists];       /**< free blocks of each size */
+    static char* chunk_position;                       /**< new memory not given yet in the current chunk */
+    static size_t chunk_remaining;                     /**< number of bytes after chunk_position */
+
+    static int nb_allocations;                         /**< number of objects allocated in the pool */
+    static int nb_reuses;                              /**< number of them that reused a free block */
+    static size_t nb_bytes_reserved;                   /**< total size of the chunks */
+};
+
+#endif
+
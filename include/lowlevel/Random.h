@@ -32,6 +32,7 @@ class Random {
 
     static void initialize();
     static void quit();
+    static void set_seed(unsigned int seed);
 
     static int get_number(unsigned int x);
     static int get_number(unsigned int x, unsigned int y);
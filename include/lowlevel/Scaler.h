@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_SCALER_H
+#define SOLARUS_SCALER_H
+
+#include "Common.h"
+#include <SDL.h>
+
+/**
+ * @brief Copies the logical screen onto the video surface, scaling it.
+ *
+ * All algorithms work on raw 32-bit pixels.
+ * When the source surface and the video surface have the same pixel format,
+ * source pixels are copied as is.
+ * Otherwise, the source is first converted into a scratch buffer with
+ * shifts and masks computed once from both formats, so that no SDL call
+ * is ever made per pixel.
+ *
+ * Stretching and Scale2x have SSE2 and AVX2 kernels, used when the compiler
+ * targets these instruction sets. Scale4x is Scale2x applied twice.
+ */
+class Scaler {
+
+  public:
+
+    /**
+     * @brief The scaling algorithms available.
+     */
+    enum Algorithm {
+      STRETCH,        /**< each pixel becomes a 2x2 square */
+      SCALE2X,        /**< Scale2x algorithm (double size) */
+      SCALE3X,        /**< Scale3x algorithm (triple size) */
+      SCALE4X         /**< Scale2x applied twice (quadruple size) */
+    };
+
+    Scaler();
+    ~Scaler();
+
+    void scale(Algorithm algorithm, SDL_Surface* src_surface,
+        SDL_Surface* dst_surface, int dst_x);
+
+  private:
+
+    /**
+     * @brief Converts raw pixels from a 32-bit format to another one.
+     *
+     * The shifts are computed once from both SDL pixel formats
+     * instead of calling SDL_GetRGBA() and SDL_MapRGBA() for each pixel.
+     */
+    struct FormatConverter {
+      uint32_t src_masks[4];       /**< R, G, B and A masks of the source format */
+      uint8_t src_shifts[4];       /**< R, G, B and A shifts of the source format */
+      uint8_t src_losses[4];       /**< R, G, B and A losses of the source format */
+      uint8_t dst_shifts[4];       /**< R, G, B and A shifts of the destination format */
+      uint8_t dst_losses[4];       /**< R, G, B and A losses of the destination format */
+      uint32_t dst_masks[4];       /**< R, G, B and A masks of the destination format */
+      uint32_t alpha_fill;         /**< bits to set when the source has no alpha channel */
+
+      void initialize(const SDL_PixelFormat* src_format,
+          const SDL_PixelFormat* dst_format);
+      void convert(const uint32_t* src, int src_pitch,
+          uint32_t* dst, int width, int height) const;
+    };
+
+    uint32_t* converted_pixels;    /**< scratch buffer receiving the source pixels
+                                    * in the destination format (NULL until needed) */
+    uint32_t* intermediate_pixels; /**< scratch buffer for the first pass of Scale4x */
+    int converted_size;            /**< number of pixels allocated in converted_pixels */
+    int intermediate_size;         /**< number of pixels allocated in intermediate_pixels */
+
+    SDL_PixelFormat last_src_format; /**< source format of the last conversion */
+    SDL_PixelFormat last_dst_format; /**< destination format of the last conversion */
+    bool formats_known;            /**< indicates that the two formats above are set */
+    bool formats_equivalent;       /**< true if source pixels can be copied as is */
+    FormatConverter converter;     /**< converter between the two formats above */
+
+    void update_formats(const SDL_PixelFormat* src_format,
+        const SDL_PixelFormat* dst_format);
+    static bool are_formats_equal(const SDL_PixelFormat* format1,
+        const SDL_PixelFormat* format2);
+    static uint32_t* reserve(uint32_t*& buffer, int& allocated, int size);
+
+    static void stretch(const uint32_t* src, int src_pitch, int width, int height,
+        uint32_t* dst, int dst_pitch);
+    static void scale2x(const uint32_t* src, int src_pitch, int width, int height,
+        uint32_t* dst, int dst_pitch);
+    static void scale3x(const uint32_t* src, int src_pitch, int width, int height,
+        uint32_t* dst, int dst_pitch);
+};
+
+#endif
+
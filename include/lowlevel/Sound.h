@@ -18,9 +18,12 @@
 #define SOLARUS_SOUND_H
 
 #include "Common.h"
+#include "lowlevel/DataBuffer.h"
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
+#include <SDL.h>
 #include <al.h>
 #include <alc.h>
 #include <vorbis/vorbisfile.h>
@@ -33,6 +36,21 @@
  * rather than calling directly the constructor of Sound.
  * This class is the only one that depends on the sound decoding library (libsndfile).
  * This class and the Music class are the only ones that depend on the audio mixer library (OpenAL).
+ *
+ * load_all() decodes the sounds of the quest with several threads: only
+ * the creation of the OpenAL buffers is done by the main thread.
+ * The decoded samples are also saved in the quest write directory,
+ * with the size and the hash of their source file, so that the next
+ * launches do not decode them again while the source is unchanged
+ * (unless the -no-sound-cache option is given).
+ * The -sound-timings option prints the time spent in each phase of load_all().
+ *
+ * Sounds are played by a fixed pool of OpenAL sources created with the
+ * audio system. The pool never takes the last source of the device,
+ * which is kept for the music. A sound plays at most max_voices_per_sound times at once,
+ * and playing a sound again during the same cycle has no effect.
+ * When all sources are busy, a new sound takes the source of the sound
+ * with the most voices, or the oldest source if they are equal.
  */
 class Sound {
 
@@ -43,16 +61,79 @@ class Sound {
 
     std::string id;                              /**< id of this sound */
     ALuint buffer;                               /**< the OpenAL buffer containing the PCM decoded data of this sound */
-    std::list<ALuint> sources;                   /**< the sources currently playing this sound */
-    static std::list<Sound*> current_sounds;     /**< the sounds currently playing */
+    int nb_voices;                               /**< number of sources currently playing this sound */
+    uint32_t last_start_cycle;                   /**< value of nb_cycles when this sound was last started */
     static std::map<std::string, Sound> all_sounds;   /**< all sounds created before */
 
+    static const unsigned int max_voices = 32;   /**< maximum number of sources of the pool */
+    static const int max_voices_per_sound = 4;   /**< maximum number of sources playing the same sound */
+    static const unsigned int nb_music_sources = 1;  /**< number of sources left free for the music */
+
+    /**
+     * @brief A source of the pool.
+     */
+    struct Voice {
+      ALuint source;                             /**< the OpenAL source */
+      Sound* sound;                              /**< the sound playing on this source, or NULL if it is free */
+      uint32_t start_cycle;                      /**< value of nb_cycles when the sound was started */
+    };
+
+    static std::vector<Voice> voices;            /**< the sources that play sounds */
+    static uint32_t nb_cycles;                   /**< number of calls to update() */
+    static int nb_active_voices;                 /**< number of sources currently playing a sound */
+    static int nb_voices_stolen;                 /**< number of sounds stopped to play another sound */
+    static int nb_plays_dropped;                 /**< number of sounds not played because they were
+                                                  * already started during the same cycle */
+
     static bool initialized;                     /**< indicates that the audio system is initialized */
     static bool sounds_preloaded;                /**< true if load_all() was called */
+    static bool pcm_cache_enabled;               /**< false if decoded sounds are not saved in the quest write directory */
+    static bool preload_timings_enabled;         /**< true to print the time spent in load_all() */
     static float volume;                         /**< the volume of sound effects (0.0 to 1.0) */
 
+    static const int nb_decoding_threads = 4;    /**< number of threads decoding sounds in load_all() */
+    static const std::string pcm_cache_dir;      /**< directory of decoded sounds, relative to the quest write directory */
+    static const std::string pcm_cache_extension; /**< extension of the decoded sound files */
+
+    /**
+     * @brief A sound decoded by a thread of load_all().
+     */
+    struct DecodedSound {
+      std::string id;                            /**< id of the sound */
+      std::string file_name;                     /**< name of the encoded sound file */
+      std::string cache_file_name;               /**< name of the decoded sound file in the write directory,
+                                                  * or an empty string if there is no cache */
+      std::vector<char> samples;                 /**< 16-bit stereo samples, empty if the sound could not be decoded */
+      ALsizei sample_rate;                       /**< sample rate of the samples */
+      uint32_t source_size;                      /**< size of the encoded sound file */
+      uint32_t source_hash;                      /**< hash of the encoded sound file */
+      bool from_cache;                           /**< true if the samples were read from the cache */
+    };
+
+    /**
+     * @brief The sounds shared by the threads of load_all().
+     */
+    struct DecodingQueue {
+      std::vector<DecodedSound>* sounds;         /**< the sounds to decode */
+      unsigned int next;                         /**< index of the next sound to decode */
+      SDL_mutex* mutex;                          /**< protects next */
+    };
+
     ALuint decode_file(const std::string &file_name);
-    bool update_playing();
+
+    static void create_voices();
+    static void destroy_voices();
+    static Voice& get_free_voice(Sound& sound);
+    static void stop_voice(Voice& voice);
+
+    static std::string get_file_name(const std::string& sound_id);
+    static bool decode_samples(const DataBuffer& source,
+        std::vector<char>& samples, ALsizei& sample_rate);
+    static ALuint create_buffer(const std::vector<char>& samples, ALsizei sample_rate);
+    static int decode_sounds(void* queue);
+    static void decode_sound(DecodedSound& sound);
+    static bool read_pcm_cache(DecodedSound& sound);
+    static void save_pcm_cache(const DecodedSound& sound);
 
   public:
 
@@ -62,8 +143,7 @@ class Sound {
      * @brief Buffer containing an encoded sound file.
      */
     struct SoundFromMemory {
-      char* data;               /**< the buffer */
-      size_t size;              /**< size of the buffer in bytes */
+      DataBuffer buffer;        /**< the encoded sound file */
       size_t position;          /**< current position in the buffer */
       bool loop;                /**< true to restart the sound when finished */
     };
@@ -88,6 +168,10 @@ class Sound {
 
     static int get_volume();
     static void set_volume(int volume);
+
+    static int get_nb_active_voices();
+    static int get_nb_voices_stolen();
+    static int get_nb_plays_dropped();
 };
 
 #endif
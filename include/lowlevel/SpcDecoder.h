@@ -44,7 +44,7 @@ class SpcDecoder {
     SpcDecoder();
     ~SpcDecoder();
 
-    void load(int16_t *sound_data, size_t sound_size);
+    void load(const int16_t *sound_data, size_t sound_size);
     void decode(int16_t *decoded_data, int nb_samples);
 };
 
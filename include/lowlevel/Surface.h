@@ -21,6 +21,9 @@
 #include "Drawable.h"
 #include "lowlevel/Rectangle.h"
 #include <SDL.h>
+#include <map>
+#include <list>
+#include <string>
 
 /**
  * @brief Represents a graphic surface.
@@ -28,6 +31,16 @@
  * A surface is a rectangle of pixels.
  * A surface can be drawn or blitted on another surface.
  * This class basically encapsulates a library-dependent surface object.
+ *
+ * Images loaded from files are decoded once and kept in a cache, converted
+ * to the pixel format of the other surfaces. Surfaces loaded from the same
+ * image (and copies of a surface) share their pixels until one of them is
+ * modified: it then gets its own copy of the pixels first.
+ * When the cache exceeds a maximum size, the images requested least recently
+ * are removed from it (surfaces still using them keep them).
+ *
+ * Images that will probably be needed soon can be decoded in advance by a
+ * separate thread (see prefetch_image()).
  */
 class Surface: public Drawable {
 
@@ -54,6 +67,10 @@ class Surface: public Drawable {
     Surface(const Surface& other);
     ~Surface();
 
+    static void quit();
+    static void prefetch_image(const std::string& file_name,
+        ImageDirectory base_directory = DIR_SPRITES);
+
     int get_width() const;
     int get_height() const;
     const Rectangle get_size() const;
@@ -70,6 +87,11 @@ class Surface: public Drawable {
 
     const std::string& get_lua_type_name() const;
 
+    static int get_nb_image_cache_hits();
+    static int get_nb_image_cache_misses();
+    static int get_nb_images_copied();
+    static int get_nb_images_prefetched();
+
   protected:
 
     // implementation from Drawable
@@ -78,11 +100,58 @@ class Surface: public Drawable {
 
   private:
 
-    SDL_Surface* internal_surface;               /**< the SDL_Surface encapsulated */
+    static const int image_cache_max_size = 32 * 1024 * 1024; /**< maximum number of bytes of images kept in the cache */
+    static const unsigned int max_prefetched_images = 8; /**< maximum number of images requested to the decoding thread */
+
+    /**
+     * @brief A decoded image in the cache.
+     */
+    struct CachedImage {
+      SDL_Surface* surface;                      /**< the image (the cache owns one reference) */
+      uint32_t last_used;                        /**< value of image_cache_counter when this image was last requested */
+    };
+
+    /**
+     * @brief An image requested to the decoding thread.
+     */
+    struct PrefetchedImage {
+      SDL_Surface* image;                        /**< the image decoded, or NULL */
+      bool decoded;                              /**< false until the decoding thread has finished */
+    };
+
+    SDL_Surface* internal_surface;               /**< the SDL_Surface encapsulated (its refcount tells
+                                                  * how many surfaces share it) */
     bool internal_surface_created;               /**< indicates that internal_surface was allocated from this class */
 
+    static std::map<std::string, CachedImage> image_cache; /**< decoded images, by file name and language */
+    static int image_cache_size;                 /**< number of bytes of the images in the cache */
+    static uint32_t image_cache_counter;         /**< incremented each time an image is requested */
+    static SDL_Surface* format_surface;          /**< a surface with the pixel format of images */
+    static int nb_image_cache_hits;              /**< number of images found in the cache */
+    static int nb_image_cache_misses;            /**< number of images decoded */
+    static int nb_images_copied;                 /**< number of shared pixels copied before a modification */
+
+    static std::map<std::string, PrefetchedImage> prefetched_images; /**< images requested to the decoding thread
+                                                  * and not collected yet, by name (only the main thread adds or
+                                                  * removes entries, values are protected by prefetch_mutex) */
+    static std::list<std::string> prefetch_requests; /**< images waiting to be decoded (protected by prefetch_mutex) */
+    static SDL_Thread* prefetch_thread;          /**< the thread that decodes images in advance, or NULL */
+    static SDL_mutex* prefetch_mutex;            /**< protects the data shared with the decoding thread */
+    static SDL_cond* prefetch_cond;              /**< signaled when an image is requested or decoded */
+    static bool prefetch_stopping;               /**< true to make the decoding thread finish */
+    static bool prefetch_decoding;               /**< true while the decoding thread decodes an image */
+    static int nb_images_prefetched;             /**< number of images decoded in advance */
+
     SDL_Surface* get_internal_surface();
-    uint32_t get_mapped_pixel(int idx_pixel, SDL_PixelFormat* dst_format);
+    void copy_if_shared();
+
+    static std::string get_image_key(const std::string& file_name, bool language_specific);
+    static SDL_Surface* get_image(const std::string& file_name, bool language_specific);
+    static SDL_Surface* convert_image(SDL_Surface* image);
+    static bool add_image(const std::string& key, SDL_Surface* image);
+    static void remove_oldest_image();
+    static void collect_prefetched_images(bool wait_all);
+    static int decode_prefetched_images(void* data);
 };
 
 #endif
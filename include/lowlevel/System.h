@@ -29,6 +29,7 @@ class System {
   private:
 
     static uint32_t ticks;
+    static uint32_t fixed_timestep;
 
   public:
 
@@ -38,6 +39,10 @@ class System {
 
     static uint32_t now();
     static void sleep(uint32_t duration);
+
+    static bool is_fixed_timestep();
+    static void set_fixed_timestep(uint32_t timestep);
+    static uint64_t get_real_time_us();
 };
 
 #endif
@@ -19,6 +19,7 @@
 
 #include "Common.h"
 #include "lowlevel/Rectangle.h"
+#include "lowlevel/Scaler.h"
 #include <list>
 
 /**
@@ -44,6 +45,10 @@ class VideoManager {
     FULLSCREEN_SCALE2X_WIDE,  /**< the game surface is scaled into a double-size surface with the Scale2x algorithm
                                * and then drawn on a widescreen resolution if possible
                                * with two black side bars */
+    WINDOWED_SCALE3X,         /**< the game surface is scaled into a triple-size window with the Scale3x algorithm */
+    WINDOWED_SCALE4X,         /**< the game surface is scaled into a quadruple-size window with the Scale4x algorithm */
+    FULLSCREEN_SCALE3X,       /**< the game surface is scaled into a triple-size screen with the Scale3x algorithm */
+    FULLSCREEN_SCALE4X,       /**< the game surface is scaled into a quadruple-size screen with the Scale4x algorithm */
     NB_MODES                  /**< number of existing video modes */
   };
 
@@ -62,17 +67,14 @@ class VideoManager {
   VideoMode video_mode;                             /**< current video mode of the screen */
   Surface* screen_surface;                          /**< the screen surface */
 
-  int width;                                        /**< width of the current screen surface */
   int offset;                                       /**< width of a side bar when using a widescreen resolution */
-  int end_row_increment;                            /**< increment used by the stretching and scaling functions
-                                                     * when changing the row */
+  Scaler scaler;                                    /**< scales the game surface in non-normal video modes */
 
   VideoManager(bool disable_window);
   ~VideoManager();
 
   void blit(Surface& src_surface, Surface& dst_surface);
-  void blit_stretched(Surface& src_surface, Surface& dst_surface);
-  void blit_scale2x(Surface& src_surface, Surface& dst_surface);
+  void blit_scaled(Scaler::Algorithm algorithm, Surface& src_surface, Surface& dst_surface);
 
  public:
 
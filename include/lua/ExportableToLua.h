@@ -50,6 +50,10 @@ class ExportableToLua {
     void increment_refcount();
     void decrement_refcount();
 
+    // Table of fields set by Lua.
+    LuaContext* get_lua_table_context() const;
+    void set_lua_table_context(LuaContext* lua_context);
+
     /**
      * @brief Returns the name identifying this type in Lua.
      * @return the name identifying this type in Lua
@@ -61,6 +65,9 @@ class ExportableToLua {
     int refcount;                /**< number of pointers to the object
                                   * including the Lua ones
                                   * (0 means that it can be deleted) */
+    LuaContext* lua_table_context;
+                                 /**< the Lua context where this object
+                                  * is used like a table, or NULL */
 };
 
 #endif
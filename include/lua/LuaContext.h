@@ -27,6 +27,7 @@
 #include <map>
 #include <set>
 #include <list>
+#include <vector>
 #include <lua.hpp>
 
 /**
@@ -99,6 +100,9 @@ class LuaContext {
     void run_item(EquipmentItem& item);
     void run_map(Map& map, Destination* destination);
     void run_enemy(Enemy& enemy);
+    void notify_userdata_destroyed(ExportableToLua& userdata);
+
+    static int get_nb_callbacks_skipped();
 
     // Lua helpers.
     static bool is_color(lua_State* l, int index);
@@ -416,6 +420,7 @@ class LuaContext {
 
       // Sprite API.
       sprite_api_create,
+      sprite_api_get_animation_id,
       sprite_api_get_animation,
       sprite_api_set_animation,
       sprite_api_get_direction,
@@ -735,6 +740,21 @@ class LuaContext {
 
   private:
 
+    /**
+     * @brief Methods called very often that a userdata may define.
+     *
+     * For userdata that can be used like tables, LuaContext remembers which
+     * of these methods they define, so that calling them costs nothing
+     * when they are not defined.
+     */
+    enum FrequentCallback {
+      CALLBACK_ON_UPDATE           = 0x01,  /**< on_update() */
+      CALLBACK_ON_PRE_DRAW         = 0x02,  /**< on_pre_draw() */
+      CALLBACK_ON_DRAW             = 0x04,  /**< on_draw() */
+      CALLBACK_ON_POST_DRAW        = 0x08,  /**< on_post_draw() */
+      CALLBACK_ON_POSITION_CHANGED = 0x10   /**< on_position_changed() */
+    };
+
     /**
      * @brief Data associated to any Lua menu.
      */
@@ -754,8 +774,36 @@ class LuaContext {
     struct LuaTimerData {
       int callback_ref;     /**< Lua ref of the function to call after the timer. */
       const void* context;  /**< Lua table or userdata the timer is attached to. */
+      uint32_t stamp;       /**< Stamp of the valid entry of the timer in the
+                             * schedule, or 0 if it is not scheduled. */
+    };
+
+    /**
+     * @brief Date when a timer has to be updated.
+     *
+     * When a timer is rescheduled, its old entry stays in the heap and
+     * is ignored because its stamp does not match the timer's anymore.
+     */
+    struct TimerScheduleEntry {
+      uint32_t date;        /**< Date when the timer has to be updated. */
+      uint32_t stamp;       /**< Unique number of this entry, increasing
+                             * with the order of scheduling. */
+      Timer* timer;         /**< The timer (may be deleted if the entry is
+                             * not valid anymore). */
     };
 
+    // Scheduling timers.
+    void schedule_timer(Timer* timer);
+    static bool is_timer_entry_after(const TimerScheduleEntry& entry1,
+        const TimerScheduleEntry& entry2);
+
+    // Callbacks defined by userdata.
+    static int get_frequent_callback(const char* key);
+    void set_userdata_callback(const ExportableToLua& userdata,
+        FrequentCallback callback, bool defined);
+    bool userdata_has_callback(const ExportableToLua& userdata,
+        FrequentCallback callback);
+
     // Executing Lua code.
     bool find_global_function(const std::string& function_name);
     bool find_local_function(int index, const std::string& function_name);
@@ -966,10 +1014,23 @@ class LuaContext {
     std::map<Timer*, LuaTimerData>
         timers;                     /**< The timers currently running, with
                                      * their context and callback. */
+    std::vector<TimerScheduleEntry>
+        timer_schedule;             /**< Heap of the next update date of each
+                                     * timer not suspended, earliest first. */
+    uint32_t next_timer_stamp;      /**< Stamp of the next timer schedule entry. */
 
     std::set<Drawable*> drawables;  /**< All drawable objects created by
                                      * this script. */
 
+    std::map<const ExportableToLua*, int>
+        userdata_callbacks;         /**< Frequent callbacks defined by each
+                                     * userdata used like a table. An entry
+                                     * exists as long as the object has a
+                                     * table, i.e. until it is destroyed. */
+    static int nb_callbacks_skipped;  /**< Number of calls to frequent
+                                     * callbacks avoided because they were
+                                     * not defined. */
+
     static const std::string enemy_attack_names[];
     static const std::string enemy_hurt_style_names[];
     static const std::string enemy_obstacle_behavior_names[];
@@ -999,7 +1060,7 @@ template<typename E>
 E LuaContext::check_enum(
     lua_State* l, int index, const std::string names[]) {
 
-  Debug::check_assertion(!names[0].empty(), "Invalid list of names");
+  SOLARUS_ASSERT(!names[0].empty(), "Invalid list of names");
 
   const std::string& name = luaL_checkstring(l, index);
   for (int i = 0; !names[i].empty(); ++i) {
@@ -71,6 +71,9 @@ class Movement: public ExportableToLua {
 
   public:
 
+    static void* operator new(size_t size);
+    static void operator delete(void* memory, size_t size);
+
     virtual ~Movement();
     int get_unique_id();
 
@@ -19,8 +19,7 @@
 
 #include "Common.h"
 #include "lowlevel/Rectangle.h"
-#include <list>
-#include <map>
+#include <vector>
 
 /**
  * @brief Implementation of the A* algorithm to compute a path.
@@ -28,6 +27,13 @@
  * In the current implementation, the computed path always corresponds to a
  * shape of 16*16. If the entity to move is bigger, some obstacles may prevent
  * it from following the computed path.
+ *
+ * Nodes are stored in a flat array with one element per 8*8 square of the
+ * map, and the open list is a binary heap of node indices.
+ * The array and the heap are shared by all searches and are only allocated
+ * again when a bigger map is used: instead of clearing them, each search
+ * has a new generation number and nodes from older generations are
+ * considered as never visited.
  */
 class PathFinding {
 
@@ -39,47 +45,61 @@ class PathFinding {
      * A node is the location of a 16*16 square of the map.
      * The algorithm tries to find the best sequence of nodes leading to the target.
      */
-    class Node {
-
-     public:
+    struct Node {
 
-      Rectangle location; /**< location of this node on the map */
-      int index;          /**< index of this node's square on the map (depends on the location) */
+      uint32_t generation; /**< the search that last visited this node */
 
       // total_cost = previous_cost + heuristic
-      int previous_cost;  /**< cost of the best path that leads to this node */
-      int heuristic;      /**< estimation of the remaining cost to the target */
-      int total_cost;     /**< total cost of this node */
+      int previous_cost;   /**< cost of the best path that leads to this node */
+      int heuristic;       /**< estimation of the remaining cost to the target */
+      int total_cost;      /**< total cost of this node */
 
-      int parent_index;   /**< index of the square containing the best node leading to this node */
-      char direction;     /**< direction from the parent node to this node (0 to 7) */
-
-      bool operator<(const Node &other);
+      int parent_index;    /**< index of the square containing the best node leading to this node */
+      int heap_position;   /**< position of this node in the open heap, or -1 if it is in the closed list */
+      char direction;      /**< direction from the parent node to this node ('0' to '7', ' ' for the start) */
     };
 
-    static const Rectangle neighbours_locations[];
-    static const Rectangle transition_collision_boxes[];
+    static std::vector<Node> nodes;     /**< all nodes, indexed by the 8*8 squares of the map */
+    static std::vector<int> open_heap;  /**< indices of the nodes of the open list, as a binary heap */
+    static uint32_t generation;         /**< generation of the current search */
+
+    static int nb_searches;             /**< number of paths computed so far */
+    static int nb_nodes_explored;       /**< number of nodes moved to the closed list so far */
+    static uint64_t search_time;        /**< time spent computing paths so far, in microseconds */
 
     Map &map;					/**< the map */
     MapEntity &source_entity;			/**< the entity to move */
     MapEntity &target_entity;			/**< the target point */
-
-    std::map<int,Node> closed_list;		/**< the closed list, indexed by the node locations on the map */
-    std::map<int,Node> open_list;		/**< the open list, indexed by the node locations on the map */
-    std::list<int> open_list_indices;		/**< indices of the open list elements, sorted by priority */
+    int width8;                                 /**< number of 8*8 squares on a row of the map */
+    int height8;                                /**< number of 8*8 squares on a column of the map */
 
     int get_square_index(const Rectangle &location);
+    const Rectangle get_square_location(int index);
     int get_manhattan_distance(const Rectangle &point1, const Rectangle &point2);
-    bool is_node_transition_valid(const Node &node, int direction);
-    void add_index_sorted(Node *node);
-    std::string rebuild_path(const Node *final_node);
+    bool is_node_transition_valid(const Rectangle &location, int direction);
+    std::string rebuild_path(int final_index);
+
+    void start_generation();
+    bool is_before(int index1, int index2);
+    void push_open_node(int index);
+    int pop_open_node();
+    void move_up(int position);
+    void move_down(int position);
+    void set_heap_element(int position, int index);
 
   public:
 
+    static const Rectangle neighbours_locations[];       /**< location of each neighbour of a node */
+    static const Rectangle transition_collision_boxes[]; /**< area to test when going to each neighbour of a node */
+
     PathFinding(Map &map, MapEntity &source_entity, MapEntity &target_entity);
     ~PathFinding();
 
     std::string compute_path();
+
+    static int get_nb_searches();
+    static int get_nb_nodes_explored();
+    static uint64_t get_search_time();
 };
 
 #endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PATH_FINDING_SERVICE_H
+#define SOLARUS_PATH_FINDING_SERVICE_H
+
+#include "Common.h"
+#include "entities/Layer.h"
+#include "entities/EntityType.h"
+#include "entities/Obstacle.h"
+#include "lowlevel/Rectangle.h"
+#include <vector>
+#include <map>
+
+/**
+ * @brief Computes the paths of all path-finding movements of a map.
+ *
+ * Nodes are the same as in PathFinding: 16*16 squares aligned on the 8*8
+ * grid of the map, with the same transitions and the same costs.
+ *
+ * Two structures make the paths cheap when many entities chase the hero:
+ * - A region graph, computed once per layer and per kind of ground
+ *   obstacles. The map is divided into sectors of 8*8 nodes, each sector
+ *   into regions of nodes connected by tile transitions, and regions are
+ *   linked when a transition crosses a sector border. Regions that cannot
+ *   reach each other are known in advance, so no search is done at all
+ *   when the target is in another part of the map.
+ * - Flow fields toward the hero. A flow field is a Dijkstra search started
+ *   from the hero's node, that gives to each node the direction to take.
+ *   It is extended only as far as the entities asking for a path, and
+ *   shared by all enemies with the same ground obstacles on the same layer
+ *   (enemies are never obstacles for each other), until the hero reaches
+ *   another node, an obstacle entity changes or the field gets too old.
+ *   Other kinds of entities each have their own field.
+ *
+ * Paths toward other targets are computed with PathFinding, after checking
+ * the region graph.
+ */
+class PathFindingService {
+
+  public:
+
+    PathFindingService(Map& map);
+    ~PathFindingService();
+
+    std::string compute_path(MapEntity& source_entity, MapEntity& target_entity);
+    void notify_obstacles_changed();
+
+    static int get_nb_requests();
+    static int get_nb_fields_built();
+    static int get_nb_nodes_settled();
+    static int get_nb_unreachable();
+    static uint64_t get_total_time();
+
+  private:
+
+    static const int max_distance = 640;     /**< maximum Manhattan distance between the source and the hero */
+    static const int max_cost = 1280;        /**< nodes more costly than this are not added to flow fields */
+    static const uint32_t max_field_age = 500; /**< a flow field older than this (in milliseconds) is rebuilt */
+    static const int nb_fields = 4;          /**< number of flow fields kept at the same time */
+    static const int sector_size = 8;        /**< width and height of a sector, in nodes */
+
+    /**
+     * @brief The static obstacles of the map for a layer and a kind of ground obstacles.
+     *
+     * Only nodes that overlap no obstacle tile belong to a region.
+     */
+    struct RegionGraph {
+      std::vector<uint8_t> blocked_squares;  /**< for each 8*8 square, whether its tile is an obstacle */
+      std::vector<int> node_regions;         /**< for each node, its region or -1 if it overlaps an obstacle tile */
+      std::vector<int> region_islands;       /**< for each region, the group of regions connected to it */
+    };
+
+    /**
+     * @brief A node of a flow field.
+     */
+    struct FieldNode {
+      uint32_t generation;                   /**< the flow field that last visited this node */
+      int cost;                              /**< cost of the best known path from this node to the target */
+      int heap_position;                     /**< position in the open heap, or -1 if the cost is final */
+      char direction;                        /**< direction to take from this node (0 to 7), -1 for the target */
+    };
+
+    /**
+     * @brief Directions toward a target, shared by several entities.
+     */
+    struct FlowField {
+      bool valid;                            /**< false if this flow field cannot be used anymore */
+      MapEntity* target;                     /**< the target entity (never dereferenced) */
+      MapEntity* source;                     /**< the only entity using this field, or NULL if enemies share it */
+      int target_index;                      /**< node of the target */
+      Layer layer;                           /**< layer of the entities using this field */
+      EntityType entity_type;                /**< type of the entities using this field */
+      int ground_obstacles;                  /**< ground obstacles of the entities using this field */
+      uint32_t date;                         /**< date when this field was started */
+      uint32_t last_used;                    /**< date when this field was last used */
+      uint32_t generation;                   /**< generation of the nodes of this field */
+      std::vector<FieldNode> nodes;          /**< nodes of the field, indexed like the map squares */
+      std::vector<int> open_heap;            /**< nodes whose cost is not final yet, as a binary heap */
+    };
+
+    Map& map;                                /**< the map */
+    int width8;                              /**< number of 8*8 squares on a row of the map */
+    int height8;                             /**< number of 8*8 squares on a column of the map */
+    std::map<int, RegionGraph*> region_graphs; /**< region graphs already computed, by layer and ground obstacles */
+    FlowField fields[nb_fields];             /**< flow fields toward the hero */
+
+    static int nb_requests;                  /**< number of paths requested */
+    static int nb_fields_built;              /**< number of flow fields started */
+    static int nb_nodes_settled;             /**< number of nodes whose cost was made final */
+    static int nb_unreachable;               /**< number of requests rejected by a region graph */
+    static uint64_t total_time;              /**< time spent computing paths in microseconds */
+
+    static int get_ground_obstacles(MapEntity& entity);
+    static bool is_ground_obstacle(Obstacle obstacle, int ground_obstacles);
+    RegionGraph& get_region_graph(Layer layer, MapEntity& entity);
+    void build_region_graph(RegionGraph& graph, Layer layer, int ground_obstacles);
+    bool is_square_blocked(const RegionGraph& graph, int x8, int y8);
+    bool is_static_transition_valid(const RegionGraph& graph, int index, int direction);
+    bool is_transition_valid(const RegionGraph& graph, int index, int direction,
+        MapEntity& entity);
+    bool get_neighbour(int index, int direction, int& neighbour_index);
+    bool are_connected(const RegionGraph& graph, int source_index, int target_index);
+
+    FlowField& get_flow_field(MapEntity& source_entity, MapEntity& target_entity, int target_index);
+    void start_flow_field(FlowField& field, int target_index);
+    bool extend_flow_field(FlowField& field, const RegionGraph& graph, int index,
+        MapEntity& entity);
+    std::string get_flow_field_path(FlowField& field, int index);
+    static bool is_before(const FlowField& field, int index1, int index2);
+    static void push_open_node(FlowField& field, int index);
+    static int pop_open_node(FlowField& field);
+    static void move_up(FlowField& field, int position);
+    static void move_down(FlowField& field, int position);
+    static void set_heap_element(FlowField& field, int position, int index);
+};
+
+#endif
+
@@ -0,0 +1,507 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "Benchmark.h"
+#include "MapLoader.h"
+#include "movements/PathFinding.h"
+#include "movements/PathFindingService.h"
+#include "entities/NonAnimatedTilesCache.h"
+#include "entities/MapEntities.h"
+#include "entities/Tileset.h"
+#include "lowlevel/Music.h"
+#include "lowlevel/FileTools.h"
+#include "lowlevel/ObjectPool.h"
+#include "lowlevel/Surface.h"
+#include "lua/LuaContext.h"
+#include "lowlevel/Debug.h"
+#include "lowlevel/StringConcat.h"
+#include <SDL.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef SOLARUS_COUNT_ALLOCATIONS
+
+#if defined(_WIN32)
+#  define NOMINMAX
+#  include <windows.h>
+#endif
+
+#if __cplusplus >= 201103L
+#  define SOLARUS_THROW_BAD_ALLOC
+#else
+#  define SOLARUS_THROW_BAD_ALLOC throw(std::bad_alloc)
+#endif
+
+/**
+ * @brief Number of memory allocations made with operator new since the
+ * beginning of the program.
+ *
+ * Several threads allocate memory: this counter is only accessed through
+ * add_allocations().
+ */
+#if defined(_WIN32)
+static volatile LONG nb_allocations = 0;
+#else
+static volatile uint32_t nb_allocations = 0;
+#endif
+
+/**
+ * @brief Atomically adds a value to the number of memory allocations.
+ * @param value the value to add (0 to only read the counter)
+ * @return the new number of allocations
+ */
+static uint32_t add_allocations(uint32_t value) {
+
+#if defined(_WIN32)
+  return uint32_t(InterlockedExchangeAdd(&nb_allocations, LONG(value)) + LONG(value));
+#else
+  return __sync_add_and_fetch(&nb_allocations, value);
+#endif
+}
+
+/**
+ * @brief Allocates memory and counts the allocation.
+ * @param size number of bytes to allocate
+ * @return the memory allocated
+ */
+void* operator new(std::size_t size) SOLARUS_THROW_BAD_ALLOC {
+
+  add_allocations(1);
+  void* memory = std::malloc(size == 0 ? 1 : size);
+  if (memory == NULL) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+/**
+ * @brief Allocates memory for an array and counts the allocation.
+ * @param size number of bytes to allocate
+ * @return the memory allocated
+ */
+void* operator new[](std::size_t size) SOLARUS_THROW_BAD_ALLOC {
+  return operator new(size);
+}
+
+/**
+ * @brief Frees memory allocated by operator new.
+ * @param memory the memory to free
+ */
+void operator delete(void* memory) throw() {
+  std::free(memory);
+}
+
+/**
+ * @brief Frees memory allocated by operator new[].
+ * @param memory the memory to free
+ */
+void operator delete[](void* memory) throw() {
+  std::free(memory);
+}
+
+#endif
+
+/**
+ * @brief Creates a benchmark from the command-line options.
+ *
+ * The input file, if any, is read immediately: the input event system
+ * must already be initialized.
+ *
+ * @param argc number of command-line arguments
+ * @param argv command-line arguments
+ */
+Benchmark::Benchmark(int argc, char** argv):
+  nb_frames(1000),
+  timestep(10),
+  next_input(0) {
+
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+
+    if (arg.find("-benchmark-map=") == 0) {
+      map_id = arg.substr(15);
+    }
+    else if (arg.find("-benchmark-input=") == 0) {
+      input_file_name = arg.substr(17);
+    }
+    else if (arg.find("-benchmark-step=") == 0) {
+      timestep = std::atoi(arg.substr(16).c_str());
+      SOLARUS_ASSERT(timestep > 0,
+          "Invalid benchmark time step: '" << arg << "'");
+    }
+    else if (arg.find("-benchmark=") == 0) {
+      nb_frames = std::atoi(arg.substr(11).c_str());
+      SOLARUS_ASSERT(nb_frames > 0,
+          "Invalid number of benchmark frames: '" << arg << "'");
+    }
+  }
+
+  update_durations.reserve(nb_frames);
+  draw_durations.reserve(nb_frames);
+  frame_allocations.reserve(nb_frames);
+
+  if (!input_file_name.empty()) {
+    load_inputs();
+  }
+}
+
+/**
+ * @brief Destructor.
+ */
+Benchmark::~Benchmark() {
+
+}
+
+/**
+ * @brief Returns whether a benchmark was requested on the command line.
+ * @param argc number of command-line arguments
+ * @param argv command-line arguments
+ * @return true if one of the options starts with -benchmark
+ */
+bool Benchmark::is_requested(int argc, char** argv) {
+
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg.find("-benchmark") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Returns the number of frames to run.
+ * @return the number of frames
+ */
+int Benchmark::get_nb_frames() {
+  return nb_frames;
+}
+
+/**
+ * @brief Returns the simulated duration of a frame.
+ * @return the time step in milliseconds
+ */
+uint32_t Benchmark::get_timestep() {
+  return timestep;
+}
+
+/**
+ * @brief Returns the map where the benchmark starts a game.
+ * @return id of the map, or an empty string to let the quest
+ * start normally
+ */
+const std::string& Benchmark::get_map_id() {
+  return map_id;
+}
+
+/**
+ * @brief Reads the input events to replay from the input file.
+ */
+void Benchmark::load_inputs() {
+
+  std::ifstream file(input_file_name.c_str());
+  SOLARUS_ASSERT(file.good(),
+      "Cannot open benchmark input file '" << input_file_name << "'");
+
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line)) {
+
+    line_number++;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    std::istringstream iss(line);
+    ScriptedInput input;
+    std::string action;
+    iss >> input.frame >> action;
+    SOLARUS_ASSERT(!iss.fail() && input.frame >= 0,
+        "Invalid line " << line_number << " in benchmark input file '"
+        << input_file_name << "'");
+
+    input.key = InputEvent::KEY_NONE;
+    if (action == "quit") {
+      input.type = SDL_QUIT;
+    }
+    else {
+      if (action == "press") {
+        input.type = SDL_KEYDOWN;
+      }
+      else if (action == "release") {
+        input.type = SDL_KEYUP;
+      }
+      else {
+        Debug::die(StringConcat() << "Unknown action '" << action << "' at line "
+            << line_number << " in benchmark input file '" << input_file_name << "'");
+      }
+
+      // The key name is the rest of the line and may contain spaces.
+      std::string key_name;
+      std::getline(iss >> std::ws, key_name);
+      input.key = InputEvent::get_keyboard_key_by_name(key_name);
+      SOLARUS_ASSERT(input.key != InputEvent::KEY_NONE,
+          "Unknown keyboard key '" << key_name << "' at line "
+          << line_number << " in benchmark input file '" << input_file_name << "'");
+    }
+    inputs.push_back(input);
+  }
+
+  // Keep the order of the file for events of the same frame.
+  std::stable_sort(inputs.begin(), inputs.end(), compare_frames);
+}
+
+/**
+ * @brief Orders scripted input events by frame.
+ * @param input1 an input event
+ * @param input2 another input event
+ * @return true if input1 occurs on an earlier frame than input2
+ */
+bool Benchmark::compare_frames(const ScriptedInput& input1, const ScriptedInput& input2) {
+  return input1.frame < input2.frame;
+}
+
+/**
+ * @brief Pushes into the event queue the scripted input events of a frame.
+ *
+ * They will then be handled like real events by the main loop.
+ *
+ * @param frame the frame about to be simulated
+ */
+void Benchmark::push_input_events(int frame) {
+
+  while (next_input < inputs.size() && inputs[next_input].frame <= frame) {
+
+    const ScriptedInput& input = inputs[next_input];
+    SDL_Event event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = input.type;
+    if (input.type == SDL_KEYDOWN || input.type == SDL_KEYUP) {
+      event.key.state = (input.type == SDL_KEYDOWN) ? 1 : 0;
+      event.key.keysym.sym = SDLKey(input.key);
+      event.key.keysym.mod = KMOD_NONE;
+    }
+    SDL_PushEvent(&event);
+    next_input++;
+  }
+}
+
+/**
+ * @brief Returns the number of memory allocations made with operator new
+ * since the beginning of the program.
+ *
+ * Allocations are only counted if the program is compiled with
+ * SOLARUS_COUNT_ALLOCATIONS. The counter wraps around: only use the
+ * difference between two values.
+ *
+ * @return the number of allocations, or 0 if they are not counted
+ */
+uint32_t Benchmark::get_nb_allocations() {
+
+#ifdef SOLARUS_COUNT_ALLOCATIONS
+  return add_allocations(0);
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief Records the timings of a frame.
+ * @param update_duration time spent updating the frame in microseconds
+ * @param draw_duration time spent drawing the frame in microseconds
+ * @param nb_frame_allocations number of memory allocations made by the frame
+ */
+void Benchmark::add_frame(uint64_t update_duration, uint64_t draw_duration,
+    uint32_t nb_frame_allocations) {
+
+  update_durations.push_back(uint32_t(update_duration));
+  draw_durations.push_back(uint32_t(draw_duration));
+  frame_allocations.push_back(nb_frame_allocations);
+}
+
+/**
+ * @brief Prints the statistics of the frames simulated so far.
+ * @param os the stream to write
+ */
+void Benchmark::print_report(std::ostream& os) {
+
+  os << "Benchmark: " << update_durations.size() << " frames";
+  if (!map_id.empty()) {
+    os << " of map '" << map_id << "'";
+  }
+  os << ", time step " << timestep << " ms" << std::endl;
+  os << std::setw(10) << "(us)"
+     << std::setw(10) << "mean"
+     << std::setw(10) << "p50"
+     << std::setw(10) << "p99"
+     << std::setw(10) << "max" << std::endl;
+  print_statistics(os, "update", update_durations);
+  print_statistics(os, "draw", draw_durations);
+#ifdef SOLARUS_COUNT_ALLOCATIONS
+  print_statistics(os, "allocs", frame_allocations);
+#endif
+
+  const int nb_searches = PathFinding::get_nb_searches();
+  if (nb_searches > 0) {
+    os << "Path finding: " << nb_searches << " searches, "
+       << (PathFinding::get_nb_nodes_explored() / nb_searches) << " nodes and "
+       << (PathFinding::get_search_time() / nb_searches) << " us per search" << std::endl;
+  }
+
+  const int nb_requests = PathFindingService::get_nb_requests();
+  if (nb_requests > 0) {
+    os << "Path requests: " << nb_requests << " requests, "
+       << PathFindingService::get_nb_unreachable() << " unreachable, "
+       << PathFindingService::get_nb_fields_built() << " flow fields, "
+       << PathFindingService::get_nb_nodes_settled() << " nodes settled, "
+       << (PathFindingService::get_total_time() / nb_requests) << " us per request" << std::endl;
+  }
+
+  const int nb_y_order_sorts = MapEntities::get_nb_y_order_sorts();
+  if (nb_y_order_sorts > 0) {
+    os << "Y order: " << nb_y_order_sorts << " sorts, "
+       << MapEntities::get_nb_y_order_moves() << " entities moved, "
+       << MapEntities::get_y_order_time() << " us total" << std::endl;
+  }
+
+  const int nb_entities_total = MapEntities::get_nb_entities_total();
+  if (nb_entities_total > 0 && !draw_durations.empty()) {
+    os << "Entities drawn: " << (MapEntities::get_nb_entities_drawn() / draw_durations.size()) << " of "
+       << (nb_entities_total / draw_durations.size()) << " per frame" << std::endl;
+  }
+
+  const int nb_prefix_queries = MapEntities::get_nb_prefix_queries();
+  if (nb_prefix_queries > 0) {
+    os << "Entity name prefixes: " << nb_prefix_queries << " queries, "
+       << MapEntities::get_prefix_query_time() << " us total" << std::endl;
+  }
+
+  const int nb_pool_allocations = ObjectPool::get_nb_allocations();
+  if (nb_pool_allocations > 0) {
+    os << "Object pool: " << nb_pool_allocations << " allocations, "
+       << ObjectPool::get_nb_reuses() << " reused, "
+       << ObjectPool::get_nb_bytes_reserved() / 1024 << " KB reserved" << std::endl;
+
+    os << "Entities created:";
+    const char* separator = " ";
+    for (int type = TILE; type <= HOOKSHOT; type++) {
+      const int nb_created = MapEntities::get_nb_entities_created(EntityType(type));
+      if (nb_created > 0) {
+        os << separator << MapEntities::get_entity_type_name(EntityType(type))
+           << " " << nb_created;
+        separator = ", ";
+      }
+    }
+    os << std::endl;
+  }
+
+  const int nb_chunks_built = NonAnimatedTilesCache::get_nb_chunks_built();
+  if (nb_chunks_built > 0) {
+    os << "Tile chunks: " << nb_chunks_built << " built, "
+       << NonAnimatedTilesCache::get_nb_chunks_freed() << " freed" << std::endl;
+  }
+
+  const int nb_inputs_presented = InputEvent::get_nb_inputs_presented();
+  if (nb_inputs_presented > 0) {
+    os << "Input latency: " << nb_inputs_presented << " frames, "
+       << (InputEvent::get_total_input_latency() / nb_inputs_presented) << " us mean, "
+       << InputEvent::get_max_input_latency() << " us max, "
+       << InputEvent::get_nb_events_coalesced() << " events coalesced" << std::endl;
+  }
+
+  const int nb_music_blocks = Music::get_nb_blocks_played();
+  if (nb_music_blocks > 0) {
+    os << "Music decoding: " << nb_music_blocks << " blocks, "
+       << (Music::get_total_decoding_time() / nb_music_blocks) << " us mean, "
+       << Music::get_max_decoding_time() << " us max, "
+       << Music::get_nb_underruns() << " underruns" << std::endl;
+  }
+
+  if (!update_durations.empty()) {
+    os << "Lua callbacks skipped: " << LuaContext::get_nb_callbacks_skipped() << " ("
+       << (LuaContext::get_nb_callbacks_skipped() / update_durations.size()) << " per frame)" << std::endl;
+  }
+
+  const int nb_lua_files = FileTools::get_nb_bytecode_hits() + FileTools::get_nb_bytecode_misses();
+  if (nb_lua_files > 0) {
+    os << "Lua data files: " << FileTools::get_nb_bytecode_hits() << " compiled, "
+       << FileTools::get_nb_bytecode_misses() << " from source, "
+       << (FileTools::get_lua_load_time() / nb_lua_files) << " us per file" << std::endl;
+  }
+
+  if (!update_durations.empty()) {
+    os << "Data files: " << FileTools::get_nb_bytes_read() << " bytes read, "
+       << FileTools::get_nb_bytes_copied() << " bytes copied ("
+       << (FileTools::get_nb_bytes_read() / update_durations.size()) << " read and "
+       << (FileTools::get_nb_bytes_copied() / update_durations.size()) << " copied per frame)" << std::endl;
+  }
+
+  const int nb_images = Surface::get_nb_image_cache_hits() + Surface::get_nb_image_cache_misses();
+  if (nb_images > 0) {
+    os << "Images: " << Surface::get_nb_image_cache_hits() << " from cache, "
+       << Surface::get_nb_image_cache_misses() << " decoded, "
+       << Surface::get_nb_images_copied() << " copied on write" << std::endl;
+  }
+
+  const int nb_tilesets = Tileset::get_nb_tilesets_reused() + Tileset::get_nb_tilesets_loaded();
+  if (nb_tilesets > 0) {
+    os << "Tilesets: " << Tileset::get_nb_tilesets_reused() << " reused, "
+       << Tileset::get_nb_tilesets_loaded() << " loaded, "
+       << Surface::get_nb_images_prefetched() << " images decoded in advance" << std::endl;
+  }
+
+  const int nb_maps_prefetch_lookups = MapLoader::get_nb_prefetch_hits() + MapLoader::get_nb_prefetch_misses();
+  if (nb_maps_prefetch_lookups > 0) {
+    os << "Maps read in advance: " << MapLoader::get_nb_prefetch_hits() << " hits, "
+       << MapLoader::get_nb_prefetch_misses() << " misses, "
+       << MapLoader::get_nb_prefetch_discarded() << " dropped by the memory limit" << std::endl;
+  }
+}
+
+/**
+ * @brief Prints the mean, median, 99th percentile and maximum of durations.
+ * @param os the stream to write
+ * @param name name of the line to print
+ * @param durations the durations (a copy because they get sorted)
+ */
+void Benchmark::print_statistics(std::ostream& os, const std::string& name,
+    std::vector<uint32_t> durations) {
+
+  os << std::setw(10) << name;
+  if (durations.empty()) {
+    os << std::endl;
+    return;
+  }
+
+  std::sort(durations.begin(), durations.end());
+  uint64_t total = 0;
+  for (size_t i = 0; i < durations.size(); i++) {
+    total += durations[i];
+  }
+  const size_t n = durations.size();
+  const size_t p99_index = std::min(n - 1, (n * 99 + 99) / 100 - 1);
+
+  os << std::setw(10) << (total / n)
+     << std::setw(10) << durations[(n - 1) / 2]
+     << std::setw(10) << durations[p99_index]
+     << std::setw(10) << durations[n - 1] << std::endl;
+}
+
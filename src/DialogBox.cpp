@@ -27,7 +27,6 @@
 #include "lowlevel/Surface.h"
 #include "lowlevel/TextSurface.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 #include "lowlevel/Sound.h"
 #include "lowlevel/System.h"
 #include <lauxlib.h>
@@ -188,8 +187,8 @@ const std::string& DialogBox::get_variable() {
 
   const std::string& value = variables[dialog_id];
 
-  Debug::check_assertion(value.size() > 0, StringConcat()
-      << "Missing variable in dialog '" << dialog_id << "'");
+  SOLARUS_ASSERT(value.size() > 0,
+      "Missing variable in dialog '" << dialog_id << "'");
 
   return value;
 }
@@ -228,8 +227,8 @@ void DialogBox::start_dialog(const std::string& dialog_id) {
 void DialogBox::start_dialog(const std::string& dialog_id, int callback_ref,
     VerticalPosition vertical_position) {
 
-  Debug::check_assertion(!is_enabled() || is_full(), StringConcat()
-      << "Cannot start dialog '" << dialog_id
+  SOLARUS_ASSERT(!is_enabled() || is_full(),
+      "Cannot start dialog '" << dialog_id
       << "': another dialog '" << this->dialog_id << "' is already started");
 
   bool first = !is_enabled();
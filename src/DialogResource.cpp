@@ -49,11 +49,7 @@ void DialogResource::initialize() {
 
   // read the dialogs file
   lua_State* l = luaL_newstate();
-  size_t size;
-  char* buffer;
-  FileTools::data_file_open_buffer(file_name, &buffer, &size, true);
-  luaL_loadbuffer(l, buffer, size, file_name.c_str());
-  FileTools::data_file_close_buffer(buffer);
+  FileTools::data_file_load_lua(l, file_name, true);
 
   lua_register(l, "dialog", l_dialog);
   if (lua_pcall(l, 0, 0, 0) != 0) {
@@ -81,8 +77,8 @@ void DialogResource::quit() {
  */
 const Dialog& DialogResource::get_dialog(const std::string& dialog_id) {
 
-  Debug::check_assertion(dialogs.count(dialog_id) > 0, StringConcat()
-      << "Cannot find dialog with id '" << dialog_id << "'");
+  SOLARUS_ASSERT(dialogs.count(dialog_id) > 0,
+      "Cannot find dialog with id '" << dialog_id << "'");
   return dialogs[dialog_id];
 }
 
@@ -160,8 +160,8 @@ int Equipment::get_max_money() {
  */
 void Equipment::set_max_money(int max_money) {
 
-  Debug::check_assertion(max_money > 0, StringConcat()
-      << "Illegal maximum amount of money: " << max_money);
+  SOLARUS_ASSERT(max_money > 0,
+      "Illegal maximum amount of money: " << max_money);
 
   savegame.set_integer(Savegame::KEY_MAX_MONEY, max_money);
 }
@@ -233,8 +233,8 @@ int Equipment::get_max_life() {
  */
 void Equipment::set_max_life(int max_life) {
 
-  Debug::check_assertion(max_life > 0, StringConcat()
-      << "Illegal maximum life: " << max_life);
+  SOLARUS_ASSERT(max_life > 0,
+      "Illegal maximum life: " << max_life);
 
   savegame.set_integer(Savegame::KEY_MAX_LIFE, max_life);
 }
@@ -310,8 +310,8 @@ int Equipment::get_max_magic() {
  */
 void Equipment::set_max_magic(int max_magic) {
 
-  Debug::check_assertion(max_magic >= 0, StringConcat()
-      << "Illegal maximum number of magic points: " << max_magic);
+  SOLARUS_ASSERT(max_magic >= 0,
+      "Illegal maximum number of magic points: " << max_magic);
 
   savegame.set_integer(Savegame::KEY_MAX_MAGIC, max_magic);
 
@@ -438,8 +438,8 @@ bool Equipment::item_exists(const std::string& item_name) {
  */
 EquipmentItem& Equipment::get_item(const std::string& item_name) {
 
-  Debug::check_assertion(item_exists(item_name),
-      StringConcat() << "Cannot find item with name '" << item_name << "'");
+  SOLARUS_ASSERT(item_exists(item_name),
+      "Cannot find item with name '" << item_name << "'");
 
   return *items[item_name];
 }
@@ -453,7 +453,7 @@ EquipmentItem* Equipment::get_item_assigned(int slot) {
 
   // TODO don't hardcode item slots
 
-  Debug::check_assertion(slot >= 1 && slot <= 2, StringConcat() <<
+  SOLARUS_ASSERT(slot >= 1 && slot <= 2,
       "Invalid item slot '" << slot << "'");
 
   std::ostringstream oss;
@@ -478,17 +478,17 @@ EquipmentItem* Equipment::get_item_assigned(int slot) {
  */
 void Equipment::set_item_assigned(int slot, EquipmentItem* item) {
 
-  Debug::check_assertion(slot >= 1 && slot <= 2, StringConcat() <<
+  SOLARUS_ASSERT(slot >= 1 && slot <= 2,
       "Invalid item slot '" << slot << "'");
 
   std::ostringstream oss;
   oss << "_item_slot_" << slot;
 
   if (item != NULL) {
-    Debug::check_assertion(item->get_variant() > 0, StringConcat()
-        << "Cannot assign item '" << item->get_name() << "' because the player does not have it");
-    Debug::check_assertion(item->is_assignable(), StringConcat()
-        << "The item '" << item->get_name() << "' cannot be assigned");
+    SOLARUS_ASSERT(item->get_variant() > 0,
+        "Cannot assign item '" << item->get_name() << "' because the player does not have it");
+    SOLARUS_ASSERT(item->is_assignable(),
+        "The item '" << item->get_name() << "' cannot be assigned");
     savegame.set_string(oss.str(), item->get_name());
   }
   else {
@@ -20,7 +20,6 @@
 #include "lua/LuaContext.h"
 #include "entities/Pickable.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 #include <map>
 
 /**
@@ -394,8 +393,8 @@ void EquipmentItem::notify_movement_changed(Pickable& pickable) {
  */
 int EquipmentItem::get_variant() const {
 
-  Debug::check_assertion(is_saved(), StringConcat()
-      << "The item '" << get_name() << "' is not saved");
+  SOLARUS_ASSERT(is_saved(),
+      "The item '" << get_name() << "' is not saved");
 
   return get_savegame().get_integer(get_savegame_variable());
 }
@@ -409,8 +408,8 @@ int EquipmentItem::get_variant() const {
  */
 void EquipmentItem::set_variant(int variant) {
 
-  Debug::check_assertion(is_saved(), StringConcat()
-      << "The item '" << get_name() << "' is not saved");
+  SOLARUS_ASSERT(is_saved(),
+      "The item '" << get_name() << "' is not saved");
 
   // Set the possession state in the savegame.
   get_savegame().set_integer(get_savegame_variable(), variant);
@@ -433,8 +432,8 @@ void EquipmentItem::set_variant(int variant) {
  */
 int EquipmentItem::get_amount() const {
 
-  Debug::check_assertion(has_amount(), StringConcat()
-      << "The item '" << get_name() << "' has no amount");
+  SOLARUS_ASSERT(has_amount(),
+      "The item '" << get_name() << "' has no amount");
 
   return get_savegame().get_integer(get_amount_savegame_variable());
 }
@@ -445,8 +444,8 @@ int EquipmentItem::get_amount() const {
  */
 void EquipmentItem::set_amount(int amount) {
 
-  Debug::check_assertion(has_amount(), StringConcat()
-      << "The item '" << get_name() << "' has no amount");
+  SOLARUS_ASSERT(has_amount(),
+      "The item '" << get_name() << "' has no amount");
 
   amount = std::max(0, std::min(get_max_amount(), amount));
   get_savegame().set_integer(get_amount_savegame_variable(), amount);
@@ -460,8 +459,8 @@ void EquipmentItem::set_amount(int amount) {
  */
 int EquipmentItem::get_max_amount() const {
 
-  Debug::check_assertion(has_amount(), StringConcat()
-      << "The item '" << get_name() << "' has no amount");
+  SOLARUS_ASSERT(has_amount(),
+      "The item '" << get_name() << "' has no amount");
 
   return max_amount;
 }
@@ -472,8 +471,8 @@ int EquipmentItem::get_max_amount() const {
  */
 void EquipmentItem::set_max_amount(int max_amount) {
 
-  Debug::check_assertion(has_amount(), StringConcat()
-      << "The item '" << get_name() << "' has no amount");
+  SOLARUS_ASSERT(has_amount(),
+      "The item '" << get_name() << "' has no amount");
 
   this->max_amount = max_amount;
 }
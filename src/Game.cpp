@@ -77,7 +77,7 @@ Game::Game(MainLoop& main_loop, Savegame* savegame):
  */
 Game::~Game() {
 
-  Debug::check_assertion(!current_map->is_started(),
+  SOLARUS_ASSERT(!current_map->is_started(),
       "Deleting a game while a map is still running. Call Game::stop() before.");
 
   savegame->set_game(NULL);
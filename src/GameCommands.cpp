@@ -765,7 +765,7 @@ bool GameCommands::is_customizing() {
  */
 GameCommands::Command GameCommands::get_command_to_customize() {
 
-  Debug::check_assertion(is_customizing(), "The player is not customizing a key");
+  SOLARUS_ASSERT(is_customizing(), "The player is not customizing a key");
   return command_to_customize;
 }
 
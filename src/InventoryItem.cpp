@@ -19,7 +19,6 @@
 #include "Equipment.h"
 #include "EquipmentItem.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 
 /**
  * @brief Creates a new inventory item.
@@ -63,8 +62,8 @@ int InventoryItem::get_variant() {
  */
 void InventoryItem::start() {
 
-  Debug::check_assertion(variant > 0, StringConcat()
-      << "Trying to use inventory item '" << item_name << "' without having it");
+  SOLARUS_ASSERT(variant > 0,
+      "Trying to use inventory item '" << item_name << "' without having it");
 
   this->finished = false;
   game.get_equipment().get_item(item_name).notify_inventory_item_used(*this);
@@ -16,18 +16,23 @@
  */
 #include "MainLoop.h"
 #include "lowlevel/System.h"
+#include "lowlevel/Random.h"
 #include "lowlevel/VideoManager.h"
 #include "lowlevel/Color.h"
 #include "lowlevel/Surface.h"
 #include "lowlevel/Music.h"
 #include "lowlevel/FileTools.h"
 #include "lowlevel/Debug.h"
+#include "lowlevel/InputEvent.h"
 #include "lua/LuaContext.h"
 #include "QuestProperties.h"
 #include "Game.h"
 #include "Savegame.h"
+#include "Equipment.h"
 #include "StringResource.h"
 #include "DebugKeys.h"
+#include "Benchmark.h"
+#include <iostream>
 
 /**
  * @brief Initializes the game engine.
@@ -40,11 +45,19 @@ MainLoop::MainLoop(int argc, char** argv):
   lua_context(NULL),
   exiting(false),
   game(NULL),
-  next_game(NULL) {
+  next_game(NULL),
+  benchmark(NULL) {
 
   // Initialize low-level features (audio, video, files...).
   System::initialize(argc, argv);
 
+  if (Benchmark::is_requested(argc, argv)) {
+    // Make the simulation reproducible.
+    benchmark = new Benchmark(argc, argv);
+    System::set_fixed_timestep(benchmark->get_timestep());
+    Random::set_seed(0);
+  }
+
   // Read the quest general properties.
   QuestProperties quest_properties(*this);
   quest_properties.load();
@@ -65,6 +78,7 @@ MainLoop::~MainLoop() {
   root_surface->decrement_refcount();
   delete root_surface;
   delete debug_keys;
+  delete benchmark;
   System::quit();
 }
 
@@ -140,8 +154,13 @@ void MainLoop::set_game(Game* game) {
  */
 void MainLoop::run() {
 
+  if (benchmark != NULL) {
+    run_benchmark();
+    return;
+  }
+
   // main loop
-  InputEvent *event;
+  InputEvent* event;
   uint32_t now;
   uint32_t next_frame_date = System::now();
   uint32_t frame_interval = 25; // time interval between two drawings
@@ -150,11 +169,10 @@ void MainLoop::run() {
 
   while (!is_exiting()) {
 
-    // handle the input events
-    event = InputEvent::get_event();
-    if (event != NULL) {
+    // handle all pending input events
+    InputEvent::poll_events();
+    while ((event = InputEvent::get_next_event()) != NULL && !is_exiting()) {
       notify_input(*event);
-      delete event;
     }
 
     // update the current screen
@@ -162,21 +180,7 @@ void MainLoop::run() {
 
     // go to another game?
     if (next_game != game) {
-      if (game != NULL) {
-        game->stop();
-        delete game;
-      }
-
-      game = next_game;
-
-      if (game != NULL) {
-        game->start();
-      }
-      else {
-        lua_context->exit();
-        lua_context->initialize();
-        Music::play(Music::none);
-      }
+      change_game();
     }
     else {
 
@@ -217,6 +221,91 @@ void MainLoop::run() {
   }
 }
 
+/**
+ * @brief Runs the benchmark instead of the normal main loop.
+ *
+ * Each frame handles all pending input events, makes one update and one
+ * drawing, with no delay between frames. The simulated clock advances by
+ * the same time step at each frame, so the same frames are simulated
+ * whatever the speed of the machine.
+ * The timings are printed on the standard output at the end.
+ */
+void MainLoop::run_benchmark() {
+
+  const std::string& map_id = benchmark->get_map_id();
+  if (!map_id.empty()) {
+    // Start a new game directly on the map (this savegame is never saved).
+    if (FileTools::get_language().empty()) {
+      FileTools::set_language(FileTools::get_default_language());
+    }
+    Savegame* savegame = new Savegame(*this, "_benchmark.dat");
+    savegame->set_string(Savegame::KEY_STARTING_MAP, map_id);
+    savegame->increment_refcount();
+    savegame->get_equipment().load_items();
+    savegame->decrement_refcount();
+    set_game(new Game(*this, savegame));
+    change_game();
+  }
+
+  const int nb_frames = benchmark->get_nb_frames();
+  for (int frame = 0; frame < nb_frames && !is_exiting(); frame++) {
+
+    benchmark->push_input_events(frame);
+    InputEvent::poll_events();
+    InputEvent* event;
+    while ((event = InputEvent::get_next_event()) != NULL) {
+      notify_input(*event);
+    }
+
+    const uint32_t nb_allocations = Benchmark::get_nb_allocations();
+    uint64_t start_date = System::get_real_time_us();
+    update();
+    uint64_t update_duration = System::get_real_time_us() - start_date;
+
+    if (next_game != game) {
+      change_game();
+    }
+
+    start_date = System::get_real_time_us();
+    draw();
+    uint64_t draw_duration = System::get_real_time_us() - start_date;
+
+    benchmark->add_frame(update_duration, draw_duration,
+        Benchmark::get_nb_allocations() - nb_allocations);
+  }
+
+  benchmark->print_report(std::cout);
+
+  if (game != NULL) {
+    game->stop();
+    delete game;
+  }
+}
+
+/**
+ * @brief Stops the current game and starts the next one.
+ *
+ * If there is no next game, the Lua context is reset.
+ */
+void MainLoop::change_game() {
+
+  if (game != NULL) {
+    game->stop();
+    delete game;
+  }
+
+  game = next_game;
+
+  if (game != NULL) {
+    game->start();
+  }
+  else {
+    lua_context->exit();
+    lua_context->initialize();
+    Music::play(Music::none);
+  }
+}
+
 /**
  * @brief This function is called when there is an input event.
  *
@@ -275,5 +364,6 @@ void MainLoop::draw() {
   }
   lua_context->main_on_draw(*root_surface);
   VideoManager::get_instance()->draw(*root_surface);
+  InputEvent::notify_frame_presented();
 }
 
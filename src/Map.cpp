@@ -32,6 +32,9 @@
 #include "entities/Destination.h"
 #include "entities/Detector.h"
 #include "entities/Hero.h"
+#include "entities/Teletransporter.h"
+#include "movements/PathFindingService.h"
+#include <algorithm>
 
 MapLoader Map::map_loader;
 
@@ -49,6 +52,7 @@ Map::Map(const std::string& id):
   started(false),
   destination_name(""),
   entities(NULL),
+  path_finding_service(NULL),
   suspended(false),
   light(1) {
 
@@ -59,7 +63,7 @@ Map::Map(const std::string& id):
  */
 Map::~Map() {
 
-  Debug::check_assertion(!is_started(),
+  SOLARUS_ASSERT(!is_started(),
       "Deleting a map that is still running. Call Map::leave() before.");
 
   if (is_loaded()) {
@@ -100,14 +104,23 @@ const std::string& Map::get_tileset_id() {
  * and have the same properties.
  * This function keeps the tiles of the previous tileset and loads the
  * image of the new tileset.
+ * If another map uses the same tileset at this time (this only happens
+ * during a transition between two maps), it also gets the new images.
  *
  * @param tileset_id Id of the new tileset.
  */
 void Map::set_tileset(const std::string& tileset_id) {
 
-  Tileset new_tileset(tileset_id);
-  new_tileset.load();
+  Tileset& new_tileset = Tileset::acquire(tileset_id);
+  if (&new_tileset == tileset) {
+    // this map already uses the images of this tileset
+    Tileset::release(new_tileset);
+    this->tileset_id = tileset_id;
+    return;
+  }
+
   tileset->set_images(new_tileset);
+  Tileset::release(new_tileset);
   get_entities().notify_tileset_changed();
   this->tileset_id = tileset_id;
 }
@@ -240,10 +253,12 @@ bool Map::is_loaded() {
 void Map::unload() {
 
   if (is_loaded()) {
-    delete tileset;
+    Tileset::release(*tileset);
     tileset = NULL;
     delete visible_surface;
     visible_surface = NULL;
+    delete path_finding_service;
+    path_finding_service = NULL;
     delete entities;
     entities = NULL;
     delete camera;
@@ -271,6 +286,7 @@ void Map::load(Game &game) {
 
   // read the map file
   map_loader.load_map(game, *this);
+  path_finding_service = new PathFindingService(*this);
 
   // initialize the light
   dark_surfaces[0] = new Surface("entities/dark0.png");
@@ -314,6 +330,30 @@ MapEntities& Map::get_entities() {
   return *entities;
 }
 
+/**
+ * @brief Returns the object that computes the paths of path-finding movements.
+ *
+ * This function should not be called before the map is loaded into a game.
+ *
+ * @return the path-finding service of the map
+ */
+PathFindingService& Map::get_path_finding_service() {
+  return *path_finding_service;
+}
+
+/**
+ * @brief Notifies the map that an entity that may be an obstacle has appeared,
+ * disappeared, moved or changed its state.
+ *
+ * Paths computed before are not valid anymore.
+ */
+void Map::notify_obstacles_changed() {
+
+  if (path_finding_service != NULL) {
+    path_finding_service->notify_obstacles_changed();
+  }
+}
+
 /**
  * @brief Sets the current destination point of the map.
  * @param destination_name name of the destination point you want to use,
@@ -348,7 +388,7 @@ Destination* Map::get_destination() {
     return NULL;
   }
   MapEntity* entity = get_entities().get_entity(destination_name);
-  Debug::check_assertion(entity->get_type() == DESTINATION,
+  SOLARUS_ASSERT(entity->get_type() == DESTINATION,
       "This entity is not a destination");
   return static_cast<Destination*>(entity);
 }
@@ -486,6 +526,7 @@ void Map::update() {
 
   // update the elements
   TilePattern::update();
+  MapLoader::update();
   entities->update();
   get_lua_context().map_on_update(*this);
   camera->update();  // update the camera after the entities since this might
@@ -637,6 +678,33 @@ void Map::start() {
   this->entities->notify_map_started();
   get_lua_context().run_map(*this, get_destination());
   Music::play(music_id);
+  prefetch_destinations();
+}
+
+/**
+ * @brief Starts reading in advance the maps where the teletransporters
+ * of this map lead.
+ *
+ * Their tilesets are decoded in advance too, once the maps are read
+ * (see MapLoader::update()).
+ * This way, the next map does not have to wait for its files.
+ */
+void Map::prefetch_destinations() {
+
+  std::vector<std::string> map_ids;
+  std::list<MapEntity*> teletransporters =
+      entities->get_entities_with_prefix(TELETRANSPORTER, "");
+  std::list<MapEntity*>::iterator it;
+  for (it = teletransporters.begin(); it != teletransporters.end(); it++) {
+
+    const std::string& map_id =
+        static_cast<Teletransporter*>(*it)->get_destination_map_id();
+    if (map_id != id
+        && std::find(map_ids.begin(), map_ids.end(), map_id) == map_ids.end()) {
+      map_ids.push_back(map_id);
+    }
+  }
+  MapLoader::prefetch_maps(map_ids);
 }
 
 /**
@@ -790,16 +858,17 @@ bool Map::test_collision_with_tiles(Layer layer, int x, int y, MapEntity &entity
  */
 bool Map::test_collision_with_entities(Layer layer, const Rectangle &collision_box, MapEntity &entity_to_check) {
 
-  std::list<MapEntity*> &obstacle_entities = entities->get_obstacle_entities(layer);
+  // only the entities whose bounding box is close to the rectangle
+  obstacle_entities_found.clear();
+  entities->get_obstacle_entities(layer, collision_box, obstacle_entities_found);
 
   bool collision = false;
 
-  std::list<MapEntity*>::iterator i;
-  for (i = obstacle_entities.begin();
-       i != obstacle_entities.end() && !collision;
+  for (unsigned int i = 0;
+       i < obstacle_entities_found.size() && !collision;
        i++) {
 
-    MapEntity *entity = *i;
+    MapEntity *entity = obstacle_entities_found[i];
     collision =
 	entity != &entity_to_check
 	&& entity->is_enabled()
@@ -1013,17 +1082,24 @@ void Map::check_collision_with_detectors(MapEntity &entity) {
     return;
   }
 
-  std::list<Detector*> &detectors = entities->get_detectors();
+  // only check the detectors close to the entity: the margin includes its
+  // origin point, its facing points and the points of custom collision tests
+  const Rectangle& bounding_box = entity.get_bounding_box();
+  const int margin = EntityGrid::cell_size;
+  const int x1 = std::min(bounding_box.get_x(), entity.get_x()) - margin;
+  const int y1 = std::min(bounding_box.get_y(), entity.get_y()) - margin;
+  const int x2 = std::max(bounding_box.get_x() + bounding_box.get_width(), entity.get_x() + 1) + margin;
+  const int y2 = std::max(bounding_box.get_y() + bounding_box.get_height(), entity.get_y() + 1) + margin;
 
-  // check each detector
-  std::list<Detector*>::iterator i;
+  std::vector<Detector*> detectors;
+  entities->get_detectors(Rectangle(x1, y1, x2 - x1, y2 - y1), detectors);
 
-  for (i = detectors.begin();
-       i != detectors.end();
-       i++) {
+  // check each detector
+  for (unsigned int i = 0; i < detectors.size(); i++) {
 
-    if (!(*i)->is_being_removed() && (*i)->is_enabled()) {
-      (*i)->check_collision(entity);
+    Detector* detector = detectors[i];
+    if (!detector->is_being_removed() && detector->is_enabled()) {
+      detector->check_collision(entity);
     }
   }
 }
@@ -1045,16 +1121,22 @@ void Map::check_collision_with_detectors(MapEntity &entity, Sprite &sprite) {
     return;
   }
 
-  std::list<Detector*> &detectors = entities->get_detectors();
+  // any frame of the sprite fits in this rectangle around the origin point
+  const Rectangle& max_size = sprite.get_max_size();
+  const Rectangle area(entity.get_x() - max_size.get_width(),
+      entity.get_y() - max_size.get_height(),
+      max_size.get_width() * 2, max_size.get_height() * 2);
+
+  std::vector<Detector*> detectors;
+  entities->get_detectors(area, detectors);
+
   // check each detector
-  std::list<Detector*>::iterator i;
-  for (i = detectors.begin();
-       i != detectors.end();
-       i++) {
+  for (unsigned int i = 0; i < detectors.size(); i++) {
 
-    if (!(*i)->is_being_removed()
-        && (*i)->is_enabled()) {
-      (*i)->check_collision(entity, sprite);
+    Detector* detector = detectors[i];
+    if (!detector->is_being_removed()
+        && detector->is_enabled()) {
+      detector->check_collision(entity, sprite);
     }
   }
 }
@@ -19,6 +19,7 @@
 #include "Game.h"
 #include "Camera.h"
 #include "lowlevel/FileTools.h"
+#include "lowlevel/DataBuffer.h"
 #include "lowlevel/Surface.h"
 #include "lowlevel/Debug.h"
 #include "lowlevel/StringConcat.h"
@@ -29,7 +30,107 @@
 #include "entities/MapEntities.h"
 #include "entities/EntityType.h"
 #include "entities/MapEntity.h"
+#include "entities/Tile.h"
 #include "lua/LuaContext.h"
+#include "lowlevel/System.h"
+#include <map>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+
+/**
+ * @brief Functions that create entities from a map file, except tiles.
+ *
+ * The index of a function in this array is the type of entity
+ * in binary map files: do not change the order.
+ */
+static const luaL_Reg entity_creation_functions[] = {
+  { "destination",      LuaContext::map_api_create_destination },
+  { "teletransporter",  LuaContext::map_api_create_teletransporter },
+  { "pickable",         LuaContext::map_api_create_pickable },
+  { "destructible",     LuaContext::map_api_create_destructible },
+  { "chest",            LuaContext::map_api_create_chest },
+  { "jumper",           LuaContext::map_api_create_jumper },
+  { "enemy",            LuaContext::map_api_create_enemy },
+  { "npc",              LuaContext::map_api_create_npc },
+  { "block",            LuaContext::map_api_create_block },
+  { "dynamic_tile",     LuaContext::map_api_create_dynamic_tile },
+  { "switch",           LuaContext::map_api_create_switch },
+  { "wall",             LuaContext::map_api_create_wall },
+  { "sensor",           LuaContext::map_api_create_sensor },
+  { "crystal",          LuaContext::map_api_create_crystal },
+  { "crystal_block",    LuaContext::map_api_create_crystal_block },
+  { "shop_item",        LuaContext::map_api_create_shop_item },
+  { "conveyor_belt",    LuaContext::map_api_create_conveyor_belt },
+  { "door",             LuaContext::map_api_create_door },
+  { "stairs",           LuaContext::map_api_create_stairs },
+  { NULL, NULL }
+};
+
+static const int nb_entity_creation_functions =
+    sizeof(entity_creation_functions) / sizeof(luaL_Reg) - 1;
+
+static const char binary_map_magic[4] = { 'S', 'M', 'P', '1' };
+
+/**
+ * @brief Appends a 32-bit integer to a binary map file.
+ * @param output the content of the file
+ * @param value the value to append (in little-endian order)
+ */
+static void write_uint32(std::string& output, uint32_t value) {
+
+  for (int i = 0; i < 4; i++) {
+    output.push_back(char((value >> (8 * i)) & 0xFF));
+  }
+}
+
+/**
+ * @brief Reads a 32-bit integer from a binary map file.
+ * @param position the current position in the file (advanced by 4 bytes)
+ * @param end the end of the file
+ * @param valid set to false if the end of the file is reached
+ * @return the value read, or 0 if the end of the file is reached
+ */
+static uint32_t read_uint32(const char*& position, const char* end, bool& valid) {
+
+  if (end - position < 4) {
+    valid = false;
+    return 0;
+  }
+
+  uint32_t value = 0;
+  for (int i = 3; i >= 0; i--) {
+    value = (value << 8) | uint8_t(position[i]);
+  }
+  position += 4;
+  return value;
+}
+
+/**
+ * @brief Strings of a binary map file, indexed in the order of their addition.
+ */
+struct StringTable {
+
+  std::map<std::string, uint32_t> indexes;  /**< index of each string */
+  std::vector<std::string> strings;         /**< strings in the order of their index */
+
+  /**
+   * @brief Returns the index of a string, adding it if necessary.
+   * @param value a string
+   * @return its index in the table
+   */
+  uint32_t get_index(const std::string& value) {
+
+    std::map<std::string, uint32_t>::iterator it = indexes.find(value);
+    if (it != indexes.end()) {
+      return it->second;
+    }
+    uint32_t index = uint32_t(strings.size());
+    indexes[value] = index;
+    strings.push_back(value);
+    return index;
+  }
+};
 
 /**
  * @brief Creates a map loader.
@@ -38,6 +139,19 @@ MapLoader::MapLoader() {
 
 }
 
+std::map<std::string, MapLoader::PrefetchedMap> MapLoader::prefetched_maps;
+std::list<std::string> MapLoader::prefetch_requests;
+std::vector<std::string> MapLoader::prefetch_tileset_ids;
+std::string MapLoader::prefetch_current;
+size_t MapLoader::prefetched_size = 0;
+SDL_Thread* MapLoader::prefetch_thread = NULL;
+SDL_mutex* MapLoader::prefetch_mutex = NULL;
+SDL_cond* MapLoader::prefetch_cond = NULL;
+bool MapLoader::prefetch_stopping = false;
+int MapLoader::nb_prefetch_hits = 0;
+int MapLoader::nb_prefetch_misses = 0;
+int MapLoader::nb_prefetch_discarded = 0;
+
 /**
  * @brief Destructor.
  */
@@ -47,6 +161,11 @@ MapLoader::~MapLoader() {
 
 /**
  * @brief Loads a map into the game.
+ *
+ * If the map was read in advance by prefetch_maps(), only its entities
+ * are created. Otherwise, the binary map file is used if it corresponds
+ * to the Lua data file.
+ *
  * @param game The game.
  * @param map The map to load.
  */
@@ -54,14 +173,32 @@ void MapLoader::load_map(Game& game, Map& map) {
 
   map.game = &game;
 
-  // Open the map data file in an independent Lua world.
+  MapData* prefetched_data = take_prefetched_map(map.get_id());
+  if (prefetched_data != NULL) {
+    nb_prefetch_hits++;
+    set_properties(map, prefetched_data->x, prefetched_data->y,
+        prefetched_data->width, prefetched_data->height,
+        prefetched_data->world, prefetched_data->floor,
+        prefetched_data->tileset_id, prefetched_data->music_id);
+    create_entities(map, *prefetched_data);
+    delete prefetched_data;
+    return;
+  }
+  nb_prefetch_misses++;
+
   const std::string& file_name = std::string("maps/") + map.get_id() + ".dat";
+  const std::string& binary_file_name = std::string("maps/") + map.get_id() + ".map";
+  if (FileTools::data_file_exists(binary_file_name)) {
+
+    const DataBuffer& source = FileTools::data_file_read(file_name);
+    if (load_binary_map(map, binary_file_name, source.get_data(), source.get_size())) {
+      return;
+    }
+  }
+
+  // Open the map data file in an independent Lua world.
   lua_State* l = luaL_newstate();
-  size_t size;
-  char* buffer;
-  FileTools::data_file_open_buffer(file_name, &buffer, &size);
-  luaL_loadbuffer(l, buffer, size, file_name.c_str());
-  FileTools::data_file_close_buffer(buffer);
+  FileTools::data_file_load_lua(l, file_name);
 
   // Register the properties() function to Lua.
   lua_register(l, "properties", l_properties);
@@ -81,8 +218,136 @@ void MapLoader::load_map(Game& game, Map& map) {
   }
 
   lua_close(l);
+}
+
+/**
+ * @brief Converts the Lua data file of each map of the quest into a
+ * binary map file.
+ *
+ * The maps are the ones listed in the quest resource database. The binary
+ * files are written in the quest data directory, which must be a directory.
+ *
+ * @param report Stream where the number of maps converted and the time to
+ * read them in both formats are written.
+ */
+void MapLoader::convert_maps(std::ostream& report) {
+
+  const std::string& data_dir = FileTools::start_writing_quest_data();
 
-  // TODO if necessary, store the Lua compiled chunck to speed up next loadings of this map.
+  // Find the maps in the resource database.
+  std::vector<std::string> map_ids;
+  std::istream& database_file = FileTools::data_file_open("project_db.dat");
+  std::string line;
+  while (std::getline(database_file, line)) {
+
+    if (line.size() == 0) {
+      continue;
+    }
+
+    int resource_type;
+    std::string resource_id, resource_name;
+    std::istringstream iss(line);
+    FileTools::read(iss, resource_type);
+    FileTools::read(iss, resource_id);
+    FileTools::read(iss, resource_name);
+    if (resource_type == 0) { // it's a map
+      map_ids.push_back(resource_id);
+    }
+  }
+  FileTools::data_file_close(database_file);
+
+  int nb_tiles = 0;
+  int nb_entities = 0;
+  uint64_t lua_time = 0;
+  uint64_t binary_time = 0;
+  for (unsigned int i = 0; i < map_ids.size(); i++) {
+
+    const std::string& file_name = std::string("maps/") + map_ids[i] + ".dat";
+    const std::string& binary_file_name = std::string("maps/") + map_ids[i] + ".map";
+
+    MapData data;
+    lua_State* l = luaL_newstate();
+    uint64_t start_time = System::get_real_time_us();
+    read_map_data(l, file_name, data);
+    lua_time += System::get_real_time_us() - start_time;
+    lua_close(l);
+
+    std::string output;
+    write_binary_map(data, output);
+    FileTools::data_file_save_buffer(binary_file_name, output.data(), output.size());
+
+    // Read it again to compare the loading times.
+    MapData binary_data;
+    start_time = System::get_real_time_us();
+    bool valid = parse_binary_map(output.data(), output.size(), binary_data);
+    binary_time += System::get_real_time_us() - start_time;
+    SOLARUS_ASSERT(valid,
+        "Invalid binary map file generated for '" << file_name << "'");
+
+    for (int layer = 0; layer < LAYER_NB; layer++) {
+      nb_tiles += data.tiles[layer].size();
+    }
+    nb_entities += data.entities.size();
+  }
+
+  report << "Converted " << map_ids.size() << " maps in '" << data_dir << "/maps' ("
+      << nb_tiles << " tiles, " << nb_entities << " other entities)" << std::endl;
+  report << "Reading all maps: " << lua_time << " us from Lua, "
+      << binary_time << " us from binary" << std::endl;
+
+  FileTools::stop_writing_quest_data();
+}
+
+/**
+ * @brief Sets the properties of a map and initializes its entities,
+ * before any entity is created.
+ * @param map The map to initialize.
+ * @param x X coordinate of the map in its world.
+ * @param y Y coordinate of the map in its world.
+ * @param width Width of the map in pixels.
+ * @param height Height of the map in pixels.
+ * @param world Name of the world of the map.
+ * @param floor Floor of the map or Map::NO_FLOOR.
+ * @param tileset_id Id of the tileset.
+ * @param music_id Id of the music.
+ */
+void MapLoader::set_properties(Map& map, int x, int y, int width, int height,
+    const std::string& world, int floor,
+    const std::string& tileset_id, const std::string& music_id) {
+
+  // Initialize the map data.
+  // TODO implement methods in Map instead to check the values instead of changing directly the fields.
+  map.location.set_size(width, height);
+  map.width8 = width / 8;
+  map.height8 = height / 8;
+  map.location.set_xy(x, y);
+  map.music_id = music_id;
+  map.set_world(world);
+  map.set_floor(floor);
+
+  map.tileset_id = tileset_id;
+  map.tileset = &Tileset::acquire(tileset_id);
+
+  MapEntities& entities = map.get_entities();
+  entities.map_width8 = map.width8;
+  entities.map_height8 = map.height8;
+  entities.tiles_grid_size = map.width8 * map.height8;
+  entities.detectors_grid.initialize(width, height);
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+
+    entities.obstacle_entities_grids[layer].initialize(width, height);
+    entities.entities_drawn_first_grids[layer].initialize(width, height);
+    entities.tiles_in_animated_regions_grids[layer].initialize(width, height);
+    entities.animated_tiles[layer] = new bool[entities.tiles_grid_size];
+    entities.obstacle_tiles[layer] = new Obstacle[entities.tiles_grid_size];
+    Obstacle initial_obstacle = (layer == LAYER_LOW) ? OBSTACLE_NONE : OBSTACLE_EMPTY;
+    for (int i = 0; i < entities.tiles_grid_size; i++) {
+      entities.animated_tiles[layer][i] = false;
+      entities.obstacle_tiles[layer][i] = initial_obstacle;
+    }
+  }
+  entities.boomerang = NULL;
+  map.camera = new Camera(map);
 }
 
 /**
@@ -98,7 +363,7 @@ int MapLoader::l_properties(lua_State* l) {
 
   // Retrieve the map to build.
   Map* map = LuaContext::get_entity_implicit_creation_map(l);
-  Debug::check_assertion(map != NULL, "No map has not been set in this Lua state");
+  SOLARUS_ASSERT(map != NULL, "No map has not been set in this Lua state");
 
   // Retrieve the map properties from the table parameter.
   luaL_checktype(l, 1, LUA_TTABLE);
@@ -112,62 +377,11 @@ int MapLoader::l_properties(lua_State* l) {
   const std::string& tileset_id = LuaContext::check_string_field(l, 1, "tileset");
   const std::string& music_id = LuaContext::opt_string_field(l, 1, "music", Music::none);
 
-  // Initialize the map data.
-  // TODO implement methods in Map instead to check the values instead of changing directly the fields.
-  map->location.set_size(width, height);
-  map->width8 = width / 8;
-  map->height8 = height / 8;
-  map->location.set_xy(x, y);
-  map->music_id = music_id;
-  map->set_world(world_name);
-  map->set_floor(floor);
-
-  map->tileset_id = tileset_id;
-  map->tileset = new Tileset(tileset_id);
-  map->tileset->load();
-
-  MapEntities& entities = map->get_entities();
-  entities.map_width8 = map->width8;
-  entities.map_height8 = map->height8;
-  entities.tiles_grid_size = map->width8 * map->height8;
-  for (int layer = 0; layer < LAYER_NB; layer++) {
-
-    entities.animated_tiles[layer] = new bool[entities.tiles_grid_size];
-    entities.obstacle_tiles[layer] = new Obstacle[entities.tiles_grid_size];
-    Obstacle initial_obstacle = (layer == LAYER_LOW) ? OBSTACLE_NONE : OBSTACLE_EMPTY;
-    for (int i = 0; i < entities.tiles_grid_size; i++) {
-      entities.animated_tiles[layer][i] = false;
-      entities.obstacle_tiles[layer][i] = initial_obstacle;
-    }
-  }
-  entities.boomerang = NULL;
-  map->camera = new Camera(*map);
+  set_properties(*map, x, y, width, height, world_name, floor, tileset_id, music_id);
 
   // Properties are set: we now allow the data file to declare entities.
-  static const luaL_Reg functions[] = {
-    { "tile",             LuaContext::map_api_create_tile },
-    { "destination",      LuaContext::map_api_create_destination },
-    { "teletransporter",  LuaContext::map_api_create_teletransporter },
-    { "pickable",         LuaContext::map_api_create_pickable },
-    { "destructible",     LuaContext::map_api_create_destructible },
-    { "chest",            LuaContext::map_api_create_chest },
-    { "jumper",           LuaContext::map_api_create_jumper },
-    { "enemy",            LuaContext::map_api_create_enemy },
-    { "npc",              LuaContext::map_api_create_npc },
-    { "block",            LuaContext::map_api_create_block },
-    { "dynamic_tile",     LuaContext::map_api_create_dynamic_tile },
-    { "switch",           LuaContext::map_api_create_switch },
-    { "wall",             LuaContext::map_api_create_wall },
-    { "sensor",           LuaContext::map_api_create_sensor },
-    { "crystal",          LuaContext::map_api_create_crystal },
-    { "crystal_block",    LuaContext::map_api_create_crystal_block },
-    { "shop_item",        LuaContext::map_api_create_shop_item },
-    { "conveyor_belt",    LuaContext::map_api_create_conveyor_belt },
-    { "door",             LuaContext::map_api_create_door },
-    { "stairs",           LuaContext::map_api_create_stairs },
-    { NULL, NULL }
-  };
-  const luaL_Reg* function = functions;
+  lua_register(l, "tile", LuaContext::map_api_create_tile);
+  const luaL_Reg* function = entity_creation_functions;
   while (function->name != NULL) {
     lua_register(l, function->name, function->func);
     function++;
@@ -176,3 +390,752 @@ int MapLoader::l_properties(lua_State* l) {
   return 0;
 }
 
+/**
+ * @brief Loads a map from its binary map file.
+ *
+ * Nothing is done if the binary map file is invalid or was not converted
+ * from the current Lua data file.
+ *
+ * @param map The map to load.
+ * @param file_name Name of the binary map file.
+ * @param source Content of the Lua data file of the map.
+ * @param source_size Size of the Lua data file of the map.
+ * @return true if the map was loaded.
+ */
+bool MapLoader::load_binary_map(Map& map, const std::string& file_name,
+    const char* source, size_t source_size) {
+
+  const DataBuffer& buffer = FileTools::data_file_read(file_name);
+  MapData data;
+  bool valid = parse_binary_map(buffer.get_data(), buffer.get_size(), data);
+
+  if (!valid
+      || data.source_size != source_size
+      || data.source_hash != FileTools::get_hash(source, source_size)) {
+    return false;
+  }
+
+  set_properties(map, data.x, data.y, data.width, data.height,
+      data.world, data.floor, data.tileset_id, data.music_id);
+  create_entities(map, data);
+  return true;
+}
+
+/**
+ * @brief Creates the entities declared in a binary map file.
+ *
+ * Tiles are created directly. Other entities are created by their Lua
+ * creation function, from a table of their fields.
+ *
+ * @param map The map, whose properties are already set.
+ * @param data The content of the binary map file.
+ */
+void MapLoader::create_entities(Map& map, const MapData& data) {
+
+  MapEntities& entities = map.get_entities();
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+
+    const std::vector<TileData>& tiles = data.tiles[layer];
+    for (unsigned int i = 0; i < tiles.size(); i++) {
+      const TileData& tile = tiles[i];
+      entities.add_entity(new Tile(Layer(layer), tile.x, tile.y,
+          tile.width, tile.height, tile.pattern));
+    }
+  }
+
+  if (data.entities.empty()) {
+    return;
+  }
+
+  lua_State* l = luaL_newstate();
+  luaL_newmetatable(l, LuaContext::map_module_name.c_str());
+  lua_pushcfunction(l, LuaContext::userdata_meta_gc);
+  lua_setfield(l, -2, "__gc");
+  lua_pop(l, 1);
+  LuaContext::set_entity_implicit_creation_map(l, &map);
+
+  for (unsigned int i = 0; i < data.entities.size(); i++) {
+
+    const EntityData& entity = data.entities[i];
+    lua_pushcfunction(l, entity_creation_functions[entity.type].func);
+    lua_createtable(l, 0, entity.fields.size());
+    for (unsigned int j = 0; j < entity.fields.size(); j++) {
+
+      const FieldData& field = entity.fields[j];
+      switch (field.type) {
+
+        case FIELD_INTEGER:
+          lua_pushinteger(l, field.int_value);
+          break;
+
+        case FIELD_STRING:
+          lua_pushlstring(l, field.string_value.data(), field.string_value.size());
+          break;
+
+        case FIELD_BOOLEAN:
+          lua_pushboolean(l, field.int_value);
+          break;
+      }
+      lua_setfield(l, -2, field.key.c_str());
+    }
+
+    if (lua_pcall(l, 1, 0, 0) != 0) {
+      Debug::die(StringConcat() << "Failed to load binary map file of map '"
+          << map.get_id() << "': " << lua_tostring(l, -1));
+      lua_pop(l, 1);
+    }
+  }
+
+  lua_close(l);
+}
+
+/**
+ * @brief Executes the Lua data file of a map and records what it declares.
+ * @param l A new Lua state.
+ * @param file_name Name of the Lua data file.
+ * @param data Receives the properties and the entities of the map.
+ */
+void MapLoader::read_map_data(lua_State* l, const std::string& file_name,
+    MapData& data) {
+
+  const DataBuffer& buffer = FileTools::data_file_read(file_name);
+  data.source_size = uint32_t(buffer.get_size());
+  data.source_hash = FileTools::get_hash(buffer.get_data(), buffer.get_size());
+  int result = luaL_loadbuffer(l, buffer.get_data(), buffer.get_size(), file_name.c_str());
+  SOLARUS_ASSERT(result == 0,
+      "Failed to load map data file '" << file_name << "': " << lua_tostring(l, -1));
+
+  if (!run_map_data(l, data)) {
+    Debug::die(StringConcat() << "Failed to load map data file '"
+        << file_name << "': " << lua_tostring(l, -1));
+    lua_pop(l, 1);
+  }
+}
+
+/**
+ * @brief Executes a loaded Lua map data file and records what it declares.
+ *
+ * This function does not depend on the engine: it can be called from any
+ * thread with its own Lua state.
+ *
+ * @param l A Lua state with the chunk of the map data file on top of the stack.
+ * @param data Receives the properties and the entities of the map.
+ * @return false in case of error (the error message is then on top of the stack).
+ */
+bool MapLoader::run_map_data(lua_State* l, MapData& data) {
+
+  lua_pushlightuserdata(l, &data);
+  lua_setfield(l, LUA_REGISTRYINDEX, "map_data");
+  lua_register(l, "properties", l_read_properties);
+  lua_register(l, "tile", l_read_entity);
+  for (int i = 0; i < nb_entity_creation_functions; i++) {
+    lua_pushinteger(l, i);
+    lua_pushcclosure(l, l_read_entity, 1);
+    lua_setglobal(l, entity_creation_functions[i].name);
+  }
+
+  return lua_pcall(l, 0, 0, 0) == 0;
+}
+
+/**
+ * @brief Implementation of the properties() function when a Lua data file
+ * is read by read_map_data().
+ * @param l The Lua state that is calling this function.
+ * @return Number of values to return to Lua.
+ */
+int MapLoader::l_read_properties(lua_State* l) {
+
+  lua_getfield(l, LUA_REGISTRYINDEX, "map_data");
+  MapData& data = *static_cast<MapData*>(lua_touserdata(l, -1));
+  lua_pop(l, 1);
+
+  luaL_checktype(l, 1, LUA_TTABLE);
+  data.x = LuaContext::opt_int_field(l, 1, "x", 0);
+  data.y = LuaContext::opt_int_field(l, 1, "y", 0);
+  data.width = LuaContext::check_int_field(l, 1, "width");
+  data.height = LuaContext::check_int_field(l, 1, "height");
+  data.world = LuaContext::check_string_field(l, 1 , "world");
+  data.floor = LuaContext::opt_int_field(l, 1, "floor", Map::NO_FLOOR);
+  data.tileset_id = LuaContext::check_string_field(l, 1, "tileset");
+  data.music_id = LuaContext::opt_string_field(l, 1, "music", Music::none);
+
+  return 0;
+}
+
+/**
+ * @brief Implementation of the entity creation functions when a Lua data file
+ * is read by read_map_data().
+ *
+ * The type of entity is the upvalue of the function, or no upvalue for tiles.
+ *
+ * @param l The Lua state that is calling this function.
+ * @return Number of values to return to Lua.
+ */
+int MapLoader::l_read_entity(lua_State* l) {
+
+  lua_getfield(l, LUA_REGISTRYINDEX, "map_data");
+  MapData& data = *static_cast<MapData*>(lua_touserdata(l, -1));
+  lua_pop(l, 1);
+
+  luaL_checktype(l, 1, LUA_TTABLE);
+
+  if (lua_isnone(l, lua_upvalueindex(1))) {
+    // A tile.
+    TileData tile;
+    Layer layer = Layer(LuaContext::check_int_field(l, 1, "layer"));
+    tile.x = LuaContext::check_int_field(l, 1, "x");
+    tile.y = LuaContext::check_int_field(l, 1, "y");
+    tile.width = LuaContext::check_int_field(l, 1, "width");
+    tile.height = LuaContext::check_int_field(l, 1, "height");
+    tile.pattern = LuaContext::check_int_field(l, 1, "pattern");
+    if (layer < 0 || layer >= LAYER_NB) {
+      luaL_argerror(l, 1, "invalid layer");
+    }
+    data.tiles[layer].push_back(tile);
+    return 0;
+  }
+
+  EntityData entity;
+  entity.type = int(lua_tointeger(l, lua_upvalueindex(1)));
+
+  lua_pushnil(l);
+  while (lua_next(l, 1) != 0) {
+
+    if (lua_type(l, -2) != LUA_TSTRING) {
+      luaL_argerror(l, 1, "field names must be strings");
+    }
+
+    FieldData field;
+    field.key = lua_tostring(l, -2);
+    field.int_value = 0;
+    switch (lua_type(l, -1)) {
+
+      case LUA_TNUMBER:
+      {
+        lua_Number value = lua_tonumber(l, -1);
+        field.type = FIELD_INTEGER;
+        field.int_value = int(value);
+        if (field.int_value != value) {
+          luaL_error(l, "Field '%s' is not an integer", field.key.c_str());
+        }
+        break;
+      }
+
+      case LUA_TSTRING:
+      {
+        size_t length;
+        const char* value = lua_tolstring(l, -1, &length);
+        field.type = FIELD_STRING;
+        field.string_value.assign(value, length);
+        break;
+      }
+
+      case LUA_TBOOLEAN:
+        field.type = FIELD_BOOLEAN;
+        field.int_value = lua_toboolean(l, -1);
+        break;
+
+      default:
+        luaL_error(l, "Field '%s' has an unsupported type", field.key.c_str());
+    }
+    entity.fields.push_back(field);
+    lua_pop(l, 1);
+  }
+
+  data.entities.push_back(entity);
+  return 0;
+}
+
+/**
+ * @brief Makes the content of a binary map file.
+ * @param data The properties and the entities of the map.
+ * @param output Receives the content of the binary map file.
+ */
+void MapLoader::write_binary_map(const MapData& data, std::string& output) {
+
+  StringTable strings;
+  uint32_t world_index = strings.get_index(data.world);
+  uint32_t tileset_index = strings.get_index(data.tileset_id);
+  uint32_t music_index = strings.get_index(data.music_id);
+  for (unsigned int i = 0; i < data.entities.size(); i++) {
+
+    const std::vector<FieldData>& fields = data.entities[i].fields;
+    for (unsigned int j = 0; j < fields.size(); j++) {
+      strings.get_index(fields[j].key);
+      if (fields[j].type == FIELD_STRING) {
+        strings.get_index(fields[j].string_value);
+      }
+    }
+  }
+
+  // Header.
+  output.assign(binary_map_magic, sizeof(binary_map_magic));
+  write_uint32(output, data.source_size);
+  write_uint32(output, data.source_hash);
+  write_uint32(output, uint32_t(data.x));
+  write_uint32(output, uint32_t(data.y));
+  write_uint32(output, uint32_t(data.width));
+  write_uint32(output, uint32_t(data.height));
+  write_uint32(output, uint32_t(data.floor));
+  write_uint32(output, world_index);
+  write_uint32(output, tileset_index);
+  write_uint32(output, music_index);
+  write_uint32(output, uint32_t(strings.strings.size()));
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+    write_uint32(output, uint32_t(data.tiles[layer].size()));
+  }
+  write_uint32(output, uint32_t(data.entities.size()));
+
+  // String table.
+  for (unsigned int i = 0; i < strings.strings.size(); i++) {
+    write_uint32(output, uint32_t(strings.strings[i].size()));
+    output.append(strings.strings[i]);
+  }
+
+  // Tiles.
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+
+    const std::vector<TileData>& tiles = data.tiles[layer];
+    for (unsigned int i = 0; i < tiles.size(); i++) {
+      write_uint32(output, uint32_t(tiles[i].x));
+      write_uint32(output, uint32_t(tiles[i].y));
+      write_uint32(output, uint32_t(tiles[i].width));
+      write_uint32(output, uint32_t(tiles[i].height));
+      write_uint32(output, uint32_t(tiles[i].pattern));
+    }
+  }
+
+  // Other entities.
+  for (unsigned int i = 0; i < data.entities.size(); i++) {
+
+    const EntityData& entity = data.entities[i];
+    write_uint32(output, uint32_t(entity.type));
+    write_uint32(output, uint32_t(entity.fields.size()));
+    for (unsigned int j = 0; j < entity.fields.size(); j++) {
+
+      const FieldData& field = entity.fields[j];
+      write_uint32(output, strings.get_index(field.key));
+      write_uint32(output, uint32_t(field.type));
+      if (field.type == FIELD_STRING) {
+        write_uint32(output, strings.get_index(field.string_value));
+      }
+      else {
+        write_uint32(output, uint32_t(field.int_value));
+      }
+    }
+  }
+}
+
+/**
+ * @brief Reads the content of a binary map file.
+ *
+ * The strings and the records of the file are copied into data,
+ * so the buffer does not have to live longer than this call.
+ *
+ * @param buffer The content of the binary map file.
+ * @param size Size of the binary map file in bytes.
+ * @param data Receives the properties and the entities of the map.
+ * @return false if the file is not a valid binary map file.
+ */
+bool MapLoader::parse_binary_map(const char* buffer, size_t size, MapData& data) {
+
+  const char* position = buffer;
+  const char* end = buffer + size;
+  if (size < sizeof(binary_map_magic)
+      || std::memcmp(buffer, binary_map_magic, sizeof(binary_map_magic)) != 0) {
+    return false;
+  }
+  position += sizeof(binary_map_magic);
+
+  // Header.
+  bool valid = true;
+  data.source_size = read_uint32(position, end, valid);
+  data.source_hash = read_uint32(position, end, valid);
+  data.x = int(read_uint32(position, end, valid));
+  data.y = int(read_uint32(position, end, valid));
+  data.width = int(read_uint32(position, end, valid));
+  data.height = int(read_uint32(position, end, valid));
+  data.floor = int(read_uint32(position, end, valid));
+  uint32_t world_index = read_uint32(position, end, valid);
+  uint32_t tileset_index = read_uint32(position, end, valid);
+  uint32_t music_index = read_uint32(position, end, valid);
+  uint32_t nb_strings = read_uint32(position, end, valid);
+  uint32_t nb_tiles[LAYER_NB];
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+    nb_tiles[layer] = read_uint32(position, end, valid);
+  }
+  uint32_t nb_entities = read_uint32(position, end, valid);
+  if (!valid) {
+    return false;
+  }
+
+  // String table.
+  std::vector<std::string> strings;
+  strings.reserve(std::min(nb_strings, uint32_t(size)));
+  for (uint32_t i = 0; i < nb_strings && valid; i++) {
+    uint32_t length = read_uint32(position, end, valid);
+    if (!valid || uint32_t(end - position) < length) {
+      return false;
+    }
+    strings.push_back(std::string(position, length));
+    position += length;
+  }
+  if (!valid || world_index >= nb_strings || tileset_index >= nb_strings
+      || music_index >= nb_strings) {
+    return false;
+  }
+  data.world = strings[world_index];
+  data.tileset_id = strings[tileset_index];
+  data.music_id = strings[music_index];
+
+  // Tiles.
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+
+    if (uint32_t(end - position) / 20 < nb_tiles[layer]) {
+      return false;
+    }
+    std::vector<TileData>& tiles = data.tiles[layer];
+    tiles.resize(nb_tiles[layer]);
+    for (uint32_t i = 0; i < nb_tiles[layer]; i++) {
+      tiles[i].x = int(read_uint32(position, end, valid));
+      tiles[i].y = int(read_uint32(position, end, valid));
+      tiles[i].width = int(read_uint32(position, end, valid));
+      tiles[i].height = int(read_uint32(position, end, valid));
+      tiles[i].pattern = int(read_uint32(position, end, valid));
+    }
+  }
+
+  // Other entities.
+  data.entities.reserve(std::min(nb_entities, uint32_t(size)));
+  for (uint32_t i = 0; i < nb_entities && valid; i++) {
+
+    EntityData entity;
+    entity.type = int(read_uint32(position, end, valid));
+    uint32_t nb_fields = read_uint32(position, end, valid);
+    if (!valid || entity.type < 0 || entity.type >= nb_entity_creation_functions
+        || uint32_t(end - position) / 12 < nb_fields) {
+      return false;
+    }
+
+    entity.fields.resize(nb_fields);
+    for (uint32_t j = 0; j < nb_fields; j++) {
+
+      FieldData& field = entity.fields[j];
+      uint32_t key_index = read_uint32(position, end, valid);
+      uint32_t type = read_uint32(position, end, valid);
+      uint32_t value = read_uint32(position, end, valid);
+      if (key_index >= nb_strings || type > FIELD_BOOLEAN
+          || (type == FIELD_STRING && value >= nb_strings)) {
+        return false;
+      }
+      field.key = strings[key_index];
+      field.type = FieldType(type);
+      field.int_value = int(value);
+      if (field.type == FIELD_STRING) {
+        field.string_value = strings[value];
+      }
+    }
+    data.entities.push_back(entity);
+  }
+
+  return valid && position == end;
+}
+
+/**
+ * @brief Starts reading in advance the maps where the hero may go next.
+ *
+ * The maps are read by a separate thread, in the order of the list.
+ * Maps previously read in advance and not in the list are forgotten.
+ *
+ * @param map_ids Ids of the maps to read.
+ */
+void MapLoader::prefetch_maps(const std::vector<std::string>& map_ids) {
+
+  if (prefetch_thread == NULL) {
+    prefetch_mutex = SDL_CreateMutex();
+    prefetch_cond = SDL_CreateCond();
+    prefetch_thread = SDL_CreateThread(read_prefetched_maps, NULL);
+  }
+
+  SDL_LockMutex(prefetch_mutex);
+
+  // forget the maps that are no longer needed
+  std::map<std::string, PrefetchedMap>::iterator it = prefetched_maps.begin();
+  while (it != prefetched_maps.end()) {
+
+    if (it->first == prefetch_current
+        || std::find(map_ids.begin(), map_ids.end(), it->first) != map_ids.end()) {
+      ++it;
+      continue;
+    }
+
+    if (it->second.data != NULL) {
+      prefetched_size -= it->second.size;
+      delete it->second.data;
+    }
+    prefetch_requests.remove(it->first);
+    prefetched_maps.erase(it++);
+  }
+
+  for (unsigned int i = 0; i < map_ids.size(); i++) {
+
+    if (prefetched_maps.count(map_ids[i]) == 0) {
+      PrefetchedMap& prefetched_map = prefetched_maps[map_ids[i]];
+      prefetched_map.data = NULL;
+      prefetched_map.size = 0;
+      prefetched_map.done = false;
+      prefetch_requests.push_back(map_ids[i]);
+    }
+  }
+
+  SDL_CondBroadcast(prefetch_cond);
+  SDL_UnlockMutex(prefetch_mutex);
+}
+
+/**
+ * @brief Starts decoding the tilesets of the maps read in advance.
+ *
+ * The prefetching thread gives the tileset of each map it has read,
+ * and this function, called at each cycle by the main thread, passes
+ * them to Tileset::prefetch().
+ */
+void MapLoader::update() {
+
+  if (prefetch_thread == NULL) {
+    return;
+  }
+
+  std::vector<std::string> tileset_ids;
+  SDL_LockMutex(prefetch_mutex);
+  tileset_ids.swap(prefetch_tileset_ids);
+  SDL_UnlockMutex(prefetch_mutex);
+
+  for (unsigned int i = 0; i < tileset_ids.size(); i++) {
+    Tileset::prefetch(tileset_ids[i]);
+  }
+}
+
+/**
+ * @brief Stops the prefetching thread and frees the maps read in advance.
+ */
+void MapLoader::quit() {
+
+  if (prefetch_thread == NULL) {
+    return;
+  }
+
+  SDL_LockMutex(prefetch_mutex);
+  prefetch_stopping = true;
+  SDL_CondBroadcast(prefetch_cond);
+  SDL_UnlockMutex(prefetch_mutex);
+  SDL_WaitThread(prefetch_thread, NULL);
+  prefetch_thread = NULL;
+
+  SDL_DestroyCond(prefetch_cond);
+  prefetch_cond = NULL;
+  SDL_DestroyMutex(prefetch_mutex);
+  prefetch_mutex = NULL;
+  prefetch_stopping = false;
+
+  std::map<std::string, PrefetchedMap>::iterator it;
+  for (it = prefetched_maps.begin(); it != prefetched_maps.end(); ++it) {
+    delete it->second.data;
+  }
+  prefetched_maps.clear();
+  prefetch_requests.clear();
+  prefetch_tileset_ids.clear();
+  prefetch_current.clear();
+  prefetched_size = 0;
+}
+
+/**
+ * @brief Returns the number of maps loaded from data read in advance,
+ * since the beginning of the program.
+ * @return the number of prefetch hits
+ */
+int MapLoader::get_nb_prefetch_hits() {
+  return nb_prefetch_hits;
+}
+
+/**
+ * @brief Returns the number of maps loaded without data read in advance,
+ * since the beginning of the program.
+ * @return the number of prefetch misses
+ */
+int MapLoader::get_nb_prefetch_misses() {
+  return nb_prefetch_misses;
+}
+
+/**
+ * @brief Returns the number of maps read in advance but dropped because
+ * of the memory limit, since the beginning of the program.
+ * @return the number of maps discarded
+ */
+int MapLoader::get_nb_prefetch_discarded() {
+  return nb_prefetch_discarded;
+}
+
+/**
+ * @brief Takes the content of a map read in advance.
+ *
+ * If the prefetching thread is reading this map, waits for it.
+ * If the map is still waiting to be read, the request is cancelled.
+ *
+ * @param map_id Id of a map.
+ * @return The content of the map (to be deleted by the caller),
+ * or NULL if it was not read in advance.
+ */
+MapLoader::MapData* MapLoader::take_prefetched_map(const std::string& map_id) {
+
+  if (prefetch_thread == NULL) {
+    return NULL;
+  }
+
+  SDL_LockMutex(prefetch_mutex);
+  MapData* data = NULL;
+  std::map<std::string, PrefetchedMap>::iterator it = prefetched_maps.find(map_id);
+  if (it != prefetched_maps.end()) {
+
+    if (prefetch_current == map_id) {
+      while (!it->second.done) {
+        SDL_CondWait(prefetch_cond, prefetch_mutex);
+      }
+    }
+
+    if (it->second.done) {
+      data = it->second.data;
+      prefetched_size -= it->second.size;
+    }
+    else {
+      prefetch_requests.remove(map_id);
+    }
+    prefetched_maps.erase(it);
+  }
+  SDL_UnlockMutex(prefetch_mutex);
+
+  return data;
+}
+
+/**
+ * @brief Reads the content of a map without using the data file cache
+ * nor the Lua context of the game.
+ *
+ * This function is thread-safe. The binary map file is used if it
+ * corresponds to the Lua data file.
+ *
+ * @param map_id Id of a map.
+ * @param data Receives the content of the map.
+ * @return false if the map could not be read.
+ */
+bool MapLoader::read_prefetched_map(const std::string& map_id, MapData& data) {
+
+  const std::string& file_name = std::string("maps/") + map_id + ".dat";
+  const std::string& binary_file_name = std::string("maps/") + map_id + ".map";
+
+  DataBuffer source = FileTools::data_file_read_uncached(file_name);
+  if (source.is_empty()) {
+    return false;
+  }
+  uint32_t source_size = uint32_t(source.get_size());
+  uint32_t source_hash = FileTools::get_hash(source.get_data(), source.get_size());
+
+  DataBuffer binary = FileTools::data_file_read_uncached(binary_file_name);
+  if (!binary.is_empty()
+      && parse_binary_map(binary.get_data(), binary.get_size(), data)
+      && data.source_size == source_size
+      && data.source_hash == source_hash) {
+    return true;
+  }
+
+  data = MapData();
+  data.source_size = source_size;
+  data.source_hash = source_hash;
+  lua_State* l = luaL_newstate();
+  bool valid = luaL_loadbuffer(l, source.get_data(), source.get_size(), file_name.c_str()) == 0
+      && run_map_data(l, data);
+  lua_close(l);
+
+  return valid;
+}
+
+/**
+ * @brief Returns an estimation of the memory used by the content of a map.
+ * @param data The content of a map.
+ * @return The number of bytes used.
+ */
+size_t MapLoader::get_map_data_size(const MapData& data) {
+
+  size_t size = sizeof(MapData);
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+    size += data.tiles[layer].size() * sizeof(TileData);
+  }
+  for (unsigned int i = 0; i < data.entities.size(); i++) {
+    const std::vector<FieldData>& fields = data.entities[i].fields;
+    size += sizeof(EntityData);
+    for (unsigned int j = 0; j < fields.size(); j++) {
+      size += sizeof(FieldData) + fields[j].key.size() + fields[j].string_value.size();
+    }
+  }
+  return size;
+}
+
+/**
+ * @brief Function executed by the thread that reads maps in advance.
+ *
+ * The thread waits for maps requested by prefetch_maps(), reads them and
+ * leaves them in prefetched_maps until load_map() takes them. A map is
+ * dropped if keeping it would exceed the memory limit.
+ *
+ * @param unused not used
+ * @return 0
+ */
+int MapLoader::read_prefetched_maps(void* unused) {
+
+  SDL_LockMutex(prefetch_mutex);
+  while (!prefetch_stopping) {
+
+    if (prefetch_requests.empty()) {
+      SDL_CondWait(prefetch_cond, prefetch_mutex);
+      continue;
+    }
+
+    prefetch_current = prefetch_requests.front();
+    prefetch_requests.pop_front();
+    const std::string map_id = prefetch_current;
+    SDL_UnlockMutex(prefetch_mutex);
+
+    MapData* data = new MapData();
+    size_t size = 0;
+    std::string tileset_id;
+    if (read_prefetched_map(map_id, *data)) {
+      size = get_map_data_size(*data);
+      tileset_id = data->tileset_id;
+    }
+    else {
+      delete data;
+      data = NULL;
+    }
+
+    SDL_LockMutex(prefetch_mutex);
+    if (data != NULL && prefetched_size + size > max_prefetched_size) {
+      delete data;
+      data = NULL;
+      size = 0;
+      nb_prefetch_discarded++;
+    }
+    prefetched_size += size;
+
+    PrefetchedMap& prefetched_map = prefetched_maps[map_id];
+    if (!tileset_id.empty()) {
+      prefetch_tileset_ids.push_back(tileset_id);
+    }
+    prefetched_map.data = data;
+    prefetched_map.size = size;
+    prefetched_map.done = true;
+    prefetch_current.clear();
+    SDL_CondBroadcast(prefetch_cond);
+  }
+  SDL_UnlockMutex(prefetch_mutex);
+
+  return 0;
+}
@@ -47,11 +47,7 @@ void QuestProperties::load() {
   // Read the quest properties file.
   const std::string& file_name = "quest.dat";
   lua_State* l = luaL_newstate();
-  size_t size;
-  char* buffer;
-  FileTools::data_file_open_buffer(file_name, &buffer, &size);
-  luaL_loadbuffer(l, buffer, size, file_name.c_str());
-  FileTools::data_file_close_buffer(buffer);
+  FileTools::data_file_load_lua(l, file_name);
 
   lua_register(l, "quest", l_quest);
   if (lua_pcall(l, 0, 0, 0) != 0) {
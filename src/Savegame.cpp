@@ -82,7 +82,7 @@ Savegame::Savegame(MainLoop& main_loop, const std::string& file_name):
   game(NULL) {
 
   const std::string& quest_write_dir = FileTools::get_quest_write_dir();
-  Debug::check_assertion(!quest_write_dir.empty(), "The quest write directory was not set");
+  SOLARUS_ASSERT(!quest_write_dir.empty(), "The quest write directory was not set");
   prefixed_file_name = quest_write_dir + "/" + file_name;
 
   if (!FileTools::data_file_exists(prefixed_file_name)) {
@@ -173,11 +173,9 @@ void Savegame::load() {
 
   // Try to parse as Lua first.
   lua_State* l = luaL_newstate();
-  size_t size;
-  char* buffer;
-  FileTools::data_file_open_buffer(prefixed_file_name, &buffer, &size);
-  int result = luaL_loadbuffer(l, buffer, size, prefixed_file_name.c_str());
-  FileTools::data_file_close_buffer(buffer);
+  const DataBuffer& buffer = FileTools::data_file_read(prefixed_file_name);
+  int result = luaL_loadbuffer(l, buffer.get_data(), buffer.get_size(),
+      prefixed_file_name.c_str());
 
   // Call Lua.
   if (result == 0) {
@@ -354,7 +352,7 @@ void Savegame::notify_game_finished() {
  */
 bool Savegame::is_string(const std::string& key) {
 
-  Debug::check_assertion(LuaContext::is_valid_lua_identifier(key), StringConcat() <<
+  SOLARUS_ASSERT(LuaContext::is_valid_lua_identifier(key),
       "Savegame variable '" << key << "' is not a valid key");
 
   bool result = false;
@@ -372,12 +370,12 @@ bool Savegame::is_string(const std::string& key) {
  */
 const std::string& Savegame::get_string(const std::string& key) {
 
-  Debug::check_assertion(LuaContext::is_valid_lua_identifier(key), StringConcat() <<
+  SOLARUS_ASSERT(LuaContext::is_valid_lua_identifier(key),
       "Savegame variable '" << key << "' is not a valid key");
 
   if (saved_values.count(key) > 0) {
     const SavedValue& value = saved_values[key];
-    Debug::check_assertion(value.type == SavedValue::VALUE_STRING, StringConcat() <<
+    SOLARUS_ASSERT(value.type == SavedValue::VALUE_STRING,
         "Value '" << key << "' is not a string");
     return value.string_data;
   }
@@ -393,7 +391,7 @@ const std::string& Savegame::get_string(const std::string& key) {
  */
 void Savegame::set_string(const std::string& key, const std::string& value) {
 
-  Debug::check_assertion(LuaContext::is_valid_lua_identifier(key), StringConcat() <<
+  SOLARUS_ASSERT(LuaContext::is_valid_lua_identifier(key),
       "Savegame variable '" << key << "' is not a valid key");
 
   saved_values[key].type = SavedValue::VALUE_STRING;
@@ -407,7 +405,7 @@ void Savegame::set_string(const std::string& key, const std::string& value) {
  */
 bool Savegame::is_integer(const std::string& key) {
 
-  Debug::check_assertion(LuaContext::is_valid_lua_identifier(key), StringConcat() <<
+  SOLARUS_ASSERT(LuaContext::is_valid_lua_identifier(key),
       "Savegame variable '" << key << "' is not a valid key");
 
   bool result = false;
@@ -425,13 +423,13 @@ bool Savegame::is_integer(const std::string& key) {
  */
 int Savegame::get_integer(const std::string& key) {
 
-  Debug::check_assertion(LuaContext::is_valid_lua_identifier(key), StringConcat() <<
+  SOLARUS_ASSERT(LuaContext::is_valid_lua_identifier(key),
       "Savegame variable '" << key << "' is not a valid key");
 
   int result = 0;
   if (saved_values.count(key) > 0) {
     const SavedValue& value = saved_values[key];
-    Debug::check_assertion(value.type == SavedValue::VALUE_INTEGER, StringConcat() <<
+    SOLARUS_ASSERT(value.type == SavedValue::VALUE_INTEGER,
         "Value '" << key << "' is not an integer");
     result = value.int_data;
   }
@@ -445,7 +443,7 @@ int Savegame::get_integer(const std::string& key) {
  */
 void Savegame::set_integer(const std::string& key, int value) {
 
-  Debug::check_assertion(LuaContext::is_valid_lua_identifier(key), StringConcat() <<
+  SOLARUS_ASSERT(LuaContext::is_valid_lua_identifier(key),
       "Savegame variable '" << key << "' is not a valid key");
 
   saved_values[key].type = SavedValue::VALUE_INTEGER;
@@ -459,7 +457,7 @@ void Savegame::set_integer(const std::string& key, int value) {
  */
 bool Savegame::is_boolean(const std::string& key) {
 
-  Debug::check_assertion(LuaContext::is_valid_lua_identifier(key), StringConcat() <<
+  SOLARUS_ASSERT(LuaContext::is_valid_lua_identifier(key),
       "Savegame variable '" << key << "' is not a valid key");
 
   bool result = false;
@@ -477,13 +475,13 @@ bool Savegame::is_boolean(const std::string& key) {
  */
 bool Savegame::get_boolean(const std::string& key) {
 
-  Debug::check_assertion(LuaContext::is_valid_lua_identifier(key), StringConcat() <<
+  SOLARUS_ASSERT(LuaContext::is_valid_lua_identifier(key),
       "Savegame variable '" << key << "' is not a valid key");
 
   bool result = false;
   if (saved_values.count(key) > 0) {
     const SavedValue& value = saved_values[key];
-    Debug::check_assertion(value.type == SavedValue::VALUE_BOOLEAN, StringConcat() <<
+    SOLARUS_ASSERT(value.type == SavedValue::VALUE_BOOLEAN,
         "Value '" << key << "' is not a boolean");
     result = value.int_data != 0;
   }
@@ -497,7 +495,7 @@ bool Savegame::get_boolean(const std::string& key) {
  */
 void Savegame::set_boolean(const std::string& key, bool value) {
 
-  Debug::check_assertion(LuaContext::is_valid_lua_identifier(key), StringConcat() <<
+  SOLARUS_ASSERT(LuaContext::is_valid_lua_identifier(key),
       "Savegame variable '" << key << "' is not a valid key");
 
   saved_values[key].type = SavedValue::VALUE_BOOLEAN;
@@ -510,7 +508,7 @@ void Savegame::set_boolean(const std::string& key, bool value) {
  */
 void Savegame::unset(const std::string& key) {
 
-  Debug::check_assertion(LuaContext::is_valid_lua_identifier(key), StringConcat() <<
+  SOLARUS_ASSERT(LuaContext::is_valid_lua_identifier(key),
       "Savegame variable '" << key << "' is not a valid key");
 
   saved_values.erase(key);
@@ -19,7 +19,6 @@
 #include "lowlevel/InputEvent.h"
 #include "lowlevel/FileTools.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 #include <cstring>
 
 /**
@@ -29,18 +28,14 @@
  */
 SavegameConverterV1::SavegameConverterV1(const std::string& file_name) {
 
-  Debug::check_assertion(FileTools::data_file_exists(file_name), StringConcat() <<
+  SOLARUS_ASSERT(FileTools::data_file_exists(file_name),
       "Cannot convert savegame '" << file_name << "' since it does not exist");
 
   // Let's load this obsolete savegame.
-  size_t size;
-  char *buffer;
-
-  FileTools::data_file_open_buffer(file_name, &buffer, &size);
-  Debug::check_assertion(size == sizeof(SavedData), StringConcat()
-      << "Cannot read savegame file version 1 '" << file_name << "': invalid file size");
-  memcpy(&saved_data, buffer, sizeof(SavedData));
-  FileTools::data_file_close_buffer(buffer);
+  const DataBuffer& buffer = FileTools::data_file_read(file_name);
+  SOLARUS_ASSERT(buffer.get_size() == sizeof(SavedData),
+      "Cannot read savegame file version 1 '" << file_name << "': invalid file size");
+  memcpy(&saved_data, buffer.get_data(), sizeof(SavedData));
 }
 
 /**
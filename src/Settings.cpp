@@ -37,11 +37,8 @@ bool Settings::load(const std::string& file_name) {
 
   // Read the settings as a Lua data file.
   lua_State* l = luaL_newstate();
-  size_t size;
-  char* buffer;
-  FileTools::data_file_open_buffer(prefixed_file_name, &buffer, &size);
-  luaL_loadbuffer(l, buffer, size, prefixed_file_name.c_str());
-  FileTools::data_file_close_buffer(buffer);
+  const DataBuffer& buffer = FileTools::data_file_read(prefixed_file_name);
+  luaL_loadbuffer(l, buffer.get_data(), buffer.get_size(), prefixed_file_name.c_str());
 
   if (lua_pcall(l, 0, 0, 0) != 0) {
     lua_pop(l, 1);
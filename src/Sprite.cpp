@@ -26,7 +26,6 @@
 #include "lowlevel/System.h"
 #include "lowlevel/Surface.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 
 std::map<std::string, SpriteAnimationSet*> Sprite::all_animation_sets;
 
@@ -77,7 +76,10 @@ Sprite::Sprite(const std::string &id):
   lua_context(NULL),
   animation_set_id(id),
   animation_set(get_animation_set(id)),
+  current_animation_id(-1),
+  current_animation(NULL),
   current_direction(0),
+  current_animation_direction(NULL),
   current_frame(-1),
   suspended(false),
   ignore_suspend(false),
@@ -87,7 +89,7 @@ Sprite::Sprite(const std::string &id):
   intermediate_surface(NULL),
   blink_delay(0) {
 
-  set_current_animation(animation_set.get_default_animation());
+  set_current_animation(animation_set.get_default_animation_id());
 }
 
 /**
@@ -162,9 +164,7 @@ bool Sprite::are_pixel_collisions_enabled() const {
  * @return the size of a frame
  */
 const Rectangle& Sprite::get_size() const {
-
-  const SpriteAnimation *animation = animation_set.get_animation(current_animation_name);
-  return animation->get_direction(current_direction)->get_size();
+  return current_animation_direction->get_size();
 }
 
 /**
@@ -180,9 +180,7 @@ const Rectangle& Sprite::get_max_size() const {
  * @return the origin point of a frame
  */
 const Rectangle& Sprite::get_origin() const {
-
-  const SpriteAnimation *animation = animation_set.get_animation(current_animation_name);
-  return animation->get_direction(current_direction)->get_origin();
+  return current_animation_direction->get_origin();
 }
 
 /**
@@ -223,7 +221,15 @@ int Sprite::get_next_frame() const {
  * @return the name of the current animation of the sprite
  */
 const std::string& Sprite::get_current_animation() const {
-  return current_animation_name;
+  return SpriteAnimationSet::get_animation_name(current_animation_id);
+}
+
+/**
+ * @brief Returns the id of the current animation of the sprite.
+ * @return the id of the current animation of the sprite
+ */
+int Sprite::get_current_animation_id() const {
+  return current_animation_id;
 }
 
 /**
@@ -236,12 +242,29 @@ const std::string& Sprite::get_current_animation() const {
  */
 void Sprite::set_current_animation(const std::string& animation_name) {
 
-  if (animation_name != this->current_animation_name || !is_animation_started()) {
+  int animation_id = SpriteAnimationSet::find_animation_id(animation_name);
+  SOLARUS_ASSERT(animation_set.has_animation(animation_id),
+      "No animation '" << animation_name << "' in sprite '" << get_animation_set_id() << "'");
+  set_current_animation(animation_id);
+}
+
+/**
+ * @brief Sets the current animation of the sprite.
+ *
+ * If the sprite is already playing another animation, this animation is interrupted.
+ * If the sprite is already playing the same animation, nothing is done.
+ *
+ * @param animation_id id of the new animation of the sprite
+ */
+void Sprite::set_current_animation(int animation_id) {
+
+  if (animation_id != this->current_animation_id || !is_animation_started()) {
 
-    SpriteAnimation* animation = animation_set.get_animation(animation_name);
+    SpriteAnimation* animation = animation_set.get_animation(animation_id);
 
-    this->current_animation_name = animation_name;
+    this->current_animation_id = animation_id;
     this->current_animation = animation;
+    update_current_animation_direction();
     set_frame_delay(animation->get_frame_delay());
     set_current_frame(0);
   }
@@ -256,6 +279,15 @@ bool Sprite::has_animation(const std::string& animation_name) {
   return animation_set.has_animation(animation_name);
 }
 
+/**
+ * @brief Returns whether this sprite has an animation with the specified id.
+ * @param animation_id an animation id
+ * @return true if this animation exists
+ */
+bool Sprite::has_animation(int animation_id) {
+  return animation_set.has_animation(animation_id);
+}
+
 /**
  * @brief Returns the current direction of the sprite's animation.
  * @return the current direction
@@ -275,17 +307,34 @@ void Sprite::set_current_direction(int current_direction) {
 
   if (current_direction != this->current_direction) {
 
-    Debug::check_assertion(current_direction >= 0
+    SOLARUS_ASSERT(current_direction >= 0
         && current_direction < current_animation->get_nb_directions(),
-        StringConcat() << "Invalid direction of sprite '" << get_animation_set_id()
-        << "' in animation '" << current_animation_name
+        "Invalid direction of sprite '" << get_animation_set_id()
+        << "' in animation '" << get_current_animation()
         << "': " << current_direction);
 
     this->current_direction = current_direction;
+    update_current_animation_direction();
     set_current_frame(0);
   }
 }
 
+/**
+ * @brief Updates the pointer to the current direction of the current animation.
+ *
+ * This function is called when the animation or the direction changes.
+ */
+void Sprite::update_current_animation_direction() {
+
+  if (current_direction >= 0 && current_direction < current_animation->get_nb_directions()) {
+    current_animation_direction = current_animation->get_direction(current_direction);
+  }
+  else {
+    // the caller is about to change the direction
+    current_animation_direction = NULL;
+  }
+}
+
 /**
  * @brief Returns the current frame of the sprite's animation.
  * @return the current frame
@@ -329,7 +378,7 @@ void Sprite::set_frame_changed(bool frame_changed) {
 
   this->frame_changed = frame_changed;
   if (lua_context != NULL) {
-    lua_context->sprite_on_frame_changed(*this, current_animation_name, current_frame);
+    lua_context->sprite_on_frame_changed(*this, get_current_animation(), current_frame);
   }
 }
 
@@ -479,8 +528,7 @@ bool Sprite::is_animation_finished() const {
  */
 bool Sprite::is_last_frame_reached() const {
 
-  const SpriteAnimationDirection* direction = current_animation->get_direction(current_direction);
-  return get_current_frame() == direction->get_nb_frames() - 1;
+  return get_current_frame() == current_animation_direction->get_nb_frames() - 1;
 }
 
 /**
@@ -516,12 +564,12 @@ void Sprite::set_blinking(uint32_t blink_delay) {
  */
 bool Sprite::test_collision(Sprite& other, int x1, int y1, int x2, int y2) const {
 
-  const SpriteAnimationDirection* direction1 = current_animation->get_direction(current_direction);
+  const SpriteAnimationDirection* direction1 = current_animation_direction;
   const Rectangle &origin1 = direction1->get_origin();
   const Rectangle location1(x1 - origin1.get_x(), y1 - origin1.get_y());
   const PixelBits& pixel_bits1 = direction1->get_pixel_bits(current_frame);
 
-  const SpriteAnimationDirection* direction2 = other.current_animation->get_direction(other.current_direction);
+  const SpriteAnimationDirection* direction2 = other.current_animation_direction;
   const Rectangle& origin2 = direction2->get_origin();
   const Rectangle location2(x2 - origin2.get_x(), y2 - origin2.get_y());
   const PixelBits& pixel_bits2 = direction2->get_pixel_bits(other.current_frame);
@@ -547,7 +595,7 @@ void Sprite::update() {
 
   // update the current frame
   if (synchronize_to == NULL
-      || current_animation_name != synchronize_to->get_current_animation()) {
+      || current_animation_id != synchronize_to->get_current_animation_id()) {
     // update the frames normally (with the time)
     int next_frame;
     while (!finished && !suspended && !paused && get_frame_delay() > 0
@@ -560,7 +608,7 @@ void Sprite::update() {
       if (next_frame == -1) {
         finished = true;
         if (lua_context != NULL) {
-          lua_context->sprite_on_animation_finished(*this, current_animation_name);
+          lua_context->sprite_on_animation_finished(*this, get_current_animation());
         }
       }
       else {
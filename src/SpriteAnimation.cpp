@@ -20,7 +20,6 @@
 #include "entities/Tileset.h"
 #include "lowlevel/Surface.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 
 /**
  * @brief Constructor.
@@ -119,8 +118,8 @@ bool SpriteAnimation::is_looping() const {
  */
 int SpriteAnimation::get_next_frame(int current_direction, int current_frame) const {
 
-  Debug::check_assertion(current_direction >= 0 && current_direction < nb_directions,
-    StringConcat() << "Invalid sprite direction '" << current_direction
+  SOLARUS_ASSERT(current_direction >= 0 && current_direction < nb_directions,
+    "Invalid sprite direction '" << current_direction
     << "': this sprite animation has only " << nb_directions << " direction(s)");
 
   int next_frame = current_frame + 1;
@@ -155,9 +155,9 @@ bool SpriteAnimationDirection::are_pixel_collisions_enabled() const {
  */
 PixelBits& SpriteAnimationDirection::get_pixel_bits(int frame) const {
 
-  SOLARUS_ASSERT(pixel_bits != NULL,
+  SOLARUS_ASSERT_PARANOID(pixel_bits != NULL,
       "Pixel-precise collisions are not enabled for this sprite");
-  SOLARUS_ASSERT(frame >= 0 && frame < nb_frames, "Invalid frame number");
+  SOLARUS_ASSERT_PARANOID(frame >= 0 && frame < nb_frames, "Invalid frame number");
 
   return *pixel_bits[frame];
 }
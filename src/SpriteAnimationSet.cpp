@@ -21,11 +21,15 @@
 #include "lowlevel/Debug.h"
 #include "lowlevel/StringConcat.h"
 
+std::map<std::string, int> SpriteAnimationSet::animation_ids;
+std::deque<std::string> SpriteAnimationSet::animation_names;
+
 /**
  * @brief Loads the animations of a sprite from a file.
  * @param id id of the sprite (used to determine the sprite file)
  */
-SpriteAnimationSet::SpriteAnimationSet(const std::string& id) {
+SpriteAnimationSet::SpriteAnimationSet(const std::string& id):
+  default_animation_id(-1) {
 
   // compute the file name
   std::string file_name = (std::string) "sprites/" + id + ".dat";
@@ -104,14 +108,18 @@ SpriteAnimationSet::SpriteAnimationSet(const std::string& id) {
       directions[i] = new SpriteAnimationDirection(nb_frames, positions_in_src, x_origin, y_origin);
     }
 
-    Debug::check_assertion(animations.count(name) == 0,
-        StringConcat() << "Animation '" << name << "' is defined twice in sprite '" << id << "'");
-    animations[name] = new SpriteAnimation(image_file_name, nb_directions, directions,
+    int animation_id = get_animation_id(name);
+    SOLARUS_ASSERT(!has_animation(animation_id),
+        "Animation '" << name << "' is defined twice in sprite '" << id << "'");
+    if (animation_id >= int(animations.size())) {
+      animations.resize(animation_id + 1, NULL);
+    }
+    animations[animation_id] = new SpriteAnimation(image_file_name, nb_directions, directions,
 					   frame_delay, loop_on_frame);
 
     // default animation
-    if (animations.size() == 1) {
-      default_animation_name = name;
+    if (default_animation_id == -1) {
+      default_animation_id = animation_id;
     }
   }
 
@@ -124,10 +132,8 @@ SpriteAnimationSet::SpriteAnimationSet(const std::string& id) {
 SpriteAnimationSet::~SpriteAnimationSet() {
 
   // delete the animations
-  std::map<std::string, SpriteAnimation*>::const_iterator it;
-
-  for (it = animations.begin(); it != animations.end(); it++) {
-    delete it->second;
+  for (unsigned int i = 0; i < animations.size(); i++) {
+    delete animations[i];
   }
 }
 
@@ -140,11 +146,60 @@ SpriteAnimationSet::~SpriteAnimationSet() {
  */
 void SpriteAnimationSet::set_map(Map &map) {
 
-  std::map<std::string, SpriteAnimation*>::const_iterator it;
+  for (unsigned int i = 0; i < animations.size(); i++) {
+    if (animations[i] != NULL) {
+      animations[i]->set_map(map);
+    }
+  }
+}
+
+/**
+ * @brief Returns the id of an animation name, interning it if necessary.
+ *
+ * The id is the same for all animation sets, even the ones that do not
+ * have this animation.
+ *
+ * @param animation_name an animation name
+ * @return the id of this name
+ */
+int SpriteAnimationSet::get_animation_id(const std::string& animation_name) {
+
+  std::map<std::string, int>::iterator it = animation_ids.find(animation_name);
+  if (it != animation_ids.end()) {
+    return it->second;
+  }
+
+  int animation_id = int(animation_names.size());
+  animation_ids[animation_name] = animation_id;
+  animation_names.push_back(animation_name);
+  return animation_id;
+}
+
+/**
+ * @brief Returns the id of an animation name without interning it.
+ * @param animation_name an animation name
+ * @return the id of this name, or -1 if no animation has this name
+ */
+int SpriteAnimationSet::find_animation_id(const std::string& animation_name) {
 
-  for (it = animations.begin(); it != animations.end(); it++) {
-    it->second->set_map(map);
+  std::map<std::string, int>::iterator it = animation_ids.find(animation_name);
+  if (it == animation_ids.end()) {
+    return -1;
   }
+  return it->second;
+}
+
+/**
+ * @brief Returns the name of an animation id.
+ * @param animation_id an id returned by get_animation_id()
+ * @return the corresponding animation name
+ */
+const std::string& SpriteAnimationSet::get_animation_name(int animation_id) {
+
+  SOLARUS_ASSERT(animation_id >= 0 && animation_id < int(animation_names.size()),
+      "Invalid animation id: " << animation_id);
+
+  return animation_names[animation_id];
 }
 
 /**
@@ -153,7 +208,7 @@ void SpriteAnimationSet::set_map(Map &map) {
  * @return true if this animation exists
  */
 bool SpriteAnimationSet::has_animation(const std::string& animation_name) const {
-  return animations.count(animation_name) > 0;
+  return has_animation(find_animation_id(animation_name));
 }
 
 /**
@@ -163,10 +218,11 @@ bool SpriteAnimationSet::has_animation(const std::string& animation_name) const
  */
 const SpriteAnimation* SpriteAnimationSet::get_animation(const std::string& animation_name) const {
 
-  Debug::check_assertion(has_animation(animation_name),
-      StringConcat() << "No animation '" << animation_name << "' in this animation set");
+  int animation_id = find_animation_id(animation_name);
+  SOLARUS_ASSERT(has_animation(animation_id),
+      "No animation '" << animation_name << "' in this animation set");
 
-  return animations.find(animation_name)->second; // the [] operator is not const in std::map
+  return animations[animation_id];
 }
 
 /**
@@ -176,10 +232,37 @@ const SpriteAnimation* SpriteAnimationSet::get_animation(const std::string& anim
  */
 SpriteAnimation* SpriteAnimationSet::get_animation(const std::string& animation_name) {
 
-  Debug::check_assertion(has_animation(animation_name),
-      StringConcat() << "No animation '" << animation_name << "' in this animation set");
+  int animation_id = find_animation_id(animation_name);
+  SOLARUS_ASSERT(has_animation(animation_id),
+      "No animation '" << animation_name << "' in this animation set");
+
+  return animations[animation_id];
+}
+
+/**
+ * @brief Returns an animation.
+ * @param animation_id id of the animation to get
+ * @return the specified animation
+ */
+const SpriteAnimation* SpriteAnimationSet::get_animation(int animation_id) const {
+
+  SOLARUS_ASSERT(has_animation(animation_id),
+      "No animation '" << get_animation_name(animation_id) << "' in this animation set");
+
+  return animations[animation_id];
+}
+
+/**
+ * @brief Returns an animation.
+ * @param animation_id id of the animation to get
+ * @return the specified animation
+ */
+SpriteAnimation* SpriteAnimationSet::get_animation(int animation_id) {
+
+  SOLARUS_ASSERT(has_animation(animation_id),
+      "No animation '" << get_animation_name(animation_id) << "' in this animation set");
 
-  return animations[animation_name];
+  return animations[animation_id];
 }
 
 /**
@@ -187,7 +270,15 @@ SpriteAnimation* SpriteAnimationSet::get_animation(const std::string& animation_
  * @return the name of the default animation
  */
 const std::string& SpriteAnimationSet::get_default_animation() const {
-  return default_animation_name;
+  return get_animation_name(default_animation_id);
+}
+
+/**
+ * @brief Returns the id of the default animation, i.e. the first one.
+ * @return the id of the default animation
+ */
+int SpriteAnimationSet::get_default_animation_id() const {
+  return default_animation_id;
 }
 
 /**
@@ -197,10 +288,10 @@ void SpriteAnimationSet::enable_pixel_collisions() {
 
   if (!are_pixel_collisions_enabled()) {
 
-    std::map<std::string, SpriteAnimation*>::const_iterator it;
-
-    for (it = animations.begin(); it != animations.end(); it++) {
-      it->second->enable_pixel_collisions();
+    for (unsigned int i = 0; i < animations.size(); i++) {
+      if (animations[i] != NULL) {
+        animations[i]->enable_pixel_collisions();
+      }
     }
   }
 }
@@ -210,7 +301,7 @@ void SpriteAnimationSet::enable_pixel_collisions() {
  * @return true if the pixel-perfect collisions are enabled
  */
 bool SpriteAnimationSet::are_pixel_collisions_enabled() const {
-  return animations.begin()->second->are_pixel_collisions_enabled();
+  return animations[default_animation_id]->are_pixel_collisions_enabled();
 }
 
 /**
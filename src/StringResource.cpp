@@ -17,7 +17,6 @@
 #include "StringResource.h"
 #include "lowlevel/FileTools.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 
 std::map<std::string, std::string> StringResource::strings;
 
@@ -60,8 +59,8 @@ void StringResource::initialize() {
  
     // get the key
     size_t index = line.find_first_of(" \t");
-    Debug::check_assertion(index != std::string::npos,
-	StringConcat() << "strings.dat, line " << i
+    SOLARUS_ASSERT(index != std::string::npos,
+	"strings.dat, line " << i
 	<< ": invalid line (expected a key and a value)");
     std::string key = line.substr(0, index);
 
@@ -71,8 +70,8 @@ void StringResource::initialize() {
     } while (index < line.size()
 	&& (line[index] == ' ' || line[index] == '\t'));
 
-    Debug::check_assertion(index < line.size(),
-      StringConcat() << "strings.dat, line " << i
+    SOLARUS_ASSERT(index < line.size(),
+      "strings.dat, line " << i
       << ": the value of key '" << key << "' is missing");
     strings[key] = line.substr(index);
   }
@@ -94,8 +93,8 @@ void StringResource::quit() {
  */
 const std::string& StringResource::get_string(const std::string& key) {
 
-  Debug::check_assertion(strings.count(key) > 0, StringConcat()
-      << "Cannot find string with key '" << key << "'");
+  SOLARUS_ASSERT(strings.count(key) > 0,
+      "Cannot find string with key '" << key << "'");
   return strings[key];
 }
 
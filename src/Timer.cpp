@@ -116,6 +116,22 @@ bool Timer::is_finished() {
   return finished;
 }
 
+/**
+ * @brief Returns the next date when calling update() has an effect.
+ *
+ * This is the expiration date, or the date of the next clock sound
+ * if it comes first. The result is meaningless while the timer is suspended.
+ *
+ * @return the date when this timer should be updated again
+ */
+uint32_t Timer::get_next_update_date() {
+
+  if (is_with_sound() && next_sound_date < expiration_date) {
+    return next_sound_date;
+  }
+  return expiration_date;
+}
+
 /**
  * @brief Updates the timer.
  */
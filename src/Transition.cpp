@@ -83,7 +83,7 @@ Transition::Direction Transition::get_direction() {
  */
 void Transition::set_previous_surface(Surface *previous_surface) {
 
-  Debug::check_assertion(get_direction() != OUT, "Cannot show a previous surface with an OUT transition effect");
+  SOLARUS_ASSERT(get_direction() != OUT, "Cannot show a previous surface with an OUT transition effect");
 
   this->previous_surface = previous_surface;
 }
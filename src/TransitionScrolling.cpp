@@ -156,7 +156,7 @@ void TransitionScrolling::draw(Surface& dst_surface) {
     return;
   }
 
-  Debug::check_assertion(previous_surface != NULL,
+  SOLARUS_ASSERT(previous_surface != NULL,
       "No previous surface defined for scrolling");
 
   // draw the old map
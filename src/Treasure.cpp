@@ -27,7 +27,6 @@
 #include "lua/LuaContext.h"
 #include "lowlevel/Surface.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 
 /**
  * @brief Creates a new treasure.
@@ -99,9 +98,9 @@ Treasure& Treasure::operator=(const Treasure& other) {
  */
 void Treasure::check_obtainable() const {
 
-  Debug::check_assertion(item_name.empty()
+  SOLARUS_ASSERT(item_name.empty()
       || game->get_equipment().get_item(item_name).is_obtainable(),
-      StringConcat() << "Treasure '" << item_name
+      "Treasure '" << item_name
       << "' is not allowed, did you call ensure_obtainable()?");
 }
 
@@ -237,6 +237,7 @@ void Block::notify_position_changed() {
   }
 
   check_collision_with_detectors(false);
+  get_map().notify_obstacles_changed();
 }
 
 /**
@@ -287,6 +288,10 @@ void Block::reset() {
   set_xy(initial_position);
   last_position.set_xy(initial_position);
   this->maximum_moves = initial_maximum_moves;
+
+  if (is_on_map()) {
+    get_map().notify_obstacles_changed();
+  }
 }
 
 /**
@@ -196,6 +196,7 @@ void CrystalBlock::update() {
     else {
       get_sprite().set_current_animation(orange_raised ? "blue_lowered" : "blue_raised");
     }
+    get_map().notify_obstacles_changed();
   }
   get_sprite().update();
 
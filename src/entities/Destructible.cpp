@@ -452,9 +452,9 @@ void Destructible::update() {
  */
 const std::string& Destructible::get_subtype_name(Subtype subtype) {
 
-  Debug::check_assertion(subtype >= 0 && subtype != DEPRECATED_1
-      && subtype < SUBTYPE_NUMBER, StringConcat()
-      << "Invalid destructible item subtype number: " << subtype);
+  SOLARUS_ASSERT(subtype >= 0 && subtype != DEPRECATED_1
+      && subtype < SUBTYPE_NUMBER,
+      "Invalid destructible item subtype number: " << subtype);
 
   return features[subtype].name;
 }
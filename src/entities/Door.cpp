@@ -21,7 +21,6 @@
 #include "lua/LuaContext.h"
 #include "lowlevel/FileTools.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 #include "lowlevel/Sound.h"
 #include "lowlevel/System.h"
 #include "lowlevel/Geometry.h"
@@ -151,6 +150,7 @@ void Door::set_open(bool door_open) {
 
   if (is_on_map()) {
     update_dynamic_tiles();
+    get_map().notify_obstacles_changed();
 
     if (is_saved()) {
       get_savegame().set_boolean(savegame_variable, door_open);
@@ -618,8 +618,8 @@ std::string Door::get_sword_tapping_sound() {
  */
 void Door::open() {
 
-  Debug::check_assertion(!is_open() || changing,
-      StringConcat() << "Door '" << get_name() << "' is already open");
+  SOLARUS_ASSERT(!is_open() || changing,
+      "Door '" << get_name() << "' is already open");
 
   if (changing) {
     if (is_open()) {
@@ -661,8 +661,8 @@ void Door::set_opening() {
  */
 void Door::close() {
 
-  Debug::check_assertion(is_open() || changing,
-      StringConcat() << "Door '" << get_name() << "' is already closed");
+  SOLARUS_ASSERT(is_open() || changing,
+      "Door '" << get_name() << "' is already closed");
 
   if (changing) {
     if (!is_open()) {
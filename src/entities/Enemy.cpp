@@ -508,7 +508,7 @@ const EnemyReaction::Reaction& Enemy::get_attack_consequence(EnemyAttack attack,
 void Enemy::set_attack_consequence(EnemyAttack attack,
     EnemyReaction::ReactionType reaction, int life_lost) {
 
-  Debug::check_assertion(life_lost >= 0, StringConcat() << "Invalid amount of life: " << life_lost);
+  SOLARUS_ASSERT(life_lost >= 0, "Invalid amount of life: " << life_lost);
   attack_reactions[attack].set_general_reaction(reaction, life_lost);
 }
 
@@ -522,7 +522,7 @@ void Enemy::set_attack_consequence(EnemyAttack attack,
 void Enemy::set_attack_consequence_sprite(Sprite& sprite, EnemyAttack attack,
     EnemyReaction::ReactionType reaction, int life_lost) {
 
-  Debug::check_assertion(life_lost >= 0, StringConcat() << "Invalid amount of life: " << life_lost);
+  SOLARUS_ASSERT(life_lost >= 0, "Invalid amount of life: " << life_lost);
   attack_reactions[attack].set_sprite_reaction(&sprite, reaction, life_lost);
 }
 
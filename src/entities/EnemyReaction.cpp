@@ -105,8 +105,8 @@ const EnemyReaction::Reaction& EnemyReaction::get_reaction(const Sprite* sprite)
  */
 const std::string& EnemyReaction::get_reaction_name(ReactionType reaction) {
 
-  Debug::check_assertion(reaction >= 0 && reaction < REACTION_NUMBER,
-      StringConcat() << "Invalid reaction number: " << reaction);
+  SOLARUS_ASSERT(reaction >= 0 && reaction < REACTION_NUMBER,
+      "Invalid reaction number: " << reaction);
 
   return reaction_names[reaction];
 }
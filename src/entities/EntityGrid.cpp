@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "entities/EntityGrid.h"
+#include "lowlevel/Debug.h"
+#include <algorithm>
+
+/**
+ * @brief Creates an empty grid.
+ *
+ * Until initialize() is called, the grid has only one square.
+ */
+EntityGrid::EntityGrid():
+  nb_columns(1),
+  nb_rows(1),
+  cells(1),
+  next_sequence(0),
+  query_stamp(0) {
+
+}
+
+/**
+ * @brief Destructor.
+ */
+EntityGrid::~EntityGrid() {
+
+}
+
+/**
+ * @brief Sets the size of the area covered by the grid.
+ *
+ * Entities already in the grid are stored again in the new squares.
+ *
+ * @param map_width width of the map in pixels
+ * @param map_height height of the map in pixels
+ */
+void EntityGrid::initialize(int map_width, int map_height) {
+
+  nb_columns = std::max(1, (map_width + cell_size - 1) / cell_size);
+  nb_rows = std::max(1, (map_height + cell_size - 1) / cell_size);
+
+  cells.clear();
+  cells.resize(nb_columns * nb_rows);
+
+  std::map<MapEntity*, Entry>::iterator it;
+  for (it = entries.begin(); it != entries.end(); it++) {
+    insert_in_cells(it->second);
+  }
+}
+
+/**
+ * @brief Removes all entities from the grid.
+ */
+void EntityGrid::clear() {
+
+  for (unsigned int i = 0; i < cells.size(); i++) {
+    cells[i].clear();
+  }
+  entries.clear();
+  found.clear();
+}
+
+/**
+ * @brief Adds an entity to the grid.
+ * @param entity the entity to add (must not be in the grid already)
+ * @param area the rectangle covered by this entity
+ */
+void EntityGrid::add(MapEntity& entity, const Rectangle& area) {
+
+  SOLARUS_ASSERT_PARANOID(!contains(entity),
+      "This entity is already in the grid");
+
+  Entry& entry = entries[&entity];
+  entry.entity = &entity;
+  entry.sequence = next_sequence++;
+  entry.query_stamp = query_stamp;
+  get_cells(area, entry.column1, entry.row1, entry.column2, entry.row2);
+  insert_in_cells(entry);
+}
+
+/**
+ * @brief Removes an entity from the grid.
+ *
+ * Nothing happens if the entity is not in the grid.
+ *
+ * @param entity the entity to remove
+ */
+void EntityGrid::remove(MapEntity& entity) {
+
+  std::map<MapEntity*, Entry>::iterator it = entries.find(&entity);
+  if (it != entries.end()) {
+    remove_from_cells(it->second);
+    entries.erase(it);
+  }
+}
+
+/**
+ * @brief Notifies the grid that the rectangle covered by an entity has changed.
+ *
+ * The entity is moved to other squares only if needed.
+ * Nothing happens if the entity is not in the grid.
+ *
+ * @param entity an entity of the grid
+ * @param area the new rectangle covered by this entity
+ */
+void EntityGrid::update(MapEntity& entity, const Rectangle& area) {
+
+  std::map<MapEntity*, Entry>::iterator it = entries.find(&entity);
+  if (it == entries.end()) {
+    return;
+  }
+
+  Entry& entry = it->second;
+  int column1, row1, column2, row2;
+  get_cells(area, column1, row1, column2, row2);
+  if (column1 != entry.column1 || row1 != entry.row1
+      || column2 != entry.column2 || row2 != entry.row2) {
+
+    remove_from_cells(entry);
+    entry.column1 = column1;
+    entry.row1 = row1;
+    entry.column2 = column2;
+    entry.row2 = row2;
+    insert_in_cells(entry);
+  }
+}
+
+/**
+ * @brief Returns whether an entity is in the grid.
+ * @param entity an entity
+ * @return true if this entity was added and not removed
+ */
+bool EntityGrid::contains(MapEntity& entity) const {
+  return entries.find(&entity) != entries.end();
+}
+
+/**
+ * @brief Returns the number of entities in the grid.
+ * @return the number of entities
+ */
+int EntityGrid::get_nb_entities() const {
+  return entries.size();
+}
+
+/**
+ * @brief Returns the entities whose squares overlap a rectangle.
+ *
+ * The result may contain entities whose area does not exactly overlap
+ * the rectangle: callers still have to do their precise tests.
+ * Each entity is returned once, in the order the entities were added.
+ *
+ * @param area the rectangle to test
+ * @param result vector where the entities found are appended
+ */
+void EntityGrid::get_entities(const Rectangle& area, std::vector<MapEntity*>& result) {
+
+  int column1, row1, column2, row2;
+  get_cells(area, column1, row1, column2, row2);
+
+  query_stamp++;
+  found.clear();
+  for (int row = row1; row <= row2; row++) {
+    for (int column = column1; column <= column2; column++) {
+
+      const std::vector<Entry*>& cell = cells[row * nb_columns + column];
+      for (unsigned int i = 0; i < cell.size(); i++) {
+        Entry* entry = cell[i];
+        if (entry->query_stamp != query_stamp) {
+          entry->query_stamp = query_stamp;
+          found.push_back(entry);
+        }
+      }
+    }
+  }
+
+  std::sort(found.begin(), found.end(), compare_sequences);
+  for (unsigned int i = 0; i < found.size(); i++) {
+    result.push_back(found[i]->entity);
+  }
+}
+
+/**
+ * @brief Computes the range of squares overlapped by a rectangle.
+ *
+ * Coordinates outside the map are clamped to the border squares.
+ *
+ * @param area a rectangle in map coordinates
+ * @param column1 receives the first column
+ * @param row1 receives the first row
+ * @param column2 receives the last column
+ * @param row2 receives the last row
+ */
+void EntityGrid::get_cells(const Rectangle& area,
+    int& column1, int& row1, int& column2, int& row2) const {
+
+  // a rectangle with no size still has a position to test
+  const int x2 = area.get_x() + std::max(area.get_width(), 1) - 1;
+  const int y2 = area.get_y() + std::max(area.get_height(), 1) - 1;
+
+  column1 = std::min(std::max(area.get_x(), 0) / cell_size, nb_columns - 1);
+  row1 = std::min(std::max(area.get_y(), 0) / cell_size, nb_rows - 1);
+  column2 = std::min(std::max(x2, 0) / cell_size, nb_columns - 1);
+  row2 = std::min(std::max(y2, 0) / cell_size, nb_rows - 1);
+}
+
+/**
+ * @brief Stores an entry in the squares of its range.
+ * @param entry the entry to store
+ */
+void EntityGrid::insert_in_cells(Entry& entry) {
+
+  // the grid may have shrunk since the range was computed
+  entry.column1 = std::min(entry.column1, nb_columns - 1);
+  entry.row1 = std::min(entry.row1, nb_rows - 1);
+  entry.column2 = std::min(entry.column2, nb_columns - 1);
+  entry.row2 = std::min(entry.row2, nb_rows - 1);
+
+  for (int row = entry.row1; row <= entry.row2; row++) {
+    for (int column = entry.column1; column <= entry.column2; column++) {
+      cells[row * nb_columns + column].push_back(&entry);
+    }
+  }
+}
+
+/**
+ * @brief Removes an entry from the squares of its range.
+ * @param entry the entry to remove
+ */
+void EntityGrid::remove_from_cells(Entry& entry) {
+
+  for (int row = entry.row1; row <= entry.row2; row++) {
+    for (int column = entry.column1; column <= entry.column2; column++) {
+
+      std::vector<Entry*>& cell = cells[row * nb_columns + column];
+      std::vector<Entry*>::iterator it = std::find(cell.begin(), cell.end(), &entry);
+      if (it != cell.end()) {
+        // the order in a square does not matter
+        *it = cell.back();
+        cell.pop_back();
+      }
+    }
+  }
+}
+
+/**
+ * @brief Orders entries by their order of addition.
+ * @param entry1 an entry
+ * @param entry2 another entry
+ * @return true if entry1 was added before entry2
+ */
+bool EntityGrid::compare_sequences(const Entry* entry1, const Entry* entry2) {
+  return entry1->sequence < entry2->sequence;
+}
+
@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "entities/EntityNameIndex.h"
+#include "entities/MapEntity.h"
+#include "lowlevel/FileTools.h"
+#include <algorithm>
+
+/**
+ * @brief Creates an empty index.
+ */
+EntityNameIndex::EntityNameIndex():
+  buckets(16),
+  nb_entities(0),
+  sorted(true),
+  next_sequence(0) {
+
+}
+
+/**
+ * @brief Destructor.
+ */
+EntityNameIndex::~EntityNameIndex() {
+
+}
+
+/**
+ * @brief Removes all entities from the index.
+ */
+void EntityNameIndex::clear() {
+
+  for (unsigned int i = 0; i < buckets.size(); i++) {
+    buckets[i].clear();
+  }
+  nb_entities = 0;
+  sorted_entries.clear();
+  sorted = true;
+  found.clear();
+}
+
+/**
+ * @brief Adds an entity to the index.
+ * @param entity the entity to add (its name must not be in the index already)
+ */
+void EntityNameIndex::add(MapEntity& entity) {
+
+  get_bucket(entity.get_name()).push_back(&entity);
+  nb_entities++;
+  if (nb_entities > int(buckets.size())) {
+    rehash();
+  }
+
+  Entry entry;
+  entry.entity = &entity;
+  entry.sequence = next_sequence++;
+  if (sorted && !sorted_entries.empty()
+      && !compare_names(sorted_entries.back(), entry)) {
+    sorted = false;
+  }
+  sorted_entries.push_back(entry);
+}
+
+/**
+ * @brief Removes an entity from the index.
+ * @param entity the entity to remove (nothing happens if it is not in the index)
+ */
+void EntityNameIndex::remove(MapEntity& entity) {
+
+  std::vector<MapEntity*>& bucket = get_bucket(entity.get_name());
+  std::vector<MapEntity*>::iterator it = std::find(bucket.begin(), bucket.end(), &entity);
+  if (it == bucket.end()) {
+    return;
+  }
+  bucket.erase(it);
+  nb_entities--;
+
+  // the order of the other names is kept
+  std::vector<Entry>::iterator entry_it = sorted ?
+      std::lower_bound(sorted_entries.begin(), sorted_entries.end(),
+          entity.get_name(), compare_name_with) :
+      sorted_entries.begin();
+  while (entry_it->entity != &entity) {
+    ++entry_it;
+  }
+  sorted_entries.erase(entry_it);
+}
+
+/**
+ * @brief Returns the entity with the specified name.
+ * @param name name of an entity
+ * @return the entity, or NULL if there is no entity with this name
+ */
+MapEntity* EntityNameIndex::find(const std::string& name) const {
+
+  const std::vector<MapEntity*>& bucket = get_bucket(name);
+  for (unsigned int i = 0; i < bucket.size(); i++) {
+    if (bucket[i]->get_name() == name) {
+      return bucket[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Returns the entities whose name starts with a prefix.
+ * @param prefix prefix of the name
+ * @param result list where the entities found are appended, in their
+ * order of addition
+ */
+void EntityNameIndex::get_entities_with_prefix(const std::string& prefix,
+    std::list<MapEntity*>& result) {
+
+  found.clear();
+  std::vector<Entry>::iterator it = find_first_with_prefix(prefix);
+  for (; it != sorted_entries.end() && has_prefix(*it, prefix); ++it) {
+    found.push_back(*it);
+  }
+
+  std::sort(found.begin(), found.end(), compare_sequences);
+  for (unsigned int i = 0; i < found.size(); i++) {
+    result.push_back(found[i].entity);
+  }
+}
+
+/**
+ * @brief Returns whether the name of an entity starts with a prefix.
+ * @param prefix prefix of the name
+ * @return true if there is such an entity
+ */
+bool EntityNameIndex::has_entity_with_prefix(const std::string& prefix) {
+
+  std::vector<Entry>::iterator it = find_first_with_prefix(prefix);
+  return it != sorted_entries.end() && has_prefix(*it, prefix);
+}
+
+/**
+ * @brief Returns the bucket of the hash table where a name is stored.
+ * @param name a name
+ * @return its bucket
+ */
+std::vector<MapEntity*>& EntityNameIndex::get_bucket(const std::string& name) {
+
+  const uint32_t hash = FileTools::get_hash(name.data(), name.size());
+  return buckets[hash & (buckets.size() - 1)];
+}
+
+/**
+ * @brief Returns the bucket of the hash table where a name is stored.
+ * @param name a name
+ * @return its bucket
+ */
+const std::vector<MapEntity*>& EntityNameIndex::get_bucket(const std::string& name) const {
+
+  const uint32_t hash = FileTools::get_hash(name.data(), name.size());
+  return buckets[hash & (buckets.size() - 1)];
+}
+
+/**
+ * @brief Doubles the number of buckets of the hash table.
+ */
+void EntityNameIndex::rehash() {
+
+  std::vector<std::vector<MapEntity*> > old_buckets(buckets.size() * 2);
+  buckets.swap(old_buckets);
+  for (unsigned int i = 0; i < old_buckets.size(); i++) {
+    for (unsigned int j = 0; j < old_buckets[i].size(); j++) {
+      MapEntity* entity = old_buckets[i][j];
+      get_bucket(entity->get_name()).push_back(entity);
+    }
+  }
+}
+
+/**
+ * @brief Sorts the names again if entities were added since the last sort.
+ */
+void EntityNameIndex::sort_entries() {
+
+  if (!sorted) {
+    std::sort(sorted_entries.begin(), sorted_entries.end(), compare_names);
+    sorted = true;
+  }
+}
+
+/**
+ * @brief Returns the first entity in the sorted names whose name starts with a prefix.
+ * @param prefix prefix of the name
+ * @return the first entity with this prefix if any, otherwise an entity
+ * without this prefix or the end of the sorted names
+ */
+std::vector<EntityNameIndex::Entry>::iterator EntityNameIndex::find_first_with_prefix(
+    const std::string& prefix) {
+
+  sort_entries();
+  return std::lower_bound(sorted_entries.begin(), sorted_entries.end(),
+      prefix, compare_name_with);
+}
+
+/**
+ * @brief Compares the names of two entities.
+ * @param entry1 an entity
+ * @param entry2 another entity
+ * @return true if the name of the first one is before the name of the second one
+ */
+bool EntityNameIndex::compare_names(const Entry& entry1, const Entry& entry2) {
+  return entry1.entity->get_name() < entry2.entity->get_name();
+}
+
+/**
+ * @brief Compares the name of an entity with a string.
+ * @param entry an entity
+ * @param name a string
+ * @return true if the name of the entity is before the string
+ */
+bool EntityNameIndex::compare_name_with(const Entry& entry, const std::string& name) {
+  return entry.entity->get_name() < name;
+}
+
+/**
+ * @brief Compares the order of addition of two entities.
+ * @param entry1 an entity
+ * @param entry2 another entity
+ * @return true if the first one was added before the second one
+ */
+bool EntityNameIndex::compare_sequences(const Entry& entry1, const Entry& entry2) {
+  return entry1.sequence < entry2.sequence;
+}
+
+/**
+ * @brief Returns whether the name of an entity starts with a prefix.
+ * @param entry an entity
+ * @param prefix a prefix
+ * @return true if its name starts with this prefix
+ */
+bool EntityNameIndex::has_prefix(const Entry& entry, const std::string& prefix) {
+  return entry.entity->get_name().compare(0, prefix.size(), prefix) == 0;
+}
+
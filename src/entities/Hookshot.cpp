@@ -31,6 +31,7 @@
 #include "entities/Hero.h"
 #include "entities/Stairs.h"
 #include "Map.h"
+#include <algorithm>
 
 /**
  * @brief Creates a hookshot.
@@ -265,6 +266,23 @@ void Hookshot::update() {
   }
 }
 
+/**
+ * @brief Returns the area of the map where this entity may draw something.
+ *
+ * The links are drawn between the hero and the hookshot.
+ *
+ * @return the area where draw_on_map() draws
+ */
+Rectangle Hookshot::get_drawing_area() {
+
+  Rectangle area = MapEntity::get_drawing_area();
+  int x1 = std::min(area.get_x(), get_hero().get_x() - 16);
+  int y1 = std::min(area.get_y(), get_hero().get_y() - 16);
+  int x2 = std::max(area.get_x() + area.get_width(), get_hero().get_x() + 16);
+  int y2 = std::max(area.get_y() + area.get_height(), get_hero().get_y() + 16);
+  return Rectangle(x1, y1, x2 - x1, y2 - y1);
+}
+
 /**
  * @brief Draws the entity on the map.
  */
@@ -319,7 +337,7 @@ bool Hookshot::is_going_back() {
  */
 void Hookshot::go_back() {
 
-  Debug::check_assertion(!is_going_back(), "The hookshot is already going back");
+  SOLARUS_ASSERT(!is_going_back(), "The hookshot is already going back");
 
   has_to_go_back = true;
 }
@@ -330,7 +348,7 @@ void Hookshot::go_back() {
  */
 void Hookshot::attach_to(MapEntity& entity_reached) {
 
-  Debug::check_assertion(this->entity_reached == NULL,
+  SOLARUS_ASSERT(this->entity_reached == NULL,
       "The hookshot is already attached to an entity");
 
   this->entity_reached = &entity_reached;
@@ -39,18 +39,18 @@ Jumper::Jumper(const std::string &name, Layer layer, int x, int y, int width, in
 
   // check the size
   if (direction % 2 != 0) {
-    Debug::check_assertion(width == height, "This jumper has a diagonal direction but is not square");
+    SOLARUS_ASSERT(width == height, "This jumper has a diagonal direction but is not square");
   }
   else {
     if (direction % 4 == 0) {
-      Debug::check_assertion(width == 8, "This jumper is horizontal but its height is not 8");
+      SOLARUS_ASSERT(width == 8, "This jumper is horizontal but its height is not 8");
     }
     else {
-      Debug::check_assertion(height == 8, "This jumper is vertical but its width is not 8");
+      SOLARUS_ASSERT(height == 8, "This jumper is vertical but its width is not 8");
     }
   }
   // check the jump length
-  Debug::check_assertion(jump_length >= 16, "The jump length of this jumper is lower than 16");
+  SOLARUS_ASSERT(jump_length >= 16, "The jump length of this jumper is lower than 16");
 }
 
 /**
@@ -24,13 +24,54 @@
 #include "entities/Boomerang.h"
 #include "Map.h"
 #include "Game.h"
-#include "lowlevel/Surface.h"
-#include "lowlevel/Color.h"
+#include "Sprite.h"
 #include "lowlevel/Music.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
+#include "lowlevel/System.h"
+#include <algorithm>
+
 using std::list;
 
+int MapEntities::nb_entities_drawn = 0;
+int MapEntities::nb_entities_total = 0;
+int MapEntities::nb_y_order_sorts = 0;
+int MapEntities::nb_y_order_moves = 0;
+uint64_t MapEntities::y_order_time = 0;
+int MapEntities::nb_prefix_queries = 0;
+uint64_t MapEntities::prefix_query_time = 0;
+int MapEntities::nb_entities_created[HOOKSHOT + 1] = { 0 };
+
+const std::string MapEntities::entity_type_names[] = {
+  "tile",
+  "destination",
+  "teletransporter",
+  "pickable",
+  "destructible",
+  "chest",
+  "jumper",
+  "enemy",
+  "npc",
+  "block",
+  "dynamic_tile",
+  "switch",
+  "wall",
+  "sensor",
+  "crystal",
+  "crystal_block",
+  "shop_item",
+  "conveyor_belt",
+  "door",
+  "stairs",
+  "hero",
+  "carried_item",
+  "boomerang",
+  "explosion",
+  "arrow",
+  "bomb",
+  "fire",
+  "hookshot",
+};
+
 /**
  * @brief Constructor.
  * @param game the game
@@ -42,16 +83,18 @@ MapEntities::MapEntities(Game& game, Map& map):
   hero(game.get_hero()),
   music_before_miniboss(Music::none) {
 
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+    y_order_changed[layer] = false;
+    y_order_max_above[layer] = 0;
+    y_order_max_below[layer] = 0;
+  }
+
   Layer layer = hero.get_layer();
   this->obstacle_entities[layer].push_back(&hero);
-  this->entities_drawn_y_order[layer].push_back(&hero);
+  this->obstacle_entities_grids[layer].add(hero, hero.get_bounding_box());
+  add_drawn_in_y_order(layer, hero);
   // TODO update that when the layer changes, same thing for enemies
-  this->named_entities[hero.get_name()] = &hero;
-
-  // surfaces to pre-render static tiles
-  for (int layer = 0; layer < LAYER_NB; layer++) {
-    non_animated_tiles_surfaces[layer] = NULL;
-  }
+  this->named_entities.add(hero);
 }
 
 /**
@@ -79,11 +122,14 @@ void MapEntities::destroy_all_entities() {
     tiles[layer].clear();
     delete[] obstacle_tiles[layer];
     delete[] animated_tiles[layer];
-    delete non_animated_tiles_surfaces[layer];
 
+    tiles_in_animated_regions[layer].clear();
+    tiles_in_animated_regions_grids[layer].clear();
     entities_drawn_first[layer].clear();
+    entities_drawn_first_grids[layer].clear();
     entities_drawn_y_order[layer].clear();
     obstacle_entities[layer].clear();
+    obstacle_entities_grids[layer].clear();
     stairs[layer].clear();
   }
 
@@ -97,7 +143,9 @@ void MapEntities::destroy_all_entities() {
   named_entities.clear();
 
   detectors.clear();
+  detectors_grid.clear();
   entities_to_remove.clear();
+  non_animated_tiles.clear();
 }
 
 /**
@@ -136,6 +184,23 @@ list<MapEntity*>& MapEntities::get_obstacle_entities(Layer layer) {
   return obstacle_entities[layer];
 }
 
+/**
+ * @brief Returns the entities (other that tiles) that might be obstacles
+ * in a rectangle.
+ *
+ * Only the obstacle entities whose bounding box is close to the rectangle
+ * are returned. The precise tests remain to be done.
+ *
+ * @param layer the layer
+ * @param area a rectangle of the map
+ * @param result vector where the entities found are appended
+ */
+void MapEntities::get_obstacle_entities(Layer layer, const Rectangle& area,
+    std::vector<MapEntity*>& result) {
+
+  obstacle_entities_grids[layer].get_entities(area, result);
+}
+
 /**
  * @brief Returns all detectors on the map.
  * @return the detectors
@@ -144,6 +209,26 @@ list<Detector*>& MapEntities::get_detectors() {
   return detectors;
 }
 
+/**
+ * @brief Returns the detectors that may detect something in a rectangle.
+ *
+ * Only the detectors whose detection area is close to the rectangle are
+ * returned, in the same order as in get_detectors().
+ * The precise collision tests remain to be done.
+ *
+ * @param area a rectangle of the map
+ * @param result vector where the detectors found are appended
+ */
+void MapEntities::get_detectors(const Rectangle& area, std::vector<Detector*>& result) {
+
+  grid_query_result.clear();
+  detectors_grid.get_entities(area, grid_query_result);
+
+  for (unsigned int i = 0; i < grid_query_result.size(); i++) {
+    result.push_back((Detector*) grid_query_result[i]);
+  }
+}
+
 /**
  * @brief Returns all stairs on the specified layer.
  * @param layer the layer
@@ -189,8 +274,8 @@ MapEntity* MapEntities::get_entity(const std::string& name) {
 
   MapEntity* entity = find_entity(name);
 
-  Debug::check_assertion(entity != NULL, StringConcat()
-      << "Map '" << map.get_id()
+  SOLARUS_ASSERT(entity != NULL,
+      "Map '" << map.get_id()
       << "': Cannot find entity with name '" << name << "'");
 
   return entity;
@@ -203,13 +288,9 @@ MapEntity* MapEntities::get_entity(const std::string& name) {
  */
 MapEntity* MapEntities::find_entity(const std::string& name) {
 
-  if (named_entities.find(name) == named_entities.end()) {
-    return NULL;
-  }
-
-  MapEntity* entity = named_entities[name];
+  MapEntity* entity = named_entities.find(name);
 
-  if (entity->is_being_removed()) {
+  if (entity == NULL || entity->is_being_removed()) {
     return NULL;
   }
 
@@ -223,17 +304,38 @@ MapEntity* MapEntities::find_entity(const std::string& name) {
  */
 list<MapEntity*> MapEntities::get_entities_with_prefix(const std::string& prefix) {
 
+  uint64_t start_time = System::get_real_time_us();
+
   list<MapEntity*> entities;
 
-  list<MapEntity*>::iterator i;
-  for (i = all_entities.begin(); i != all_entities.end(); i++) {
+  if (prefix.empty()) {
+    // all entities, including the ones without name
+    list<MapEntity*>::iterator i;
+    for (i = all_entities.begin(); i != all_entities.end(); i++) {
 
-    MapEntity* entity = *i;
-    if (entity->has_prefix(prefix) && !entity->is_being_removed()) {
-      entities.push_back(entity);
+      MapEntity* entity = *i;
+      if (!entity->is_being_removed()) {
+        entities.push_back(entity);
+      }
+    }
+  }
+  else {
+    named_entities.get_entities_with_prefix(prefix, entities);
+
+    // the hero is not considered as an entity of the map
+    list<MapEntity*>::iterator i = entities.begin();
+    while (i != entities.end()) {
+      if (*i == &hero || (*i)->is_being_removed()) {
+        i = entities.erase(i);
+      }
+      else {
+        ++i;
+      }
     }
   }
 
+  nb_prefix_queries++;
+  prefix_query_time += System::get_real_time_us() - start_time;
   return entities;
 }
 
@@ -247,14 +349,15 @@ list<MapEntity*> MapEntities::get_entities_with_prefix(const std::string& prefix
 list<MapEntity*> MapEntities::get_entities_with_prefix(
     EntityType type, const std::string& prefix) {
 
-  list<MapEntity*> entities;
-
-  list<MapEntity*>::iterator i;
-  for (i = all_entities.begin(); i != all_entities.end(); i++) {
+  list<MapEntity*> entities = get_entities_with_prefix(prefix);
 
-    MapEntity* entity = *i;
-    if (entity->get_type() == type && entity->has_prefix(prefix) && !entity->is_being_removed()) {
-      entities.push_back(entity);
+  list<MapEntity*>::iterator i = entities.begin();
+  while (i != entities.end()) {
+    if ((*i)->get_type() != type) {
+      i = entities.erase(i);
+    }
+    else {
+      ++i;
     }
   }
 
@@ -269,16 +372,12 @@ list<MapEntity*> MapEntities::get_entities_with_prefix(
  */
 bool MapEntities::has_entity_with_prefix(const std::string& prefix) {
 
-  list<MapEntity*>::iterator i;
-  for (i = all_entities.begin(); i != all_entities.end(); i++) {
-
-    MapEntity* entity = *i;
-    if (entity->has_prefix(prefix) && !entity->is_being_removed()) {
-      return true;
-    }
+  if (!prefix.empty() && !named_entities.has_entity_with_prefix(prefix)) {
+    nb_prefix_queries++;
+    return false;
   }
 
-  return false;
+  return !get_entities_with_prefix(prefix).empty();
 }
 
 /**
@@ -287,15 +386,19 @@ bool MapEntities::has_entity_with_prefix(const std::string& prefix) {
  */
 void MapEntities::bring_to_front(MapEntity *entity) {
 
-  Debug::check_assertion(entity->can_be_drawn(),
-      StringConcat() << "Cannot bring to front entity '" << entity->get_name() << "' since it is not drawn");
+  SOLARUS_ASSERT(entity->can_be_drawn(),
+      "Cannot bring to front entity '" << entity->get_name() << "' since it is not drawn");
 
-  Debug::check_assertion(!entity->is_drawn_in_y_order(),
-    StringConcat() << "Cannot bring to front entity '" << entity->get_name() << "' since it is drawn in the y order");
+  SOLARUS_ASSERT(!entity->is_drawn_in_y_order(),
+    "Cannot bring to front entity '" << entity->get_name() << "' since it is drawn in the y order");
 
   Layer layer = entity->get_layer();
   entities_drawn_first[layer].remove(entity);
   entities_drawn_first[layer].push_back(entity);
+
+  // the grid returns the entities in their order of addition
+  entities_drawn_first_grids[layer].remove(*entity);
+  entities_drawn_first_grids[layer].add(*entity, entity->get_drawing_area());
 }
 
 /**
@@ -310,6 +413,9 @@ void MapEntities::notify_map_started() {
   }
   hero.notify_map_started();
 
+  // the hero was added to the grid before being placed on this map
+  notify_entity_bounding_box_changed(hero);
+
   // pre-render non-animated tiles
   build_non_animated_tiles();
 }
@@ -334,8 +440,8 @@ void MapEntities::notify_map_opening_transition_finished() {
  */
 void MapEntities::notify_tileset_changed() {
 
-  // Redraw optimized tiles (i.e. non animated ones).
-  redraw_non_animated_tiles();
+  // Redraw optimized tiles (i.e. non animated ones) when they are visible.
+  non_animated_tiles.invalidate();
 }
 
 /**
@@ -506,6 +612,8 @@ void MapEntities::add_entity(MapEntity* entity) {
     return;
   }
 
+  nb_entities_created[entity->get_type()]++;
+
   if (entity->get_type() == TILE) {
     // Tiles are optimized specifically for obstacle checks and rendering.
     add_tile((Tile*) entity);
@@ -516,6 +624,7 @@ void MapEntities::add_entity(MapEntity* entity) {
     // update the detectors list
     if (entity->is_detector()) {
       detectors.push_back((Detector*) entity);
+      detectors_grid.add(*entity, get_detection_area(*entity));
     }
 
     // update the obstacle list
@@ -523,22 +632,26 @@ void MapEntities::add_entity(MapEntity* entity) {
 
       if (entity->has_layer_independent_collisions()) {
         // some entities handle collisions on any layer (e.g. stairs inside a single floor)
-        obstacle_entities[LAYER_LOW].push_back(entity);
-        obstacle_entities[LAYER_INTERMEDIATE].push_back(entity);
-        obstacle_entities[LAYER_HIGH].push_back(entity);
+        for (int i = 0; i < LAYER_NB; i++) {
+          obstacle_entities[i].push_back(entity);
+          obstacle_entities_grids[i].add(*entity, entity->get_bounding_box());
+        }
       }
       else {
         // but usually, an entity collides with only one layer
         obstacle_entities[layer].push_back(entity);
+        obstacle_entities_grids[layer].add(*entity, entity->get_bounding_box());
       }
+      map.notify_obstacles_changed();
     }
 
     // update the sprites list
     if (entity->is_drawn_in_y_order()) {
-      entities_drawn_y_order[layer].push_back(entity);
+      add_drawn_in_y_order(layer, *entity);
     }
     else if (entity->can_be_drawn()) {
       entities_drawn_first[layer].push_back(entity);
+      entities_drawn_first_grids[layer].add(*entity, entity->get_drawing_area());
     }
 
     // update the specific entities lists
@@ -566,10 +679,9 @@ void MapEntities::add_entity(MapEntity* entity) {
 
   const std::string& name = entity->get_name();
   if (!name.empty()) {
-    Debug::check_assertion(named_entities.find(name) == named_entities.end(),
-        StringConcat()
-        << "Error: an entity with name '" << name << "' already exists.");
-    named_entities[name] = entity;
+    SOLARUS_ASSERT(named_entities.find(name) == NULL,
+        "Error: an entity with name '" << name << "' already exists.");
+    named_entities.add(*entity);
   }
   entity->increment_refcount();
 
@@ -639,31 +751,35 @@ void MapEntities::remove_marked_entities() {
       if (entity->has_layer_independent_collisions()) {
         for (int i = 0; i < LAYER_NB; i++) {
           obstacle_entities[i].remove(entity);
+          obstacle_entities_grids[i].remove(*entity);
         }
       }
       else {
         obstacle_entities[layer].remove(entity);
+        obstacle_entities_grids[layer].remove(*entity);
       }
+      map.notify_obstacles_changed();
     }
 
     // remove it from the detectors list if present
     if (entity->is_detector()) {
       detectors.remove((Detector*) entity);
+      detectors_grid.remove(*entity);
     }
 
     // remove it from the sprite entities list if present
     if (entity->is_drawn_in_y_order()) {
-      entities_drawn_y_order[layer].remove(entity);
+      remove_drawn_in_y_order(layer, *entity);
     }
     else if (entity->can_be_drawn()) {
       entities_drawn_first[layer].remove(entity);
+      entities_drawn_first_grids[layer].remove(*entity);
     }
 
     // remove it from the whole list
     all_entities.remove(entity);
-    const std::string& name = entity->get_name();
-    if (!name.empty()) {
-      named_entities.erase(name);
+    if (!entity->get_name().empty()) {
+      named_entities.remove(*entity);
     }
 
     // destroy it
@@ -714,8 +830,10 @@ void MapEntities::update() {
       tiles[layer][i]->update();
     }
 
-    // sort the entities drawn in y order
-    entities_drawn_y_order[layer].sort(compare_y);
+    // sort the entities drawn in y order if some of them have moved
+    if (y_order_changed[layer]) {
+      sort_drawn_in_y_order(Layer(layer));
+    }
   }
 
   for (it = all_entities.begin();
@@ -732,24 +850,21 @@ void MapEntities::update() {
 }
 
 /**
- * @brief Determines which rectangles are animated and draws all non-animated
- * rectangles of tiles on intermediate surfaces.
+ * @brief Determines which rectangles are animated and prepares the
+ * rendering of non-animated rectangles of tiles on intermediate surfaces.
+ *
+ * The intermediate surfaces are only drawn when they become visible.
  */
 void MapEntities::build_non_animated_tiles() {
 
-  const Rectangle map_size(0, 0, map.get_width(), map.get_height());
+  non_animated_tiles.initialize(map.get_width(), map.get_height());
   for (int layer = 0; layer < LAYER_NB; layer++) {
 
-    delete non_animated_tiles_surfaces[layer];
-    non_animated_tiles_surfaces[layer] = new Surface(map_size.get_width(), map_size.get_height());
-    non_animated_tiles_surfaces[layer]->set_transparency_color(Color::get_magenta());
-    non_animated_tiles_surfaces[layer]->fill_with_color(Color::get_magenta());
-
     for (unsigned int i = 0; i < tiles[layer].size(); i++) {
       Tile& tile = *tiles[layer][i];
       if (!tile.is_animated()) {
         // non-animated tile: optimize its displaying
-        tile.draw(*non_animated_tiles_surfaces[layer], map_size);
+        non_animated_tiles.add_tile(tile);
       }
       else {
         // animated tile: mark its region as non-optimizable
@@ -774,62 +889,15 @@ void MapEntities::build_non_animated_tiles() {
       }
     }
 
-    // erase the rectangles that contain animated tiles
-    int index = 0;
-    for (int y = 0; y < map.get_height(); y += 8) {
-      for (int x = 0; x < map.get_width(); x += 8) {
-
-        if (animated_tiles[layer][index]) {
-          Rectangle animated_square(x, y, 8, 8);
-          non_animated_tiles_surfaces[layer]->fill_with_color(Color::get_magenta(), animated_square);
-        }
-        index++;
-      }
-    }
+    // the rectangles that contain animated tiles will be erased
+    non_animated_tiles.set_animated_squares(Layer(layer), animated_tiles[layer]);
 
     // build the list of animated tiles and tiles overlapping them
     for (unsigned int i = 0; i < tiles[layer].size(); i++) {
       Tile& tile = *tiles[layer][i];
       if (tile.is_animated() || overlaps_animated_tile(tile)) {
         tiles_in_animated_regions[layer].push_back(&tile);
-      }
-    }
-  }
-}
-
-/**
- * @brief Draws all non-animated rectangles of tiles on intermediate surfaces.
- *
- * This function is similar to build_non_animated_tiles() except that it
- * assumes that animated and non-animated rectangles were already determined.
- *
- * This function is called when the tileset changes.
- */
-void MapEntities::redraw_non_animated_tiles() {
-
-  const Rectangle map_size(0, 0, map.get_width(), map.get_height());
-  for (int layer = 0; layer < LAYER_NB; layer++) {
-
-    non_animated_tiles_surfaces[layer]->fill_with_color(Color::get_magenta());
-
-    for (unsigned int i = 0; i < tiles[layer].size(); i++) {
-      Tile& tile = *tiles[layer][i];
-      if (!tile.is_animated()) {
-        // Non-animated tile: optimize its displaying.
-        tile.draw(*non_animated_tiles_surfaces[layer], map_size);
-      }
-    }
-
-    // Erase rectangles that contain animated tiles.
-    int index = 0;
-    for (int y = 0; y < map.get_height(); y += 8) {
-      for (int x = 0; x < map.get_width(); x += 8) {
-
-        if (animated_tiles[layer][index]) {
-          Rectangle animated_square(x, y, 8, 8);
-          non_animated_tiles_surfaces[layer]->fill_with_color(Color::get_magenta(), animated_square);
-        }
-        index++;
+        tiles_in_animated_regions_grids[layer].add(tile, tile.get_bounding_box());
       }
     }
   }
@@ -868,48 +936,92 @@ bool MapEntities::overlaps_animated_tile(Tile& tile) {
 
 /**
  * @brief Draws the entities on the map surface.
+ *
+ * Only the tiles and the entities near the visible area are drawn.
  */
 void MapEntities::draw() {
 
+  const Rectangle& camera_position = map.get_camera_position();
+  const Rectangle area(camera_position.get_x() - drawing_margin,
+      camera_position.get_y() - drawing_margin,
+      camera_position.get_width() + 2 * drawing_margin,
+      camera_position.get_height() + 2 * drawing_margin);
+
   for (int layer = 0; layer < LAYER_NB; layer++) {
 
     // draw the animated tiles and the tiles that overlap them:
     // in other words, draw all regions containing animated tiles
     // (and maybe more, but we don't care because non-animated tiles
     // will be drawn later)
-    for (unsigned int i = 0; i < tiles_in_animated_regions[layer].size(); i++) {
-      tiles_in_animated_regions[layer][i]->draw_on_map();
+    entities_to_draw.clear();
+    tiles_in_animated_regions_grids[layer].get_entities(area, entities_to_draw);
+    for (unsigned int i = 0; i < entities_to_draw.size(); i++) {
+      entities_to_draw[i]->draw_on_map();
     }
+    nb_entities_drawn += entities_to_draw.size();
+    nb_entities_total += tiles_in_animated_regions[layer].size();
 
     // draw the non-animated tiles (with transparent rectangles on the regions of animated tiles
     // since they are already drawn)
-    non_animated_tiles_surfaces[layer]->draw_region(
-        map.get_camera_position(), map.get_visible_surface());
+    non_animated_tiles.draw(Layer(layer), map.get_visible_surface(), map.get_camera_position());
 
     // draw the first sprites
-    list<MapEntity*>::iterator i;
-    for (i = entities_drawn_first[layer].begin();
-	 i != entities_drawn_first[layer].end();
-	 i++) {
+    entities_to_draw.clear();
+    entities_drawn_first_grids[layer].get_entities(area, entities_to_draw);
+    for (unsigned int i = 0; i < entities_to_draw.size(); i++) {
 
-      MapEntity *entity = *i;
+      MapEntity *entity = entities_to_draw[i];
       if (entity->is_enabled()) {
         entity->draw_on_map();
+        nb_entities_drawn++;
       }
     }
+    nb_entities_total += entities_drawn_first[layer].size();
 
     // draw the sprites at the hero's level, in the order
     // defined by their y position (including the hero)
-    for (i = entities_drawn_y_order[layer].begin();
-	  i != entities_drawn_y_order[layer].end();
-	  i++) {
+    draw_entities_y_order(Layer(layer), area);
+  }
+}
 
-      MapEntity *entity = *i;
-      if (entity->is_enabled()) {
-        entity->draw_on_map();
-      }
+/**
+ * @brief Draws the entities of a layer that are displayed in the y order
+ * and whose drawing area overlaps a rectangle.
+ *
+ * The entities are sorted by the bottom edge of their bounding box, so
+ * only the ones whose bottom edge is close enough to the rectangle
+ * are tested.
+ *
+ * @param layer a layer
+ * @param area the rectangle to draw in map coordinates
+ */
+void MapEntities::draw_entities_y_order(Layer layer, const Rectangle& area) {
+
+  if (y_order_changed[layer]) {
+    // an entity has moved since the last update
+    sort_drawn_in_y_order(layer);
+  }
+
+  const std::vector<YOrderEntry>& entries = entities_drawn_y_order[layer];
+  const int x1 = area.get_x();
+  const int y1 = area.get_y();
+  const int x2 = x1 + area.get_width();
+  const int y2 = y1 + area.get_height();
+
+  std::vector<YOrderEntry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(),
+      y1 - y_order_max_below[layer], compare_y_order_keys);
+  const int last_y = y2 + y_order_max_above[layer];
+  for (; it != entries.end() && it->y <= last_y; ++it) {
+
+    MapEntity *entity = it->entity;
+    if (it->x1 < x2 && x1 < it->x2
+        && it->y1 < y2 && y1 < it->y2
+        && entity->is_enabled()) {
+      entity->draw_on_map();
+      nb_entities_drawn++;
     }
   }
+  nb_entities_total += entries.size();
 }
 
 /**
@@ -925,6 +1037,214 @@ bool MapEntities::compare_y(MapEntity *first, MapEntity *second) {
   return first->get_top_left_y() + first->get_height() < second->get_top_left_y() + second->get_height();
 }
 
+/**
+ * @brief Returns the value that orders the entities drawn in the y order.
+ *
+ * Like compare_y(), this is the y coordinate of the bottom edge of the entity.
+ *
+ * @param entity an entity
+ * @return its sort key
+ */
+int MapEntities::get_y_order_key(MapEntity& entity) {
+  return entity.get_top_left_y() + entity.get_height();
+}
+
+/**
+ * @brief Adds an entity to the entities drawn in the y order of a layer.
+ *
+ * The entity is placed at the end: its place is computed at the next update.
+ *
+ * @param layer a layer
+ * @param entity the entity to add
+ */
+void MapEntities::add_drawn_in_y_order(Layer layer, MapEntity& entity) {
+
+  YOrderEntry entry;
+  entry.entity = &entity;
+  update_y_order_entry(layer, entry);
+  entities_drawn_y_order[layer].push_back(entry);
+  y_order_changed[layer] = true;
+}
+
+/**
+ * @brief Updates the key and the drawing area of an entity drawn in the y order.
+ *
+ * The extents of the drawing areas around the keys of this layer
+ * are enlarged if necessary.
+ *
+ * @param layer the layer of the entity
+ * @param entry the entry to update
+ */
+void MapEntities::update_y_order_entry(Layer layer, YOrderEntry& entry) {
+
+  const Rectangle& drawing_area = entry.entity->get_drawing_area();
+  entry.y = get_y_order_key(*entry.entity);
+  entry.x1 = drawing_area.get_x();
+  entry.y1 = drawing_area.get_y();
+  entry.x2 = entry.x1 + drawing_area.get_width();
+  entry.y2 = entry.y1 + drawing_area.get_height();
+
+  y_order_max_above[layer] = std::max(y_order_max_above[layer], entry.y - entry.y1);
+  y_order_max_below[layer] = std::max(y_order_max_below[layer], entry.y2 - entry.y);
+}
+
+/**
+ * @brief Compares the key of an entity drawn in the y order with a y coordinate.
+ * @param entry an entity drawn in the y order
+ * @param y a y coordinate
+ * @return true if the key of the entity is lower than y
+ */
+bool MapEntities::compare_y_order_keys(const YOrderEntry& entry, int y) {
+  return entry.y < y;
+}
+
+/**
+ * @brief Removes an entity from the entities drawn in the y order of a layer.
+ *
+ * The order of the other entities is kept.
+ *
+ * @param layer a layer
+ * @param entity the entity to remove
+ */
+void MapEntities::remove_drawn_in_y_order(Layer layer, MapEntity& entity) {
+
+  std::vector<YOrderEntry>& entries = entities_drawn_y_order[layer];
+  for (unsigned int i = 0; i < entries.size(); i++) {
+    if (entries[i].entity == &entity) {
+      entries.erase(entries.begin() + i);
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Sorts again the entities drawn in the y order of a layer.
+ *
+ * The keys are updated and an insertion sort moves the entities whose
+ * order has changed. Entities with the same key keep their previous order,
+ * like with the stable sort of compare_y() previously done at each frame.
+ *
+ * @param layer a layer
+ */
+void MapEntities::sort_drawn_in_y_order(Layer layer) {
+
+  uint64_t start_time = System::get_real_time_us();
+
+  std::vector<YOrderEntry>& entries = entities_drawn_y_order[layer];
+  const unsigned int nb_entries = entries.size();
+  y_order_max_above[layer] = 0;
+  y_order_max_below[layer] = 0;
+  for (unsigned int i = 0; i < nb_entries; i++) {
+    update_y_order_entry(layer, entries[i]);
+  }
+
+  for (unsigned int i = 1; i < nb_entries; i++) {
+
+    if (entries[i].y >= entries[i - 1].y) {
+      continue;
+    }
+
+    // move this entity up to its place
+    YOrderEntry entry = entries[i];
+    unsigned int j = i;
+    do {
+      entries[j] = entries[j - 1];
+      j--;
+    } while (j > 0 && entry.y < entries[j - 1].y);
+    entries[j] = entry;
+    nb_y_order_moves++;
+  }
+
+  y_order_changed[layer] = false;
+  nb_y_order_sorts++;
+  y_order_time += System::get_real_time_us() - start_time;
+}
+
+/**
+ * @brief Returns the number of tiles and entities drawn on the map,
+ * since the beginning of the program.
+ *
+ * Tiles and entities far from the visible area are not drawn.
+ *
+ * @return the number of tiles and entities drawn
+ */
+int MapEntities::get_nb_entities_drawn() {
+  return nb_entities_drawn;
+}
+
+/**
+ * @brief Returns the number of tiles and entities that were candidates
+ * for being drawn on the map, since the beginning of the program.
+ * @return the number of tiles and entities drawn or skipped
+ */
+int MapEntities::get_nb_entities_total() {
+  return nb_entities_total;
+}
+
+/**
+ * @brief Returns the number of times a layer was sorted again because
+ * entities drawn in the y order have moved, since the beginning of the program.
+ * @return the number of sorts
+ */
+int MapEntities::get_nb_y_order_sorts() {
+  return nb_y_order_sorts;
+}
+
+/**
+ * @brief Returns the number of entities whose place in the y order
+ * has changed, since the beginning of the program.
+ * @return the number of entities moved by the sorts
+ */
+int MapEntities::get_nb_y_order_moves() {
+  return nb_y_order_moves;
+}
+
+/**
+ * @brief Returns the time spent sorting the entities drawn in the y order,
+ * since the beginning of the program.
+ * @return the time in microseconds
+ */
+uint64_t MapEntities::get_y_order_time() {
+  return y_order_time;
+}
+
+/**
+ * @brief Returns the number of searches of entities by name prefix,
+ * since the beginning of the program.
+ * @return the number of searches
+ */
+int MapEntities::get_nb_prefix_queries() {
+  return nb_prefix_queries;
+}
+
+/**
+ * @brief Returns the time spent searching entities by name prefix,
+ * since the beginning of the program.
+ * @return the time in microseconds
+ */
+uint64_t MapEntities::get_prefix_query_time() {
+  return prefix_query_time;
+}
+
+/**
+ * @brief Returns the number of entities of a type added to maps,
+ * since the beginning of the program.
+ * @param type a type of entity
+ * @return the number of entities of this type created
+ */
+int MapEntities::get_nb_entities_created(EntityType type) {
+  return nb_entities_created[type];
+}
+
+/**
+ * @brief Returns the name of a type of entity.
+ * @param type a type of entity
+ * @return the name of this type, as used in map files
+ */
+const std::string& MapEntities::get_entity_type_name(EntityType type) {
+  return entity_type_names[type];
+}
+
 /**
  * @brief Changes the layer of an entity.
  *
@@ -943,16 +1263,21 @@ void MapEntities::set_entity_layer(MapEntity& entity, Layer layer) {
     if (entity.can_be_obstacle() && !entity.has_layer_independent_collisions()) {
       obstacle_entities[old_layer].remove(&entity);
       obstacle_entities[layer].push_back(&entity);
+      obstacle_entities_grids[old_layer].remove(entity);
+      obstacle_entities_grids[layer].add(entity, entity.get_bounding_box());
+      map.notify_obstacles_changed();
     }
 
     // update the sprites list
     if (entity.is_drawn_in_y_order()) {
-      entities_drawn_y_order[old_layer].remove(&entity);
-      entities_drawn_y_order[layer].push_back(&entity);
+      remove_drawn_in_y_order(old_layer, entity);
+      add_drawn_in_y_order(layer, entity);
     }
     else if (entity.can_be_drawn()) {
       entities_drawn_first[old_layer].remove(&entity);
       entities_drawn_first[layer].push_back(&entity);
+      entities_drawn_first_grids[old_layer].remove(entity);
+      entities_drawn_first_grids[layer].add(entity, entity.get_drawing_area());
     }
 
     // update the entity after the lists because this function might be called again
@@ -960,6 +1285,69 @@ void MapEntities::set_entity_layer(MapEntity& entity, Layer layer) {
   }
 }
 
+/**
+ * @brief Notifies this object that the bounding box, the origin or the
+ * sprites of an entity have just changed.
+ *
+ * The entity is moved to the appropriate squares of the spatial indexes.
+ *
+ * @param entity an entity of the map
+ */
+void MapEntities::notify_entity_bounding_box_changed(MapEntity& entity) {
+
+  if (entity.is_drawn_in_y_order()) {
+    y_order_changed[entity.get_layer()] = true;
+  }
+  else if (entities_drawn_first_grids[entity.get_layer()].contains(entity)) {
+    entities_drawn_first_grids[entity.get_layer()].update(entity, entity.get_drawing_area());
+  }
+
+  if (entity.is_detector()) {
+    detectors_grid.update(entity, get_detection_area(entity));
+  }
+
+  if (entity.has_layer_independent_collisions()) {
+    for (int i = 0; i < LAYER_NB; i++) {
+      obstacle_entities_grids[i].update(entity, entity.get_bounding_box());
+    }
+  }
+  else {
+    obstacle_entities_grids[entity.get_layer()].update(entity, entity.get_bounding_box());
+  }
+}
+
+/**
+ * @brief Returns the rectangle where a detector may detect entities.
+ *
+ * It contains the bounding box and the origin point of the detector,
+ * and the biggest frame of each sprite placed on the origin point in any
+ * possible way, so that pixel-precise collisions are also covered
+ * (assuming that the origin of a frame is inside the frame).
+ *
+ * @param detector a detector
+ * @return the area to index this detector with
+ */
+Rectangle MapEntities::get_detection_area(MapEntity& detector) {
+
+  const Rectangle& bounding_box = detector.get_bounding_box();
+  int x1 = std::min(bounding_box.get_x(), detector.get_x());
+  int y1 = std::min(bounding_box.get_y(), detector.get_y());
+  int x2 = std::max(bounding_box.get_x() + bounding_box.get_width(), detector.get_x() + 1);
+  int y2 = std::max(bounding_box.get_y() + bounding_box.get_height(), detector.get_y() + 1);
+
+  std::list<Sprite*>& sprites = detector.get_sprites();
+  std::list<Sprite*>::iterator it;
+  for (it = sprites.begin(); it != sprites.end(); it++) {
+    const Rectangle& max_size = (*it)->get_max_size();
+    x1 = std::min(x1, detector.get_x() - max_size.get_width());
+    y1 = std::min(y1, detector.get_y() - max_size.get_height());
+    x2 = std::max(x2, detector.get_x() + max_size.get_width());
+    y2 = std::max(y2, detector.get_y() + max_size.get_height());
+  }
+
+  return Rectangle(x1, y1, x2 - x1, y2 - y1);
+}
+
 /**
  * @brief Returns whether a rectangle overlaps with a raised crystal block.
  * @param layer the layer to check
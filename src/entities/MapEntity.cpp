@@ -24,6 +24,7 @@
 #include "lua/LuaContext.h"
 #include "lowlevel/Geometry.h"
 #include "lowlevel/System.h"
+#include "lowlevel/ObjectPool.h"
 #include "lowlevel/Debug.h"
 #include "lowlevel/StringConcat.h"
 #include "MainLoop.h"
@@ -31,6 +32,7 @@
 #include "Map.h"
 #include "Sprite.h"
 #include "SpriteAnimationSet.h"
+#include <algorithm>
 
 const Rectangle MapEntity::directions_to_xy_moves[] = {
   Rectangle( 1, 0),
@@ -144,6 +146,28 @@ MapEntity::~MapEntity() {
   clear_old_movements();
 }
 
+/**
+ * @brief Allocates the memory of an entity.
+ *
+ * Entities are created and destroyed often during the game, so their
+ * memory is recycled by ObjectPool.
+ *
+ * @param size size of the entity in bytes
+ * @return the memory allocated
+ */
+void* MapEntity::operator new(size_t size) {
+  return ObjectPool::allocate(size);
+}
+
+/**
+ * @brief Releases the memory of an entity.
+ * @param memory the memory to release
+ * @param size size of the entity in bytes
+ */
+void MapEntity::operator delete(void* memory, size_t size) {
+  ObjectPool::release(memory, size);
+}
+
 /**
  * @brief Returns whether this entity is the hero controlled by the player.
  * @return true if this entity is the hero
@@ -239,6 +263,20 @@ void MapEntity::set_map(Map& map) {
   }
 }
 
+/**
+ * @brief Notifies the map that the bounding box, the origin or the sprites
+ * of this entity have just changed.
+ *
+ * This keeps the spatial indexes of the map up to date.
+ * Nothing is done if the entity is not on a map yet or is being removed.
+ */
+void MapEntity::notify_bounding_box_changed() {
+
+  if (map != NULL && !being_removed) {
+    get_entities().notify_entity_bounding_box_changed(*this);
+  }
+}
+
 /**
  * @brief Notifies this entity that its map has just become active.
  */
@@ -299,7 +337,7 @@ MapEntities& MapEntity::get_entities() const {
  */
 LuaContext& MapEntity::get_lua_context() const {
 
-  Debug::check_assertion(main_loop != NULL, "This entity is not fully constructed yet");
+  SOLARUS_ASSERT(main_loop != NULL, "This entity is not fully constructed yet");
   return main_loop->get_lua_context();
 }
 
@@ -468,6 +506,7 @@ int MapEntity::get_y() {
  */
 void MapEntity::set_x(int x) {
   bounding_box.set_x(x - origin.get_x());
+  notify_bounding_box_changed();
 }
 
 /**
@@ -479,6 +518,7 @@ void MapEntity::set_x(int x) {
  */
 void MapEntity::set_y(int y) {
   bounding_box.set_y(y - origin.get_y());
+  notify_bounding_box_changed();
 }
 
 /**
@@ -538,6 +578,7 @@ int MapEntity::get_top_left_y() {
  */
 void MapEntity::set_top_left_x(int x) {
   bounding_box.set_x(x);
+  notify_bounding_box_changed();
 }
 
 /**
@@ -546,6 +587,7 @@ void MapEntity::set_top_left_x(int x) {
  */
 void MapEntity::set_top_left_y(int y) {
   bounding_box.set_y(y);
+  notify_bounding_box_changed();
 }
 
 /**
@@ -611,6 +653,7 @@ const Rectangle& MapEntity::get_size() {
  */
 void MapEntity::set_size(int width, int height) {
   bounding_box.set_size(width, height);
+  notify_bounding_box_changed();
 }
 
 /**
@@ -619,6 +662,7 @@ void MapEntity::set_size(int width, int height) {
  */
 void MapEntity::set_size(const Rectangle &size) {
   bounding_box.set_size(size);
+  notify_bounding_box_changed();
 }
 
 /**
@@ -643,6 +687,7 @@ const Rectangle& MapEntity::get_bounding_box() {
  */
 void MapEntity::set_bounding_box(const Rectangle &bounding_box) {
   this->bounding_box = bounding_box;
+  notify_bounding_box_changed();
 }
 
 /**
@@ -819,6 +864,7 @@ void MapEntity::set_origin(int x, int y) {
 
   bounding_box.add_xy(origin.get_x() - x, origin.get_y() - y);
   origin.set_xy(x, y);
+  notify_bounding_box_changed();
 }
 
 /**
@@ -893,6 +939,7 @@ Sprite& MapEntity::create_sprite(const std::string& animation_set_id,
   }
 
   sprites.push_back(sprite);
+  notify_bounding_box_changed();
   return *sprite;
 }
 
@@ -910,7 +957,7 @@ void MapEntity::remove_sprite(Sprite& sprite) {
     }
   }
 
-  Debug::check_assertion(found, "This sprite does not belong to this entity");
+  SOLARUS_ASSERT(found, "This sprite does not belong to this entity");
 }
 
 /**
@@ -1173,6 +1220,10 @@ void MapEntity::set_enabled(bool enabled) {
 
     if (is_on_map()) {
       notify_enabled(enabled);
+
+      if (can_be_obstacle()) {
+        get_map().notify_obstacles_changed();
+      }
     }
   }
 }
@@ -1831,6 +1882,10 @@ void MapEntity::update() {
       this->waiting_enabled = false;
       notify_enabled(true);
 
+      if (can_be_obstacle()) {
+        get_map().notify_obstacles_changed();
+      }
+
       if (get_movement() != NULL) {
         get_movement()->set_suspended(suspended || !enabled);
       }
@@ -1915,6 +1970,35 @@ void MapEntity::draw_on_map() {
   }
 }
 
+/**
+ * @brief Returns the area of the map where this entity may draw something.
+ *
+ * It contains the bounding box and the biggest frame of each sprite placed
+ * on the origin point in any possible way. The map does not draw entities
+ * whose drawing area is far from the visible area, so entities that draw
+ * something elsewhere must redefine this function.
+ *
+ * @return the area where draw_on_map() draws
+ */
+Rectangle MapEntity::get_drawing_area() {
+
+  int x1 = std::min(bounding_box.get_x(), get_x());
+  int y1 = std::min(bounding_box.get_y(), get_y());
+  int x2 = std::max(bounding_box.get_x() + bounding_box.get_width(), get_x() + 1);
+  int y2 = std::max(bounding_box.get_y() + bounding_box.get_height(), get_y() + 1);
+
+  std::list<Sprite*>::iterator it;
+  for (it = sprites.begin(); it != sprites.end(); it++) {
+    const Rectangle& max_size = (*it)->get_max_size();
+    x1 = std::min(x1, get_x() - max_size.get_width());
+    y1 = std::min(y1, get_y() - max_size.get_height());
+    x2 = std::max(x2, get_x() + max_size.get_width());
+    y2 = std::max(y2, get_y() + max_size.get_height());
+  }
+
+  return Rectangle(x1, y1, x2 - x1, y2 - y1);
+}
+
 /**
  * @brief Returns the name identifying this type in Lua.
  * @return The name identifying this type in Lua.
@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "entities/NonAnimatedTilesCache.h"
+#include "entities/Tile.h"
+#include "lowlevel/Surface.h"
+#include "lowlevel/Color.h"
+#include <algorithm>
+
+int NonAnimatedTilesCache::nb_chunks_built = 0;
+int NonAnimatedTilesCache::nb_chunks_freed = 0;
+
+/**
+ * @brief Creates an empty cache.
+ */
+NonAnimatedTilesCache::NonAnimatedTilesCache():
+  map_width(0),
+  map_height(0),
+  nb_columns(0),
+  nb_rows(0),
+  nb_surfaces(0),
+  use_counter(0) {
+
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+    animated_squares[layer] = NULL;
+  }
+}
+
+/**
+ * @brief Destructor.
+ */
+NonAnimatedTilesCache::~NonAnimatedTilesCache() {
+
+  clear();
+}
+
+/**
+ * @brief Sets the size of the map and removes all tiles.
+ * @param map_width width of the map in pixels
+ * @param map_height height of the map in pixels
+ */
+void NonAnimatedTilesCache::initialize(int map_width, int map_height) {
+
+  clear();
+
+  this->map_width = map_width;
+  this->map_height = map_height;
+  nb_columns = (map_width + chunk_size - 1) / chunk_size;
+  nb_rows = (map_height + chunk_size - 1) / chunk_size;
+
+  Chunk empty_chunk;
+  empty_chunk.surface = NULL;
+  empty_chunk.last_used = 0;
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+    chunks[layer].resize(nb_columns * nb_rows, empty_chunk);
+  }
+}
+
+/**
+ * @brief Removes all tiles and frees all surfaces.
+ */
+void NonAnimatedTilesCache::clear() {
+
+  invalidate();
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+    chunks[layer].clear();
+    animated_squares[layer] = NULL;
+  }
+}
+
+/**
+ * @brief Frees all surfaces, so that chunks are rendered again when they are visible.
+ *
+ * Call this function when the tileset changes.
+ */
+void NonAnimatedTilesCache::invalidate() {
+
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+    for (unsigned int i = 0; i < chunks[layer].size(); i++) {
+      delete chunks[layer][i].surface;
+      chunks[layer][i].surface = NULL;
+    }
+  }
+  nb_surfaces = 0;
+}
+
+/**
+ * @brief Adds a non-animated tile to the chunks it overlaps.
+ * @param tile a non-animated tile of the map
+ */
+void NonAnimatedTilesCache::add_tile(Tile& tile) {
+
+  int column1, row1, column2, row2;
+  get_chunks(tile.get_bounding_box(), column1, row1, column2, row2);
+
+  std::vector<Chunk>& layer_chunks = chunks[tile.get_layer()];
+  for (int row = row1; row <= row2; row++) {
+    for (int column = column1; column <= column2; column++) {
+      layer_chunks[row * nb_columns + column].tiles.push_back(&tile);
+    }
+  }
+}
+
+/**
+ * @brief Sets the squares of a layer where the non-animated tiles are not drawn.
+ * @param layer a layer
+ * @param animated_squares for each 8*8 square of the map, whether it contains
+ * an animated tile (the array must remain valid)
+ */
+void NonAnimatedTilesCache::set_animated_squares(Layer layer, const bool* animated_squares) {
+  this->animated_squares[layer] = animated_squares;
+}
+
+/**
+ * @brief Draws the non-animated tiles of a layer visible in a viewport.
+ *
+ * Visible chunks are rendered if needed. Then, at most one chunk
+ * around the viewport is rendered in advance.
+ *
+ * @param layer the layer to draw
+ * @param dst_surface the surface to draw (its top-left corner corresponds to
+ * the top-left corner of the viewport)
+ * @param viewport the area of the map to draw
+ */
+void NonAnimatedTilesCache::draw(Layer layer, Surface& dst_surface, const Rectangle& viewport) {
+
+  std::vector<Chunk>& layer_chunks = chunks[layer];
+  if (layer_chunks.empty()) {
+    return;
+  }
+
+  int column1, row1, column2, row2;
+  get_chunks(viewport, column1, row1, column2, row2);
+  for (int row = row1; row <= row2; row++) {
+    for (int column = column1; column <= column2; column++) {
+
+      int index = row * nb_columns + column;
+      Chunk& chunk = layer_chunks[index];
+      if (chunk.tiles.empty()) {
+        continue;
+      }
+
+      if (chunk.surface == NULL) {
+        build_chunk(layer, index);
+      }
+      chunk.last_used = ++use_counter;
+
+      // draw the part of the chunk that is in the viewport
+      Rectangle chunk_rectangle = get_chunk_rectangle(index);
+      int x1 = std::max(chunk_rectangle.get_x(), viewport.get_x());
+      int y1 = std::max(chunk_rectangle.get_y(), viewport.get_y());
+      int x2 = std::min(chunk_rectangle.get_x() + chunk_rectangle.get_width(),
+          viewport.get_x() + viewport.get_width());
+      int y2 = std::min(chunk_rectangle.get_y() + chunk_rectangle.get_height(),
+          viewport.get_y() + viewport.get_height());
+      if (x1 < x2 && y1 < y2) {
+        Rectangle src_position(x1 - chunk_rectangle.get_x(), y1 - chunk_rectangle.get_y(),
+            x2 - x1, y2 - y1);
+        Rectangle dst_position(x1 - viewport.get_x(), y1 - viewport.get_y());
+        chunk.surface->draw_region(src_position, dst_surface, dst_position);
+      }
+    }
+  }
+
+  // prepare a chunk that may become visible soon
+  Rectangle neighbourhood(viewport.get_x() - chunk_size / 2, viewport.get_y() - chunk_size / 2,
+      viewport.get_width() + chunk_size, viewport.get_height() + chunk_size);
+  get_chunks(neighbourhood, column1, row1, column2, row2);
+  for (int row = row1; row <= row2; row++) {
+    for (int column = column1; column <= column2; column++) {
+
+      int index = row * nb_columns + column;
+      Chunk& chunk = layer_chunks[index];
+      if (chunk.surface == NULL && !chunk.tiles.empty()) {
+        build_chunk(layer, index);
+        chunk.last_used = ++use_counter;
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Returns the number of chunks rendered since the beginning of the program.
+ * @return the number of chunk surfaces built
+ */
+int NonAnimatedTilesCache::get_nb_chunks_built() {
+  return nb_chunks_built;
+}
+
+/**
+ * @brief Returns the number of chunks freed to respect the memory limit
+ * since the beginning of the program.
+ * @return the number of chunk surfaces freed
+ */
+int NonAnimatedTilesCache::get_nb_chunks_freed() {
+  return nb_chunks_freed;
+}
+
+/**
+ * @brief Returns the area of the map covered by a chunk.
+ * @param index index of the chunk in its layer
+ * @return the rectangle of this chunk (smaller on the right and bottom
+ * borders of the map)
+ */
+Rectangle NonAnimatedTilesCache::get_chunk_rectangle(int index) {
+
+  int x = (index % nb_columns) * chunk_size;
+  int y = (index / nb_columns) * chunk_size;
+  return Rectangle(x, y,
+      std::min(chunk_size, map_width - x),
+      std::min(chunk_size, map_height - y));
+}
+
+/**
+ * @brief Computes the range of chunks overlapped by a rectangle.
+ *
+ * Coordinates outside the map are clamped to the border chunks.
+ *
+ * @param area a rectangle in map coordinates
+ * @param column1 receives the first column
+ * @param row1 receives the first row
+ * @param column2 receives the last column
+ * @param row2 receives the last row
+ */
+void NonAnimatedTilesCache::get_chunks(const Rectangle& area,
+    int& column1, int& row1, int& column2, int& row2) {
+
+  const int x2 = area.get_x() + std::max(area.get_width(), 1) - 1;
+  const int y2 = area.get_y() + std::max(area.get_height(), 1) - 1;
+
+  column1 = std::min(std::max(area.get_x(), 0) / chunk_size, nb_columns - 1);
+  row1 = std::min(std::max(area.get_y(), 0) / chunk_size, nb_rows - 1);
+  column2 = std::min(std::max(x2, 0) / chunk_size, nb_columns - 1);
+  row2 = std::min(std::max(y2, 0) / chunk_size, nb_rows - 1);
+}
+
+/**
+ * @brief Renders the non-animated tiles of a chunk on a new surface.
+ *
+ * If the maximum number of surfaces is reached, the chunk used least
+ * recently is freed first.
+ *
+ * @param layer layer of the chunk
+ * @param index index of the chunk in its layer
+ */
+void NonAnimatedTilesCache::build_chunk(Layer layer, int index) {
+
+  if (nb_surfaces >= max_surfaces) {
+    free_oldest_chunk();
+  }
+
+  Chunk& chunk = chunks[layer][index];
+  Rectangle chunk_rectangle = get_chunk_rectangle(index);
+  chunk.surface = new Surface(chunk_rectangle.get_width(), chunk_rectangle.get_height());
+  chunk.surface->set_transparency_color(Color::get_magenta());
+  chunk.surface->fill_with_color(Color::get_magenta());
+  nb_surfaces++;
+  nb_chunks_built++;
+
+  for (unsigned int i = 0; i < chunk.tiles.size(); i++) {
+    chunk.tiles[i]->draw(*chunk.surface, chunk_rectangle);
+  }
+
+  // erase the squares that contain animated tiles
+  const bool* layer_animated_squares = animated_squares[layer];
+  if (layer_animated_squares != NULL) {
+
+    const int map_width8 = map_width / 8;
+    const int x8_start = chunk_rectangle.get_x() / 8;
+    const int y8_start = chunk_rectangle.get_y() / 8;
+    const int width8 = chunk_rectangle.get_width() / 8;
+    const int height8 = chunk_rectangle.get_height() / 8;
+    for (int j = 0; j < height8; j++) {
+      for (int i = 0; i < width8; i++) {
+        if (layer_animated_squares[(y8_start + j) * map_width8 + x8_start + i]) {
+          Rectangle animated_square(i * 8, j * 8, 8, 8);
+          chunk.surface->fill_with_color(Color::get_magenta(), animated_square);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Frees the surface of the chunk used least recently.
+ */
+void NonAnimatedTilesCache::free_oldest_chunk() {
+
+  Chunk* oldest_chunk = NULL;
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+    for (unsigned int i = 0; i < chunks[layer].size(); i++) {
+      Chunk& chunk = chunks[layer][i];
+      if (chunk.surface != NULL
+          && (oldest_chunk == NULL || chunk.last_used < oldest_chunk->last_used)) {
+        oldest_chunk = &chunk;
+      }
+    }
+  }
+
+  if (oldest_chunk != NULL) {
+    delete oldest_chunk->surface;
+    oldest_chunk->surface = NULL;
+    nb_surfaces--;
+    nb_chunks_freed++;
+  }
+}
+
@@ -110,6 +110,14 @@ void Teletransporter::set_map(Map& map) {
   transition_direction = (destination_side + 2) % 4;
 }
 
+/**
+ * @brief Returns the id of the map where this teletransporter leads.
+ * @return id of the destination map
+ */
+const std::string& Teletransporter::get_destination_map_id() {
+  return destination_map_id;
+}
+
 /**
  * @brief Returns the type of entity.
  * @return the type of entity
@@ -18,7 +18,6 @@
 #include "entities/AnimatedTilePattern.h"
 #include "entities/TimeScrollingTilePattern.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 #include "lowlevel/Surface.h"
 
 /**
@@ -34,15 +33,15 @@ TilePattern::TilePattern(Obstacle obstacle, int width, int height):
   obstacle(obstacle), width(width), height(height) {
 
   // check the width and the height
-  Debug::check_assertion(width > 0
+  SOLARUS_ASSERT(width > 0
       && height > 0
       && width % 8 == 0
       && height % 8 == 0,
-      StringConcat() << "Invalid tile pattern: the size is (" << width << "x" << height <<
+      "Invalid tile pattern: the size is (" << width << "x" << height <<
       ") but should be positive and multiple of 8 pixels");
 
   // diagonal obstacle: check that the tile is square
-  Debug::check_assertion(obstacle < OBSTACLE_TOP_RIGHT
+  SOLARUS_ASSERT(obstacle < OBSTACLE_TOP_RIGHT
       || obstacle > OBSTACLE_BOTTOM_RIGHT
       || width == height,
       "Invalid tile pattern: a tile pattern with a diagonal obstacle must be square");
@@ -27,6 +27,11 @@
 #include "lua/LuaContext.h"
 #include <lua.hpp>
 
+std::map<std::string, Tileset*> Tileset::all_tilesets;
+uint32_t Tileset::release_counter = 0;
+int Tileset::nb_tilesets_reused = 0;
+int Tileset::nb_tilesets_loaded = 0;
+
 /**
  * @brief Lua name of each ground type.
  */
@@ -59,7 +64,9 @@ Tileset::Tileset(const std::string& id):
   id(id),
   max_tile_id(0),
   tiles_image(NULL),
-  entities_image(NULL) {
+  entities_image(NULL),
+  refcount(0),
+  last_released(0) {
 }
 
 /**
@@ -71,6 +78,142 @@ Tileset::~Tileset() {
   }
 }
 
+/**
+ * @brief Returns a loaded tileset, shared with the other maps that use it.
+ *
+ * Call release() when the map no longer uses it.
+ *
+ * @param id id of the tileset
+ * @return the tileset, loaded
+ */
+Tileset& Tileset::acquire(const std::string& id) {
+
+  Tileset* tileset = NULL;
+  std::map<std::string, Tileset*>::iterator it = all_tilesets.find(id);
+  if (it != all_tilesets.end()) {
+    nb_tilesets_reused++;
+    tileset = it->second;
+  }
+  else {
+    nb_tilesets_loaded++;
+    tileset = new Tileset(id);
+    tileset->load();
+    all_tilesets[id] = tileset;
+  }
+
+  tileset->refcount++;
+  return *tileset;
+}
+
+/**
+ * @brief Indicates that a map no longer uses a tileset obtained with acquire().
+ *
+ * The tileset is kept loaded for other maps, unless too many
+ * tilesets are not used anymore.
+ *
+ * @param tileset the tileset
+ */
+void Tileset::release(Tileset& tileset) {
+
+  tileset.refcount--;
+  if (tileset.refcount > 0) {
+    return;
+  }
+
+  std::map<std::string, Tileset*>::iterator it = all_tilesets.find(tileset.id);
+  if (it == all_tilesets.end() || it->second != &tileset) {
+    // its images were changed: it cannot be shared anymore
+    delete &tileset;
+    return;
+  }
+
+  tileset.last_released = ++release_counter;
+  unsigned int nb_unused = 0;
+  for (it = all_tilesets.begin(); it != all_tilesets.end(); it++) {
+    if (it->second->refcount == 0) {
+      nb_unused++;
+    }
+  }
+  if (nb_unused > max_unused_tilesets) {
+    remove_oldest_unused_tileset();
+  }
+}
+
+/**
+ * @brief Destroys the tileset released the longest time ago
+ * among the ones that no map uses.
+ */
+void Tileset::remove_oldest_unused_tileset() {
+
+  std::map<std::string, Tileset*>::iterator oldest = all_tilesets.end();
+  std::map<std::string, Tileset*>::iterator it;
+  for (it = all_tilesets.begin(); it != all_tilesets.end(); it++) {
+    if (it->second->refcount == 0
+        && (oldest == all_tilesets.end()
+            || it->second->last_released < oldest->second->last_released)) {
+      oldest = it;
+    }
+  }
+
+  if (oldest != all_tilesets.end()) {
+    delete oldest->second;
+    all_tilesets.erase(oldest);
+  }
+}
+
+/**
+ * @brief Starts decoding the images of a tileset in a separate thread,
+ * so that a map can load it later without waiting.
+ *
+ * Nothing is done if the tileset is already loaded.
+ *
+ * @param id id of the tileset
+ */
+void Tileset::prefetch(const std::string& id) {
+
+  if (all_tilesets.count(id) > 0) {
+    return;
+  }
+
+  Surface::prefetch_image(std::string("tilesets/") + id + ".tiles.png", Surface::DIR_DATA);
+  Surface::prefetch_image(std::string("tilesets/") + id + ".entities.png", Surface::DIR_DATA);
+}
+
+/**
+ * @brief Destroys the tilesets that no map uses.
+ */
+void Tileset::quit() {
+
+  std::map<std::string, Tileset*>::iterator it = all_tilesets.begin();
+  while (it != all_tilesets.end()) {
+    if (it->second->refcount == 0) {
+      delete it->second;
+      all_tilesets.erase(it++);
+    }
+    else {
+      ++it;
+    }
+  }
+}
+
+/**
+ * @brief Returns the number of times a map got a tileset that was already
+ * loaded, since the beginning of the program.
+ * @return the number of tilesets reused
+ */
+int Tileset::get_nb_tilesets_reused() {
+  return nb_tilesets_reused;
+}
+
+/**
+ * @brief Returns the number of times a map had to load its tileset,
+ * since the beginning of the program.
+ * @return the number of tilesets loaded
+ */
+int Tileset::get_nb_tilesets_loaded() {
+  return nb_tilesets_loaded;
+}
+
 /**
  * @brief Returns the id of this tileset.
  * @return the tileset id
@@ -103,11 +246,7 @@ void Tileset::load() {
   std::string file_name = std::string("tilesets/") + id + ".dat";
 
   lua_State* l = luaL_newstate();
-  size_t size;
-  char* buffer;
-  FileTools::data_file_open_buffer(file_name, &buffer, &size);
-  luaL_loadbuffer(l, buffer, size, file_name.c_str());
-  FileTools::data_file_close_buffer(buffer);
+  FileTools::data_file_load_lua(l, file_name);
 
   lua_pushlightuserdata(l, this);
   lua_setfield(l, LUA_REGISTRYINDEX, "tileset");
@@ -188,22 +327,37 @@ Surface& Tileset::get_entities_image() {
 TilePattern& Tileset::get_tile_pattern(int id) {
 
   TilePattern* tile_pattern =  tile_patterns[id];
-  Debug::check_assertion(tile_pattern != NULL, StringConcat() << "There is not tile pattern with id '" << id << "' in this tileset'");
+  SOLARUS_ASSERT(tile_pattern != NULL, "There is not tile pattern with id '" << id << "' in this tileset'");
   return *tile_pattern;
 }
 
 /**
  * @brief Changes the tiles images, the entities images and the background color of
  * this tileset.
+ *
+ * If this tileset was obtained with acquire(), it is no longer shared:
+ * acquire() will load a new one for the next maps.
+ *
  * @param other another tileset whose images and background color will be copied
  * into this tileset
  */
 void Tileset::set_images(Tileset& other) {
 
+  if (&other == this) {
+    return;
+  }
+
+  std::map<std::string, Tileset*>::iterator it = all_tilesets.find(id);
+  if (it != all_tilesets.end() && it->second == this) {
+    all_tilesets.erase(it);
+  }
+
+  Surface* new_tiles_image = new Surface(other.get_tiles_image());
+  Surface* new_entities_image = new Surface(other.get_entities_image());
   delete tiles_image;
-  tiles_image = new Surface(other.get_tiles_image());
+  tiles_image = new_tiles_image;
   delete entities_image;
-  entities_image = new Surface(other.get_entities_image());
+  entities_image = new_entities_image;
   background_color = other.get_background_color();
 }
 
@@ -24,7 +24,6 @@
 #include "lowlevel/Sound.h"
 #include "lowlevel/System.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 
 /**
  * @brief Associates to each movement direction the possible directions of the hero's sprites.
@@ -114,6 +113,43 @@ const std::string HeroSprites::ground_sound_ids[] = {
   "walk_on_water",
 };
 
+/**
+ * @brief Names of the animations that this class gives to the hero's sprites,
+ * in the order of the Animation enumeration.
+ */
+const std::string HeroSprites::animation_names[] = {
+  "big",
+  "brandish",
+  "carrying_stopped",
+  "carrying_walking",
+  "falling",
+  "grabbing",
+  "hurt",
+  "jumping",
+  "lifting",
+  "loading",
+  "pulling",
+  "pushing",
+  "running",
+  "spin_attack",
+  "stopped",
+  "stopped_with_shield",
+  "super_spin_attack",
+  "swimming_fast",
+  "swimming_slow",
+  "swimming_stopped",
+  "sword",
+  "sword_loading_stopped",
+  "sword_loading_walking",
+  "sword_tapping",
+  "victory",
+  "walking",
+  "walking_diagonal",
+  "walking_with_shield",
+};
+
+int HeroSprites::animation_ids[NB_ANIMATIONS];
+
 /**
  * @brief Constructor.
  * @param hero the hero
@@ -124,6 +160,10 @@ HeroSprites::HeroSprites(Hero &hero, Equipment &equipment):
   sword_stars_sprite(NULL), shield_sprite(NULL), shadow_sprite(NULL), ground_sprite(NULL), trail_sprite(NULL),
   end_blink_date(0), walking(false), clipping_rectangle(Rectangle()), lifted_item(NULL) {
 
+  // intern the animation names once instead of looking them up at each change
+  for (int i = 0; i < NB_ANIMATIONS; i++) {
+    animation_ids[i] = SpriteAnimationSet::get_animation_id(animation_names[i]);
+  }
 }
 
 /**
@@ -148,39 +188,39 @@ HeroSprites::~HeroSprites() {
  */
 void HeroSprites::rebuild_equipment() {
 
-  std::string tunic_animation;
-  std::string sword_animation;
-  std::string shield_animation;
+  int tunic_animation = -1;
+  int sword_animation = -1;
+  int shield_animation = -1;
   int animation_direction = -1;
 
   // the hero
   if (tunic_sprite != NULL) {
     // save the animation direction
     animation_direction = tunic_sprite->get_current_direction();
-    tunic_animation = tunic_sprite->get_current_animation();
+    tunic_animation = tunic_sprite->get_current_animation_id();
     delete tunic_sprite;
   }
 
   int tunic_number = equipment.get_ability("tunic");
   
-  Debug::check_assertion(tunic_number > 0, StringConcat() << "Invalid tunic number: " << tunic_number);
+  SOLARUS_ASSERT(tunic_number > 0, "Invalid tunic number: " << tunic_number);
 
   tunic_sprite = new Sprite(tunic_sprite_ids[tunic_number - 1]);
   tunic_sprite->enable_pixel_collisions();
-  if (!tunic_animation.empty()) {
+  if (tunic_animation != -1) {
     tunic_sprite->set_current_animation(tunic_animation);
   }
 
   // the hero's shadow
   if (shadow_sprite == NULL) {
     shadow_sprite = new Sprite("entities/shadow");
-    shadow_sprite->set_current_animation("big");
+    shadow_sprite->set_current_animation(animation_ids[ANIMATION_BIG]);
   }
 
   // the hero's sword
   if (sword_sprite != NULL) {
     if (sword_sprite->is_animation_started()) {
-      sword_animation = sword_sprite->get_current_animation();
+      sword_animation = sword_sprite->get_current_animation_id();
     }
     delete sword_sprite;
     delete sword_stars_sprite;
@@ -194,7 +234,7 @@ void HeroSprites::rebuild_equipment() {
     // the hero has a sword: get the sprite and the sound
     sword_sprite = new Sprite(sword_sprite_ids[sword_number - 1]);
     sword_sprite->enable_pixel_collisions();
-    if (sword_animation.empty()) {
+    if (sword_animation == -1) {
       sword_sprite->stop_animation();
     }
     else {
@@ -210,7 +250,7 @@ void HeroSprites::rebuild_equipment() {
   // the hero's shield
   if (shield_sprite != NULL) {
     if (shield_sprite->is_animation_started()) {
-      shield_animation = shield_sprite->get_current_animation();
+      shield_animation = shield_sprite->get_current_animation_id();
     }
     delete shield_sprite;
     shield_sprite = NULL;
@@ -221,7 +261,7 @@ void HeroSprites::rebuild_equipment() {
   if (shield_number > 0) {
     // the hero has a shield
     shield_sprite = new Sprite(shield_sprite_ids[shield_number - 1]);
-    if (shield_animation.empty()) {
+    if (shield_animation == -1) {
       shield_sprite->stop_animation();
     }
     else {
@@ -451,8 +491,8 @@ int HeroSprites::get_animation_direction(int keys_direction, int real_movement_d
  */
 void HeroSprites::set_animation_direction(int direction) {
 
-  Debug::check_assertion(direction >= 0 && direction < 4,
-    StringConcat() << "Invalid direction for set_animation_direction: " << direction);
+  SOLARUS_ASSERT(direction >= 0 && direction < 4,
+    "Invalid direction for set_animation_direction: " << direction);
 
   tunic_sprite->set_current_direction(direction);
 
@@ -746,7 +786,7 @@ void HeroSprites::set_animation_stopped_common() {
 
   if (is_ground_visible()
       && hero.get_ground() != GROUND_SHALLOW_WATER) {
-    ground_sprite->set_current_animation("stopped");
+    ground_sprite->set_current_animation(animation_ids[ANIMATION_STOPPED]);
   }
   walking = false;
 }
@@ -760,12 +800,12 @@ void HeroSprites::set_animation_stopped_normal() {
 
   if (equipment.has_ability("shield")) {
 
-    tunic_sprite->set_current_animation("stopped_with_shield");
-    shield_sprite->set_current_animation("stopped");
+    tunic_sprite->set_current_animation(animation_ids[ANIMATION_STOPPED_WITH_SHIELD]);
+    shield_sprite->set_current_animation(animation_ids[ANIMATION_STOPPED]);
     shield_sprite->set_current_direction(get_animation_direction());
   }
   else {
-    tunic_sprite->set_current_animation("stopped");
+    tunic_sprite->set_current_animation(animation_ids[ANIMATION_STOPPED]);
   }
   stop_displaying_sword();
   stop_displaying_trail();
@@ -780,15 +820,15 @@ void HeroSprites::set_animation_stopped_sword_loading() {
 
   int direction = get_animation_direction();
 
-  tunic_sprite->set_current_animation("sword_loading_stopped");
-  sword_sprite->set_current_animation("sword_loading_stopped");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_SWORD_LOADING_STOPPED]);
+  sword_sprite->set_current_animation(animation_ids[ANIMATION_SWORD_LOADING_STOPPED]);
   sword_sprite->set_current_direction(direction);
-  sword_stars_sprite->set_current_animation("loading");
+  sword_stars_sprite->set_current_animation(animation_ids[ANIMATION_LOADING]);
   sword_stars_sprite->set_current_direction(direction);
 
   if (equipment.has_ability("shield")) {
 
-    shield_sprite->set_current_animation("sword_loading_stopped");
+    shield_sprite->set_current_animation(animation_ids[ANIMATION_SWORD_LOADING_STOPPED]);
     shield_sprite->set_current_direction(direction);
   }
   stop_displaying_trail();
@@ -803,7 +843,7 @@ void HeroSprites::set_animation_stopped_sword_loading() {
 void HeroSprites::set_animation_stopped_carrying() {
 
   set_animation_stopped_common();
-  tunic_sprite->set_current_animation("carrying_stopped");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_CARRYING_STOPPED]);
 
   if (lifted_item != NULL) {
     lifted_item->set_animation_stopped();
@@ -818,7 +858,7 @@ void HeroSprites::set_animation_stopped_carrying() {
 void HeroSprites::set_animation_stopped_swimming() {
 
   set_animation_stopped_common();
-  tunic_sprite->set_current_animation("swimming_stopped");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_SWIMMING_STOPPED]);
   stop_displaying_sword();
   stop_displaying_shield();
   stop_displaying_trail();
@@ -833,7 +873,7 @@ void HeroSprites::set_animation_stopped_swimming() {
 void HeroSprites::set_animation_walking_common() {
 
   if (is_ground_visible() && hero.get_ground() != GROUND_SHALLOW_WATER) {
-    ground_sprite->set_current_animation("walking");
+    ground_sprite->set_current_animation(animation_ids[ANIMATION_WALKING]);
   }
 
   walking = true;
@@ -848,13 +888,13 @@ void HeroSprites::set_animation_walking_normal() {
 
   if (equipment.has_ability("shield")) {
 
-    tunic_sprite->set_current_animation("walking_with_shield");
+    tunic_sprite->set_current_animation(animation_ids[ANIMATION_WALKING_WITH_SHIELD]);
 
-    shield_sprite->set_current_animation("walking");
+    shield_sprite->set_current_animation(animation_ids[ANIMATION_WALKING]);
     shield_sprite->set_current_direction(get_animation_direction());
   }
   else {
-    tunic_sprite->set_current_animation("walking");
+    tunic_sprite->set_current_animation(animation_ids[ANIMATION_WALKING]);
   }
   stop_displaying_sword();
   stop_displaying_trail();
@@ -869,16 +909,16 @@ void HeroSprites::set_animation_walking_sword_loading() {
 
   int direction = get_animation_direction();
 
-  tunic_sprite->set_current_animation("sword_loading_walking");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_SWORD_LOADING_WALKING]);
   if (equipment.has_ability("sword")) {
-    sword_sprite->set_current_animation("sword_loading_walking");
+    sword_sprite->set_current_animation(animation_ids[ANIMATION_SWORD_LOADING_WALKING]);
     sword_sprite->set_current_direction(direction);
-    sword_stars_sprite->set_current_animation("loading");
+    sword_stars_sprite->set_current_animation(animation_ids[ANIMATION_LOADING]);
     sword_stars_sprite->set_current_direction(direction);
   }
 
   if (equipment.has_ability("shield")) {
-    shield_sprite->set_current_animation("sword_loading_walking");
+    shield_sprite->set_current_animation(animation_ids[ANIMATION_SWORD_LOADING_WALKING]);
     shield_sprite->set_current_direction(direction);
   }
   stop_displaying_trail();
@@ -894,7 +934,7 @@ void HeroSprites::set_animation_walking_carrying() {
 
   set_animation_walking_common();
 
-  tunic_sprite->set_current_animation("carrying_walking");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_CARRYING_WALKING]);
 
   if (lifted_item != NULL) {
     lifted_item->set_animation_walking();
@@ -910,7 +950,7 @@ void HeroSprites::set_animation_swimming_slow() {
 
   set_animation_walking_common();
 
-  tunic_sprite->set_current_animation("swimming_slow");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_SWIMMING_SLOW]);
   stop_displaying_sword();
   stop_displaying_shield();
   stop_displaying_trail();
@@ -923,7 +963,7 @@ void HeroSprites::set_animation_swimming_fast() {
 
   set_animation_walking_common();
 
-  tunic_sprite->set_current_animation("swimming_fast");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_SWIMMING_FAST]);
   stop_displaying_sword();
   stop_displaying_shield();
   stop_displaying_trail();
@@ -938,7 +978,7 @@ void HeroSprites::set_animation_walking_diagonal(int direction8) {
   stop_displaying_sword();
   stop_displaying_shield();
   stop_displaying_trail();
-  tunic_sprite->set_current_animation("walking_diagonal");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_WALKING_DIAGONAL]);
   tunic_sprite->set_current_direction(direction8 / 2);
 }
 
@@ -949,10 +989,10 @@ void HeroSprites::set_animation_sword() {
 
   int direction = get_animation_direction();
 
-  tunic_sprite->set_current_animation("sword");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_SWORD]);
   tunic_sprite->restart_animation();
 
-  sword_sprite->set_current_animation("sword");
+  sword_sprite->set_current_animation(animation_ids[ANIMATION_SWORD]);
   sword_sprite->set_current_direction(direction);
   sword_sprite->restart_animation();
   sword_stars_sprite->stop_animation();
@@ -960,7 +1000,7 @@ void HeroSprites::set_animation_sword() {
   if (equipment.has_ability("shield")) {
 
     if (direction % 2 != 0) {
-      shield_sprite->set_current_animation("sword");
+      shield_sprite->set_current_animation(animation_ids[ANIMATION_SWORD]);
       shield_sprite->set_current_direction(direction / 2);
       shield_sprite->restart_animation();
     }
@@ -985,17 +1025,17 @@ void HeroSprites::set_animation_sword_tapping() {
 
   int direction = get_animation_direction();
 
-  tunic_sprite->set_current_animation("sword_tapping");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_SWORD_TAPPING]);
   tunic_sprite->restart_animation();
 
-  sword_sprite->set_current_animation("sword_tapping");
+  sword_sprite->set_current_animation(animation_ids[ANIMATION_SWORD_TAPPING]);
   sword_sprite->set_current_direction(direction);
   sword_sprite->restart_animation();
   sword_stars_sprite->stop_animation();
 
   if (equipment.has_ability("shield")) {
 
-    shield_sprite->set_current_animation("sword_tapping");
+    shield_sprite->set_current_animation(animation_ids[ANIMATION_SWORD_TAPPING]);
     shield_sprite->set_current_direction(direction);
     shield_sprite->restart_animation();
   }
@@ -1007,8 +1047,8 @@ void HeroSprites::set_animation_sword_tapping() {
  */
 void HeroSprites::set_animation_spin_attack() {
 
-  tunic_sprite->set_current_animation("spin_attack");
-  sword_sprite->set_current_animation("spin_attack");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_SPIN_ATTACK]);
+  sword_sprite->set_current_animation(animation_ids[ANIMATION_SPIN_ATTACK]);
   stop_displaying_sword_stars();
   stop_displaying_shield();
   stop_displaying_trail();
@@ -1019,8 +1059,8 @@ void HeroSprites::set_animation_spin_attack() {
  */
 void HeroSprites::set_animation_super_spin_attack() {
 
-  tunic_sprite->set_current_animation("super_spin_attack");
-  sword_sprite->set_current_animation("super_spin_attack");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_SUPER_SPIN_ATTACK]);
+  sword_sprite->set_current_animation(animation_ids[ANIMATION_SUPER_SPIN_ATTACK]);
   stop_displaying_sword_stars();
   stop_displaying_shield();
   stop_displaying_trail();
@@ -1031,7 +1071,7 @@ void HeroSprites::set_animation_super_spin_attack() {
  */
 void HeroSprites::set_animation_grabbing() {
 
-  tunic_sprite->set_current_animation("grabbing");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_GRABBING]);
   stop_displaying_shield();
   stop_displaying_trail();
 }
@@ -1041,7 +1081,7 @@ void HeroSprites::set_animation_grabbing() {
  */
 void HeroSprites::set_animation_pulling() {
 
-  tunic_sprite->set_current_animation("pulling");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_PULLING]);
   stop_displaying_shield();
   stop_displaying_trail();
 }
@@ -1051,7 +1091,7 @@ void HeroSprites::set_animation_pulling() {
  */
 void HeroSprites::set_animation_pushing() {
 
-  tunic_sprite->set_current_animation("pushing");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_PUSHING]);
   stop_displaying_shield();
   stop_displaying_trail();
 }
@@ -1061,7 +1101,7 @@ void HeroSprites::set_animation_pushing() {
  */
 void HeroSprites::set_animation_lifting() {
 
-  tunic_sprite->set_current_animation("lifting");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_LIFTING]);
   stop_displaying_shield();
   stop_displaying_trail();
 }
@@ -1071,10 +1111,10 @@ void HeroSprites::set_animation_lifting() {
  */
 void HeroSprites::set_animation_jumping() {
 
-  tunic_sprite->set_current_animation("jumping");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_JUMPING]);
 
   if (equipment.has_ability("shield")) {
-    shield_sprite->set_current_animation("stopped");
+    shield_sprite->set_current_animation(animation_ids[ANIMATION_STOPPED]);
     shield_sprite->set_current_direction(get_animation_direction());
   }
   stop_displaying_sword();
@@ -1086,7 +1126,7 @@ void HeroSprites::set_animation_jumping() {
  */
 void HeroSprites::set_animation_hurt() {
 
-  tunic_sprite->set_current_animation("hurt");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_HURT]);
   stop_displaying_sword();
   stop_displaying_shield();
   stop_displaying_trail();
@@ -1098,7 +1138,7 @@ void HeroSprites::set_animation_hurt() {
 void HeroSprites::set_animation_falling() {
 
   // show the animation
-  tunic_sprite->set_current_animation("falling");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_FALLING]);
   stop_displaying_sword();
   stop_displaying_shield();
   stop_displaying_trail();
@@ -1109,7 +1149,7 @@ void HeroSprites::set_animation_falling() {
  */
 void HeroSprites::set_animation_brandish() {
 
-  tunic_sprite->set_current_animation("brandish");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_BRANDISH]);
   tunic_sprite->set_current_direction(1);
   stop_displaying_sword();
   stop_displaying_shield();
@@ -1121,9 +1161,9 @@ void HeroSprites::set_animation_brandish() {
  */
 void HeroSprites::set_animation_victory() {
 
-  tunic_sprite->set_current_animation("victory");
+  tunic_sprite->set_current_animation(animation_ids[ANIMATION_VICTORY]);
   tunic_sprite->set_current_direction(1);
-  sword_sprite->set_current_animation("victory");
+  sword_sprite->set_current_animation(animation_ids[ANIMATION_VICTORY]);
   sword_sprite->set_current_direction(1);
   stop_displaying_sword_stars();
   stop_displaying_shield();
@@ -1136,7 +1176,7 @@ void HeroSprites::set_animation_victory() {
 void HeroSprites::set_animation_prepare_running() {
 
   set_animation_walking_normal();
-  trail_sprite->set_current_animation("running");
+  trail_sprite->set_current_animation(animation_ids[ANIMATION_RUNNING]);
 }
 
 /**
@@ -1146,7 +1186,7 @@ void HeroSprites::set_animation_running() {
 
   set_animation_walking_sword_loading();
   stop_displaying_sword_stars();
-  trail_sprite->set_current_animation("running");
+  trail_sprite->set_current_animation(animation_ids[ANIMATION_RUNNING]);
 }
 
 /**
@@ -1186,7 +1226,7 @@ void HeroSprites::create_ground(Ground ground) {
   ground_sprite = new Sprite(ground_sprite_ids[ground - 1]);
   ground_sprite->set_map(hero.get_map());
   if (hero.get_ground() != GROUND_SHALLOW_WATER) {
-    ground_sprite->set_current_animation(walking ? "walking" : "stopped");
+    ground_sprite->set_current_animation(animation_ids[walking ? ANIMATION_WALKING : ANIMATION_STOPPED]);
   }
   ground_sound_id = ground_sound_ids[ground - 1];
 }
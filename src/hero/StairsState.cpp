@@ -204,7 +204,7 @@ void Hero::StairsState::update() {
         // there must be a teletransporter associated with these stairs,
         // otherwise the hero would get stuck into the walls
         Teletransporter *teletransporter = hero.get_delayed_teletransporter();
-        Debug::check_assertion(teletransporter != NULL, "Teletransporter expected with the stairs");
+        SOLARUS_ASSERT(teletransporter != NULL, "Teletransporter expected with the stairs");
         teletransporter->transport_hero(hero);
       }
       else {
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "lowlevel/DataBuffer.h"
+
+#if SOLARUS_HAVE_MMAP != 0
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+/**
+ * @brief Creates an empty data buffer.
+ */
+DataBuffer::DataBuffer():
+  content(NULL) {
+
+}
+
+/**
+ * @brief Creates a data buffer that takes ownership of some bytes.
+ * @param data bytes allocated with new[]
+ * @param size number of bytes
+ */
+DataBuffer::DataBuffer(char* data, size_t size):
+  content(new Content) {
+
+  content->data = data;
+  content->size = size;
+  content->mapped = false;
+  content->refcount = 1;
+}
+
+/**
+ * @brief Creates a data buffer that shares the bytes of another one.
+ * @param other another data buffer
+ */
+DataBuffer::DataBuffer(const DataBuffer& other):
+  content(other.content) {
+
+  if (content != NULL) {
+    content->refcount++;
+  }
+}
+
+/**
+ * @brief Destructor.
+ *
+ * The bytes are freed if no other data buffer shares them.
+ */
+DataBuffer::~DataBuffer() {
+
+  release();
+}
+
+/**
+ * @brief Makes this data buffer share the bytes of another one.
+ * @param other another data buffer
+ * @return this data buffer
+ */
+DataBuffer& DataBuffer::operator=(const DataBuffer& other) {
+
+  if (other.content != content) {
+    release();
+    content = other.content;
+    if (content != NULL) {
+      content->refcount++;
+    }
+  }
+  return *this;
+}
+
+/**
+ * @brief Returns whether this data buffer refers to no bytes.
+ * @return true if this data buffer is empty
+ */
+bool DataBuffer::is_empty() const {
+  return content == NULL;
+}
+
+/**
+ * @brief Returns the bytes of this data buffer.
+ * @return the bytes, or NULL for an empty buffer
+ */
+const char* DataBuffer::get_data() const {
+  return content != NULL ? content->data : NULL;
+}
+
+/**
+ * @brief Returns the number of bytes of this data buffer.
+ * @return the number of bytes
+ */
+size_t DataBuffer::get_size() const {
+  return content != NULL ? content->size : 0;
+}
+
+/**
+ * @brief Returns the number of data buffers that share these bytes.
+ * @return the number of copies of this data buffer (0 for an empty buffer)
+ */
+int DataBuffer::get_refcount() const {
+  return content != NULL ? content->refcount : 0;
+}
+
+/**
+ * @brief Maps a file of the file system into memory.
+ * @param path path of the file in the file system
+ * @return a data buffer on the mapped file, or an empty buffer if the file
+ * cannot be mapped (it should then be read normally)
+ */
+DataBuffer DataBuffer::map_file(const std::string& path) {
+
+  DataBuffer buffer;
+
+#if SOLARUS_HAVE_MMAP != 0
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return buffer;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0
+      && S_ISREG(file_stat.st_mode)
+      && file_stat.st_size > 0) {
+
+    size_t size = size_t(file_stat.st_size);
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      buffer.content = new Content;
+      buffer.content->data = static_cast<const char*>(data);
+      buffer.content->size = size;
+      buffer.content->mapped = true;
+      buffer.content->refcount = 1;
+    }
+  }
+  close(fd);
+#endif
+
+  return buffer;
+}
+
+/**
+ * @brief Stops sharing the bytes, and frees them if this was the last copy.
+ */
+void DataBuffer::release() {
+
+  if (content == NULL) {
+    return;
+  }
+
+  content->refcount--;
+  if (content->refcount == 0) {
+    if (content->mapped) {
+#if SOLARUS_HAVE_MMAP != 0
+      munmap(const_cast<char*>(content->data), content->size);
+#endif
+    }
+    else {
+      delete[] content->data;
+    }
+    delete content;
+  }
+  content = NULL;
+}
+
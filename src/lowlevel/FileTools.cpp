@@ -15,12 +15,16 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "lowlevel/FileTools.h"
+#include "lowlevel/System.h"
 #include "lowlevel/Debug.h"
 #include "lowlevel/StringConcat.h"
 #include "lua/LuaContext.h"
 #include "StringResource.h"
 #include "DialogResource.h"
 #include <physfs.h>
+#include <cstring>
+#include <istream>
+#include <ostream>
 
 #if defined(SOLARUS_OS_MACOSX) && SOLARUS_OS_MACOSX != 0
 #   include "lowlevel/osx/OSXInterface.h"
@@ -31,6 +35,88 @@ std::string FileTools::quest_write_dir;
 std::string FileTools::language_code;
 std::string FileTools::default_language_code;
 std::map<std::string, std::string> FileTools::languages;
+const std::string FileTools::bytecode_dir = "bytecode";
+int FileTools::nb_bytecode_hits = 0;
+int FileTools::nb_bytecode_misses = 0;
+uint64_t FileTools::lua_load_time = 0;
+std::map<std::string, FileTools::CachedFile> FileTools::archive_cache;
+size_t FileTools::archive_cache_size = 0;
+uint32_t FileTools::archive_cache_counter = 0;
+uint64_t FileTools::nb_bytes_read = 0;
+uint64_t FileTools::nb_bytes_copied = 0;
+
+/**
+ * @brief Magic number at the beginning of compiled Lua chunk files.
+ *
+ * It is followed by the size and the hash of the source file (32-bit
+ * little-endian integers) and by the chunk as dumped by Lua.
+ */
+static const char bytecode_magic[4] = { 'S', 'L', 'B', '1' };
+static const size_t bytecode_header_size = 12;
+
+/**
+ * @brief Input stream that reads a data buffer in place.
+ */
+class DataBufferStream: public std::istream {
+
+  public:
+
+    /**
+     * @brief Creates a stream on a data buffer.
+     * @param buffer the data buffer to read (shared by the stream)
+     */
+    DataBufferStream(const DataBuffer& buffer):
+      std::istream(NULL),
+      buffer(buffer) {
+
+      streambuf.set_buffer(buffer.get_data(), buffer.get_size());
+      rdbuf(&streambuf);
+    }
+
+  private:
+
+    /**
+     * @brief Stream buffer whose get area is the whole data buffer.
+     */
+    class StreamBuffer: public std::streambuf {
+
+      public:
+
+        void set_buffer(const char* data, size_t size) {
+          char* begin = const_cast<char*>(data);  // never written: there is no put area
+          setg(begin, begin, begin + size);
+        }
+
+      protected:
+
+        pos_type seekoff(off_type offset, std::ios_base::seekdir direction,
+            std::ios_base::openmode mode) {
+
+          char* position = gptr();
+          if (direction == std::ios_base::beg) {
+            position = eback() + offset;
+          }
+          else if (direction == std::ios_base::cur) {
+            position = gptr() + offset;
+          }
+          else {
+            position = egptr() + offset;
+          }
+          if (!(mode & std::ios_base::in) || position < eback() || position > egptr()) {
+            return pos_type(off_type(-1));
+          }
+          setg(eback(), position, egptr());
+          return pos_type(off_type(position - eback()));
+        }
+
+        pos_type seekpos(pos_type position, std::ios_base::openmode mode) {
+          return seekoff(off_type(position), std::ios_base::beg, mode);
+        }
+    };
+
+    DataBuffer buffer;          /**< the data buffer, kept alive while the stream exists */
+    StreamBuffer streambuf;     /**< reads the data buffer */
+};
 
 /**
  * @brief Initializes the file tools.
@@ -84,6 +170,8 @@ void FileTools::quit() {
 
   DialogResource::quit();
   StringResource::quit();
+  archive_cache.clear();
+  archive_cache_size = 0;
   PHYSFS_deinit();
 }
 
@@ -96,11 +184,7 @@ void FileTools::initialize_languages() {
 
   // read the languages file
   lua_State* l = luaL_newstate();
-  size_t size;
-  char* buffer;
-  FileTools::data_file_open_buffer(file_name, &buffer, &size);
-  luaL_loadbuffer(l, buffer, size, file_name.c_str());
-  FileTools::data_file_close_buffer(buffer);
+  data_file_load_lua(l, file_name);
 
   lua_register(l, "language", l_language);
   if (lua_pcall(l, 0, 0, 0) != 0) {
@@ -156,8 +240,8 @@ bool FileTools::has_language(const std::string& language_code) {
  */
 void FileTools::set_language(const std::string& language_code) {
 
-  Debug::check_assertion(has_language(language_code),
-      StringConcat() << "Unknown language '" << language_code << "'");
+  SOLARUS_ASSERT(has_language(language_code),
+      "Unknown language '" << language_code << "'");
   FileTools::language_code = language_code;
   StringResource::initialize();
   DialogResource::initialize();
@@ -213,6 +297,7 @@ bool FileTools::data_file_exists(const std::string& file_name) {
  *
  * The file name is relative to the Solarus data directory.
  * The program is stopped with an error message if the file cannot be open.
+ * The stream reads the content of the file in place, without copying it.
  * Don't forget to close the stream with data_file_close().
  *
  * @param file_name name of the file to open
@@ -222,14 +307,7 @@ bool FileTools::data_file_exists(const std::string& file_name) {
 std::istream& FileTools::data_file_open(const std::string& file_name,
     bool language_specific) {
 
-  size_t size;
-  char* buffer;
-  data_file_open_buffer(file_name, &buffer, &size, language_specific);
-
-  // create an input stream
-  std::istringstream* is = new std::istringstream(std::string(buffer, size));
-  data_file_close_buffer(buffer);
-  return *is;
+  return *new DataBufferStream(data_file_read(file_name, language_specific));
 }
 
 /**
@@ -241,14 +319,18 @@ void FileTools::data_file_close(const std::istream& data_file) {
 }
 
 /**
- * @brief Opens a data file an loads its content into a buffer.
- * @param file_name name of the file to open
- * @param buffer the buffer to load
- * @param size number of bytes to read
+ * @brief Returns the content of a data file.
+ *
+ * The file is memory-mapped if it is in a directory. Otherwise, it is read
+ * into memory, unless it is still in the cache of files read recently.
+ * The program is stopped with an error message if the file cannot be open.
+ *
+ * @param file_name name of the file to read
  * @param language_specific true if the file is specific to the current language
+ * @return the content of the file
  */
-void FileTools::data_file_open_buffer(const std::string& file_name, char** buffer,
-    size_t* size, bool language_specific) {
+DataBuffer FileTools::data_file_read(const std::string& file_name,
+    bool language_specific) {
 
   std::string full_file_name;
   if (language_specific) {
@@ -258,22 +340,68 @@ void FileTools::data_file_open_buffer(const std::string& file_name, char** buffe
     full_file_name = file_name;
   }
 
-  // open the file
-  Debug::check_assertion(PHYSFS_exists(full_file_name.c_str()), StringConcat()
-      << "Data file " << full_file_name << " does not exist");
-  PHYSFS_file* file = PHYSFS_openRead(full_file_name.c_str());
-  Debug::check_assertion(file != NULL, StringConcat()
-      << "Cannot open data file " << full_file_name);
+  SOLARUS_ASSERT(PHYSFS_exists(full_file_name.c_str()),
+      "Data file " << full_file_name << " does not exist");
 
-  // load it into memory
-  *size = PHYSFS_fileLength(file);
+  // maybe we have read it recently
+  std::map<std::string, CachedFile>::iterator it = archive_cache.find(full_file_name);
+  if (it != archive_cache.end()) {
+    it->second.last_used = ++archive_cache_counter;
+    nb_bytes_read += it->second.buffer.get_size();
+    return it->second.buffer;
+  }
 
-  *buffer = new char[*size];
-  Debug::check_assertion(buffer != NULL, StringConcat()
-      << "Cannot allocate memory to read file " << full_file_name);
+  DataBuffer buffer = data_file_read_uncached(full_file_name);
+  SOLARUS_ASSERT(!buffer.is_empty(),
+      "Cannot open data file " << full_file_name);
 
-  PHYSFS_read(file, *buffer, 1, PHYSFS_uint32(*size));
-  PHYSFS_close(file);
+  if (!buffer.content->mapped) {
+    nb_bytes_copied += buffer.get_size();
+    add_cached_file(full_file_name, buffer);
+  }
+
+  nb_bytes_read += buffer.get_size();
+  return buffer;
+}
+
+/**
+ * @brief Returns the content of a data file without using the cache.
+ *
+ * Unlike data_file_read(), this function can be called from any thread:
+ * the buffer returned is not shared with anything else, and it is not
+ * counted in the statistics.
+ * The file is memory-mapped if it is in a directory, and read otherwise.
+ *
+ * @param file_name name of the file to read, including the language
+ * directory if any
+ * @return the content of the file, or an empty buffer if it cannot be read
+ */
+DataBuffer FileTools::data_file_read_uncached(const std::string& file_name) {
+
+  // map it if it is a file of a directory (this fails for a file of an archive)
+  const char* real_dir = PHYSFS_getRealDir(file_name.c_str());
+  if (real_dir == NULL) {
+    return DataBuffer();
+  }
+  DataBuffer buffer = DataBuffer::map_file(
+      std::string(real_dir) + PHYSFS_getDirSeparator() + file_name);
+
+  if (buffer.is_empty()) {
+    // load it into memory
+    PHYSFS_file* file = PHYSFS_openRead(file_name.c_str());
+    if (file == NULL) {
+      return buffer;
+    }
+
+    size_t size = size_t(PHYSFS_fileLength(file));
+    char* data = new char[size];
+    PHYSFS_read(file, data, 1, PHYSFS_uint32(size));
+    PHYSFS_close(file);
+
+    buffer = DataBuffer(data, size);
+  }
+
+  return buffer;
 }
 
 /**
@@ -286,10 +414,13 @@ void FileTools::data_file_open_buffer(const std::string& file_name, char** buffe
 void FileTools::data_file_save_buffer(const std::string& file_name,
     const char* buffer, size_t size) {
 
+  // forget the old content if we have it
+  remove_cached_file(file_name);
+
   // open the file to write
   PHYSFS_file *file = PHYSFS_openWrite(file_name.c_str());
-  Debug::check_assertion(file != NULL, StringConcat()
-      << "Cannot open file '" << file_name << "' for writing: "
+  SOLARUS_ASSERT(file != NULL,
+      "Cannot open file '" << file_name << "' for writing: "
       << PHYSFS_getLastError());
  
   // save the memory buffer 
@@ -300,15 +431,6 @@ void FileTools::data_file_save_buffer(const std::string& file_name,
   PHYSFS_close(file);
 }
 
-/**
- * @brief Closes a data buffer previously open with data_file_open_buffer().
- * @param buffer the buffer to close
- */
-void FileTools::data_file_close_buffer(char* buffer) {
-
-  delete[] buffer;
-}
- 
 /**
  * @brief Removes a file from the write directory.
  * @param file_name Name of the file to delete, relative to the Solarus
@@ -316,9 +438,434 @@ void FileTools::data_file_close_buffer(char* buffer) {
  */
 void FileTools::data_file_delete(const std::string& file_name) {
 
+  remove_cached_file(file_name);
   PHYSFS_delete(file_name.c_str());
 }
 
+/**
+ * @brief Keeps the content of a data file that could not be memory-mapped.
+ *
+ * Files used least recently are removed from the cache when the maximum
+ * size is reached. Big files are not kept.
+ *
+ * @param file_name Name of the data file.
+ * @param buffer Its content.
+ */
+void FileTools::add_cached_file(const std::string& file_name, const DataBuffer& buffer) {
+
+  const size_t size = buffer.get_size();
+  if (size > archive_cache_max_size / 8) {
+    return;
+  }
+
+  while (archive_cache_size + size > archive_cache_max_size) {
+
+    std::map<std::string, CachedFile>::iterator oldest = archive_cache.begin();
+    std::map<std::string, CachedFile>::iterator it;
+    for (it = archive_cache.begin(); it != archive_cache.end(); ++it) {
+      if (it->second.last_used < oldest->second.last_used) {
+        oldest = it;
+      }
+    }
+    archive_cache_size -= oldest->second.buffer.get_size();
+    archive_cache.erase(oldest);
+  }
+
+  CachedFile& cached_file = archive_cache[file_name];
+  cached_file.buffer = buffer;
+  cached_file.last_used = ++archive_cache_counter;
+  archive_cache_size += size;
+}
+
+/**
+ * @brief Forgets the content of a data file if it is in the cache.
+ * @param file_name Name of the data file.
+ */
+void FileTools::remove_cached_file(const std::string& file_name) {
+
+  std::map<std::string, CachedFile>::iterator it = archive_cache.find(file_name);
+  if (it != archive_cache.end()) {
+    archive_cache_size -= it->second.buffer.get_size();
+    archive_cache.erase(it);
+  }
+}
+
+/**
+ * @brief Returns the number of bytes of data files returned by data_file_read()
+ * and data_file_open() since the beginning of the program.
+ * @return The number of bytes read.
+ */
+uint64_t FileTools::get_nb_bytes_read() {
+  return nb_bytes_read;
+}
+
+/**
+ * @brief Returns the number of bytes of data files copied into memory
+ * since the beginning of the program.
+ *
+ * Bytes of memory-mapped files and of cached files are not copied.
+ *
+ * @return The number of bytes copied.
+ */
+uint64_t FileTools::get_nb_bytes_copied() {
+  return nb_bytes_copied;
+}
+
+/**
+ * @brief Loads a Lua data file as a function on top of the stack.
+ *
+ * This function is like luaL_loadbuffer() on the content of the file,
+ * except that the compiled chunk is used instead if it is up to date.
+ * If there is none, the compiled chunk is saved in the quest write
+ * directory for next time (once the quest write directory is known).
+ *
+ * @param l A Lua state.
+ * @param file_name Name of the Lua data file to load.
+ * @param language_specific true if the file is specific to the current language.
+ * @return 0 in case of success, or an error code of luaL_loadbuffer()
+ * (the error message is then on top of the stack).
+ */
+int FileTools::data_file_load_lua(lua_State* l, const std::string& file_name,
+    bool language_specific) {
+
+  uint64_t start_time = System::get_real_time_us();
+
+  std::string full_file_name;
+  if (language_specific) {
+    full_file_name = (std::string) "languages/" + language_code + "/" + file_name;
+  }
+  else {
+    full_file_name = file_name;
+  }
+
+  const DataBuffer& source = data_file_read(file_name, language_specific);
+  const char* buffer = source.get_data();
+  const size_t size = source.get_size();
+
+  // Look for a chunk packaged with the quest, then in the quest write directory.
+  const std::string& packaged_file_name = bytecode_dir + "/" + full_file_name;
+  const std::string& saved_file_name = quest_write_dir + "/" + packaged_file_name;
+  int result = 0;
+  if (load_bytecode(l, packaged_file_name, file_name, buffer, size)
+      || (!quest_write_dir.empty()
+          && load_bytecode(l, saved_file_name, file_name, buffer, size))) {
+    nb_bytecode_hits++;
+  }
+  else {
+    nb_bytecode_misses++;
+    result = luaL_loadbuffer(l, buffer, size, file_name.c_str());
+    if (result == 0 && !quest_write_dir.empty()) {
+      std::string bytecode;
+      dump_bytecode(l, buffer, size, bytecode);
+      data_file_save_cache(saved_file_name, bytecode.data(), bytecode.size());
+    }
+  }
+
+  lua_load_time += System::get_real_time_us() - start_time;
+  return result;
+}
+
+/**
+ * @brief Compiles all Lua data files of the quest and saves the
+ * compiled chunks in the quest data directory.
+ *
+ * The compiled chunks are saved in the "bytecode" subdirectory, so that
+ * they can be packaged with the quest. Files with a .lua or .dat extension
+ * that are not valid Lua code are ignored.
+ * The quest data must be a directory, not an archive.
+ *
+ * @param report Stream where the number of files compiled and the time
+ * saved are written.
+ */
+void FileTools::precompile_lua_files(std::ostream& report) {
+
+  const std::string& data_dir = start_writing_quest_data();
+
+  std::vector<std::string> file_names;
+  get_lua_source_files("", data_dir, file_names);
+
+  int nb_compiled = 0;
+  int nb_ignored = 0;
+  int nb_maps = 0;
+  uint64_t source_time = 0;
+  uint64_t bytecode_time = 0;
+  uint64_t map_source_time = 0;
+  uint64_t map_bytecode_time = 0;
+  for (unsigned int i = 0; i < file_names.size(); i++) {
+
+    const std::string& file_name = file_names[i];
+    const DataBuffer& source = data_file_read(file_name);
+    const char* buffer = source.get_data();
+    const size_t size = source.get_size();
+
+    // Compile the source.
+    lua_State* l = luaL_newstate();
+    uint64_t start_time = System::get_real_time_us();
+    int result = luaL_loadbuffer(l, buffer, size, file_name.c_str());
+    uint64_t parse_time = System::get_real_time_us() - start_time;
+    if (result != 0) {
+      // Not Lua code.
+      nb_ignored++;
+      lua_close(l);
+      continue;
+    }
+
+    std::string bytecode;
+    dump_bytecode(l, buffer, size, bytecode);
+    lua_close(l);
+
+    // Measure the time to load the compiled chunk instead.
+    l = luaL_newstate();
+    start_time = System::get_real_time_us();
+    luaL_loadbuffer(l, bytecode.data() + bytecode_header_size,
+        bytecode.size() - bytecode_header_size, file_name.c_str());
+    uint64_t load_time = System::get_real_time_us() - start_time;
+    lua_close(l);
+
+    data_file_save_cache(bytecode_dir + "/" + file_name, bytecode.data(), bytecode.size());
+    nb_compiled++;
+    source_time += parse_time;
+    bytecode_time += load_time;
+    if (file_name.find("maps/") == 0) {
+      nb_maps++;
+      map_source_time += parse_time;
+      map_bytecode_time += load_time;
+    }
+  }
+
+  report << "Compiled " << nb_compiled << " Lua files into '" << data_dir << "/"
+      << bytecode_dir << "' (" << nb_ignored << " other files ignored)" << std::endl;
+  report << "All files: " << source_time << " us to compile, "
+      << bytecode_time << " us to load compiled" << std::endl;
+  if (nb_maps > 0) {
+    report << "Maps: " << (map_source_time / nb_maps) << " us to compile, "
+        << (map_bytecode_time / nb_maps) << " us to load compiled per map" << std::endl;
+  }
+
+  stop_writing_quest_data();
+}
+
+/**
+ * @brief Makes the quest data directory the write directory.
+ *
+ * This is only useful for tools that generate data files of the quest.
+ * The quest data must be a directory, not an archive.
+ * Call stop_writing_quest_data() when you have finished.
+ *
+ * @return The quest data directory.
+ */
+std::string FileTools::start_writing_quest_data() {
+
+  const char* real_dir = PHYSFS_getRealDir("quest.dat");
+  if (real_dir == NULL || !PHYSFS_setWriteDir(real_dir)) {
+    Debug::die("Cannot write files in the quest data: it must be a directory");
+  }
+  return real_dir;
+}
+
+/**
+ * @brief Restores the usual write directory after start_writing_quest_data().
+ */
+void FileTools::stop_writing_quest_data() {
+
+  set_solarus_write_dir(solarus_write_dir);
+}
+
+/**
+ * @brief Returns the number of Lua data files loaded from a compiled chunk
+ * since the beginning of the program.
+ * @return The number of compiled chunks used.
+ */
+int FileTools::get_nb_bytecode_hits() {
+  return nb_bytecode_hits;
+}
+
+/**
+ * @brief Returns the number of Lua data files compiled from their source
+ * since the beginning of the program.
+ * @return The number of source files compiled.
+ */
+int FileTools::get_nb_bytecode_misses() {
+  return nb_bytecode_misses;
+}
+
+/**
+ * @brief Returns the time spent loading Lua data files
+ * since the beginning of the program.
+ * @return The loading time in microseconds.
+ */
+uint64_t FileTools::get_lua_load_time() {
+  return lua_load_time;
+}
+
+/**
+ * @brief Computes the hash of some data (32-bit FNV-1a).
+ * @param data The data.
+ * @param size Number of bytes of the data.
+ * @return The hash.
+ */
+uint32_t FileTools::get_hash(const char* data, size_t size) {
+
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ uint8_t(data[i])) * 16777619U;
+  }
+  return hash;
+}
+
+/**
+ * @brief Loads a compiled chunk if it corresponds to a source.
+ *
+ * Nothing is pushed if the compiled chunk does not exist, was compiled
+ * from another source or by an incompatible version of Lua.
+ *
+ * @param l A Lua state.
+ * @param bytecode_file_name Name of the compiled chunk file.
+ * @param chunk_name Name of the chunk, used in error messages.
+ * @param source The current content of the source file.
+ * @param source_size Number of bytes of the source file.
+ * @return true if the chunk was loaded.
+ */
+bool FileTools::load_bytecode(lua_State* l, const std::string& bytecode_file_name,
+    const std::string& chunk_name, const char* source, size_t source_size) {
+
+  if (!data_file_exists(bytecode_file_name)) {
+    return false;
+  }
+
+  const DataBuffer& bytecode = data_file_read(bytecode_file_name);
+  const char* buffer = bytecode.get_data();
+  const size_t size = bytecode.get_size();
+
+  bool loaded = false;
+  if (size > bytecode_header_size
+      && std::memcmp(buffer, bytecode_magic, sizeof(bytecode_magic)) == 0) {
+
+    uint32_t saved_size = 0;
+    uint32_t saved_hash = 0;
+    for (int i = 3; i >= 0; i--) {
+      saved_size = (saved_size << 8) | uint8_t(buffer[4 + i]);
+      saved_hash = (saved_hash << 8) | uint8_t(buffer[8 + i]);
+    }
+
+    if (saved_size == source_size && saved_hash == get_hash(source, source_size)) {
+      loaded = luaL_loadbuffer(l, buffer + bytecode_header_size,
+          size - bytecode_header_size, chunk_name.c_str()) == 0;
+      if (!loaded) {
+        // Probably compiled by another version of Lua.
+        lua_pop(l, 1);
+      }
+    }
+  }
+
+  return loaded;
+}
+
+/**
+ * @brief Makes the content of a compiled chunk file.
+ * @param l A Lua state with the function compiled from the source on top
+ * of the stack.
+ * @param source The content of the source file.
+ * @param source_size Number of bytes of the source file.
+ * @param bytecode Receives the content of the compiled chunk file.
+ */
+void FileTools::dump_bytecode(lua_State* l, const char* source, size_t source_size,
+    std::string& bytecode) {
+
+  const uint32_t hash = get_hash(source, source_size);
+  bytecode.assign(bytecode_magic, sizeof(bytecode_magic));
+  for (int i = 0; i < 4; i++) {
+    bytecode.push_back(char((uint32_t(source_size) >> (8 * i)) & 0xFF));
+  }
+  for (int i = 0; i < 4; i++) {
+    bytecode.push_back(char((hash >> (8 * i)) & 0xFF));
+  }
+  lua_dump(l, bytecode_writer, &bytecode);
+}
+
+/**
+ * @brief Function called by lua_dump() to write a compiled chunk.
+ * @param l The Lua state.
+ * @param data Part of the compiled chunk.
+ * @param size Number of bytes of this part.
+ * @param bytecode The string where the chunk is written.
+ * @return 0.
+ */
+int FileTools::bytecode_writer(lua_State* l, const void* data, size_t size,
+    void* bytecode) {
+
+  static_cast<std::string*>(bytecode)->append(static_cast<const char*>(data), size);
+  return 0;
+}
+
+/**
+ * @brief Saves a file that caches data computed from the quest
+ * (like a compiled chunk) in the write directory.
+ *
+ * Missing directories are created. Nothing happens if the file cannot be
+ * written: the data will just be computed again next time.
+ *
+ * @param file_name Name of the file, relative to the write directory.
+ * @param data The content of the file.
+ * @param size Number of bytes to write.
+ */
+void FileTools::data_file_save_cache(const std::string& file_name,
+    const char* data, size_t size) {
+
+  size_t separator = file_name.rfind('/');
+  if (separator != std::string::npos) {
+    PHYSFS_mkdir(file_name.substr(0, separator).c_str());
+  }
+
+  remove_cached_file(file_name);
+  PHYSFS_file* file = PHYSFS_openWrite(file_name.c_str());
+  if (file == NULL) {
+    return;
+  }
+  PHYSFS_write(file, data, PHYSFS_uint32(size), 1);
+  PHYSFS_close(file);
+}
+
+/**
+ * @brief Lists the files of the quest data that may contain Lua code.
+ *
+ * These are the files with a .lua or .dat extension, except the compiled
+ * chunks themselves.
+ *
+ * @param dir_name A directory of the quest data ("" for the root).
+ * @param real_dir The quest data directory: files of the same name from
+ * other locations of the search path are ignored.
+ * @param file_names Vector where the files found are appended.
+ */
+void FileTools::get_lua_source_files(const std::string& dir_name,
+    const std::string& real_dir, std::vector<std::string>& file_names) {
+
+  char** files = PHYSFS_enumerateFiles(dir_name.c_str());
+  for (char** it = files; *it != NULL; it++) {
+
+    const std::string& file_name = dir_name.empty() ?
+        std::string(*it) : dir_name + "/" + *it;
+    const char* file_real_dir = PHYSFS_getRealDir(file_name.c_str());
+    if (file_real_dir == NULL || real_dir != file_real_dir) {
+      continue;
+    }
+
+    if (PHYSFS_isDirectory(file_name.c_str())) {
+      if (file_name != bytecode_dir) {
+        get_lua_source_files(file_name, real_dir, file_names);
+      }
+    }
+    else {
+      size_t length = file_name.size();
+      if (length > 4
+          && (file_name.substr(length - 4) == ".lua" || file_name.substr(length - 4) == ".dat")) {
+        file_names.push_back(file_name);
+      }
+    }
+  }
+  PHYSFS_freeList(files);
+}
+
 /**
  * @brief Reads an integer value from an input stream.
  *
@@ -346,7 +893,7 @@ void FileTools::read(std::istream& is, uint32_t& value) {
 
   int v;
   read(is, v);
-  Debug::check_assertion(v >= 0, "Positive integer value expected from input stream");
+  SOLARUS_ASSERT(v >= 0, "Positive integer value expected from input stream");
   value = (uint32_t) v;
 }
 
@@ -15,6 +15,8 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "lowlevel/InputEvent.h"
+#include "lowlevel/System.h"
+#include <algorithm>
 
 const InputEvent::KeyboardKey InputEvent::directional_keys[] = {
     KEY_RIGHT,
@@ -26,6 +28,18 @@ const InputEvent::KeyboardKey InputEvent::directional_keys[] = {
 SDL_Joystick* InputEvent::joystick = NULL;
 std::map<InputEvent::KeyboardKey, std::string> InputEvent::keyboard_key_names;
 
+InputEvent InputEvent::event_queue[event_queue_capacity];
+int InputEvent::event_queue_first = 0;
+int InputEvent::event_queue_size = 0;
+int InputEvent::joypad_axis_states[max_joypad_axes] = { 0 };
+int InputEvent::joypad_hat_values[max_joypad_hats] = { 0 };
+
+uint64_t InputEvent::first_pending_input_date = 0;
+int InputEvent::nb_inputs_presented = 0;
+uint64_t InputEvent::total_input_latency = 0;
+uint64_t InputEvent::max_input_latency = 0;
+int InputEvent::nb_events_coalesced = 0;
+
 /**
  * @brief Initializes the input event manager.
  */
@@ -177,6 +191,16 @@ void InputEvent::quit() {
   }
 }
 
+/**
+ * @brief Creates an empty event.
+ *
+ * This is only used to preallocate the elements of the event queue.
+ */
+InputEvent::InputEvent() {
+
+  internal_event.type = SDL_NOEVENT;
+}
+
 /**
  * @brief Creates a keyboard event.
  * @param event the internal event to encapsulate
@@ -194,26 +218,156 @@ InputEvent::~InputEvent() {
 }
 
 /**
- * @brief Returns the first event from the event queue, or NULL
- * if there is no event.
- * @return the current event to handle, or NULL if there is no event
+ * @brief Moves all pending events from the system to the event queue.
+ *
+ * Redundant events are dropped: joypad axis and hat events that do not change
+ * the state of their axis or hat, and mouse motions that follow another mouse
+ * motion (which is updated instead).
+ * If the queue is full, the remaining events stay in the system queue
+ * until the next call.
  */
-InputEvent * InputEvent::get_event() {
+void InputEvent::poll_events() {
 
-  InputEvent *result = NULL;
   SDL_Event internal_event;
-  if (SDL_PollEvent(&internal_event)) {
+  while (event_queue_size < event_queue_capacity
+      && SDL_PollEvent(&internal_event)) {
 
     // ignore intermediate positions of joystick axis
-    if (internal_event.type != SDL_JOYAXISMOTION
-	|| internal_event.jaxis.value <= 1000
-	|| internal_event.jaxis.value >= 10000) {
+    if (internal_event.type == SDL_JOYAXISMOTION
+        && internal_event.jaxis.value > 1000
+        && internal_event.jaxis.value < 10000) {
+      continue;
+    }
+
+    if (is_redundant(internal_event)) {
+      nb_events_coalesced++;
+      continue;
+    }
+
+    int last = (event_queue_first + event_queue_size - 1) % event_queue_capacity;
+    if (internal_event.type == SDL_MOUSEMOTION
+        && event_queue_size > 0
+        && event_queue[last].internal_event.type == SDL_MOUSEMOTION) {
+      // merge with the previous motion
+      SDL_MouseMotionEvent& previous = event_queue[last].internal_event.motion;
+      internal_event.motion.xrel += previous.xrel;
+      internal_event.motion.yrel += previous.yrel;
+      previous = internal_event.motion;
+      nb_events_coalesced++;
+      continue;
+    }
+
+    int index = (event_queue_first + event_queue_size) % event_queue_capacity;
+    event_queue[index].internal_event = internal_event;
+    event_queue_size++;
+
+    if (first_pending_input_date == 0
+        && (event_queue[index].is_keyboard_event() || event_queue[index].is_joypad_event())) {
+      first_pending_input_date = System::get_real_time_us();
+    }
+  }
+}
+
+/**
+ * @brief Returns whether an event does not change the state of its joypad axis or hat.
+ *
+ * The state remembered is updated if the event is not redundant.
+ *
+ * @param event an event polled from the system
+ * @return true if this event can be dropped
+ */
+bool InputEvent::is_redundant(const SDL_Event& event) {
 
-      result = new InputEvent(internal_event);
+  if (event.type == SDL_JOYAXISMOTION
+      && event.jaxis.axis < max_joypad_axes) {
+
+    InputEvent axis_event(event);
+    int state = axis_event.get_joypad_axis_state();
+    if (state == joypad_axis_states[event.jaxis.axis]) {
+      return true;
     }
+    joypad_axis_states[event.jaxis.axis] = state;
   }
+  else if (event.type == SDL_JOYHATMOTION
+      && event.jhat.hat < max_joypad_hats) {
 
-  return result;
+    if (event.jhat.value == joypad_hat_values[event.jhat.hat]) {
+      return true;
+    }
+    joypad_hat_values[event.jhat.hat] = event.jhat.value;
+  }
+
+  return false;
+}
+
+/**
+ * @brief Removes the first event from the event queue and returns it.
+ *
+ * Call poll_events() first to fill the queue.
+ * No memory is allocated: the event returned is only valid until the next
+ * call to poll_events().
+ *
+ * @return the next event to handle, or NULL if there is no more event
+ */
+InputEvent* InputEvent::get_next_event() {
+
+  if (event_queue_size == 0) {
+    return NULL;
+  }
+
+  InputEvent* event = &event_queue[event_queue_first];
+  event_queue_first = (event_queue_first + 1) % event_queue_capacity;
+  event_queue_size--;
+  return event;
+}
+
+/**
+ * @brief Notifies the input manager that a frame was just shown on the screen.
+ *
+ * If some keyboard or joypad events were polled since the last frame,
+ * the time between the first of them and now is recorded as a latency.
+ */
+void InputEvent::notify_frame_presented() {
+
+  if (first_pending_input_date != 0) {
+    uint64_t latency = System::get_real_time_us() - first_pending_input_date;
+    nb_inputs_presented++;
+    total_input_latency += latency;
+    max_input_latency = std::max(max_input_latency, latency);
+    first_pending_input_date = 0;
+  }
+}
+
+/**
+ * @brief Returns the number of frames presented after keyboard or joypad events.
+ * @return the number of latencies recorded
+ */
+int InputEvent::get_nb_inputs_presented() {
+  return nb_inputs_presented;
+}
+
+/**
+ * @brief Returns the sum of the input-to-present latencies recorded.
+ * @return the total latency in microseconds
+ */
+uint64_t InputEvent::get_total_input_latency() {
+  return total_input_latency;
+}
+
+/**
+ * @brief Returns the highest input-to-present latency recorded.
+ * @return the maximum latency in microseconds
+ */
+uint64_t InputEvent::get_max_input_latency() {
+  return max_input_latency;
+}
+
+/**
+ * @brief Returns the number of redundant events dropped or merged.
+ * @return the number of events coalesced
+ */
+int InputEvent::get_nb_events_coalesced() {
+  return nb_events_coalesced;
 }
 
 // global information
@@ -575,6 +729,10 @@ void InputEvent::set_joypad_enabled(bool joypad_enabled) {
       SDL_JoystickEventState(SDL_IGNORE);
       SDL_QuitSubSystem(SDL_INIT_JOYSTICK);
     }
+
+    // a new joypad starts centered
+    std::fill(joypad_axis_states, joypad_axis_states + max_joypad_axes, 0);
+    std::fill(joypad_hat_values, joypad_hat_values + max_joypad_hats, 0);
   }
 }
 
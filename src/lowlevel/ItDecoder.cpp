@@ -43,10 +43,10 @@ ItDecoder::~ItDecoder() {
  * @param sound_data the memory area to read
  * @param sound_size size of the memory area in bytes
  */
-void ItDecoder::load(void* sound_data, size_t sound_size) {
+void ItDecoder::load(const void* sound_data, size_t sound_size) {
 
   // load the IT data into the IT library
-  modplug_file = ModPlug_Load((const void*) sound_data, int(sound_size));
+  modplug_file = ModPlug_Load(sound_data, int(sound_size));
 }
 
 /**
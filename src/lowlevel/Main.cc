@@ -17,6 +17,8 @@
 #ifndef SOLARUS_NOMAIN
 
 #include "MainLoop.h"
+#include "lowlevel/FileTools.h"
+#include "MapLoader.h"
 #include <iostream>
 #include <SDL.h>  // Necessary on some systems for SDLMain.
 
@@ -38,24 +40,52 @@ static void print_help(int argc, char** argv);
  * The following options are supported:
  *   -help               shows a help message
  *   -no-audio           disables sounds and musics
+ *   -no-sound-cache     does not save the decoded sounds in the quest write
+ *                       directory (see Sound)
+ *   -sound-timings      prints the time spent preloading the sounds
  *   -no-video           disables displaying (used for unitary tests)
+ *   -benchmark=N        runs N frames headless with a fixed timestep and
+ *                       prints the update and draw timings (see Benchmark)
+ *   -benchmark-map=ID   starts the benchmark on a new game on this map
+ *   -benchmark-input=F  replays the input events of file F during the benchmark
+ *   -benchmark-step=MS  simulated duration of a benchmark frame (default 10)
+ *   -precompile         compiles the Lua data files of the quest into its
+ *                       data directory and exits (see FileTools)
+ *   -convert-maps       converts the maps of the quest into binary map files
+ *                       in its data directory and exits (see MapLoader)
  *
  * @param argc number of command-line arguments
  * @param argv command-line arguments
  */
 int main(int argc, char **argv) {
 
-  // check the -help option
+  // check the -help, -precompile and -convert-maps options
   bool help = false;
+  bool precompile = false;
+  bool convert_maps = false;
   for (int i = 1; i < argc && !help; ++i) {
     const std::string arg = argv[i];
     help = (arg == std::string("-help"));
+    precompile = precompile || (arg == std::string("-precompile"));
+    convert_maps = convert_maps || (arg == std::string("-convert-maps"));
   }
 
   if (help) {
     // print a help message
     print_help(argc, argv);
   }
+  else if (precompile) {
+    // compile the Lua data files without running the quest
+    FileTools::initialize(argc, argv);
+    FileTools::precompile_lua_files(std::cout);
+    FileTools::quit();
+  }
+  else if (convert_maps) {
+    // make the binary map files without running the quest
+    FileTools::initialize(argc, argv);
+    MapLoader::convert_maps(std::cout);
+    FileTools::quit();
+  }
   else {
     // run the window
     MainLoop(argc, argv).run();
@@ -88,7 +118,25 @@ static void print_help(int argc, char **argv) {
     << std::endl
     << "  -no-audio           disables sounds and musics"
     << std::endl
+    << "  -no-sound-cache     does not keep the decoded sounds for the next launches"
+    << std::endl
+    << "  -sound-timings      prints the time spent preloading the sounds"
+    << std::endl
     << "  -no-video           disables displaying (may be useful for tests)"
+    << std::endl
+    << "  -benchmark=N        runs N frames as fast as possible without video and audio,"
+    << std::endl
+    << "                      with a simulated clock, and prints update/draw timings"
+    << std::endl
+    << "  -benchmark-map=ID   starts the benchmark with a new game on map ID"
+    << std::endl
+    << "  -benchmark-input=F  replays the keyboard events listed in file F"
+    << std::endl
+    << "  -benchmark-step=MS  simulated duration of a frame in milliseconds (default 10)"
+    << std::endl
+    << "  -precompile         compiles the Lua data files of the quest and exits"
+    << std::endl
+    << "  -convert-maps       converts the maps of the quest into binary files and exits"
     << std::endl;
 }
 
@@ -18,10 +18,25 @@
 #include "lowlevel/SpcDecoder.h"
 #include "lowlevel/ItDecoder.h"
 #include "lowlevel/FileTools.h"
+#include "lowlevel/System.h"
 #include "lowlevel/Debug.h"
 #include "lowlevel/StringConcat.h"
+#include <algorithm>
 
 const int Music::nb_buffers;
+const int Music::nb_samples_per_block;
+const int Music::nb_pcm_blocks;
+Music::PcmBlock* Music::pcm_blocks = NULL;
+int Music::next_block_written = 0;
+int Music::next_block_read = 0;
+SDL_sem* Music::free_blocks = NULL;
+SDL_sem* Music::ready_blocks = NULL;
+SDL_Thread* Music::decoding_thread = NULL;
+volatile bool Music::decoding_stopping = false;
+int Music::nb_blocks_played = 0;
+uint64_t Music::total_decoding_time = 0;
+uint32_t Music::max_decoding_time = 0;
+int Music::nb_underruns = 0;
 SpcDecoder* Music::spc_decoder = NULL;
 ItDecoder* Music::it_decoder = NULL;
 float Music::volume = 1.0;
@@ -65,6 +80,7 @@ Music::Music(const std::string& music_id):
     buffers[i] = AL_NONE;
   }
   source = AL_NONE;
+  nb_idle_buffers = 0;
 }
 
 /**
@@ -89,6 +105,7 @@ void Music::initialize() {
   // initialize the decoding features
   spc_decoder = new SpcDecoder();
   it_decoder = new ItDecoder();
+  pcm_blocks = new PcmBlock[nb_pcm_blocks];
 
   set_volume(100);
 }
@@ -98,8 +115,14 @@ void Music::initialize() {
  */
 void Music::quit() {
   if (is_initialized()) {
+    // the decoding thread must not use the decoders anymore
+    if (current_music != NULL) {
+      current_music->stop();
+    }
     delete spc_decoder;
     delete it_decoder;
+    delete[] pcm_blocks;
+    pcm_blocks = NULL;
     all_musics.clear();
   }
 }
@@ -212,114 +235,206 @@ void Music::update() {
 /**
  * @brief Updates this music when it is playing.
  *
- * This function handles the double buffering.
+ * The buffers already played are filled again with the blocks
+ * decoded by the decoding thread and queued to the source.
  */
 void Music::update_playing() {
 
   // get the empty buffers
   ALint nb_empty;
   alGetSourcei(source, AL_BUFFERS_PROCESSED, &nb_empty);
-
-  // refill them
   for (int i = 0; i < nb_empty; i++) {
-    ALuint buffer;
-    alSourceUnqueueBuffers(source, 1, &buffer); // unqueue the buffer
+    alSourceUnqueueBuffers(source, 1, &idle_buffers[nb_idle_buffers]);
+    nb_idle_buffers++;
+  }
+
+  // refill them with the blocks already decoded, without waiting for the others
+  while (nb_idle_buffers > 0 && SDL_SemTryWait(ready_blocks) == 0) {
+
+    PcmBlock& block = pcm_blocks[next_block_read];
+    ALuint buffer = idle_buffers[--nb_idle_buffers];
+    alBufferData(buffer, block.format, block.data, block.size, block.sample_rate);
+
+    int error = alGetError();
+    SOLARUS_ASSERT(error == AL_NO_ERROR,
+        "Failed to fill the audio buffer with decoded data for music file '" << file_name << ": error " << error);
+
+    nb_blocks_played++;
+    total_decoding_time += block.decoding_time;
+    max_decoding_time = std::max(max_decoding_time, block.decoding_time);
+
+    // give the block back to the decoding thread
+    next_block_read = (next_block_read + 1) % nb_pcm_blocks;
+    SDL_SemPost(free_blocks);
+
+    alSourceQueueBuffers(source, 1, &buffer);
+  }
+
+  ALint status;
+  alGetSourcei(source, AL_SOURCE_STATE, &status);
+
+  if (status != AL_PLAYING) {
+
+    ALint nb_queued;
+    alGetSourcei(source, AL_BUFFERS_QUEUED, &nb_queued);
+    if (nb_queued > 0) {
+      if (status == AL_STOPPED) {
+        // all buffers were played before new blocks were ready
+        nb_underruns++;
+      }
+      alSourcePlay(source);
+    }
+  }
+}
+
+/**
+ * @brief Starts the thread that decodes this music into the ring of blocks.
+ *
+ * All blocks are free and all buffers are waiting for data.
+ */
+void Music::start_decoding_thread() {
+
+  for (int i = 0; i < nb_buffers; i++) {
+    idle_buffers[i] = buffers[i];
+  }
+  nb_idle_buffers = nb_buffers;
+
+  next_block_written = 0;
+  next_block_read = 0;
+  free_blocks = SDL_CreateSemaphore(nb_pcm_blocks);
+  ready_blocks = SDL_CreateSemaphore(0);
+  decoding_stopping = false;
+  decoding_thread = SDL_CreateThread(decode_blocks, this);
+
+  SOLARUS_ASSERT(decoding_thread != NULL,
+      "Cannot create the decoding thread for music file '" << file_name << "': " << SDL_GetError());
+}
+
+/**
+ * @brief Stops the thread that decodes this music and waits for it to finish.
+ *
+ * The blocks not played yet are discarded.
+ */
+void Music::stop_decoding_thread() {
+
+  if (decoding_thread == NULL) {
+    return;
+  }
+
+  // wake up the thread if it is waiting for a free block
+  decoding_stopping = true;
+  SDL_SemPost(free_blocks);
+  SDL_WaitThread(decoding_thread, NULL);
+  decoding_thread = NULL;
+
+  SDL_DestroySemaphore(free_blocks);
+  SDL_DestroySemaphore(ready_blocks);
+  free_blocks = NULL;
+  ready_blocks = NULL;
+}
+
+/**
+ * @brief Main function of the decoding thread.
+ *
+ * Decodes the music into each free block of the ring, in order,
+ * until the music is stopped.
+ * This function never calls OpenAL: only the main thread does.
+ *
+ * @param music the music to decode
+ * @return 0
+ */
+int Music::decode_blocks(void* music) {
+
+  Music& self = *((Music*) music);
+
+  while (true) {
+
+    SDL_SemWait(free_blocks);
+    if (decoding_stopping) {
+      break;
+    }
+
+    PcmBlock& block = pcm_blocks[next_block_written];
+    uint64_t start_time = System::get_real_time_us();
 
-    // fill it by decoding more data
-    switch (format) {
+    switch (self.format) {
 
       case SPC:
-        decode_spc(buffer, 4096);
+        self.decode_spc(block, nb_samples_per_block);
         break;
 
       case IT:
-        decode_it(buffer, 4096);
+        self.decode_it(block, nb_samples_per_block);
         break;
 
       case OGG:
-        decode_ogg(buffer, 4096);
+        self.decode_ogg(block, nb_samples_per_block);
         break;
     }
-    alSourceQueueBuffers(source, 1, &buffer);   // queue it again
-  }
-
-  ALint status;
-  alGetSourcei(source, AL_SOURCE_STATE, &status);
+    block.decoding_time = uint32_t(System::get_real_time_us() - start_time);
 
-  if (status != AL_PLAYING) {
-    alSourcePlay(source);
+    // the block is now ready to be played
+    next_block_written = (next_block_written + 1) % nb_pcm_blocks;
+    SDL_SemPost(ready_blocks);
   }
+
+  return 0;
 }
 
 /**
  * @brief Decodes a chunk of SPC data into PCM data for the current music.
- * @param destination_buffer the destination buffer to write
+ * @param block the block to write
  * @param nb_samples number of samples to write
  */
-void Music::decode_spc(ALuint destination_buffer, ALsizei nb_samples) {
+void Music::decode_spc(PcmBlock& block, int nb_samples) {
 
-  // decode the SPC data
-  ALushort* raw_data = new ALushort[nb_samples];
-  spc_decoder->decode((int16_t*) raw_data, nb_samples);
+  spc_decoder->decode(block.data, nb_samples);
 
-  // put this decoded data into the buffer
-  alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data, nb_samples * 2, 32000);
-
-  delete[] raw_data;
-
-  int error = alGetError();
-  Debug::check_assertion(error == AL_NO_ERROR,
-      StringConcat() << "Failed to fill the audio buffer with decoded SPC data for music file '" << file_name << ": error " << error);
+  block.size = nb_samples * 2;
+  block.format = AL_FORMAT_STEREO16;
+  block.sample_rate = 32000;
 }
 
 /**
  * @brief Decodes a chunk of IT data into PCM data for the current music.
- * @param destination_buffer the destination buffer to write
+ * @param block the block to write
  * @param nb_samples number of samples to write
  */
-void Music::decode_it(ALuint destination_buffer, ALsizei nb_samples) {
+void Music::decode_it(PcmBlock& block, int nb_samples) {
 
-  // decode the IT data
-  ALushort* raw_data = new ALushort[nb_samples];
-  it_decoder->decode(raw_data, nb_samples);
+  it_decoder->decode(block.data, nb_samples);
 
-  // put this decoded data into the buffer
-  alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data, nb_samples, 44100);
-
-  delete[] raw_data;
-
-  int error = alGetError();
-  Debug::check_assertion(error == AL_NO_ERROR,
-      StringConcat() << "Failed to fill the audio buffer with decoded IT data for music file '" << file_name << ": error " << error);
+  block.size = nb_samples;
+  block.format = AL_FORMAT_STEREO16;
+  block.sample_rate = 44100;
 }
 
 /**
  * @brief Decodes a chunk of OGG data into PCM data for the current music.
- * @param destination_buffer the destination buffer to write
+ * @param block the block to write
  * @param nb_samples number of samples to write
  */
-void Music::decode_ogg(ALuint destination_buffer, ALsizei nb_samples) {
+void Music::decode_ogg(PcmBlock& block, int nb_samples) {
 
   // read the encoded music properties
   vorbis_info* info = ov_info(&ogg_file, -1);
-  ALsizei sample_rate = ALsizei(info->rate);
+  block.sample_rate = ALsizei(info->rate);
 
-  ALenum al_format = AL_NONE;
+  block.format = AL_NONE;
   if (info->channels == 1) {
-    al_format = AL_FORMAT_MONO16;
+    block.format = AL_FORMAT_MONO16;
   }
   else if (info->channels == 2) {
-    al_format = AL_FORMAT_STEREO16;
+    block.format = AL_FORMAT_STEREO16;
   }
 
   // decode the OGG data
-  ALshort* raw_data = new ALshort[nb_samples * info->channels];
   int bitstream;
   long bytes_read;
   long total_bytes_read = 0;
-  long remaining_bytes = nb_samples * info->channels * sizeof(ALshort);
+  long remaining_bytes = std::min(nb_samples * info->channels, nb_samples * 2) * sizeof(int16_t);
   do {
-    bytes_read = ov_read(&ogg_file, ((char*) raw_data) + total_bytes_read, int(remaining_bytes), 0, 2, 1, &bitstream);
+    bytes_read = ov_read(&ogg_file, ((char*) block.data) + total_bytes_read, int(remaining_bytes), 0, 2, 1, &bitstream);
     if (bytes_read < 0) {
       if (bytes_read != OV_HOLE) { // OV_HOLE is normal when the music loops
         std::cout << "Error while decoding ogg chunk: " << bytes_read << std::endl;
@@ -332,14 +447,7 @@ void Music::decode_ogg(ALuint destination_buffer, ALsizei nb_samples) {
   }
   while (remaining_bytes > 0 && bytes_read > 0);
 
-  // put this decoded data into the buffer
-  alBufferData(destination_buffer, al_format, raw_data, ALsizei(total_bytes_read), sample_rate);
-
-  delete[] raw_data;
-
-  int error = alGetError();
-  Debug::check_assertion(error == AL_NO_ERROR,
-      StringConcat() << "Failed to fill the audio buffer with decoded OGG data for music file '" << file_name << ": error " << error);
+  block.size = ALsizei(total_bytes_read);
 }
 
 /**
@@ -355,85 +463,76 @@ bool Music::start() {
     return false;
   }
 
-  Debug::check_assertion(current_music == NULL,
-      StringConcat() << "Cannot play music file '" << file_name << "': a music is already playing");
+  SOLARUS_ASSERT(current_music == NULL,
+      "Cannot play music file '" << file_name << "': a music is already playing");
 
   bool success = true;
 
   // create the buffers and the source
+  alGetError();
   alGenBuffers(nb_buffers, buffers);
+  int error = alGetError();
+  if (error != AL_NO_ERROR) {
+    std::cerr << "Cannot create buffers for music '" << file_name << "': error " << error << std::endl;
+    return false;
+  }
+
   alGenSources(1, &source);
+  error = alGetError();
+  if (error != AL_NO_ERROR) {
+    std::cerr << "Cannot create a source for music '" << file_name << "': error " << error << std::endl;
+    alDeleteBuffers(nb_buffers, buffers);
+    return false;
+  }
   alSourcef(source, AL_GAIN, volume);
 
   // load the music into memory
-  size_t sound_size;
-  char* sound_data;
+  DataBuffer sound_data;
   switch (format) {
 
     case SPC:
 
-      FileTools::data_file_open_buffer(file_name, &sound_data, &sound_size);
+      sound_data = FileTools::data_file_read(file_name);
 
       // load the SPC data into the SPC decoding library
-      spc_decoder->load((int16_t*) sound_data, sound_size);
-      FileTools::data_file_close_buffer(sound_data);
-
-      for (int i = 0; i < nb_buffers; i++) {
-        decode_spc(buffers[i], 4096);
-      }
+      spc_decoder->load((const int16_t*) sound_data.get_data(), sound_data.get_size());
       break;
 
     case IT:
 
-      FileTools::data_file_open_buffer(file_name, &sound_data, &sound_size);
+      sound_data = FileTools::data_file_read(file_name);
 
       // load the IT data into the IT decoding library
-      it_decoder->load(sound_data, sound_size);
-      FileTools::data_file_close_buffer(sound_data);
-
-      for (int i = 0; i < nb_buffers; i++) {
-        decode_it(buffers[i], 4096);
-      }
+      it_decoder->load(sound_data.get_data(), sound_data.get_size());
       break;
 
     case OGG:
 
       ogg_mem.position = 0;
       ogg_mem.loop = true;
-      FileTools::data_file_open_buffer(file_name, &ogg_mem.data, &ogg_mem.size);
+      ogg_mem.buffer = FileTools::data_file_read(file_name);
       // now, ogg_mem contains the encoded data
 
       int error = ov_open_callbacks(&ogg_mem, &ogg_file, NULL, 0, Sound::ogg_callbacks);
       if (error) {
         std::cout << "Cannot load music file from memory: error " << error << std::endl;
-      }
-      else {
-        for (int i = 0; i < nb_buffers; i++) {
-          decode_ogg(buffers[i], 4096);
-        }
+        success = false;
       }
       break;
   }
 
-  // start the streaming
-  alSourceQueueBuffers(source, nb_buffers, buffers);
-  int error = alGetError();
+  error = alGetError();
   if (error != AL_NO_ERROR) {
     std::cerr << "Cannot initialize buffers for music '" << file_name << "': error " << error << std::endl;
     success = false;
   }
-/*  else {
-    alSourcePlay(source);
-    int error = alGetError();
-    if (error != AL_NO_ERROR) {
-      std::cerr << "Cannot play music '" << file_name << "': error " << error << std::endl;
-      success = false;
-    }
-  }*/
-
-  alSourcePlay(source);
 
-  // now the update() function will take care of filling the buffers
+  // start decoding: the update() function will take care of filling the buffers
+  // and playing them as soon as the first blocks are ready
+  nb_idle_buffers = 0;
+  if (success) {
+    start_decoding_thread();
+  }
   current_music = this;
 
   return success;
@@ -452,6 +551,8 @@ void Music::stop() {
     return;
   }
 
+  stop_decoding_thread();
+
   // empty the source
   alSourceStop(source);
 
@@ -482,7 +583,7 @@ void Music::stop() {
 
     case OGG:
       ov_clear(&ogg_file);
-      FileTools::data_file_close_buffer(ogg_mem.data);
+      ogg_mem.buffer = DataBuffer();
       break;
   }
 }
@@ -520,3 +621,36 @@ void Music::set_paused(bool pause) {
   }
 }
 
+/**
+ * @brief Returns the number of decoded blocks given to OpenAL
+ * since the beginning of the program.
+ * @return the number of blocks played
+ */
+int Music::get_nb_blocks_played() {
+  return nb_blocks_played;
+}
+
+/**
+ * @brief Returns the total time spent decoding the blocks played.
+ * @return the decoding time in microseconds
+ */
+uint64_t Music::get_total_decoding_time() {
+  return total_decoding_time;
+}
+
+/**
+ * @brief Returns the highest time spent decoding a block.
+ * @return the decoding time in microseconds
+ */
+uint32_t Music::get_max_decoding_time() {
+  return max_decoding_time;
+}
+
+/**
+ * @brief Returns the number of times the music source played all its
+ * buffers before new blocks were decoded.
+ * @return the number of underruns
+ */
+int Music::get_nb_underruns() {
+  return nb_underruns;
+}
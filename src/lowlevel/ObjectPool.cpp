@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "lowlevel/ObjectPool.h"
+#include <new>
+
+ObjectPool::FreeBlock* ObjectPool::free_lists[ObjectPool::nb_free_lists] = { NULL };
+char* ObjectPool::chunk_position = NULL;
+size_t ObjectPool::chunk_remaining = 0;
+int ObjectPool::nb_allocations = 0;
+int ObjectPool::nb_reuses = 0;
+size_t ObjectPool::nb_bytes_reserved = 0;
+
+/**
+ * @brief Allocates memory for an object.
+ * @param size size of the object in bytes
+ * @return the memory allocated
+ */
+void* ObjectPool::allocate(size_t size) {
+
+  if (size == 0 || size > max_object_size) {
+    return ::operator new(size);
+  }
+
+  nb_allocations++;
+  const int index = int((size - 1) / granularity);
+  FreeBlock* block = free_lists[index];
+  if (block != NULL) {
+    free_lists[index] = block->next;
+    nb_reuses++;
+    return block;
+  }
+
+  const size_t block_size = (index + 1) * granularity;
+  if (chunk_remaining < block_size) {
+    // the end of the current chunk is lost: it is smaller than one object
+    chunk_position = static_cast<char*>(::operator new(chunk_size));
+    chunk_remaining = chunk_size;
+    nb_bytes_reserved += chunk_size;
+  }
+
+  void* memory = chunk_position;
+  chunk_position += block_size;
+  chunk_remaining -= block_size;
+  return memory;
+}
+
+/**
+ * @brief Releases the memory of an object allocated with allocate().
+ *
+ * The memory is kept for the next object of the same size.
+ *
+ * @param memory the memory to release (can be NULL)
+ * @param size size of the object in bytes, as passed to allocate()
+ */
+void ObjectPool::release(void* memory, size_t size) {
+
+  if (memory == NULL) {
+    return;
+  }
+
+  if (size == 0 || size > max_object_size) {
+    ::operator delete(memory);
+    return;
+  }
+
+  const int index = int((size - 1) / granularity);
+  FreeBlock* block = static_cast<FreeBlock*>(memory);
+  block->next = free_lists[index];
+  free_lists[index] = block;
+}
+
+/**
+ * @brief Returns the number of objects allocated in the pool since the
+ * beginning of the program.
+ * @return the number of allocations
+ */
+int ObjectPool::get_nb_allocations() {
+  return nb_allocations;
+}
+
+/**
+ * @brief Returns the number of objects allocated in the memory of a
+ * destroyed object, since the beginning of the program.
+ * @return the number of allocations that reused memory
+ */
+int ObjectPool::get_nb_reuses() {
+  return nb_reuses;
+}
+
+/**
+ * @brief Returns the total size of the memory chunks of the pool.
+ * @return the number of bytes reserved
+ */
+size_t ObjectPool::get_nb_bytes_reserved() {
+  return nb_bytes_reserved;
+}
+
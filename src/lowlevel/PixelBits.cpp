@@ -33,7 +33,7 @@ PixelBits::PixelBits(Surface& surface, const Rectangle& image_position) {
 
   int bits_per_pixel = format->BitsPerPixel;
 
-  Debug::check_assertion(bits_per_pixel == 8
+  SOLARUS_ASSERT(bits_per_pixel == 8
       || bits_per_pixel == 16
       || bits_per_pixel == 32,
       "This surface should have an 8/16/32-bit pixel format");
@@ -32,6 +32,18 @@ void Random::quit() {
   // nothing to do
 }
 
+/**
+ * @brief Restarts the random sequence from a known seed.
+ *
+ * This makes the sequence of random numbers reproducible,
+ * for example in benchmarks.
+ *
+ * @param seed the seed to use
+ */
+void Random::set_seed(unsigned int seed) {
+  srand(seed);
+}
+
 /**
  * @brief Returns a random integer number in [0, x[ with a uniform distribution.
  *
@@ -0,0 +1,520 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "lowlevel/Scaler.h"
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#endif
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Computes the four output pixels of Scale2x for one source pixel.
+ *
+ * Neighbours are named like in the Scale2x documentation:
+ * b is above, d on the left, e is the pixel itself, f on the right
+ * and h below.
+ */
+inline void scale2x_pixel(uint32_t b, uint32_t d, uint32_t e, uint32_t f, uint32_t h,
+    uint32_t* dst_row0, uint32_t* dst_row1) {
+
+  if (b != h && d != f) {
+    dst_row0[0] = (d == b) ? d : e;
+    dst_row0[1] = (b == f) ? f : e;
+    dst_row1[0] = (d == h) ? d : e;
+    dst_row1[1] = (h == f) ? f : e;
+  }
+  else {
+    dst_row0[0] = dst_row0[1] = dst_row1[0] = dst_row1[1] = e;
+  }
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief Returns a where mask is set and b elsewhere.
+ */
+inline __m128i select_128(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif
+
+#if defined(__AVX2__)
+/**
+ * @brief Returns a where mask is set and b elsewhere.
+ */
+inline __m256i select_256(__m256i mask, __m256i a, __m256i b) {
+  return _mm256_or_si256(_mm256_and_si256(mask, a), _mm256_andnot_si256(mask, b));
+}
+
+/**
+ * @brief Interleaves the 32-bit values of a and b: a0 b0 a1 b1 ... a7 b7.
+ * @param low Receives a0 b0 ... a3 b3.
+ * @param high Receives a4 b4 ... a7 b7.
+ */
+inline void interleave_256(__m256i a, __m256i b, __m256i& low, __m256i& high) {
+
+  // unpacklo/unpackhi work within each 128-bit lane.
+  __m256i lo = _mm256_unpacklo_epi32(a, b);  // a0 b0 a1 b1 | a4 b4 a5 b5
+  __m256i hi = _mm256_unpackhi_epi32(a, b);  // a2 b2 a3 b3 | a6 b6 a7 b7
+  low = _mm256_permute2x128_si256(lo, hi, 0x20);
+  high = _mm256_permute2x128_si256(lo, hi, 0x31);
+}
+#endif
+
+}
+
+/**
+ * @brief Constructor.
+ */
+Scaler::Scaler():
+  converted_pixels(NULL),
+  intermediate_pixels(NULL),
+  converted_size(0),
+  intermediate_size(0),
+  formats_known(false),
+  formats_equivalent(true) {
+
+}
+
+/**
+ * @brief Destructor.
+ */
+Scaler::~Scaler() {
+
+  delete[] converted_pixels;
+  delete[] intermediate_pixels;
+}
+
+/**
+ * @brief Scales a surface onto another one.
+ *
+ * Both surfaces must have 32 bits per pixel and the destination surface
+ * must be large enough to receive the scaled image at the specified x offset.
+ * The caller does not need to lock the surfaces.
+ *
+ * @param algorithm The scaling algorithm to use.
+ * @param src_surface The source surface.
+ * @param dst_surface The destination surface.
+ * @param dst_x X coordinate of the scaled image on the destination surface
+ * (non-zero when there are side bars).
+ */
+void Scaler::scale(Algorithm algorithm, SDL_Surface* src_surface,
+    SDL_Surface* dst_surface, int dst_x) {
+
+  const int width = src_surface->w;
+  const int height = src_surface->h;
+
+  SDL_LockSurface(src_surface);
+  SDL_LockSurface(dst_surface);
+
+  update_formats(src_surface->format, dst_surface->format);
+
+  const uint32_t* src = (const uint32_t*) src_surface->pixels;
+  int src_pitch = src_surface->pitch / 4;
+  if (!formats_equivalent) {
+    uint32_t* converted = reserve(converted_pixels, converted_size, width * height);
+    converter.convert(src, src_pitch, converted, width, height);
+    src = converted;
+    src_pitch = width;
+  }
+
+  uint32_t* dst = ((uint32_t*) dst_surface->pixels) + dst_x;
+  const int dst_pitch = dst_surface->pitch / 4;
+
+  switch (algorithm) {
+
+    case STRETCH:
+      stretch(src, src_pitch, width, height, dst, dst_pitch);
+      break;
+
+    case SCALE2X:
+      scale2x(src, src_pitch, width, height, dst, dst_pitch);
+      break;
+
+    case SCALE3X:
+      scale3x(src, src_pitch, width, height, dst, dst_pitch);
+      break;
+
+    case SCALE4X:
+    {
+      uint32_t* intermediate = reserve(intermediate_pixels, intermediate_size,
+          width * height * 4);
+      scale2x(src, src_pitch, width, height, intermediate, width * 2);
+      scale2x(intermediate, width * 2, width * 2, height * 2, dst, dst_pitch);
+      break;
+    }
+  }
+
+  SDL_UnlockSurface(dst_surface);
+  SDL_UnlockSurface(src_surface);
+}
+
+/**
+ * @brief Determines how source pixels must be converted.
+ *
+ * The result is cached: nothing is recomputed while the formats stay the same.
+ *
+ * @param src_format Pixel format of the source surface.
+ * @param dst_format Pixel format of the destination surface.
+ */
+void Scaler::update_formats(const SDL_PixelFormat* src_format,
+    const SDL_PixelFormat* dst_format) {
+
+  if (formats_known
+      && are_formats_equal(src_format, &last_src_format)
+      && are_formats_equal(dst_format, &last_dst_format)) {
+    return;
+  }
+
+  last_src_format = *src_format;
+  last_dst_format = *dst_format;
+  formats_known = true;
+
+  // The unused bits of the destination don't matter
+  // if it has no alpha channel.
+  formats_equivalent = src_format->Rmask == dst_format->Rmask
+      && src_format->Gmask == dst_format->Gmask
+      && src_format->Bmask == dst_format->Bmask
+      && (src_format->Amask == dst_format->Amask || dst_format->Amask == 0);
+
+  if (!formats_equivalent) {
+    converter.initialize(src_format, dst_format);
+  }
+}
+
+/**
+ * @brief Returns whether two pixel formats have the same channel layout.
+ * @param format1 A pixel format.
+ * @param format2 Another pixel format.
+ * @return true if they have the same depth and channel masks.
+ */
+bool Scaler::are_formats_equal(const SDL_PixelFormat* format1,
+    const SDL_PixelFormat* format2) {
+
+  return format1->BitsPerPixel == format2->BitsPerPixel
+      && format1->Rmask == format2->Rmask
+      && format1->Gmask == format2->Gmask
+      && format1->Bmask == format2->Bmask
+      && format1->Amask == format2->Amask;
+}
+
+/**
+ * @brief Makes sure that a scratch buffer can hold the specified number of pixels.
+ * @param buffer The buffer, reallocated if it is too small.
+ * @param allocated Number of pixels currently allocated in the buffer, updated.
+ * @param size Number of pixels required.
+ * @return The buffer.
+ */
+uint32_t* Scaler::reserve(uint32_t*& buffer, int& allocated, int size) {
+
+  if (allocated < size) {
+    delete[] buffer;
+    buffer = new uint32_t[size];
+    allocated = size;
+  }
+  return buffer;
+}
+
+/**
+ * @brief Precomputes the conversion between two 32-bit pixel formats.
+ * @param src_format The source format.
+ * @param dst_format The destination format.
+ */
+void Scaler::FormatConverter::initialize(const SDL_PixelFormat* src_format,
+    const SDL_PixelFormat* dst_format) {
+
+  src_masks[0] = src_format->Rmask;
+  src_masks[1] = src_format->Gmask;
+  src_masks[2] = src_format->Bmask;
+  src_masks[3] = src_format->Amask;
+  src_shifts[0] = src_format->Rshift;
+  src_shifts[1] = src_format->Gshift;
+  src_shifts[2] = src_format->Bshift;
+  src_shifts[3] = src_format->Ashift;
+  src_losses[0] = src_format->Rloss;
+  src_losses[1] = src_format->Gloss;
+  src_losses[2] = src_format->Bloss;
+  src_losses[3] = src_format->Aloss;
+
+  dst_masks[0] = dst_format->Rmask;
+  dst_masks[1] = dst_format->Gmask;
+  dst_masks[2] = dst_format->Bmask;
+  dst_masks[3] = dst_format->Amask;
+  dst_shifts[0] = dst_format->Rshift;
+  dst_shifts[1] = dst_format->Gshift;
+  dst_shifts[2] = dst_format->Bshift;
+  dst_shifts[3] = dst_format->Ashift;
+  dst_losses[0] = dst_format->Rloss;
+  dst_losses[1] = dst_format->Gloss;
+  dst_losses[2] = dst_format->Bloss;
+  dst_losses[3] = dst_format->Aloss;
+
+  // Like SDL_GetRGBA(), consider pixels as opaque if there is no alpha
+  // in the source, and like SDL_MapRGBA(), ignore alpha if there is none
+  // in the destination.
+  alpha_fill = 0;
+  if (src_masks[3] == 0) {
+    alpha_fill = dst_masks[3];
+  }
+  if (dst_masks[3] == 0) {
+    src_masks[3] = 0;
+  }
+}
+
+/**
+ * @brief Converts a rectangle of pixels.
+ * @param src The source pixels.
+ * @param src_pitch Number of pixels between two source rows.
+ * @param dst The destination pixels (rows are contiguous).
+ * @param width Number of pixels per row.
+ * @param height Number of rows.
+ */
+void Scaler::FormatConverter::convert(const uint32_t* src, int src_pitch,
+    uint32_t* dst, int width, int height) const {
+
+  for (int row = 0; row < height; row++) {
+    for (int col = 0; col < width; col++) {
+      const uint32_t pixel = src[col];
+      uint32_t result = alpha_fill;
+      for (int i = 0; i < 4; i++) {
+        if (src_masks[i] != 0) {
+          uint32_t value = ((pixel & src_masks[i]) >> src_shifts[i]) << src_losses[i];
+          result |= ((value >> dst_losses[i]) << dst_shifts[i]) & dst_masks[i];
+        }
+      }
+      dst[col] = result;
+    }
+    src += src_pitch;
+    dst += width;
+  }
+}
+
+/**
+ * @brief Stretches an image to double size: each pixel becomes a 2x2 square.
+ * @param src The source pixels.
+ * @param src_pitch Number of pixels between two source rows.
+ * @param width Width of the source image.
+ * @param height Height of the source image.
+ * @param dst The destination pixels.
+ * @param dst_pitch Number of pixels between two destination rows.
+ */
+void Scaler::stretch(const uint32_t* src, int src_pitch, int width, int height,
+    uint32_t* dst, int dst_pitch) {
+
+  for (int row = 0; row < height; row++) {
+
+    uint32_t* dst_row0 = dst;
+    uint32_t* dst_row1 = dst + dst_pitch;
+    int col = 0;
+
+#if defined(__AVX2__)
+    for (; col + 8 <= width; col += 8) {
+      __m256i pixels = _mm256_loadu_si256((const __m256i*) (src + col));
+      __m256i low, high;
+      interleave_256(pixels, pixels, low, high);
+      _mm256_storeu_si256((__m256i*) (dst_row0 + 2 * col), low);
+      _mm256_storeu_si256((__m256i*) (dst_row0 + 2 * col + 8), high);
+      _mm256_storeu_si256((__m256i*) (dst_row1 + 2 * col), low);
+      _mm256_storeu_si256((__m256i*) (dst_row1 + 2 * col + 8), high);
+    }
+#endif
+
+#if defined(__SSE2__)
+    for (; col + 4 <= width; col += 4) {
+      __m128i pixels = _mm_loadu_si128((const __m128i*) (src + col));
+      __m128i low = _mm_unpacklo_epi32(pixels, pixels);
+      __m128i high = _mm_unpackhi_epi32(pixels, pixels);
+      _mm_storeu_si128((__m128i*) (dst_row0 + 2 * col), low);
+      _mm_storeu_si128((__m128i*) (dst_row0 + 2 * col + 4), high);
+      _mm_storeu_si128((__m128i*) (dst_row1 + 2 * col), low);
+      _mm_storeu_si128((__m128i*) (dst_row1 + 2 * col + 4), high);
+    }
+#endif
+
+    for (; col < width; col++) {
+      dst_row0[2 * col] = dst_row0[2 * col + 1] =
+          dst_row1[2 * col] = dst_row1[2 * col + 1] = src[col];
+    }
+
+    src += src_pitch;
+    dst += 2 * dst_pitch;
+  }
+}
+
+/**
+ * @brief Scales an image to double size with the Scale2x algorithm.
+ *
+ * See http://scale2x.sourceforge.net/algorithm.html
+ * Pixels on the borders use themselves as their missing neighbours.
+ *
+ * @param src The source pixels.
+ * @param src_pitch Number of pixels between two source rows.
+ * @param width Width of the source image.
+ * @param height Height of the source image.
+ * @param dst The destination pixels.
+ * @param dst_pitch Number of pixels between two destination rows.
+ */
+void Scaler::scale2x(const uint32_t* src, int src_pitch, int width, int height,
+    uint32_t* dst, int dst_pitch) {
+
+  for (int row = 0; row < height; row++) {
+
+    const uint32_t* above = (row == 0) ? src : src - src_pitch;
+    const uint32_t* below = (row == height - 1) ? src : src + src_pitch;
+    uint32_t* dst_row0 = dst;
+    uint32_t* dst_row1 = dst + dst_pitch;
+
+    // First column: no left neighbour.
+    scale2x_pixel(above[0], src[0], src[0], (width > 1) ? src[1] : src[0], below[0],
+        dst_row0, dst_row1);
+
+    // Interior columns: all neighbours exist.
+    int col = 1;
+
+#if defined(__AVX2__)
+    for (; col + 8 < width; col += 8) {
+      __m256i b = _mm256_loadu_si256((const __m256i*) (above + col));
+      __m256i d = _mm256_loadu_si256((const __m256i*) (src + col - 1));
+      __m256i e = _mm256_loadu_si256((const __m256i*) (src + col));
+      __m256i f = _mm256_loadu_si256((const __m256i*) (src + col + 1));
+      __m256i h = _mm256_loadu_si256((const __m256i*) (below + col));
+
+      // Mask of the pixels where b != h and d != f.
+      __m256i changed = _mm256_andnot_si256(_mm256_cmpeq_epi32(b, h),
+          _mm256_andnot_si256(_mm256_cmpeq_epi32(d, f), _mm256_set1_epi32(-1)));
+
+      __m256i e0 = select_256(_mm256_and_si256(changed, _mm256_cmpeq_epi32(d, b)), d, e);
+      __m256i e1 = select_256(_mm256_and_si256(changed, _mm256_cmpeq_epi32(b, f)), f, e);
+      __m256i e2 = select_256(_mm256_and_si256(changed, _mm256_cmpeq_epi32(d, h)), d, e);
+      __m256i e3 = select_256(_mm256_and_si256(changed, _mm256_cmpeq_epi32(h, f)), f, e);
+
+      __m256i low, high;
+      interleave_256(e0, e1, low, high);
+      _mm256_storeu_si256((__m256i*) (dst_row0 + 2 * col), low);
+      _mm256_storeu_si256((__m256i*) (dst_row0 + 2 * col + 8), high);
+      interleave_256(e2, e3, low, high);
+      _mm256_storeu_si256((__m256i*) (dst_row1 + 2 * col), low);
+      _mm256_storeu_si256((__m256i*) (dst_row1 + 2 * col + 8), high);
+    }
+#endif
+
+#if defined(__SSE2__)
+    for (; col + 4 < width; col += 4) {
+      __m128i b = _mm_loadu_si128((const __m128i*) (above + col));
+      __m128i d = _mm_loadu_si128((const __m128i*) (src + col - 1));
+      __m128i e = _mm_loadu_si128((const __m128i*) (src + col));
+      __m128i f = _mm_loadu_si128((const __m128i*) (src + col + 1));
+      __m128i h = _mm_loadu_si128((const __m128i*) (below + col));
+
+      // Mask of the pixels where b != h and d != f.
+      __m128i changed = _mm_andnot_si128(_mm_cmpeq_epi32(b, h),
+          _mm_andnot_si128(_mm_cmpeq_epi32(d, f), _mm_set1_epi32(-1)));
+
+      __m128i e0 = select_128(_mm_and_si128(changed, _mm_cmpeq_epi32(d, b)), d, e);
+      __m128i e1 = select_128(_mm_and_si128(changed, _mm_cmpeq_epi32(b, f)), f, e);
+      __m128i e2 = select_128(_mm_and_si128(changed, _mm_cmpeq_epi32(d, h)), d, e);
+      __m128i e3 = select_128(_mm_and_si128(changed, _mm_cmpeq_epi32(h, f)), f, e);
+
+      _mm_storeu_si128((__m128i*) (dst_row0 + 2 * col), _mm_unpacklo_epi32(e0, e1));
+      _mm_storeu_si128((__m128i*) (dst_row0 + 2 * col + 4), _mm_unpackhi_epi32(e0, e1));
+      _mm_storeu_si128((__m128i*) (dst_row1 + 2 * col), _mm_unpacklo_epi32(e2, e3));
+      _mm_storeu_si128((__m128i*) (dst_row1 + 2 * col + 4), _mm_unpackhi_epi32(e2, e3));
+    }
+#endif
+
+    for (; col < width - 1; col++) {
+      scale2x_pixel(above[col], src[col - 1], src[col], src[col + 1], below[col],
+          dst_row0 + 2 * col, dst_row1 + 2 * col);
+    }
+
+    // Last column: no right neighbour.
+    if (width > 1) {
+      col = width - 1;
+      scale2x_pixel(above[col], src[col - 1], src[col], src[col], below[col],
+          dst_row0 + 2 * col, dst_row1 + 2 * col);
+    }
+
+    src += src_pitch;
+    dst += 2 * dst_pitch;
+  }
+}
+
+/**
+ * @brief Scales an image to triple size with the Scale3x algorithm.
+ *
+ * See http://scale2x.sourceforge.net/algorithm.html
+ * Pixels on the borders use themselves as their missing neighbours.
+ *
+ * @param src The source pixels.
+ * @param src_pitch Number of pixels between two source rows.
+ * @param width Width of the source image.
+ * @param height Height of the source image.
+ * @param dst The destination pixels.
+ * @param dst_pitch Number of pixels between two destination rows.
+ */
+void Scaler::scale3x(const uint32_t* src, int src_pitch, int width, int height,
+    uint32_t* dst, int dst_pitch) {
+
+  for (int row = 0; row < height; row++) {
+
+    const uint32_t* above = (row == 0) ? src : src - src_pitch;
+    const uint32_t* below = (row == height - 1) ? src : src + src_pitch;
+    uint32_t* dst_row0 = dst;
+    uint32_t* dst_row1 = dst + dst_pitch;
+    uint32_t* dst_row2 = dst + 2 * dst_pitch;
+
+    for (int col = 0; col < width; col++) {
+
+      // Neighbours:
+      // a b c
+      // d e f
+      // g h i
+      const int left = (col == 0) ? col : col - 1;
+      const int right = (col == width - 1) ? col : col + 1;
+      const uint32_t a = above[left], b = above[col], c = above[right];
+      const uint32_t d = src[left], e = src[col], f = src[right];
+      const uint32_t g = below[left], h = below[col], i = below[right];
+
+      uint32_t* e0 = dst_row0 + 3 * col;
+      uint32_t* e3 = dst_row1 + 3 * col;
+      uint32_t* e6 = dst_row2 + 3 * col;
+
+      if (b != h && d != f) {
+        e0[0] = (d == b) ? d : e;
+        e0[1] = ((d == b && e != c) || (b == f && e != a)) ? b : e;
+        e0[2] = (b == f) ? f : e;
+        e3[0] = ((d == b && e != g) || (d == h && e != a)) ? d : e;
+        e3[1] = e;
+        e3[2] = ((b == f && e != i) || (h == f && e != c)) ? f : e;
+        e6[0] = (d == h) ? d : e;
+        e6[1] = ((d == h && e != i) || (h == f && e != g)) ? h : e;
+        e6[2] = (h == f) ? f : e;
+      }
+      else {
+        e0[0] = e0[1] = e0[2] = e;
+        e3[0] = e3[1] = e3[2] = e;
+        e6[0] = e6[1] = e6[2] = e;
+      }
+    }
+
+    src += src_pitch;
+    dst += 3 * dst_pitch;
+  }
+}
@@ -24,13 +24,25 @@
 #include "lowlevel/FileTools.h"
 #include "lowlevel/Debug.h"
 #include "lowlevel/StringConcat.h"
+#include "lowlevel/System.h"
+
+static const char pcm_magic[4] = { 'S', 'P', 'C', '1' };
+static const size_t pcm_header_size = 16;
 
 ALCdevice* Sound::device = NULL;
 ALCcontext* Sound::context = NULL;
 bool Sound::initialized = false;
 bool Sound::sounds_preloaded = false;
+bool Sound::pcm_cache_enabled = true;
+bool Sound::preload_timings_enabled = false;
+const std::string Sound::pcm_cache_dir = "pcm";
+const std::string Sound::pcm_cache_extension = ".pcm";
 float Sound::volume = 1.0;
-std::list<Sound*> Sound::current_sounds;
+std::vector<Sound::Voice> Sound::voices;
+uint32_t Sound::nb_cycles = 1;
+int Sound::nb_active_voices = 0;
+int Sound::nb_voices_stolen = 0;
+int Sound::nb_plays_dropped = 0;
 std::map<std::string, Sound> Sound::all_sounds;
 ov_callbacks Sound::ogg_callbacks = {
     cb_read,
@@ -46,7 +58,9 @@ ov_callbacks Sound::ogg_callbacks = {
  */
 Sound::Sound(const std::string& sound_id):
   id(sound_id),
-  buffer(AL_NONE) {
+  buffer(AL_NONE),
+  nb_voices(0),
+  last_start_cycle(0) {
 
 }
 
@@ -58,15 +72,12 @@ Sound::~Sound() {
   if (is_initialized()) {
 
     // stop the sources where this buffer is attached
-    std::list<ALuint>::iterator it;
-    for (it = sources.begin(); it != sources.end(); it++) {
-      ALuint source = (*it);
-      alSourceStop(source);
-      alSourcei(source, AL_BUFFER, 0);
-      alDeleteSources(1, &source);
+    for (unsigned int i = 0; i < voices.size() && nb_voices > 0; i++) {
+      if (voices[i].sound == this) {
+        stop_voice(voices[i]);
+      }
     }
     alDeleteBuffers(1, &buffer);
-    current_sounds.remove(this);
   }
 }
 
@@ -74,19 +85,29 @@ Sound::~Sound() {
  * @brief Initializes the audio (music and sound) system.
  *
  * This method should be called when the application starts.
- * If the argument -no-audio is provided, this function has no effect and
+ * If the argument -no-audio (or -benchmark) is provided, this function has no effect and
  * there will be no sound.
+ * If the argument -no-sound-cache is provided, the sounds preloaded are not
+ * saved in the quest write directory.
+ * If the argument -sound-timings is provided, the time spent preloading the
+ * sounds is printed.
  *
  * @param argc command-line arguments number
  * @param argv command-line arguments
  */
 void Sound::initialize(int argc, char** argv) {
  
-  // check the -no-audio option
+  // check the -no-audio, -benchmark, -no-sound-cache and -sound-timings options
   bool disable = false;
   for (argv++; argc > 1 && !disable; argv++, argc--) {
     const std::string arg = *argv;
-    disable = (arg.find("-no-audio") == 0);
+    disable = (arg.find("-no-audio") == 0 || arg.find("-benchmark") == 0);
+    if (arg.find("-no-sound-cache") == 0) {
+      pcm_cache_enabled = false;
+    }
+    else if (arg.find("-sound-timings") == 0) {
+      preload_timings_enabled = true;
+    }
   }
   if (disable) {
     return;
@@ -118,6 +139,7 @@ void Sound::initialize(int argc, char** argv) {
 
   initialized = true;
   set_volume(100);
+  create_voices();
 
   // initialize the music system
   Music::initialize();
@@ -137,6 +159,7 @@ void Sound::quit() {
 
     // clear the sounds
     all_sounds.clear();
+    destroy_voices();
 
     // uninitialize OpenAL
 
@@ -160,11 +183,18 @@ bool Sound::is_initialized() {
 
 /**
  * @brief Loads and decodes all sounds listed in the game database.
+ *
+ * The sounds are decoded by several threads, or read from the decoded
+ * sounds saved by a previous launch. The time spent in each phase is printed
+ * if the -sound-timings option was given.
  */
 void Sound::load_all() {
 
   if (is_initialized() && !sounds_preloaded) {
 
+    uint64_t start_time = System::get_real_time_us();
+    std::vector<DecodedSound> sounds;
+
     // open the resource database file
     static const std::string file_name = "project_db.dat";
     std::istream& database_file = FileTools::data_file_open(file_name);
@@ -187,12 +217,91 @@ void Sound::load_all() {
 
         if (all_sounds.count(resource_id) == 0) {
           all_sounds[resource_id] = Sound(resource_id);
-          all_sounds[resource_id].load();
+
+          DecodedSound sound;
+          sound.id = resource_id;
+          sound.file_name = get_file_name(resource_id);
+          const std::string& quest_write_dir = FileTools::get_quest_write_dir();
+          if (pcm_cache_enabled && !quest_write_dir.empty()) {
+            // the decoded samples are not an ogg file: change the extension
+            std::string cache_name = sound.file_name;
+            const size_t dot_index = cache_name.rfind('.');
+            if (dot_index != std::string::npos && cache_name.find('/', dot_index) == std::string::npos) {
+              cache_name = cache_name.substr(0, dot_index);
+            }
+            sound.cache_file_name = quest_write_dir + "/" + pcm_cache_dir + "/"
+                + cache_name + pcm_cache_extension;
+          }
+          sound.sample_rate = 0;
+          sound.source_size = 0;
+          sound.source_hash = 0;
+          sound.from_cache = false;
+          sounds.push_back(sound);
         }
       }
     }
     FileTools::data_file_close(database_file);
- 
+    uint64_t listing_end_time = System::get_real_time_us();
+
+    // decode the sounds in parallel: the main thread also takes part
+    DecodingQueue queue;
+    queue.sounds = &sounds;
+    queue.next = 0;
+    queue.mutex = SDL_CreateMutex();
+
+    std::vector<SDL_Thread*> threads;
+    const int nb_threads = std::min(nb_decoding_threads, int(sounds.size())) - 1;
+    for (int i = 0; i < nb_threads; i++) {
+      SDL_Thread* thread = SDL_CreateThread(decode_sounds, &queue);
+      if (thread != NULL) {
+        threads.push_back(thread);
+      }
+    }
+    decode_sounds(&queue);
+    for (unsigned int i = 0; i < threads.size(); i++) {
+      SDL_WaitThread(threads[i], NULL);
+    }
+    SDL_DestroyMutex(queue.mutex);
+    uint64_t decoding_end_time = System::get_real_time_us();
+
+    // only the main thread creates OpenAL buffers
+    int nb_from_cache = 0;
+    for (unsigned int i = 0; i < sounds.size(); i++) {
+
+      const DecodedSound& sound = sounds[i];
+      Sound& preloaded_sound = all_sounds[sound.id];
+      if (!sound.samples.empty()) {
+        preloaded_sound.buffer = create_buffer(sound.samples, sound.sample_rate);
+      }
+      if (preloaded_sound.buffer == AL_NONE) {
+        std::cerr << "Sound '" << sound.file_name << "' will not be played" << std::endl;
+      }
+      if (sound.from_cache) {
+        nb_from_cache++;
+      }
+    }
+    uint64_t upload_end_time = System::get_real_time_us();
+
+    // keep the sounds decoded for the next launches
+    for (unsigned int i = 0; i < sounds.size(); i++) {
+
+      const DecodedSound& sound = sounds[i];
+      if (!sound.from_cache && !sound.samples.empty() && !sound.cache_file_name.empty()) {
+        save_pcm_cache(sound);
+      }
+    }
+    uint64_t end_time = System::get_real_time_us();
+
+    if (preload_timings_enabled) {
+      std::cout << "Preloaded " << sounds.size() << " sounds (" << nb_from_cache
+          << " already decoded) in " << (end_time - start_time) << " us: "
+          << (listing_end_time - start_time) << " us listing, "
+          << (decoding_end_time - listing_end_time) << " us decoding with "
+          << (threads.size() + 1) << " threads, "
+          << (upload_end_time - decoding_end_time) << " us creating buffers, "
+          << (end_time - upload_end_time) << " us saving decoded sounds" << std::endl;
+    }
+
     sounds_preloaded = true;
   }
 }
@@ -241,6 +350,32 @@ void Sound::set_volume(int volume) {
   Sound::volume = volume / 100.0;
 }
 
+/**
+ * @brief Returns the number of sources currently playing a sound.
+ * @return the number of active voices
+ */
+int Sound::get_nb_active_voices() {
+  return nb_active_voices;
+}
+
+/**
+ * @brief Returns the number of sounds stopped before their end because
+ * all sources were busy, since the beginning of the program.
+ * @return the number of voices stolen
+ */
+int Sound::get_nb_voices_stolen() {
+  return nb_voices_stolen;
+}
+
+/**
+ * @brief Returns the number of sounds not played because they were
+ * already started during the same cycle, since the beginning of the program.
+ * @return the number of plays dropped
+ */
+int Sound::get_nb_plays_dropped() {
+  return nb_plays_dropped;
+}
+
 /**
  * @brief Updates the audio (music and sound) system.
  *
@@ -248,55 +383,142 @@ void Sound::set_volume(int volume) {
  */
 void Sound::update() {
 
-  // update the playing sounds
-  Sound* sound;
-  std::list<Sound*> sounds_to_remove;
-  std::list<Sound*>::iterator it;
-  for (it = current_sounds.begin(); it != current_sounds.end(); it++) {
-    sound = *it;
-    if (!sound->update_playing()) {
-      sounds_to_remove.push_back(sound);
-    }
-  }
+  // free the sources that have finished playing
+  for (unsigned int i = 0; i < voices.size(); i++) {
 
-  for (it = sounds_to_remove.begin(); it != sounds_to_remove.end(); it++) {
-    sound = *it;
-    current_sounds.remove(sound);
+    Voice& voice = voices[i];
+    if (voice.sound != NULL) {
+      ALint status;
+      alGetSourcei(voice.source, AL_SOURCE_STATE, &status);
+      if (status != AL_PLAYING) {
+        stop_voice(voice);
+      }
+    }
   }
+  nb_cycles++;
 
   // also update the music
   Music::update();
 }
 
 /**
- * @brief Updates this sound when it is playing.
- * @return true if the sound is still playing, false if it is finished.
+ * @brief Creates the pool of sources.
+ *
+ * Up to max_voices sources are created, fewer if the audio device
+ * does not support as many. In this case, the last nb_music_sources
+ * sources that the device can create are left free for the music.
  */
-bool Sound::update_playing() {
+void Sound::create_voices() {
 
-  // see whether a source playing this sound has finished playing
-  ALuint source = *sources.begin();
-  ALint status;
-  alGetSourcei(source, AL_SOURCE_STATE, &status);
+  // create the sources of the music too, and then give them back
+  voices.reserve(max_voices + nb_music_sources);
+  while (voices.size() < max_voices + nb_music_sources) {
 
-  if (status != AL_PLAYING) {
-    sources.pop_front();
-    alSourcei(source, AL_BUFFER, 0);
-    alDeleteSources(1, &source);
+    Voice voice;
+    alGetError();
+    alGenSources(1, &voice.source);
+    if (alGetError() != AL_NO_ERROR) {
+      break;
+    }
+    voice.sound = NULL;
+    voice.start_cycle = 0;
+    voices.push_back(voice);
   }
 
-  return sources.size() != 0;
+  for (unsigned int i = 0; i < nb_music_sources && !voices.empty(); i++) {
+    alDeleteSources(1, &voices.back().source);
+    voices.pop_back();
+  }
 }
 
 /**
- * @brief Loads and decodes the sound into memory.
+ * @brief Destroys the pool of sources.
  */
-void Sound::load() {
+void Sound::destroy_voices() {
 
-  std::string file_name = (std::string) "sounds/" + id;
-  if (id.find(".") == std::string::npos) {
+  for (unsigned int i = 0; i < voices.size(); i++) {
+    if (voices[i].sound != NULL) {
+      stop_voice(voices[i]);
+    }
+    alDeleteSources(1, &voices[i].source);
+  }
+  voices.clear();
+}
+
+/**
+ * @brief Returns a source to play a sound.
+ *
+ * If the sound is already played by max_voices_per_sound sources, its
+ * oldest source is returned. Otherwise, a free source is returned if any.
+ * Otherwise, the source taken is the one of the sound with the most voices,
+ * or the oldest one among them.
+ * The source returned is stopped.
+ *
+ * @param sound the sound to play
+ * @return the source to use
+ */
+Sound::Voice& Sound::get_free_voice(Sound& sound) {
+
+  Voice* best_voice = NULL;
+  for (unsigned int i = 0; i < voices.size(); i++) {
+
+    Voice& voice = voices[i];
+    if (sound.nb_voices >= max_voices_per_sound) {
+      // the sound replaces itself
+      if (voice.sound == &sound
+          && (best_voice == NULL || voice.start_cycle < best_voice->start_cycle)) {
+        best_voice = &voice;
+      }
+    }
+    else if (voice.sound == NULL) {
+      return voice;
+    }
+    else if (best_voice == NULL
+        || voice.sound->nb_voices > best_voice->sound->nb_voices
+        || (voice.sound->nb_voices == best_voice->sound->nb_voices
+            && voice.start_cycle < best_voice->start_cycle)) {
+      best_voice = &voice;
+    }
+  }
+
+  stop_voice(*best_voice);
+  nb_voices_stolen++;
+  return *best_voice;
+}
+
+/**
+ * @brief Stops the sound played by a source and makes it free.
+ * @param voice a source playing a sound
+ */
+void Sound::stop_voice(Voice& voice) {
+
+  alSourceStop(voice.source);
+  alSourcei(voice.source, AL_BUFFER, 0);
+  voice.sound->nb_voices--;
+  voice.sound = NULL;
+  nb_active_voices--;
+}
+
+/**
+ * @brief Returns the name of the file of a sound.
+ * @param sound_id id of a sound
+ * @return name of its file in the data directory
+ */
+std::string Sound::get_file_name(const std::string& sound_id) {
+
+  std::string file_name = (std::string) "sounds/" + sound_id;
+  if (sound_id.find(".") == std::string::npos) {
     file_name += ".ogg";
   }
+  return file_name;
+}
+
+/**
+ * @brief Loads and decodes the sound into memory.
+ */
+void Sound::load() {
+
+  const std::string& file_name = get_file_name(id);
 
   // create an OpenAL buffer with the sound decoded by the library
   buffer = decode_file(file_name);
@@ -320,25 +542,31 @@ bool Sound::start() {
       load();
     }
 
-    if (buffer != AL_NONE) {
+    if (last_start_cycle == nb_cycles) {
+      // already started during this cycle: playing it twice would only be louder
+      nb_plays_dropped++;
+      success = true;
+    }
+    else if (buffer != AL_NONE && !voices.empty()) {
 
-      // create a source
-      ALuint source;
-      alGenSources(1, &source);
-      alSourcei(source, AL_BUFFER, buffer);
-      alSourcef(source, AL_GAIN, volume);
+      // take a source from the pool
+      Voice& voice = get_free_voice(*this);
+      alSourcei(voice.source, AL_BUFFER, buffer);
+      alSourcef(voice.source, AL_GAIN, volume);
 
       // play the sound
       int error = alGetError();
       if (error != AL_NO_ERROR) {
         std::cerr << "Cannot attach buffer " << buffer << " to the source to play sound: error " << error << std::endl;
-        alDeleteSources(1, &source);
+        alSourcei(voice.source, AL_BUFFER, 0);
       }
       else {
-        sources.push_back(source);
-        current_sounds.remove(this); // to avoid duplicates
-        current_sounds.push_back(this);
-        alSourcePlay(source);
+        voice.sound = this;
+        voice.start_cycle = nb_cycles;
+        nb_voices++;
+        nb_active_voices++;
+        last_start_cycle = nb_cycles;
+        alSourcePlay(voice.source);
         error = alGetError();
         if (error != AL_NO_ERROR) {
           std::cerr << "Cannot play sound: error " << error << std::endl;
@@ -361,83 +589,230 @@ ALuint Sound::decode_file(const std::string& file_name) {
 
   ALuint buffer = AL_NONE;
 
+  std::vector<char> samples;
+  ALsizei sample_rate;
+  if (decode_samples(FileTools::data_file_read(file_name), samples, sample_rate)) {
+    buffer = create_buffer(samples, sample_rate);
+  }
+
+  return buffer;
+}
+
+/**
+ * @brief Decodes an encoded sound file into 16-bit stereo samples.
+ *
+ * This function does not use OpenAL and can be called from any thread.
+ *
+ * @param source content of the encoded sound file
+ * @param samples vector where the decoded samples are stored
+ * @param sample_rate receives the sample rate of the sound
+ * @return true if the sound was decoded
+ */
+bool Sound::decode_samples(const DataBuffer& source,
+    std::vector<char>& samples, ALsizei& sample_rate) {
+
   // load the sound file
   SoundFromMemory mem;
   mem.loop = false;
   mem.position = 0;
-  FileTools::data_file_open_buffer(file_name, &mem.data, &mem.size);
+  mem.buffer = source;
 
   OggVorbis_File file;
   int error = ov_open_callbacks(&mem, &file, NULL, 0, ogg_callbacks);
 
   if (error) {
     std::cout << "Cannot load sound file from memory: error " << error << std::endl;
+    return false;
   }
-  else {
 
-    // read the encoded sound properties
-    vorbis_info* info = ov_info(&file, -1);
-    ALsizei sample_rate = ALsizei(info->rate);
+  // read the encoded sound properties
+  vorbis_info* info = ov_info(&file, -1);
+  sample_rate = ALsizei(info->rate);
 
-    ALenum format = AL_NONE;
-    if (info->channels == 1) {
-      format = AL_FORMAT_MONO16;
-    }
-    else if (info->channels == 2) {
-      format = AL_FORMAT_STEREO16;
-    }
+  ALenum format = AL_NONE;
+  if (info->channels == 1) {
+    format = AL_FORMAT_MONO16;
+  }
+  else if (info->channels == 2) {
+    format = AL_FORMAT_STEREO16;
+  }
 
-    if (format == AL_NONE) {
-      std::cout << "Invalid audio format" << std::endl;
-    }
-    else {
+  if (format == AL_NONE) {
+    std::cout << "Invalid audio format" << std::endl;
+  }
+  else {
 
-      // decode the sound with vorbisfile
-      std::vector<char> samples;
-      int bitstream;
-      long bytes_read;
-      long total_bytes_read = 0;
-      char samples_buffer[4096];
-      do {
-        bytes_read = ov_read(&file, samples_buffer, 4096, 0, 2, 1, &bitstream);
-        if (bytes_read < 0) {
-          std::cout << "Error while decoding ogg chunk: " << bytes_read << std::endl;
+    // decode the sound with vorbisfile
+    int bitstream;
+    long bytes_read;
+    char samples_buffer[4096];
+    do {
+      bytes_read = ov_read(&file, samples_buffer, 4096, 0, 2, 1, &bitstream);
+      if (bytes_read < 0) {
+        std::cout << "Error while decoding ogg chunk: " << bytes_read << std::endl;
+      }
+      else {
+        if (format == AL_FORMAT_STEREO16) {
+          samples.insert(samples.end(), samples_buffer, samples_buffer + bytes_read);
         }
         else {
-          total_bytes_read += bytes_read;
-          if (format == AL_FORMAT_STEREO16) {
-            samples.insert(samples.end(), samples_buffer, samples_buffer + bytes_read);
-          }
-          else {
-            // mono sound files make no sound on some machines
-            // workaround: convert them on-the-fly into stereo sounds
-            // TODO find a better solution
-            for (int i = 0; i < bytes_read; i += 2) {
-              samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
-              samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
-            }
-            total_bytes_read += bytes_read;
+          // mono sound files make no sound on some machines
+          // workaround: convert them on-the-fly into stereo sounds
+          // TODO find a better solution
+          for (int i = 0; i < bytes_read; i += 2) {
+            samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
+            samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
           }
         }
       }
-      while (bytes_read > 0);
-
-      // copy the samples into an OpenAL buffer
-      alGenBuffers(1, &buffer);
-      alBufferData(buffer, AL_FORMAT_STEREO16, (ALshort*) &samples[0], ALsizei(total_bytes_read), sample_rate);
-      if (alGetError() != AL_NO_ERROR) {
-        std::cout << "Cannot copy the sound samples into buffer " << buffer << "\n";
-        buffer = AL_NONE;
-      }
     }
-    ov_clear(&file);
+    while (bytes_read > 0);
   }
+  ov_clear(&file);
 
-  FileTools::data_file_close_buffer(mem.data);
+  return !samples.empty();
+}
+
+/**
+ * @brief Copies decoded samples into a new OpenAL buffer.
+ *
+ * This function must be called from the main thread.
+ *
+ * @param samples 16-bit stereo samples (not empty)
+ * @param sample_rate sample rate of the samples
+ * @return the buffer created, or AL_NONE in case of error
+ */
+ALuint Sound::create_buffer(const std::vector<char>& samples, ALsizei sample_rate) {
+
+  ALuint buffer = AL_NONE;
+  alGenBuffers(1, &buffer);
+  alBufferData(buffer, AL_FORMAT_STEREO16, (ALshort*) &samples[0], ALsizei(samples.size()), sample_rate);
+  if (alGetError() != AL_NO_ERROR) {
+    std::cout << "Cannot copy the sound samples into buffer " << buffer << "\n";
+    alDeleteBuffers(1, &buffer);
+    buffer = AL_NONE;
+  }
 
   return buffer;
 }
 
+/**
+ * @brief Function executed by the threads that decode sounds in load_all().
+ *
+ * Each thread takes the next sound of the queue until there is no more.
+ *
+ * @param queue the DecodingQueue shared by the threads
+ * @return 0
+ */
+int Sound::decode_sounds(void* queue) {
+
+  DecodingQueue& decoding_queue = *static_cast<DecodingQueue*>(queue);
+  std::vector<DecodedSound>& sounds = *decoding_queue.sounds;
+
+  while (true) {
+
+    SDL_LockMutex(decoding_queue.mutex);
+    unsigned int index = decoding_queue.next;
+    if (index < sounds.size()) {
+      decoding_queue.next++;
+    }
+    SDL_UnlockMutex(decoding_queue.mutex);
+
+    if (index >= sounds.size()) {
+      return 0;
+    }
+    decode_sound(sounds[index]);
+  }
+}
+
+/**
+ * @brief Gets the samples of a sound, from the cache if the sound was
+ * already decoded from the same source or by decoding its file otherwise.
+ *
+ * This function does not use OpenAL and can be called from any thread.
+ *
+ * @param sound the sound to decode
+ */
+void Sound::decode_sound(DecodedSound& sound) {
+
+  const DataBuffer& source = FileTools::data_file_read_uncached(sound.file_name);
+  if (source.is_empty()) {
+    std::cout << "Cannot read sound file '" << sound.file_name << "'" << std::endl;
+    return;
+  }
+
+  sound.source_size = uint32_t(source.get_size());
+  sound.source_hash = FileTools::get_hash(source.get_data(), source.get_size());
+  if (!sound.cache_file_name.empty() && read_pcm_cache(sound)) {
+    sound.from_cache = true;
+  }
+  else {
+    decode_samples(source, sound.samples, sound.sample_rate);
+  }
+}
+
+/**
+ * @brief Reads the samples of a sound from its decoded sound file.
+ *
+ * The decoded sound file starts with a header: "SPC1", the size and the
+ * hash of the source file and the sample rate (32-bit little-endian integers).
+ * The samples follow. The file is only used if it was decoded from the
+ * current source.
+ *
+ * This function can be called from any thread.
+ *
+ * @param sound the sound to read, with the hash of its source
+ * @return true if the samples were read
+ */
+bool Sound::read_pcm_cache(DecodedSound& sound) {
+
+  const DataBuffer& cache = FileTools::data_file_read_uncached(sound.cache_file_name);
+  const char* data = cache.get_data();
+  const size_t size = cache.get_size();
+
+  if (size <= pcm_header_size
+      || std::memcmp(data, pcm_magic, sizeof(pcm_magic)) != 0) {
+    return false;
+  }
+
+  uint32_t source_size = 0;
+  uint32_t source_hash = 0;
+  uint32_t sample_rate = 0;
+  for (int i = 3; i >= 0; i--) {
+    source_size = (source_size << 8) | uint8_t(data[4 + i]);
+    source_hash = (source_hash << 8) | uint8_t(data[8 + i]);
+    sample_rate = (sample_rate << 8) | uint8_t(data[12 + i]);
+  }
+
+  if (source_size != sound.source_size || source_hash != sound.source_hash) {
+    return false;
+  }
+
+  sound.sample_rate = ALsizei(sample_rate);
+  sound.samples.assign(data + pcm_header_size, data + size);
+  return true;
+}
+
+/**
+ * @brief Saves the samples of a sound in its decoded sound file.
+ *
+ * Nothing happens if the file cannot be written.
+ *
+ * @param sound a sound just decoded from its source
+ */
+void Sound::save_pcm_cache(const DecodedSound& sound) {
+
+  std::vector<char> content(pcm_magic, pcm_magic + sizeof(pcm_magic));
+  const uint32_t values[] = { sound.source_size, sound.source_hash, uint32_t(sound.sample_rate) };
+  for (int j = 0; j < 3; j++) {
+    for (int i = 0; i < 4; i++) {
+      content.push_back(char((values[j] >> (8 * i)) & 0xFF));
+    }
+  }
+  content.insert(content.end(), sound.samples.begin(), sound.samples.end());
+
+  FileTools::data_file_save_cache(sound.cache_file_name, &content[0], content.size());
+}
 
 /**
  * @brief Loads an encoded sound from memory.
@@ -454,7 +829,8 @@ size_t Sound::cb_read(void* ptr, size_t size, size_t nb_bytes, void* datasource)
 
   SoundFromMemory* mem = (SoundFromMemory*) datasource;
 
-  if (mem->position >= mem->size) {
+  const size_t mem_size = mem->buffer.get_size();
+  if (mem->position >= mem_size) {
     if (mem->loop) {
       mem->position = 0;
     }
@@ -462,11 +838,11 @@ size_t Sound::cb_read(void* ptr, size_t size, size_t nb_bytes, void* datasource)
       return 0;
     }
   }
-  else if (mem->position + nb_bytes >= mem->size) {
-    nb_bytes = mem->size - mem->position;
+  else if (mem->position + nb_bytes >= mem_size) {
+    nb_bytes = mem_size - mem->position;
   }
 
-  memcpy(ptr, mem->data + mem->position, nb_bytes);
+  memcpy(ptr, mem->buffer.get_data() + mem->position, nb_bytes);
   mem->position += nb_bytes;
 
   return nb_bytes;
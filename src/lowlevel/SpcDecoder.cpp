@@ -16,7 +16,6 @@
  */
 #include "lowlevel/SpcDecoder.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 
 /**
  * @brief Creates an SPC decoder.
@@ -43,10 +42,10 @@ SpcDecoder::~SpcDecoder() {
  * @param sound_data the memory area to read
  * @param sound_size size of the memory area in bytes
  */
-void SpcDecoder::load(int16_t *sound_data, size_t sound_size) {
+void SpcDecoder::load(const int16_t *sound_data, size_t sound_size) {
 
   // load the SPC data into the SPC library
-  spc_load_spc(snes_spc_manager, (short int*) sound_data, sound_size);
+  spc_load_spc(snes_spc_manager, sound_data, sound_size);
   spc_clear_echo(snes_spc_manager);
   spc_filter_clear(snes_spc_filter);
 }
@@ -62,7 +61,7 @@ void SpcDecoder::decode(int16_t *decoded_data, int nb_samples) {
   // decode from the SPC data the specified number of PCM samples
 
   const char *err = spc_play(snes_spc_manager, nb_samples, (short int*) decoded_data);
-  Debug::check_assertion(err == NULL, StringConcat() << "Failed to decode SPC data: " << err);
+  SOLARUS_ASSERT(err == NULL, "Failed to decode SPC data: " << err);
   spc_filter_run(snes_spc_filter, (short int*) decoded_data, nb_samples);
 }
 
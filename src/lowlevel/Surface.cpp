@@ -19,11 +19,26 @@
 #include "lowlevel/Rectangle.h"
 #include "lowlevel/FileTools.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 #include "lua/LuaContext.h"
 #include "Transition.h"
 #include <SDL_image.h>
 
+std::map<std::string, Surface::CachedImage> Surface::image_cache;
+int Surface::image_cache_size = 0;
+uint32_t Surface::image_cache_counter = 0;
+SDL_Surface* Surface::format_surface = NULL;
+int Surface::nb_image_cache_hits = 0;
+int Surface::nb_image_cache_misses = 0;
+int Surface::nb_images_copied = 0;
+std::map<std::string, Surface::PrefetchedImage> Surface::prefetched_images;
+std::list<std::string> Surface::prefetch_requests;
+SDL_Thread* Surface::prefetch_thread = NULL;
+SDL_mutex* Surface::prefetch_mutex = NULL;
+SDL_cond* Surface::prefetch_cond = NULL;
+bool Surface::prefetch_stopping = false;
+bool Surface::prefetch_decoding = false;
+int Surface::nb_images_prefetched = 0;
+
 /**
  * @brief Creates an empty surface with the specified size.
  * @param width the width in pixels
@@ -51,6 +66,9 @@ Surface::Surface(const Rectangle& size):
 
 /**
  * @brief Creates a surface from the specified image file name.
+ *
+ * The image is only decoded if it is not in the cache.
+ *
  * @param file_name name of the image file to load, relative to the base directory specified
  * @param base_directory the base directory to use
  */
@@ -70,15 +88,7 @@ Surface::Surface(const std::string& file_name, ImageDirectory base_directory):
   }
   std::string prefixed_file_name = prefix + file_name;
 
-  size_t size;
-  char* buffer;
-  FileTools::data_file_open_buffer(prefixed_file_name, &buffer, &size, language_specific);
-  SDL_RWops* rw = SDL_RWFromMem(buffer, int(size));
-  this->internal_surface = IMG_Load_RW(rw, 0);
-  FileTools::data_file_close_buffer(buffer);
-  SDL_RWclose(rw);
-
-  Debug::check_assertion(internal_surface != NULL, StringConcat() << "Cannot load image '" << prefixed_file_name << "'");
+  this->internal_surface = get_image(prefixed_file_name, language_specific);
 }
 
 /**
@@ -98,14 +108,24 @@ Surface::Surface(SDL_Surface* internal_surface):
 
 /**
  * @brief Copy constructor.
+ *
+ * The pixels are shared until one of the surfaces is modified.
+ *
  * @param other a surface to copy
  */
 Surface::Surface(const Surface& other):
   Drawable(),
-  internal_surface(SDL_ConvertSurface(other.internal_surface,
-      other.internal_surface->format, other.internal_surface->flags)),
+  internal_surface(other.internal_surface),
   internal_surface_created(true) {
 
+  if (other.internal_surface_created) {
+    internal_surface->refcount++;
+  }
+  else {
+    // the other surface does not own its SDL surface: we cannot keep it
+    internal_surface = SDL_ConvertSurface(other.internal_surface,
+        other.internal_surface->format, other.internal_surface->flags);
+  }
 }
 
 /**
@@ -118,6 +138,375 @@ Surface::~Surface() {
   }
 }
 
+/**
+ * @brief Stops decoding images in advance and empties the cache of images.
+ *
+ * Surfaces that still use an image of the cache keep it.
+ */
+void Surface::quit() {
+
+  if (prefetch_thread != NULL) {
+    SDL_LockMutex(prefetch_mutex);
+    prefetch_stopping = true;
+    SDL_CondBroadcast(prefetch_cond);
+    SDL_UnlockMutex(prefetch_mutex);
+    SDL_WaitThread(prefetch_thread, NULL);
+    prefetch_thread = NULL;
+
+    SDL_DestroyCond(prefetch_cond);
+    prefetch_cond = NULL;
+    SDL_DestroyMutex(prefetch_mutex);
+    prefetch_mutex = NULL;
+    prefetch_stopping = false;
+  }
+
+  std::map<std::string, PrefetchedImage>::iterator prefetched_it;
+  for (prefetched_it = prefetched_images.begin();
+      prefetched_it != prefetched_images.end(); ++prefetched_it) {
+    if (prefetched_it->second.image != NULL) {
+      SDL_FreeSurface(prefetched_it->second.image);
+    }
+  }
+  prefetched_images.clear();
+  prefetch_requests.clear();
+
+  std::map<std::string, CachedImage>::iterator it;
+  for (it = image_cache.begin(); it != image_cache.end(); ++it) {
+    SDL_FreeSurface(it->second.surface);
+  }
+  image_cache.clear();
+  image_cache_size = 0;
+
+  if (format_surface != NULL) {
+    SDL_FreeSurface(format_surface);
+    format_surface = NULL;
+  }
+}
+
+/**
+ * @brief Returns the name identifying an image in the cache.
+ * @param file_name name of the image file, relative to the data directory
+ * (or to the language directory)
+ * @param language_specific true if the image is specific to the current language
+ * @return the name of the image file, including the language directory if any
+ */
+std::string Surface::get_image_key(const std::string& file_name, bool language_specific) {
+
+  if (language_specific) {
+    return std::string("languages/") + FileTools::get_language() + "/" + file_name;
+  }
+  return file_name;
+}
+
+/**
+ * @brief Returns a decoded image, from the cache if possible.
+ *
+ * If the image was requested to the decoding thread, it is taken from there,
+ * possibly after waiting for the end of its decoding.
+ *
+ * @param file_name name of the image file, relative to the data directory
+ * (or to the language directory)
+ * @param language_specific true if the image is specific to the current language
+ * @return the decoded image, with a new reference for the caller
+ */
+SDL_Surface* Surface::get_image(const std::string& file_name, bool language_specific) {
+
+  const std::string& key = get_image_key(file_name, language_specific);
+  collect_prefetched_images(false);
+
+  SDL_Surface* image = NULL;
+  std::map<std::string, CachedImage>::iterator it = image_cache.find(key);
+  if (it != image_cache.end()) {
+    nb_image_cache_hits++;
+    it->second.last_used = ++image_cache_counter;
+    image = it->second.surface;
+    image->refcount++;
+    return image;
+  }
+
+  nb_image_cache_misses++;
+  if (prefetched_images.count(key) > 0) {
+    // being decoded: wait for it
+    collect_prefetched_images(true);
+    it = image_cache.find(key);
+    if (it != image_cache.end()) {
+      it->second.last_used = ++image_cache_counter;
+      image = it->second.surface;
+      image->refcount++;
+      return image;
+    }
+  }
+
+  const DataBuffer& buffer = FileTools::data_file_read(file_name, language_specific);
+  SDL_RWops* rw = SDL_RWFromConstMem(buffer.get_data(), int(buffer.get_size()));
+  image = IMG_Load_RW(rw, 0);
+  SDL_RWclose(rw);
+
+  SOLARUS_ASSERT(image != NULL, "Cannot load image '" << file_name << "'");
+
+  image = convert_image(image);
+  if (add_image(key, image)) {
+    image->refcount++;
+  }
+  // otherwise, it is too big to be kept: the caller gets the only reference
+  return image;
+}
+
+/**
+ * @brief Converts a decoded image to the pixel format of the surfaces
+ * created by this class, so that blitting it needs no conversion.
+ *
+ * Images with an alpha channel are not converted.
+ *
+ * @param image a decoded image (freed if it is converted)
+ * @return the converted image
+ */
+SDL_Surface* Surface::convert_image(SDL_Surface* image) {
+
+  if (format_surface == NULL) {
+    format_surface = SDL_CreateRGBSurface(
+        SDL_SWSURFACE, 1, 1, SOLARUS_COLOR_DEPTH, 0, 0, 0, 0);
+  }
+  if (image->format->Amask == 0) {
+    SDL_Surface* converted_image = SDL_ConvertSurface(image, format_surface->format,
+        image->flags & (SDL_SRCCOLORKEY | SDL_SRCALPHA));
+    if (converted_image != NULL) {
+      SDL_FreeSurface(image);
+      image = converted_image;
+    }
+  }
+  return image;
+}
+
+/**
+ * @brief Puts a decoded image into the cache.
+ *
+ * Images requested least recently are removed if the cache is full.
+ *
+ * @param key name of the image in the cache
+ * @param image the image (the cache takes its reference)
+ * @return false if the image is too big to be kept (it is then not added)
+ */
+bool Surface::add_image(const std::string& key, SDL_Surface* image) {
+
+  const int size = image->h * image->pitch;
+  if (size > image_cache_max_size / 4) {
+    return false;
+  }
+
+  while (image_cache_size + size > image_cache_max_size) {
+    remove_oldest_image();
+  }
+  CachedImage& cached_image = image_cache[key];
+  cached_image.surface = image;
+  cached_image.last_used = ++image_cache_counter;
+  image_cache_size += size;
+  return true;
+}
+
+/**
+ * @brief Starts decoding an image in a separate thread, so that it is ready
+ * in the cache when a surface needs it.
+ *
+ * Nothing is done if the image is already in the cache or if too many
+ * images are waiting to be decoded.
+ *
+ * @param file_name name of the image file to load, relative to the base directory specified
+ * @param base_directory the base directory to use
+ */
+void Surface::prefetch_image(const std::string& file_name, ImageDirectory base_directory) {
+
+  std::string prefixed_file_name = file_name;
+  bool language_specific = false;
+  if (base_directory == DIR_SPRITES) {
+    prefixed_file_name = std::string("sprites/") + file_name;
+  }
+  else if (base_directory == DIR_LANGUAGE) {
+    language_specific = true;
+    prefixed_file_name = std::string("images/") + file_name;
+  }
+
+  const std::string& key = get_image_key(prefixed_file_name, language_specific);
+  collect_prefetched_images(false);
+  if (image_cache.count(key) > 0
+      || prefetched_images.count(key) > 0
+      || prefetched_images.size() >= max_prefetched_images
+      || !FileTools::data_file_exists(key)) {
+    return;
+  }
+
+  if (prefetch_thread == NULL) {
+    prefetch_mutex = SDL_CreateMutex();
+    prefetch_cond = SDL_CreateCond();
+    prefetch_thread = SDL_CreateThread(decode_prefetched_images, NULL);
+  }
+
+  SDL_LockMutex(prefetch_mutex);
+  PrefetchedImage& prefetched_image = prefetched_images[key];
+  prefetched_image.image = NULL;
+  prefetched_image.decoded = false;
+  prefetch_requests.push_back(key);
+  SDL_CondBroadcast(prefetch_cond);
+  SDL_UnlockMutex(prefetch_mutex);
+}
+
+/**
+ * @brief Moves the images decoded by the decoding thread into the cache.
+ * @param wait_all true to wait until all requested images are decoded
+ */
+void Surface::collect_prefetched_images(bool wait_all) {
+
+  if (prefetch_thread == NULL) {
+    return;
+  }
+
+  SDL_LockMutex(prefetch_mutex);
+  if (wait_all) {
+    while (!prefetch_requests.empty() || prefetch_decoding) {
+      SDL_CondWait(prefetch_cond, prefetch_mutex);
+    }
+  }
+
+  std::map<std::string, PrefetchedImage>::iterator it = prefetched_images.begin();
+  while (it != prefetched_images.end()) {
+
+    if (!it->second.decoded) {
+      ++it;
+      continue;
+    }
+
+    SDL_Surface* image = it->second.image;
+    if (image != NULL) {
+      // the cache is only used by this thread
+      image = convert_image(image);
+      if (add_image(it->first, image)) {
+        nb_images_prefetched++;
+      }
+      else {
+        SDL_FreeSurface(image);
+      }
+    }
+    prefetched_images.erase(it++);
+  }
+  SDL_UnlockMutex(prefetch_mutex);
+}
+
+/**
+ * @brief Function executed by the thread that decodes images in advance.
+ *
+ * The thread waits for images requested by prefetch_image(), decodes them
+ * and leaves them in prefetched_images until the main thread collects them.
+ * It never uses the cache of images nor the cache of data files.
+ *
+ * @param data not used
+ * @return 0
+ */
+int Surface::decode_prefetched_images(void* data) {
+
+  SDL_LockMutex(prefetch_mutex);
+  while (!prefetch_stopping) {
+
+    if (prefetch_requests.empty()) {
+      SDL_CondWait(prefetch_cond, prefetch_mutex);
+      continue;
+    }
+
+    const std::string key = prefetch_requests.front();
+    prefetch_requests.pop_front();
+    prefetch_decoding = true;
+    SDL_UnlockMutex(prefetch_mutex);
+
+    SDL_Surface* image = NULL;
+    DataBuffer buffer = FileTools::data_file_read_uncached(key);
+    if (!buffer.is_empty()) {
+      SDL_RWops* rw = SDL_RWFromConstMem(buffer.get_data(), int(buffer.get_size()));
+      image = IMG_Load_RW(rw, 0);
+      SDL_RWclose(rw);
+    }
+
+    SDL_LockMutex(prefetch_mutex);
+    PrefetchedImage& prefetched_image = prefetched_images[key];
+    prefetched_image.image = image;
+    prefetched_image.decoded = true;
+    prefetch_decoding = false;
+    SDL_CondBroadcast(prefetch_cond);
+  }
+  SDL_UnlockMutex(prefetch_mutex);
+
+  return 0;
+}
+
+/**
+ * @brief Removes from the cache the image requested least recently.
+ */
+void Surface::remove_oldest_image() {
+
+  std::map<std::string, CachedImage>::iterator oldest = image_cache.begin();
+  std::map<std::string, CachedImage>::iterator it;
+  for (it = image_cache.begin(); it != image_cache.end(); ++it) {
+    if (it->second.last_used < oldest->second.last_used) {
+      oldest = it;
+    }
+  }
+
+  SDL_Surface* image = oldest->second.surface;
+  image_cache_size -= image->h * image->pitch;
+  SDL_FreeSurface(image);
+  image_cache.erase(oldest);
+}
+
+/**
+ * @brief Gives this surface its own pixels if it shares them.
+ *
+ * This function must be called before any modification of the surface.
+ */
+void Surface::copy_if_shared() {
+
+  if (internal_surface_created && internal_surface->refcount > 1) {
+    SDL_Surface* copy = SDL_ConvertSurface(internal_surface,
+        internal_surface->format, internal_surface->flags);
+    SDL_FreeSurface(internal_surface);  // only decrements the refcount
+    internal_surface = copy;
+    nb_images_copied++;
+  }
+}
+
+/**
+ * @brief Returns the number of images found in the cache
+ * since the beginning of the program.
+ * @return the number of images not decoded again
+ */
+int Surface::get_nb_image_cache_hits() {
+  return nb_image_cache_hits;
+}
+
+/**
+ * @brief Returns the number of images decoded (or waited for) when a surface
+ * needed them, since the beginning of the program.
+ * @return the number of images not found in the cache
+ */
+int Surface::get_nb_image_cache_misses() {
+  return nb_image_cache_misses;
+}
+
+/**
+ * @brief Returns the number of times a surface had to copy shared pixels
+ * before being modified, since the beginning of the program.
+ * @return the number of copies
+ */
+int Surface::get_nb_images_copied() {
+  return nb_images_copied;
+}
+
+/**
+ * @brief Returns the number of images decoded in advance by the decoding
+ * thread since the beginning of the program.
+ * @return the number of images decoded in advance
+ */
+int Surface::get_nb_images_prefetched() {
+  return nb_images_prefetched;
+}
+
 /**
  * @brief Returns the width of the surface.
  * @return the width in pixels
@@ -164,6 +553,7 @@ Color Surface::get_transparency_color() {
  */
 void Surface::set_transparency_color(const Color& color) {
 
+  copy_if_shared();
   SDL_SetColorKey(internal_surface, SDL_SRCCOLORKEY, color.get_internal_value());
 }
 
@@ -179,6 +569,7 @@ void Surface::set_opacity(int opacity) {
     opacity = 127;
   }
 
+  copy_if_shared();
   SDL_SetAlpha(internal_surface, SDL_SRCALPHA, opacity);
 }
 
@@ -195,6 +586,7 @@ void Surface::set_opacity(int opacity) {
  */
 void Surface::set_clipping_rectangle(const Rectangle& clipping_rectangle) {
 
+  copy_if_shared();
   if (clipping_rectangle.get_width() == 0) {
     SDL_SetClipRect(internal_surface, NULL);
   }
@@ -209,6 +601,8 @@ void Surface::set_clipping_rectangle(const Rectangle& clipping_rectangle) {
  * @param color a color
  */
 void Surface::fill_with_color(Color& color) {
+
+  copy_if_shared();
   SDL_FillRect(internal_surface, NULL, color.get_internal_value());
 }
 
@@ -218,6 +612,8 @@ void Surface::fill_with_color(Color& color) {
  * @param where the rectangle to fill
  */
 void Surface::fill_with_color(Color& color, const Rectangle& where) {
+
+  copy_if_shared();
   Rectangle where2 = where;
   SDL_FillRect(internal_surface, where2.get_internal_rect(), color.get_internal_value());
 }
@@ -231,6 +627,7 @@ void Surface::raw_draw(Surface& dst_surface,
     const Rectangle& dst_position) {
 
   Rectangle dst_position2(dst_position);
+  dst_surface.copy_if_shared();
   SDL_BlitSurface(internal_surface, NULL, dst_surface.internal_surface,
       dst_position2.get_internal_rect());
 }
@@ -254,6 +651,7 @@ void Surface::draw_transition(Transition& transition) {
 void Surface::draw_region(const Rectangle& src_position, Surface& dst_surface) {
 
   Rectangle src_position2(src_position);
+  dst_surface.copy_if_shared();
   SDL_BlitSurface(internal_surface, src_position2.get_internal_rect(),
       dst_surface.internal_surface, NULL);
 }
@@ -269,6 +667,7 @@ void Surface::draw_region(const Rectangle &src_position, Surface& dst_surface,
 
   Rectangle src_position2(src_position);
   Rectangle dst_position2(dst_position);
+  dst_surface.copy_if_shared();
   SDL_BlitSurface(internal_surface, src_position2.get_internal_rect(),
       dst_surface.internal_surface, dst_position2.get_internal_rect());
 }
@@ -284,22 +683,6 @@ SDL_Surface* Surface::get_internal_surface() {
   return internal_surface;
 }
 
-/**
- * @brief Returns the mapped 32bits pixel from internal SDL_PixelFormat to dst_format.
- *
- * This method should be used only by low-level classes, and after lock source internal_surface.
- *
- * @param idx_pixel the index of the pixel to convert
- * @param dst_format the destination format
- * @return the mapped 32bits pixel
- */
-uint32_t Surface::get_mapped_pixel(int idx_pixel, SDL_PixelFormat* dst_format) {
-
-  uint8_t r, g, b, a;
-  SDL_GetRGBA(((uint32_t*) internal_surface->pixels)[idx_pixel], internal_surface->format, &r, &g, &b, &a);
-  return SDL_MapRGBA(dst_format, r, g, b, a);
-}
-
 /**
  * @brief Returns the name identifying this type in Lua.
  * @return the name identifying this type in Lua
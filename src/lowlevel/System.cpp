@@ -18,14 +18,25 @@
 #include "lowlevel/FileTools.h"
 #include "lowlevel/VideoManager.h"
 #include "lowlevel/Color.h"
+#include "lowlevel/Surface.h"
 #include "lowlevel/TextSurface.h"
 #include "lowlevel/Sound.h"
 #include "lowlevel/Random.h"
 #include "lowlevel/InputEvent.h"
 #include "Sprite.h"
+#include "MapLoader.h"
+#include "entities/Tileset.h"
 #include <SDL.h>
+#include <string>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#endif
 
 uint32_t System::ticks = 0;
+uint32_t System::fixed_timestep = 0;
 
 /**
  * @brief Initializes the whole lowlevel system.
@@ -38,6 +49,17 @@ uint32_t System::ticks = 0;
  */
 void System::initialize(int argc, char **argv) {
 
+  // check the -benchmark option: a benchmark must be able to run on a
+  // machine without display
+  bool headless = false;
+  for (int i = 1; i < argc && !headless; i++) {
+    const std::string arg = argv[i];
+    headless = (arg.find("-benchmark") == 0);
+  }
+  if (headless) {
+    putenv((char*) "SDL_VIDEODRIVER=dummy");
+  }
+
   // initialize SDL
   SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK);
 
@@ -70,8 +92,11 @@ void System::quit() {
   Random::quit();
   InputEvent::quit();
   Sound::quit();
+  MapLoader::quit();
   Sprite::quit();
+  Tileset::quit();
   TextSurface::quit();
+  Surface::quit();
   Color::quit();
   VideoManager::quit();
   FileTools::quit();
@@ -86,12 +111,22 @@ void System::quit() {
  */
 void System::update() {
 
-  ticks = SDL_GetTicks();
+  if (fixed_timestep != 0) {
+    ticks += fixed_timestep;
+  }
+  else {
+    ticks = SDL_GetTicks();
+  }
   Sound::update();
 }
 
 /**
  * @brief Returns the number of milliseconds elapsed since the beginning of the program.
+ *
+ * This is the date seen by the whole engine. It only changes when update()
+ * is called. With a fixed timestep, it is a simulated clock that advances by
+ * the same amount at each update, regardless of the real time.
+ *
  * @return the number of milliseconds elapsed since the beginning of the program
  */
 uint32_t System::now() {
@@ -109,3 +144,51 @@ void System::sleep(uint32_t duration) {
   SDL_Delay(duration);
 }
 
+
+/**
+ * @brief Returns whether the simulated clock is used instead of the real time.
+ * @return true if System::now() advances by a fixed timestep at each update
+ */
+bool System::is_fixed_timestep() {
+  return fixed_timestep != 0;
+}
+
+/**
+ * @brief Makes System::now() a simulated clock, or the real time again.
+ *
+ * With a fixed timestep, each call to update() advances the date by exactly
+ * this duration, which makes the simulation independent from the speed
+ * of the machine. This is used to run reproducible benchmarks.
+ *
+ * @param timestep duration of an update in milliseconds,
+ * or 0 to follow the real time again
+ */
+void System::set_fixed_timestep(uint32_t timestep) {
+
+  fixed_timestep = timestep;
+  if (timestep != 0) {
+    ticks = 0;
+  }
+}
+
+/**
+ * @brief Returns a precise real time, for profiling purposes only.
+ *
+ * Unlike now(), this is always the real time and it is not
+ * affected by update().
+ *
+ * @return a date in microseconds, with an unspecified origin
+ */
+uint64_t System::get_real_time_us() {
+
+#if defined(_WIN32)
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t) (counter.QuadPart * 1000000 / frequency.QuadPart);
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
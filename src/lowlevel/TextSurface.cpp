@@ -38,11 +38,7 @@ void TextSurface::initialize() {
   static const std::string file_name = "text/fonts.dat";
 
   lua_State* l = luaL_newstate();
-  size_t size;
-  char* buffer;
-  FileTools::data_file_open_buffer(file_name, &buffer, &size);
-  luaL_loadbuffer(l, buffer, size, file_name.c_str());
-  FileTools::data_file_close_buffer(buffer);
+  FileTools::data_file_load_lua(l, file_name);
 
   lua_register(l, "font", l_font);
   if (lua_pcall(l, 0, 0, 0) != 0) {
@@ -73,7 +69,7 @@ void TextSurface::quit() {
       // It's a normal font.
       TTF_CloseFont(font->internal_font);
       SDL_RWclose(font->rw);
-      FileTools::data_file_close_buffer(font->buffer);
+      font->buffer = DataBuffer();
     }
   }
 
@@ -117,12 +113,12 @@ int TextSurface::l_font(lua_State* l) {
   }
   else {
     // It's a normal font.
-    size_t size;
-    FileTools::data_file_open_buffer(file_name, &fonts[font_id].buffer, &size);
-    fonts[font_id].rw = SDL_RWFromMem(fonts[font_id].buffer, int(size));
+    fonts[font_id].buffer = FileTools::data_file_read(file_name);
+    fonts[font_id].rw = SDL_RWFromConstMem(fonts[font_id].buffer.get_data(),
+        int(fonts[font_id].buffer.get_size()));
     fonts[font_id].internal_font = TTF_OpenFontRW(fonts[font_id].rw, 0, font_size);
-    Debug::check_assertion(fonts[font_id].internal_font != NULL,
-        StringConcat() << "Cannot load font from file '" << file_name << "': " << TTF_GetError());
+    SOLARUS_ASSERT(fonts[font_id].internal_font != NULL,
+        "Cannot load font from file '" << file_name << "': " << TTF_GetError());
   }
 
   return 0;
@@ -213,7 +209,7 @@ const std::string& TextSurface::get_font() {
  */
 void TextSurface::set_font(const std::string& font_id) {
 
-  Debug::check_assertion(has_font(font_id), StringConcat() <<
+  SOLARUS_ASSERT(has_font(font_id),
       "No such font: '" << font_id << "'");
   this->font_id = font_id;
   rebuild();
@@ -570,8 +566,8 @@ void TextSurface::rebuild_ttf() {
     break;
   }
 
-  Debug::check_assertion(internal_surface != NULL, StringConcat()
-      << "Cannot create the text surface for string '" << text << "': " << SDL_GetError());
+  SOLARUS_ASSERT(internal_surface != NULL,
+      "Cannot create the text surface for string '" << text << "': " << SDL_GetError());
   surface = new Surface(internal_surface);
 }
 
@@ -42,6 +42,10 @@ Rectangle VideoManager::default_mode_sizes[] = {
   Rectangle(0, 0, 0, 0),                                                 // FULLSCREEN_WIDE
   Rectangle(0, 0, SOLARUS_SCREEN_WIDTH * 2, SOLARUS_SCREEN_HEIGHT * 2),  // FULLSCREEN_SCALE2X
   Rectangle(0, 0, 0, 0),                                                 // FULLSCREEN_SCALE2X_WIDE
+  Rectangle(0, 0, SOLARUS_SCREEN_WIDTH * 3, SOLARUS_SCREEN_HEIGHT * 3),  // WINDOWED_SCALE3X
+  Rectangle(0, 0, SOLARUS_SCREEN_WIDTH * 4, SOLARUS_SCREEN_HEIGHT * 4),  // WINDOWED_SCALE4X
+  Rectangle(0, 0, SOLARUS_SCREEN_WIDTH * 3, SOLARUS_SCREEN_HEIGHT * 3),  // FULLSCREEN_SCALE3X
+  Rectangle(0, 0, SOLARUS_SCREEN_WIDTH * 4, SOLARUS_SCREEN_HEIGHT * 4),  // FULLSCREEN_SCALE4X
 };
 
 // Properties of SDL surfaces.
@@ -58,6 +62,10 @@ const std::string VideoManager::video_mode_names[] = {
   "fullscreen_wide",
   "fullscreen_scale2x",
   "fullscreen_scale2x_wide",
+  "windowed_scale3x",
+  "windowed_scale4x",
+  "fullscreen_scale3x",
+  "fullscreen_scale4x",
   ""  // Sentinel.
 };
 
@@ -65,7 +73,7 @@ const std::string VideoManager::video_mode_names[] = {
  * @brief Initializes the video system and creates the window.
  *
  * This method should be called when the application starts.
- * If the argument -no-video is provided, no window will be displayed
+ * If the argument -no-video (or -benchmark) is provided, no window will be displayed
  * but all surfaces will exist internally.
  *
  * @param argc command-line arguments number
@@ -73,11 +81,11 @@ const std::string VideoManager::video_mode_names[] = {
  */
 void VideoManager::initialize(int argc, char **argv) {
 
-  // check the -no-video option
+  // check the -no-video and -benchmark options
   bool disable = false;
   for (argv++; argc > 1 && !disable; argv++, argc--) {
     const std::string arg = *argv;
-    disable = (arg.find("-no-video") == 0);
+    disable = (arg.find("-no-video") == 0 || arg.find("-benchmark") == 0);
   }
 
   instance = new VideoManager(disable);
@@ -180,7 +188,20 @@ bool VideoManager::is_mode_supported(VideoMode mode) {
  * @return true if this video mode is in fullscreen.
  */
 bool VideoManager::is_fullscreen(VideoMode mode) {
-  return mode >= FULLSCREEN_NORMAL;
+
+  switch (mode) {
+
+    case FULLSCREEN_NORMAL:
+    case FULLSCREEN_WIDE:
+    case FULLSCREEN_SCALE2X:
+    case FULLSCREEN_SCALE2X_WIDE:
+    case FULLSCREEN_SCALE3X:
+    case FULLSCREEN_SCALE4X:
+      return true;
+
+    default:
+      return false;
+  }
 }
 
 /**
@@ -217,6 +238,10 @@ void VideoManager::switch_fullscreen() {
       WINDOWED_STRETCHED,     // FULLSCREEN_WIDE
       WINDOWED_SCALE2X,       // FULLSCREEN_SCALE2X
       WINDOWED_SCALE2X,       // FULLSCREEN_SCALE2X_WIDE
+      FULLSCREEN_SCALE3X,     // WINDOWED_SCALE3X
+      FULLSCREEN_SCALE4X,     // WINDOWED_SCALE4X
+      WINDOWED_SCALE3X,       // FULLSCREEN_SCALE3X
+      WINDOWED_SCALE4X,       // FULLSCREEN_SCALE4X
   };
 
   VideoMode mode = next_modes[get_video_mode()];
@@ -275,7 +300,7 @@ bool VideoManager::set_video_mode(VideoMode mode) {
   }
 
   const Rectangle& size = mode_sizes[mode];
-  if (size.get_width() > SOLARUS_SCREEN_WIDTH * 2) {
+  if (mode == FULLSCREEN_WIDE || mode == FULLSCREEN_SCALE2X_WIDE) {
     // Wide screen resolution with two black side bars.
     offset = dst_position_wide.get_x();
   }
@@ -283,14 +308,12 @@ bool VideoManager::set_video_mode(VideoMode mode) {
     // No side bars.
     offset = 0;
   }
-  width = size.get_width();
-  end_row_increment = 2 * offset + width;
 
   if (!disable_window) {
     SDL_Surface* screen_internal_surface = SDL_SetVideoMode(
         size.get_width(), size.get_height(), SOLARUS_COLOR_DEPTH, flags);
 
-    Debug::check_assertion(screen_internal_surface != NULL, StringConcat() << "Cannot create the video surface for mode " << mode);
+    SOLARUS_ASSERT(screen_internal_surface != NULL, "Cannot create the video surface for mode " << mode);
 
     SDL_ShowCursor(show_cursor);
     delete this->screen_surface;
@@ -373,13 +396,23 @@ void VideoManager::draw(Surface& src_surface) {
     case WINDOWED_STRETCHED:
     case FULLSCREEN_NORMAL:
     case FULLSCREEN_WIDE:
-      blit_stretched(src_surface, *screen_surface);
+      blit_scaled(Scaler::STRETCH, src_surface, *screen_surface);
       break;
 
     case WINDOWED_SCALE2X:
     case FULLSCREEN_SCALE2X:
     case FULLSCREEN_SCALE2X_WIDE:
-      blit_scale2x(src_surface, *screen_surface);
+      blit_scaled(Scaler::SCALE2X, src_surface, *screen_surface);
+      break;
+
+    case WINDOWED_SCALE3X:
+    case FULLSCREEN_SCALE3X:
+      blit_scaled(Scaler::SCALE3X, src_surface, *screen_surface);
+      break;
+
+    case WINDOWED_SCALE4X:
+    case FULLSCREEN_SCALE4X:
+      blit_scaled(Scaler::SCALE4X, src_surface, *screen_surface);
       break;
 
     default:
@@ -402,100 +435,20 @@ void VideoManager::blit(Surface& src_surface, Surface& dst_surface) {
 
 /**
  * @brief Blits a SOLARUS_SCREEN_WIDTH*SOLARUS_SCREEN_HEIGHT surface on a
- * double-size surface, stretching the image.
- *
- * Two black side bars are added if the destination surface is wider than SOLARUS_SCREEN_WIDTH * 2.
- *
- * @param src_surface the source surface
- * @param dst_surface the destination surface
- */
-void VideoManager::blit_stretched(Surface& src_surface, Surface& dst_surface) {
-
-  SDL_Surface* src_internal_surface = src_surface.get_internal_surface();
-  SDL_Surface* dst_internal_surface = dst_surface.get_internal_surface();
-
-  SDL_LockSurface(src_internal_surface);
-  SDL_LockSurface(dst_internal_surface);
-
-  uint32_t* dst = (uint32_t*) dst_internal_surface->pixels;
-
-  int p = offset;
-  for (int i = 0; i < SOLARUS_SCREEN_HEIGHT; i++) {
-    for (int j = 0; j < SOLARUS_SCREEN_WIDTH; j++) {
-      dst[p] = dst[p + 1] = dst[p + width] = dst[p + width + 1] = src_surface.get_mapped_pixel(i * SOLARUS_SCREEN_WIDTH + j, dst_internal_surface->format);
-      p += 2;
-    }
-
-    p += end_row_increment;
-  }
-
-  SDL_UnlockSurface(dst_internal_surface);
-  SDL_UnlockSurface(src_internal_surface);
-}
-
-/**
- * @brief Blits a SOLARUS_SCREEN_WIDTH*SOLARUS_SCREEN_HEIGHT surface on a
- * double-size surface.
+ * larger surface with a scaling algorithm.
  *
- * The image is scaled with an implementation of the Scale2x algorithm.
- * Two black side bars if the destination surface is wider than
- * SOLARUS_SCREEN_WIDTH * 2.
+ * Two black side bars are added if the destination surface is wider than
+ * the scaled image.
  *
+ * @param algorithm the scaling algorithm to use
  * @param src_surface the source surface
  * @param dst_surface the destination surface
  */
-void VideoManager::blit_scale2x(Surface& src_surface, Surface& dst_surface) {
-
-  SDL_Surface* src_internal_surface = src_surface.get_internal_surface();
-  SDL_Surface* dst_internal_surface = dst_surface.get_internal_surface();
-
-  SDL_LockSurface(src_internal_surface);
-  SDL_LockSurface(dst_internal_surface);
-
-  uint32_t* src = (uint32_t*) src_internal_surface->pixels;
-  uint32_t* dst = (uint32_t*) dst_internal_surface->pixels;
-
-  int b, d, e = 0, f,  h;
-  int e1 = offset, e2, e3, e4;
-  for (int row = 0; row < SOLARUS_SCREEN_HEIGHT; row++) {
-    for (int col = 0; col < SOLARUS_SCREEN_WIDTH; col++) {
-
-      // compute a to i
-
-      b = e - SOLARUS_SCREEN_WIDTH;
-      d = e - 1;
-      f = e + 1;
-      h = e + SOLARUS_SCREEN_WIDTH;
-
-      if (row == 0)   { b = e; }
-      if (row == SOLARUS_SCREEN_HEIGHT - 1) { h = e; }
-      if (col == 0)   { d = e; }
-      if (col == SOLARUS_SCREEN_WIDTH - 1) { f = e; }
-
-      // compute e1 to e4
-      e2 = e1 + 1;
-      e3 = e1 + width;
-      e4 = e3 + 1;
-
-      // compute the color
-
-      if (src[b] != src[h] && src[d] != src[f]) {
-        dst[e1] = src_surface.get_mapped_pixel((src[d] == src[b]) ? d : e, dst_internal_surface->format);
-        dst[e2] = src_surface.get_mapped_pixel((src[b] == src[f]) ? f : e, dst_internal_surface->format);
-        dst[e3] = src_surface.get_mapped_pixel((src[d] == src[h]) ? d : e, dst_internal_surface->format);
-        dst[e4] = src_surface.get_mapped_pixel((src[h] == src[f]) ? f : e, dst_internal_surface->format);
-      }
-      else {
-        dst[e1] = dst[e2] = dst[e3] = dst[e4] = src_surface.get_mapped_pixel(e, dst_internal_surface->format);
-      }
-      e1 += 2;
-      e++;
-    }
-    e1 += end_row_increment;
-  }
+void VideoManager::blit_scaled(Scaler::Algorithm algorithm,
+    Surface& src_surface, Surface& dst_surface) {
 
-  SDL_UnlockSurface(dst_internal_surface);
-  SDL_UnlockSurface(src_internal_surface);
+  scaler.scale(algorithm, src_surface.get_internal_surface(),
+      dst_surface.get_internal_surface(), offset);
 }
 
 /**
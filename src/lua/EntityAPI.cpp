@@ -1764,8 +1764,8 @@ int LuaContext::enemy_api_set_attack_consequence(lua_State* l) {
 
   if (lua_isnumber(l, 3)) {
     int life_points = luaL_checkint(l, 3);
-    Debug::check_assertion(life_points > 0, StringConcat()
-        << "Invalid attack consequence: " << life_points);
+    SOLARUS_ASSERT(life_points > 0,
+        "Invalid attack consequence: " << life_points);
     enemy.set_attack_consequence(attack, EnemyReaction::HURT, life_points);
   }
   else {
@@ -1792,8 +1792,8 @@ int LuaContext::enemy_api_set_attack_consequence_sprite(lua_State* l) {
 
   if (lua_isnumber(l, 4)) {
     int life_points = luaL_checkint(l, 4);
-    Debug::check_assertion(life_points > 0, StringConcat()
-        << "Invalid attack consequence: " << life_points);
+    SOLARUS_ASSERT(life_points > 0,
+        "Invalid attack consequence: " << life_points);
     enemy.set_attack_consequence_sprite(sprite, attack, EnemyReaction::HURT, life_points);
   }
   else {
@@ -2196,6 +2196,10 @@ void LuaContext::shop_item_on_bought(ShopItem& shop_item) {
  */
 void LuaContext::enemy_on_update(Enemy& enemy) {
 
+  if (!userdata_has_callback(enemy, CALLBACK_ON_UPDATE)) {
+    return;
+  }
+
   push_enemy(l, enemy);
   on_update();
   lua_pop(l, 1);
@@ -2263,6 +2267,10 @@ void LuaContext::enemy_on_restarted(Enemy& enemy) {
  */
 void LuaContext::enemy_on_pre_draw(Enemy& enemy) {
 
+  if (!userdata_has_callback(enemy, CALLBACK_ON_PRE_DRAW)) {
+    return;
+  }
+
   push_enemy(l, enemy);
   on_pre_draw();
   lua_pop(l, 1);
@@ -2274,6 +2282,10 @@ void LuaContext::enemy_on_pre_draw(Enemy& enemy) {
  */
 void LuaContext::enemy_on_post_draw(Enemy& enemy) {
 
+  if (!userdata_has_callback(enemy, CALLBACK_ON_POST_DRAW)) {
+    return;
+  }
+
   push_enemy(l, enemy);
   on_post_draw();
   lua_pop(l, 1);
@@ -2288,6 +2300,10 @@ void LuaContext::enemy_on_post_draw(Enemy& enemy) {
 void LuaContext::enemy_on_position_changed(
     Enemy& enemy, const Rectangle& xy, Layer layer) {
 
+  if (!userdata_has_callback(enemy, CALLBACK_ON_POSITION_CHANGED)) {
+    return;
+  }
+
   push_enemy(l, enemy);
   on_position_changed(xy, layer);
   lua_pop(l, 1);
@@ -15,24 +15,32 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "lua/ExportableToLua.h"
+#include "lua/LuaContext.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 
 /**
  * @brief Creates an object exportable to Lua.
  */
 ExportableToLua::ExportableToLua():
-  refcount(0) {
+  refcount(0),
+  lua_table_context(NULL) {
 
 }
 
 /**
  * @brief Destroys this exportable object.
+ *
+ * If Lua has set fields on this object, they are forgotten, so that
+ * a new object created at the same address does not get them.
  */
 ExportableToLua::~ExportableToLua() {
 
-  Debug::check_assertion(refcount == 0, StringConcat()
-      << "This object is still used somewhere else: refcount is " << refcount);
+  SOLARUS_ASSERT(refcount == 0,
+      "This object is still used somewhere else: refcount is " << refcount);
+
+  if (lua_table_context != NULL) {
+    lua_table_context->notify_userdata_destroyed(*this);
+  }
 }
 
 /**
@@ -62,3 +70,24 @@ void ExportableToLua::decrement_refcount() {
   refcount--;
 }
 
+/**
+ * @brief Returns the Lua context where this object is used like a table.
+ * @return the Lua context that stores the fields set on this object,
+ * or NULL if no field was set
+ */
+LuaContext* ExportableToLua::get_lua_table_context() const {
+  return lua_table_context;
+}
+
+/**
+ * @brief Sets the Lua context where this object is used like a table.
+ *
+ * This context is notified when the object is destroyed.
+ *
+ * @param lua_context the Lua context that stores the fields set on this
+ * object, or NULL
+ */
+void ExportableToLua::set_lua_table_context(LuaContext* lua_context) {
+  this->lua_table_context = lua_context;
+}
+
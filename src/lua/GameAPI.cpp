@@ -1061,7 +1061,9 @@ void LuaContext::game_on_finished(Game& game) {
 void LuaContext::game_on_update(Game& game) {
 
   push_game(l, game.get_savegame());
-  on_update();
+  if (userdata_has_callback(game.get_savegame(), CALLBACK_ON_UPDATE)) {
+    on_update();
+  }
   menus_on_update(-1);
   lua_pop(l, 1);
 }
@@ -1075,7 +1077,9 @@ void LuaContext::game_on_draw(Game& game, Surface& dst_surface) {
 
   push_game(l, game.get_savegame());
   menus_on_draw(-1, dst_surface);
-  on_draw(dst_surface);
+  if (userdata_has_callback(game.get_savegame(), CALLBACK_ON_DRAW)) {
+    on_draw(dst_surface);
+  }
   lua_pop(l, 1);
 }
 
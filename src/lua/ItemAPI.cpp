@@ -684,8 +684,8 @@ int LuaContext::item_api_set_finished(lua_State* l) {
   if (hero.is_using_inventory_item()) {  // Do nothing if the script has already changed the hero's state.
 
     InventoryItem& inventory_item = hero.get_current_inventory_item();
-    Debug::check_assertion(inventory_item.get_name() == item.get_name(),
-        StringConcat() << "Trying to finish inventory item '" << item.get_name()
+    SOLARUS_ASSERT(inventory_item.get_name() == item.get_name(),
+        "Trying to finish inventory item '" << item.get_name()
         << "' but the current inventory item is '" << inventory_item.get_name() << "'");
     inventory_item.set_finished();
   }
@@ -723,6 +723,10 @@ void LuaContext::item_on_finished(EquipmentItem& item) {
  */
 void LuaContext::item_on_update(EquipmentItem& item) {
 
+  if (!userdata_has_callback(item, CALLBACK_ON_UPDATE)) {
+    return;
+  }
+
   push_item(l, item);
   on_update();
   lua_pop(l, 1);
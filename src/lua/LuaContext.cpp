@@ -34,6 +34,9 @@
 #include <sstream>
 #include <iomanip>
 #include <lua.hpp>
+#include <cstring>
+
+int LuaContext::nb_callbacks_skipped = 0;
 
 /**
  * @brief Creates a Lua context.
@@ -41,7 +44,8 @@
  */
 LuaContext::LuaContext(MainLoop& main_loop):
   l(NULL),
-  main_loop(main_loop) {
+  main_loop(main_loop),
+  next_timer_stamp(1) {
 
 }
 
@@ -65,7 +69,7 @@ LuaContext& LuaContext::get_lua_context(lua_State* l) {
   LuaContext* lua_context = static_cast<LuaContext*>(lua_touserdata(l, -1));
   lua_pop(l, 1);
 
-  Debug::check_assertion(lua_context != NULL,
+  SOLARUS_ASSERT(lua_context != NULL,
       "This Lua state does not belong to a LuaContext object");
 
   return *lua_context;
@@ -79,6 +83,18 @@ MainLoop& LuaContext::get_main_loop() {
   return main_loop;
 }
 
+/**
+ * @brief Returns the number of calls to frequent callbacks avoided
+ * since the beginning of the program because userdata did not define them.
+ *
+ * Each of them would have pushed the userdata and looked for the method.
+ *
+ * @return The number of callbacks skipped.
+ */
+int LuaContext::get_nb_callbacks_skipped() {
+  return nb_callbacks_skipped;
+}
+
 /**
  * @brief Initializes Lua.
  */
@@ -161,6 +177,13 @@ void LuaContext::exit() {
     // Finalize Lua.
     lua_close(l);
     l = NULL;
+
+    // The objects still used by C++ no longer have a table.
+    std::map<const ExportableToLua*, int>::iterator it;
+    for (it = userdata_callbacks.begin(); it != userdata_callbacks.end(); ++it) {
+      const_cast<ExportableToLua*>(it->first)->set_lua_table_context(NULL);
+    }
+    userdata_callbacks.clear();
   }
 }
 
@@ -790,6 +813,105 @@ bool LuaContext::find_method(int index, const std::string& function_name) {
   return exists;
 }
 
+/**
+ * @brief Returns the frequent callback that corresponds to a key.
+ * @param key A key of a userdata.
+ * @return The corresponding frequent callback, or 0 if this key is not
+ * a frequent callback.
+ */
+int LuaContext::get_frequent_callback(const char* key) {
+
+  if (std::strncmp(key, "on_", 3) != 0) {
+    return 0;
+  }
+
+  key += 3;
+  if (std::strcmp(key, "update") == 0) {
+    return CALLBACK_ON_UPDATE;
+  }
+  if (std::strcmp(key, "pre_draw") == 0) {
+    return CALLBACK_ON_PRE_DRAW;
+  }
+  if (std::strcmp(key, "draw") == 0) {
+    return CALLBACK_ON_DRAW;
+  }
+  if (std::strcmp(key, "post_draw") == 0) {
+    return CALLBACK_ON_POST_DRAW;
+  }
+  if (std::strcmp(key, "position_changed") == 0) {
+    return CALLBACK_ON_POSITION_CHANGED;
+  }
+  return 0;
+}
+
+/**
+ * @brief Records whether a userdata defines a frequent callback.
+ * @param userdata A userdata used like a table.
+ * @param callback A frequent callback.
+ * @param defined true if the userdata has now a value for this callback,
+ * false if the value was removed.
+ */
+void LuaContext::set_userdata_callback(const ExportableToLua& userdata,
+    FrequentCallback callback, bool defined) {
+
+  int& callbacks = userdata_callbacks[&userdata];
+  if (defined) {
+    callbacks |= callback;
+  }
+  else {
+    callbacks &= ~callback;
+  }
+}
+
+/**
+ * @brief Returns whether a userdata may define a frequent callback.
+ *
+ * Use this function before pushing the userdata to call the callback:
+ * if it returns false, the call can be skipped.
+ * The number of calls skipped is counted.
+ *
+ * @param userdata A userdata used like a table.
+ * @param callback A frequent callback.
+ * @return true if a value was set for this callback in the userdata.
+ */
+bool LuaContext::userdata_has_callback(const ExportableToLua& userdata,
+    FrequentCallback callback) {
+
+  std::map<const ExportableToLua*, int>::const_iterator it =
+      userdata_callbacks.find(&userdata);
+  if (it == userdata_callbacks.end() || (it->second & callback) == 0) {
+    nb_callbacks_skipped++;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Forgets the fields that Lua has set on a userdata.
+ *
+ * This function is called when the object is destroyed, so that
+ * a new object created at the same address starts without fields.
+ *
+ * @param userdata A userdata used like a table that is being destroyed.
+ */
+void LuaContext::notify_userdata_destroyed(ExportableToLua& userdata) {
+
+  userdata_callbacks.erase(&userdata);
+
+  if (l != NULL) {
+    lua_getfield(l, LUA_REGISTRYINDEX, "sol.userdata_tables");
+                                  // udata_tables
+    lua_pushlightuserdata(l, &userdata);
+                                  // udata_tables udata
+    lua_pushnil(l);
+                                  // udata_tables udata nil
+    lua_settable(l, -3);
+                                  // udata_tables
+    lua_pop(l, 1);
+                                  // --
+  }
+}
+
 /**
  * @brief Calls the Lua function with its arguments on top of the stack.
  *
@@ -876,11 +998,7 @@ bool LuaContext::load_file_if_exists(lua_State* l, const std::string& script_nam
 
   if (FileTools::data_file_exists(file_name)) {
     // Load the file.
-    size_t size;
-    char* buffer;
-    FileTools::data_file_open_buffer(file_name, &buffer, &size);
-    int result = luaL_loadbuffer(l, buffer, size, file_name.c_str());
-    FileTools::data_file_close_buffer(buffer);
+    int result = FileTools::data_file_load_lua(l, file_name);
 
     if (result != 0) {
       Debug::print(StringConcat() << "Error: failed to load script '"
@@ -1130,7 +1248,7 @@ void LuaContext::push_userdata(lua_State* l, ExportableToLua& userdata) {
                                   // ... all_udata lightudata udata
     luaL_getmetatable(l, userdata.get_lua_type_name().c_str());
                                   // ... all_udata lightudata udata mt
-    Debug::check_assertion(!lua_isnil(l, -1), StringConcat() <<
+    SOLARUS_ASSERT(!lua_isnil(l, -1),
         "Userdata of type '" << userdata.get_lua_type_name()
         << "' has no metatable, this is a memory leak");  // TODO also check __gc
     lua_setmetatable(l, -2);
@@ -1319,6 +1437,11 @@ int LuaContext::userdata_meta_newindex_as_table(lua_State* l) {
                                   // ... udata_tables udata_table udata udata_table
     lua_settable(l, -4);
                                   // ... udata_tables udata_table
+
+    // The table will be removed when the object is destroyed.
+    LuaContext& lua_context = get_lua_context(l);
+    (*userdata)->set_lua_table_context(&lua_context);
+    lua_context.userdata_callbacks[*userdata] = 0;
   }
   lua_pushvalue(l, 2);
                                   // ... udata_tables udata_table key
@@ -1326,6 +1449,15 @@ int LuaContext::userdata_meta_newindex_as_table(lua_State* l) {
                                   // ... udata_tables udata_table key value
   lua_settable(l, -3);
                                   // ... udata_tables udata_table
+
+  // Remember the frequent callbacks defined, to avoid calling them otherwise.
+  if (lua_type(l, 2) == LUA_TSTRING) {
+    int callback = get_frequent_callback(lua_tostring(l, 2));
+    if (callback != 0) {
+      get_lua_context(l).set_userdata_callback(**userdata,
+          FrequentCallback(callback), !lua_isnil(l, 3));
+    }
+  }
   return 0;
 }
 
@@ -183,7 +183,7 @@ Map& LuaContext::get_entity_creation_map(lua_State* l) {
   else {
     // The map was is implicit (typically, we are loading its data file).
     map = get_entity_implicit_creation_map(l);
-    Debug::check_assertion(map != NULL,
+    SOLARUS_ASSERT(map != NULL,
         "No implicit creation was been set in this Lua state");
   }
 
@@ -901,7 +901,7 @@ int LuaContext::map_api_create_tile(lua_State* l) {
   Map& map = get_entity_creation_map(l);
 
   // Should not happen: create_tile is not in the map metatable.
-  Debug::check_assertion(!map.is_started(),
+  SOLARUS_ASSERT(!map.is_started(),
       "Cannot create a tile when the map is already started");
 
   luaL_checktype(l, 1, LUA_TTABLE);
@@ -1708,7 +1708,9 @@ void LuaContext::map_on_finished(Map& map) {
 void LuaContext::map_on_update(Map& map) {
 
   push_map(l, map);
-  on_update();
+  if (userdata_has_callback(map, CALLBACK_ON_UPDATE)) {
+    on_update();
+  }
   menus_on_update(-1);
   lua_pop(l, 1);
 }
@@ -1722,7 +1724,9 @@ void LuaContext::map_on_draw(Map& map, Surface& dst_surface) {
 
   push_map(l, map);
   menus_on_draw(-1, dst_surface);
-  on_draw(dst_surface);
+  if (userdata_has_callback(map, CALLBACK_ON_DRAW)) {
+    on_draw(dst_surface);
+  }
   lua_pop(l, 1);
 }
 
@@ -1496,6 +1496,10 @@ int LuaContext::pixel_movement_api_set_delay(lua_State* l) {
  */
 void LuaContext::movement_on_position_changed(Movement& movement) {
 
+  if (!userdata_has_callback(movement, CALLBACK_ON_POSITION_CHANGED)) {
+    return;
+  }
+
   push_movement(l, movement);
   on_position_changed();
   lua_pop(l, 1);
@@ -17,6 +17,7 @@
 #include <lua.hpp>
 #include "lua/LuaContext.h"
 #include "Sprite.h"
+#include "SpriteAnimationSet.h"
 
 const std::string LuaContext::sprite_module_name = "sol.sprite";
 
@@ -27,6 +28,7 @@ void LuaContext::register_sprite_module() {
 
   static const luaL_Reg methods[] = {
       { "create", sprite_api_create },
+      { "get_animation_id", sprite_api_get_animation_id },
       { "get_animation", sprite_api_get_animation },
       { "set_animation", sprite_api_set_animation },
       { "get_direction", sprite_api_get_direction },
@@ -104,6 +106,19 @@ int LuaContext::sprite_api_create(lua_State* l) {
   return 1;
 }
 
+/**
+ * @brief Implementation of \ref lua_api_sprite_get_animation_id.
+ * @param l the Lua context that is calling this function
+ * @return number of values to return to Lua
+ */
+int LuaContext::sprite_api_get_animation_id(lua_State* l) {
+
+  const std::string& animation_name = luaL_checkstring(l, 1);
+
+  lua_pushinteger(l, SpriteAnimationSet::get_animation_id(animation_name));
+  return 1;
+}
+
 /**
  * @brief Implementation of \ref lua_api_sprite_get_animation.
  * @param l the Lua context that is calling this function
@@ -128,8 +143,17 @@ int LuaContext::sprite_api_set_animation(lua_State* l) {
 
   Sprite& sprite = check_sprite(l, 1);
 
-  const std::string& animation_name = luaL_checkstring(l, 2);
-  sprite.set_current_animation(animation_name);
+  if (lua_type(l, 2) == LUA_TNUMBER) {
+    int animation_id = luaL_checkint(l, 2);
+    if (!sprite.has_animation(animation_id)) {
+      luaL_argerror(l, 2, "No such animation in this sprite");
+    }
+    sprite.set_current_animation(animation_id);
+  }
+  else {
+    const std::string& animation_name = luaL_checkstring(l, 2);
+    sprite.set_current_animation(animation_name);
+  }
   sprite.restart_animation();
 
   return 0;
@@ -16,10 +16,12 @@
  */
 #include "lua/LuaContext.h"
 #include "lowlevel/Debug.h"
+#include "lowlevel/System.h"
 #include "Timer.h"
 #include "MainLoop.h"
 #include "Game.h"
 #include <list>
+#include <algorithm>
 #include <lua.hpp>
 
 const std::string LuaContext::timer_module_name = "sol.timer";
@@ -109,6 +111,7 @@ void LuaContext::add_timer(Timer* timer, int context_index, int callback_index)
 
   timers[timer].callback_ref = callback_ref;
   timers[timer].context = context;
+  timers[timer].stamp = 0;
 
   Game* game = main_loop.get_game();
   if (game != NULL) {
@@ -121,6 +124,7 @@ void LuaContext::add_timer(Timer* timer, int context_index, int callback_index)
     }
   }
   timer->increment_refcount();
+  schedule_timer(timer);
 }
 
 /**
@@ -198,38 +202,145 @@ void LuaContext::remove_timers() {
     }
   }
   timers.clear();
+  timer_schedule.clear();
 }
 
 /**
- * @brief Updates all timers currently running for this script.
+ * @brief Updates the timers that have something to do now.
+ *
+ * Only the timers whose expiration date or next clock sound has come
+ * are updated, earliest first. All timers finished at this date call
+ * their callback during this pass, in the order of their expiration.
+ * Timers started or rescheduled during this pass are not updated before
+ * the next pass, even if they have already expired.
  */
 void LuaContext::update_timers() {
 
-  std::list<Timer*> timers_to_remove;
+  const uint32_t now = System::now();
+  const uint32_t first_new_stamp = next_timer_stamp;
+  std::vector<TimerScheduleEntry> timers_to_reschedule;
 
-  std::map<Timer*, LuaTimerData>::iterator it;
-  for (it = timers.begin(); it != timers.end(); ++it) {
+  while (!timer_schedule.empty() && timer_schedule.front().date <= now) {
 
-    Timer* timer = it->first;
+    TimerScheduleEntry entry = timer_schedule.front();
+    std::pop_heap(timer_schedule.begin(), timer_schedule.end(), is_timer_entry_after);
+    timer_schedule.pop_back();
+
+    std::map<Timer*, LuaTimerData>::iterator it = timers.find(entry.timer);
+    if (it == timers.end() || it->second.stamp != entry.stamp) {
+      // the timer was removed or rescheduled since this entry was pushed
+      continue;
+    }
+
+    if (entry.stamp >= first_new_stamp) {
+      // scheduled by a callback of this pass: wait for the next one
+      timers_to_reschedule.push_back(entry);
+      continue;
+    }
+
+    Timer* timer = entry.timer;
     timer->update();
     if (timer->is_finished()) {
-      do_callback(it->second.callback_ref);
-      lua_pushlightuserdata(l, (void*) it->second.context);
-      timers_to_remove.push_back(timer);
-      lua_pop(l, 1);
-      break;
+      // unregister the timer before the callback because the callback
+      // may start or stop other timers
+      int callback_ref = it->second.callback_ref;
+      timers.erase(it);
+      do_callback(callback_ref);
+      timer->decrement_refcount();
+      if (timer->get_refcount() == 0) {
+        delete timer;
+      }
+    }
+    else {
+      // a clock sound was played: update the timer again at the next one,
+      // but not during this pass even if this sound is late
+      it->second.stamp = next_timer_stamp++;
+      entry.stamp = it->second.stamp;
+      timers_to_reschedule.push_back(entry);
     }
   }
 
-  std::list<Timer*>::iterator it2;
-  for (it2 = timers_to_remove.begin(); it2 != timers_to_remove.end(); ++it2) {
-    remove_timer(*it2);
+  for (unsigned int i = 0; i < timers_to_reschedule.size(); i++) {
+    const TimerScheduleEntry& entry = timers_to_reschedule[i];
+    std::map<Timer*, LuaTimerData>::iterator it = timers.find(entry.timer);
+    if (it != timers.end() && it->second.stamp == entry.stamp) {
+      schedule_timer(entry.timer);
+    }
+  }
+}
+
+/**
+ * @brief Computes again the date when a timer has to be updated.
+ *
+ * Call this function when the timer is added, suspended, resumed
+ * or when its clock sound is enabled or disabled.
+ * A suspended timer is not scheduled and costs nothing until it is resumed.
+ *
+ * @param timer A timer of this context.
+ */
+void LuaContext::schedule_timer(Timer* timer) {
+
+  std::map<Timer*, LuaTimerData>::iterator it = timers.find(timer);
+  if (it == timers.end()) {
+    return;
+  }
+
+  if (timer->is_suspended() || timer->is_finished()) {
+    it->second.stamp = 0;
+    return;
+  }
+
+  if (timer_schedule.size() > 2 * timers.size() + 32) {
+    // too many obsolete entries: remove them
+    std::vector<TimerScheduleEntry> valid_entries;
+    for (unsigned int i = 0; i < timer_schedule.size(); i++) {
+      const TimerScheduleEntry& entry = timer_schedule[i];
+      std::map<Timer*, LuaTimerData>::iterator it2 = timers.find(entry.timer);
+      if (it2 != timers.end() && it2->second.stamp == entry.stamp) {
+        valid_entries.push_back(entry);
+      }
+    }
+    timer_schedule.swap(valid_entries);
+    std::make_heap(timer_schedule.begin(), timer_schedule.end(), is_timer_entry_after);
   }
+
+  TimerScheduleEntry entry;
+  entry.date = timer->get_next_update_date();
+  entry.stamp = next_timer_stamp++;
+  entry.timer = timer;
+  it->second.stamp = entry.stamp;
+
+  timer_schedule.push_back(entry);
+  std::push_heap(timer_schedule.begin(), timer_schedule.end(), is_timer_entry_after);
+}
+
+/**
+ * @brief Compares two entries of the timer schedule.
+ *
+ * Used as the comparison function of the heap, so that its first element
+ * is the earliest entry. Entries with the same date are ordered by
+ * order of scheduling.
+ *
+ * @param entry1 An entry.
+ * @param entry2 Another entry.
+ * @return true if entry1 comes after entry2.
+ */
+bool LuaContext::is_timer_entry_after(const TimerScheduleEntry& entry1,
+    const TimerScheduleEntry& entry2) {
+
+  if (entry1.date != entry2.date) {
+    return entry1.date > entry2.date;
+  }
+  return entry1.stamp > entry2.stamp;
 }
 
 /**
  * @brief This function is called when the game (if any) is being suspended
  * or resumed.
+ *
+ * Resumed timers have their expiration date shifted by the duration of
+ * the suspension and are scheduled again.
+ *
  * @param suspended true if the game is suspended, false if it is resumed.
  */
 void LuaContext::notify_timers_map_suspended(bool suspended) {
@@ -239,6 +350,7 @@ void LuaContext::notify_timers_map_suspended(bool suspended) {
     Timer* timer = it->first;
     if (!suspended || timer->is_suspended_with_map()) {
       timer->notify_map_suspended(suspended);
+      schedule_timer(timer);
     }
   }
 }
@@ -354,6 +466,7 @@ int LuaContext::timer_api_set_with_sound(lua_State* l) {
   }
 
   timer.set_with_sound(with_sound);
+  get_lua_context(l).schedule_timer(&timer);
 
   return 0;
 }
@@ -385,6 +498,7 @@ int LuaContext::timer_api_set_suspended(lua_State* l) {
   }
 
   timer.set_suspended(suspended);
+  get_lua_context(l).schedule_timer(&timer);
 
   return 0;
 }
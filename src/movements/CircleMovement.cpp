@@ -19,7 +19,6 @@
 #include "lowlevel/System.h"
 #include "lowlevel/Geometry.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 #include "entities/MapEntity.h"
 #include "entities/MapEntities.h"
 #include "Map.h"
@@ -102,7 +101,7 @@ int CircleMovement::get_radius() {
  */
 void CircleMovement::set_radius(int radius) {
 
-  Debug::check_assertion(radius >= 0, StringConcat() << "Invalid radius: " << radius);
+  SOLARUS_ASSERT(radius >= 0, "Invalid radius: " << radius);
 
   this->wanted_radius = radius;
   if (radius_change_delay == 0) {
@@ -138,7 +137,7 @@ int CircleMovement::get_radius_speed() {
  */
 void CircleMovement::set_radius_speed(int radius_speed) {
 
-  Debug::check_assertion(radius_speed >= 0, StringConcat() << "Invalid radius speed: " << radius_speed);
+  SOLARUS_ASSERT(radius_speed >= 0, "Invalid radius speed: " << radius_speed);
 
   if (radius_speed == 0) {
     this->radius_change_delay = 0;
@@ -164,7 +163,7 @@ int CircleMovement::get_angle_speed() {
  */
 void CircleMovement::set_angle_speed(int angle_speed) {
 
-  Debug::check_assertion(angle_speed > 0, StringConcat() << "Invalid angle speed: " << angle_speed);
+  SOLARUS_ASSERT(angle_speed > 0, "Invalid angle speed: " << angle_speed);
 
   this->angle_change_delay = 1000 / angle_speed;
   this->next_angle_change_date = System::now();
@@ -186,8 +185,8 @@ double CircleMovement::get_initial_angle() {
  */
 void CircleMovement::set_initial_angle(double initial_angle) {
 
-  Debug::check_assertion(initial_angle >= 0 && initial_angle < Geometry::TWO_PI,
-      StringConcat() << "Invalid initial angle: " << initial_angle);
+  SOLARUS_ASSERT(initial_angle >= 0 && initial_angle < Geometry::TWO_PI,
+      "Invalid initial angle: " << initial_angle);
 
   // convert to degrees (everything works in degrees in this class)
   this->initial_angle = Geometry::radians_to_degrees(initial_angle);
@@ -267,7 +266,7 @@ int CircleMovement::get_max_rotations() {
  */
 void CircleMovement::set_max_rotations(int max_rotations) {
 
-  Debug::check_assertion(max_rotations >= 0, StringConcat() << "Invalid maximum rotations number: " << max_rotations);
+  SOLARUS_ASSERT(max_rotations >= 0, "Invalid maximum rotations number: " << max_rotations);
 
   this->max_rotations = max_rotations;
   this->nb_rotations = 0;
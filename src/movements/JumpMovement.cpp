@@ -17,7 +17,6 @@
 #include "movements/JumpMovement.h"
 #include "lua/LuaContext.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 #include <sstream>
 
 /**
@@ -48,8 +47,8 @@ JumpMovement::JumpMovement(int direction8, int distance, int speed, bool ignore_
   speed(0),
   jump_height(0) {
 
-  Debug::check_assertion(direction8 >= 0 && direction8 < 8,
-      StringConcat() << "Invalid jump direction: " << direction8);
+  SOLARUS_ASSERT(direction8 >= 0 && direction8 < 8,
+      "Invalid jump direction: " << direction8);
   set_speed(speed);
 }
 
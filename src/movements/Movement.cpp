@@ -18,6 +18,7 @@
 #include "entities/MapEntity.h"
 #include "lua/LuaContext.h"
 #include "lowlevel/System.h"
+#include "lowlevel/ObjectPool.h"
 #include "lowlevel/Debug.h"
 #include "Map.h"
 
@@ -51,6 +52,28 @@ Movement::~Movement() {
 
 }
 
+/**
+ * @brief Allocates the memory of a movement.
+ *
+ * Movements are created and destroyed often during the game, so their
+ * memory is recycled by ObjectPool.
+ *
+ * @param size size of the movement in bytes
+ * @return the memory allocated
+ */
+void* Movement::operator new(size_t size) {
+  return ObjectPool::allocate(size);
+}
+
+/**
+ * @brief Releases the memory of a movement.
+ * @param memory the memory to release
+ * @param size size of the movement in bytes
+ */
+void Movement::operator delete(void* memory, size_t size) {
+  ObjectPool::release(memory, size);
+}
+
 /**
  * @brief Returns the unique id of this movement.
  *
@@ -17,7 +17,9 @@
 #include "movements/PathFinding.h"
 #include "entities/MapEntity.h"
 #include "Map.h"
+#include "lowlevel/System.h"
 #include "lowlevel/Debug.h"
+#include <cstdlib>
 
 const Rectangle PathFinding::neighbours_locations[] = {
   Rectangle( 8,  0, 16, 16 ),
@@ -41,6 +43,13 @@ const Rectangle PathFinding::transition_collision_boxes[] = {
   Rectangle( 0,  0, 24, 24 )
 };
 
+std::vector<PathFinding::Node> PathFinding::nodes;
+std::vector<int> PathFinding::open_heap;
+uint32_t PathFinding::generation = 0;
+int PathFinding::nb_searches = 0;
+int PathFinding::nb_nodes_explored = 0;
+uint64_t PathFinding::search_time = 0;
+
 /**
  * @brief Constructor.
  * @param map the map
@@ -49,9 +58,10 @@ const Rectangle PathFinding::transition_collision_boxes[] = {
  * @param target_entity the target entity (its size must be 16*16)
  */
 PathFinding::PathFinding(Map &map, MapEntity &source_entity, MapEntity &target_entity):
-  map(map), source_entity(source_entity), target_entity(target_entity) {
+  map(map), source_entity(source_entity), target_entity(target_entity),
+  width8(map.get_width8()), height8(map.get_height8()) {
 
-  Debug::check_assertion(source_entity.is_aligned_to_grid(),
+  SOLARUS_ASSERT(source_entity.is_aligned_to_grid(),
       "The source must be aligned on the map grid");
 }
 
@@ -61,6 +71,30 @@ PathFinding::PathFinding(Map &map, MapEntity &source_entity, MapEntity &target_e
 PathFinding::~PathFinding() {
 }
 
+/**
+ * @brief Returns the number of paths computed since the beginning of the program.
+ * @return the number of calls to compute_path() that ran the A* algorithm
+ */
+int PathFinding::get_nb_searches() {
+  return nb_searches;
+}
+
+/**
+ * @brief Returns the number of nodes explored since the beginning of the program.
+ * @return the number of nodes that were moved to the closed list
+ */
+int PathFinding::get_nb_nodes_explored() {
+  return nb_nodes_explored;
+}
+
+/**
+ * @brief Returns the time spent computing paths since the beginning of the program.
+ * @return the total duration of the A* algorithm in microseconds
+ */
+uint64_t PathFinding::get_search_time() {
+  return search_time;
+}
+
 /**
  * @brief Tries to find a path between the source point and the target point.
  * @return the path found, or an empty string if no path was found
@@ -68,10 +102,6 @@ PathFinding::~PathFinding() {
  */
 std::string PathFinding::compute_path() {
 
-  //std::cout << "will compute a path from " << source_entity.get_top_left_x() << ","
-  //  << source_entity.get_top_left_y() << " to " << target_entity.get_top_left_x() << ","
-  //  << target_entity.get_top_left_y() << std::endl;
-
   Rectangle source = source_entity.get_bounding_box();
   Rectangle target = target_entity.get_bounding_box();
 
@@ -79,116 +109,127 @@ std::string PathFinding::compute_path() {
   target.add_x(-target.get_x() % 8);
   target.add_y(4);
   target.add_y(-target.get_y() % 8);
-  int target_index = get_square_index(target);
 
-  Debug::check_assertion(target.get_x() % 8 == 0 && target.get_y() % 8 == 0,
+  SOLARUS_ASSERT(target.get_x() % 8 == 0 && target.get_y() % 8 == 0,
       "Could not snap the target to the map grid");
 
   int total_mdistance = get_manhattan_distance(source, target);
   if (total_mdistance > 200 || target_entity.get_layer() != source_entity.get_layer()) {
-    //std::cout << "too far, not computing a path\n";
     return ""; // too far to compute a path
   }
 
-  std::string path = "";
+  if (source.get_x() < 0 || source.get_x() >= width8 * 8
+      || source.get_y() < 0 || source.get_y() >= height8 * 8
+      || target.get_x() < 0 || target.get_x() >= width8 * 8
+      || target.get_y() < 0 || target.get_y() >= height8 * 8) {
+    return ""; // squares outside the map are never valid nodes
+  }
 
-  Node starting_node;
-  int index = get_square_index(source);
-  starting_node.location = source;
-  starting_node.index = index;
+  uint64_t start_time = System::get_real_time_us();
+  nb_searches++;
+  start_generation();
+
+  int target_index = get_square_index(target);
+  int source_index = get_square_index(source);
+  Node& starting_node = nodes[source_index];
+  starting_node.generation = generation;
   starting_node.previous_cost = 0;
   starting_node.heuristic = total_mdistance;
   starting_node.total_cost = total_mdistance;
-  starting_node.direction = ' ';
   starting_node.parent_index = -1;
+  starting_node.direction = ' ';
+  push_open_node(source_index);
 
-  open_list[index] = starting_node;
-  open_list_indices.push_front(index);
-
-  bool finished = false;
-  while (!finished) {
+  std::string path = "";
+  while (!open_heap.empty()) {
 
     // pick the node with the lowest total cost in the open list
-    int index = open_list_indices.front();
-    Node *current_node = &open_list[index];
-    open_list_indices.pop_front();
-    closed_list[index] = *current_node;
-    open_list.erase(index);
-    current_node = &closed_list[index];
-
-    //std::cout << System::now() << " picking the lowest cost node in the open list ("
-    //  << (open_list_indices.size() + 1) << " elements): "
-    //  << current_node->location << ", index = " << current_node->index
-    //  << ", cost = " << current_node->previous_cost << " + " << current_node->heuristic << "\n";
+    int index = pop_open_node();
+    nb_nodes_explored++;
 
     if (index == target_index) {
-      //std::cout << "target node was added to the closed list\n";
-      finished = true;
-      path = rebuild_path(current_node);
-      //std::cout << "rebuild done\n";
+      path = rebuild_path(index);
+      break;
     }
-    else {
-      // look at the accessible nodes from it
-      //std::cout << System::now() << " looking for accessible states\n";
-      for (int i = 0; i < 8; i++) {
-
-        Node new_node;
-        int immediate_cost = (i & 1) ? 11 : 8;
-        new_node.previous_cost = current_node->previous_cost + immediate_cost;
-        new_node.location = current_node->location;
-        new_node.location.add_xy(neighbours_locations[i]);
-        new_node.index = get_square_index(new_node.location);
-        //std::cout << "  node in direction " << i << ": index = " << new_node.index << std::endl;
-
-        bool in_closed_list = (closed_list.find(new_node.index) != closed_list.end());
-        if (!in_closed_list && get_manhattan_distance(new_node.location, target) < 200
-            && is_node_transition_valid(*current_node, i)) {
-          //std::cout << "  node in direction " << i << " is not in the closed list\n";
-          // not in the closed list: look in the open list
-
-          bool in_open_list = open_list.find(new_node.index) != open_list.end();
-
-          if (!in_open_list) {
-            // not in the open list: add it
-            new_node.heuristic = get_manhattan_distance(new_node.location, target);
-            new_node.total_cost = new_node.previous_cost + new_node.heuristic;
-            new_node.parent_index = index;
-            new_node.direction = '0' + i;
-            open_list[new_node.index] = new_node; 
-            add_index_sorted(&open_list[new_node.index]);
-            //std::cout << "  node in direction " << i << " is not in the open list, adding it with cost "
-            //  << new_node.previous_cost << " (" << current_node->previous_cost << " + "
-            //  << immediate_cost << ") + " << new_node.heuristic << " and parent " << new_node.parent_index << "\n";
-          }
-          else {
-            //std::cout << "  node in direction " << i << " is already in the open list\n";
-            Node *existing_node = &open_list[new_node.index];
-            // already in the open list: see if the current path is better
-            if (new_node.previous_cost < existing_node->previous_cost) {
-              existing_node->previous_cost = new_node.previous_cost;
-              existing_node->total_cost = existing_node->previous_cost + existing_node->heuristic;
-              existing_node->parent_index = index;
-              open_list_indices.sort();
-            }
-          }
-        }
-        else {
-          //std::cout << "skipping node in direction " << i << ": already in closed list = "
-          //  << in_closed_list << ", too far from target = "
-          //  << (get_manhattan_distance(new_node.location, target) >= 200) << ", invalid transition = "
-          //  << (!is_node_transition_valid(*current_node, i)) << std::endl;
-        }
+
+    // look at the accessible nodes from it
+    const Rectangle location = get_square_location(index);
+    const int previous_cost = nodes[index].previous_cost;
+    for (int i = 0; i < 8; i++) {
+
+      Rectangle new_location = location;
+      new_location.add_xy(neighbours_locations[i]);
+      if (new_location.get_x() < 0 || new_location.get_x() >= width8 * 8
+          || new_location.get_y() < 0 || new_location.get_y() >= height8 * 8) {
+        continue;
       }
-      if (open_list_indices.empty()) {
-        finished = true;
+
+      int new_index = get_square_index(new_location);
+      Node& new_node = nodes[new_index];
+      bool visited = (new_node.generation == generation);
+      if (visited && new_node.heap_position == -1) {
+        continue; // in the closed list
+      }
+
+      int heuristic = get_manhattan_distance(new_location, target);
+      if (heuristic >= 200 || !is_node_transition_valid(location, i)) {
+        continue;
+      }
+
+      int new_cost = previous_cost + ((i & 1) ? 11 : 8);
+      if (!visited) {
+        // not in the open list: add it
+        new_node.generation = generation;
+        new_node.previous_cost = new_cost;
+        new_node.heuristic = heuristic;
+        new_node.total_cost = new_cost + heuristic;
+        new_node.parent_index = index;
+        new_node.direction = '0' + i;
+        push_open_node(new_index);
+      }
+      else if (new_cost < new_node.previous_cost) {
+        // already in the open list: the current path is better
+        new_node.previous_cost = new_cost;
+        new_node.total_cost = new_cost + new_node.heuristic;
+        new_node.parent_index = index;
+        new_node.direction = '0' + i;
+        move_up(new_node.heap_position);
       }
     }
   }
 
-  //std::cout << "path found: " << path << ", open nodes: " << open_list.size() << ", closed nodes: " << closed_list.size() << std::endl;
+  search_time += System::get_real_time_us() - start_time;
   return path;
 }
 
+/**
+ * @brief Prepares the node array and the open list for a new search.
+ *
+ * The node array is only allocated again if the map is bigger than all
+ * previous ones. Nodes of previous searches are invalidated by changing
+ * the current generation rather than by clearing them.
+ */
+void PathFinding::start_generation() {
+
+  const unsigned int nb_squares = width8 * height8;
+  if (nodes.size() < nb_squares) {
+    Node unvisited_node;
+    unvisited_node.generation = 0;
+    nodes.resize(nb_squares, unvisited_node);
+    open_heap.reserve(nb_squares);
+  }
+  open_heap.clear();
+
+  generation++;
+  if (generation == 0) {
+    // the counter has wrapped: make sure that no node looks visited
+    for (unsigned int i = 0; i < nodes.size(); i++) {
+      nodes[i].generation = 0;
+    }
+    generation = 1;
+  }
+}
+
 /**
  * @brief Returns the index of the 8*8 square in the map
  * corresponding to the specified location.
@@ -199,7 +240,17 @@ int PathFinding::get_square_index(const Rectangle &location) {
 
   int x8 = location.get_x() / 8;
   int y8 = location.get_y() / 8;
-  return y8 * map.get_width8() + x8;
+  return y8 * width8 + x8;
+}
+
+/**
+ * @brief Returns the location of the node of a square.
+ * @param index index of an 8*8 square of the map
+ * @return the 16*16 location of the node whose top-left part is this square
+ */
+const Rectangle PathFinding::get_square_location(int index) {
+
+  return Rectangle((index % width8) * 8, (index / width8) * 8, 16, 16);
 }
 
 /**
@@ -214,64 +265,136 @@ int PathFinding::get_manhattan_distance(const Rectangle &point1, const Rectangle
   return distance;
 }
 
+/**
+ * @brief Returns whether a node should be explored before another one.
+ *
+ * The node with the lowest total cost comes first. In case of equality,
+ * the node closest to the target comes first.
+ *
+ * @param index1 index of a node of the open list
+ * @param index2 index of another node of the open list
+ * @return true if the first node has a higher priority
+ */
+bool PathFinding::is_before(int index1, int index2) {
+
+  const Node& node1 = nodes[index1];
+  const Node& node2 = nodes[index2];
+  return node1.total_cost < node2.total_cost
+      || (node1.total_cost == node2.total_cost && node1.heuristic < node2.heuristic);
+}
 
 /**
- * @brief Compares two nodes according to their total estimated cost.
- * @param other the other node
+ * @brief Adds a node to the open list.
+ * @param index index of the node
  */
-bool PathFinding::Node::operator<(const Node &other) {
-  return total_cost < other.total_cost;
+void PathFinding::push_open_node(int index) {
+
+  open_heap.push_back(index);
+  nodes[index].heap_position = open_heap.size() - 1;
+  move_up(open_heap.size() - 1);
 }
 
 /**
- * @brief Adds the index of a node to the sorted list of indices of the open list, making sure the list remains sorted.
- * @param node the node
+ * @brief Removes the node with the highest priority from the open list
+ * and puts it into the closed list.
+ * @return index of this node
  */
-void PathFinding::add_index_sorted(Node *node) {
-
-  bool inserted = false;
-  std::list<int>::iterator i;
-  for (i = open_list_indices.begin(); i != open_list_indices.end() && !inserted; i++) {
-    int index = *i;
-    Node *current_node = &open_list[index];
-    if (current_node->total_cost >= node->total_cost) {
-      open_list_indices.insert(i, node->index);
-      inserted = true;
+int PathFinding::pop_open_node() {
+
+  int index = open_heap[0];
+  int last_index = open_heap.back();
+  open_heap.pop_back();
+  if (!open_heap.empty()) {
+    set_heap_element(0, last_index);
+    move_down(0);
+  }
+  nodes[index].heap_position = -1;
+  return index;
+}
+
+/**
+ * @brief Moves an element of the open heap up until its parent has a higher priority.
+ * @param position current position of the element in the heap
+ */
+void PathFinding::move_up(int position) {
+
+  int index = open_heap[position];
+  while (position > 0) {
+    int parent_position = (position - 1) / 2;
+    int parent_index = open_heap[parent_position];
+    if (!is_before(index, parent_index)) {
+      break;
     }
+    set_heap_element(position, parent_index);
+    position = parent_position;
   }
+  set_heap_element(position, index);
+}
 
-  if (!inserted) {
-    open_list_indices.push_back(node->index);
+/**
+ * @brief Moves an element of the open heap down until its children have a lower priority.
+ * @param position current position of the element in the heap
+ */
+void PathFinding::move_down(int position) {
+
+  const int size = open_heap.size();
+  int index = open_heap[position];
+  while (true) {
+    int child_position = position * 2 + 1;
+    if (child_position >= size) {
+      break;
+    }
+    if (child_position + 1 < size
+        && is_before(open_heap[child_position + 1], open_heap[child_position])) {
+      child_position++;
+    }
+    int child_index = open_heap[child_position];
+    if (!is_before(child_index, index)) {
+      break;
+    }
+    set_heap_element(position, child_index);
+    position = child_position;
   }
+  set_heap_element(position, index);
+}
+
+/**
+ * @brief Puts a node at a position of the open heap.
+ * @param position a position in the heap
+ * @param index index of the node to put there
+ */
+void PathFinding::set_heap_element(int position, int index) {
+
+  open_heap[position] = index;
+  nodes[index].heap_position = position;
 }
 
 /**
  * @brief Builds the string representation of the path found by the algorithm.
- * @param closed_list the closed list of A*
- * @return final_node the final node of the path
+ * @param final_index index of the final node of the path
+ * @return the path
  */
-std::string PathFinding::rebuild_path(const Node *final_node) {
+std::string PathFinding::rebuild_path(int final_index) {
 
-  const Node *current_node = final_node;
   std::string path = "";
+  const Node* current_node = &nodes[final_index];
   while (current_node->direction != ' ') {
-    path = current_node->direction + path;
-    current_node = &closed_list[current_node->parent_index];
-    //std::cout << "current_node: " << current_node->index << ", path = " << path << std::endl;
+    path += current_node->direction;
+    current_node = &nodes[current_node->parent_index];
   }
-  return path;
+  return std::string(path.rbegin(), path.rend());
 }
 
 /**
  * @brief Returns whether a transition between two nodes is valid, i.e. whether there is no collision with the map.
- * @param initial_node the first node
+ * @param location location of the first node
  * @param direction the direction to take (0 to 7)
  * @return true if there is no collision for this transition
  */
-bool PathFinding::is_node_transition_valid(const Node &initial_node, int direction) {
+bool PathFinding::is_node_transition_valid(const Rectangle &location, int direction) {
 
   Rectangle collision_box = transition_collision_boxes[direction];
-  collision_box.add_xy(initial_node.location);
+  collision_box.add_xy(location);
 
   return !map.test_collision_with_obstacles(source_entity.get_layer(), collision_box, source_entity);
 }
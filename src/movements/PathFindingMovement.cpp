@@ -15,7 +15,8 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "movements/PathFindingMovement.h"
-#include "movements/PathFinding.h"
+#include "movements/PathFindingService.h"
+#include "Map.h"
 #include "lua/LuaContext.h"
 #include "entities/MapEntity.h"
 #include "lowlevel/Random.h"
@@ -81,8 +82,8 @@ void PathFindingMovement::update() {
  */
 void PathFindingMovement::recompute_movement() { 
 
-  PathFinding path_finding(get_entity()->get_map(), *get_entity(), *target);
-  std::string path = path_finding.compute_path();
+  PathFindingService& path_finding = get_entity()->get_map().get_path_finding_service();
+  std::string path = path_finding.compute_path(*get_entity(), *target);
 
   uint32_t min_delay;
   if (path.size() == 0) {
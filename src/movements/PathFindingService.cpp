@@ -0,0 +1,788 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "movements/PathFindingService.h"
+#include "movements/PathFinding.h"
+#include "entities/MapEntities.h"
+#include "entities/MapEntity.h"
+#include "Map.h"
+#include "lowlevel/System.h"
+#include "lowlevel/Debug.h"
+#include <cstdlib>
+#include <algorithm>
+
+int PathFindingService::nb_requests = 0;
+int PathFindingService::nb_fields_built = 0;
+int PathFindingService::nb_nodes_settled = 0;
+int PathFindingService::nb_unreachable = 0;
+uint64_t PathFindingService::total_time = 0;
+
+/**
+ * @brief Bits representing the kinds of ground an entity cannot walk on.
+ */
+enum GroundObstacle {
+  GROUND_OBSTACLE_SHALLOW_WATER = 0x01,
+  GROUND_OBSTACLE_DEEP_WATER    = 0x02,
+  GROUND_OBSTACLE_HOLE          = 0x04,
+  GROUND_OBSTACLE_LAVA          = 0x08,
+  GROUND_OBSTACLE_PRICKLE       = 0x10,
+  GROUND_OBSTACLE_LADDER        = 0x20
+};
+
+/**
+ * @brief Creates the path-finding service of a map.
+ * @param map the map (its size must be known)
+ */
+PathFindingService::PathFindingService(Map& map):
+  map(map),
+  width8(map.get_width8()),
+  height8(map.get_height8()) {
+
+  for (int i = 0; i < nb_fields; i++) {
+    fields[i].valid = false;
+    fields[i].generation = 0;
+  }
+}
+
+/**
+ * @brief Destructor.
+ */
+PathFindingService::~PathFindingService() {
+
+  std::map<int, RegionGraph*>::iterator it;
+  for (it = region_graphs.begin(); it != region_graphs.end(); it++) {
+    delete it->second;
+  }
+}
+
+/**
+ * @brief Returns the number of paths requested since the beginning of the program.
+ * @return the number of calls to compute_path()
+ */
+int PathFindingService::get_nb_requests() {
+  return nb_requests;
+}
+
+/**
+ * @brief Returns the number of flow fields started since the beginning of the program.
+ * @return the number of flow fields
+ */
+int PathFindingService::get_nb_fields_built() {
+  return nb_fields_built;
+}
+
+/**
+ * @brief Returns the number of flow field nodes computed since the beginning of the program.
+ * @return the number of nodes whose cost was made final
+ */
+int PathFindingService::get_nb_nodes_settled() {
+  return nb_nodes_settled;
+}
+
+/**
+ * @brief Returns the number of requests where the region graph proved
+ * that there was no path.
+ * @return the number of requests answered without any search
+ */
+int PathFindingService::get_nb_unreachable() {
+  return nb_unreachable;
+}
+
+/**
+ * @brief Returns the time spent computing paths since the beginning of the program.
+ * @return the total duration of compute_path() in microseconds
+ */
+uint64_t PathFindingService::get_total_time() {
+  return total_time;
+}
+
+/**
+ * @brief Notifies this service that an obstacle entity of the map has
+ * appeared, disappeared, moved or changed its state.
+ *
+ * All flow fields are dropped. The region graphs only depend on the tiles
+ * and are kept.
+ */
+void PathFindingService::notify_obstacles_changed() {
+
+  for (int i = 0; i < nb_fields; i++) {
+    fields[i].valid = false;
+  }
+}
+
+/**
+ * @brief Tries to find a path between an entity and a target.
+ *
+ * The path is the same kind of path as the ones computed by PathFinding.
+ * Only when the target is the hero, it can be longer than 200 pixels.
+ *
+ * @param source_entity the entity that will move from the starting point to the target
+ * (its position must be aligned on the map grid)
+ * @param target_entity the target entity (its size must be 16*16)
+ * @return the path found, or an empty string if no path was found
+ * (because there is no path or the target is too far)
+ */
+std::string PathFindingService::compute_path(MapEntity& source_entity, MapEntity& target_entity) {
+
+  SOLARUS_ASSERT(source_entity.is_aligned_to_grid(),
+      "The source must be aligned on the map grid");
+
+  nb_requests++;
+
+  const Rectangle& source = source_entity.get_bounding_box();
+  Rectangle target = target_entity.get_bounding_box();
+  target.add_x(4);
+  target.add_x(-target.get_x() % 8);
+  target.add_y(4);
+  target.add_y(-target.get_y() % 8);
+
+  const bool to_hero = target_entity.is_hero();
+  int distance = std::abs(target.get_x() - source.get_x()) + std::abs(target.get_y() - source.get_y());
+  if (distance > (to_hero ? max_distance : 200)
+      || target_entity.get_layer() != source_entity.get_layer()) {
+    return ""; // too far to compute a path
+  }
+
+  if (source.get_x() < 0 || source.get_x() >= width8 * 8
+      || source.get_y() < 0 || source.get_y() >= height8 * 8
+      || target.get_x() < 0 || target.get_x() >= width8 * 8
+      || target.get_y() < 0 || target.get_y() >= height8 * 8) {
+    return ""; // squares outside the map are never valid nodes
+  }
+
+  uint64_t start_time = System::get_real_time_us();
+
+  const int source_index = (source.get_y() / 8) * width8 + source.get_x() / 8;
+  const int target_index = (target.get_y() / 8) * width8 + target.get_x() / 8;
+  const RegionGraph& graph = get_region_graph(source_entity.get_layer(), source_entity);
+
+  std::string path = "";
+  if (!are_connected(graph, source_index, target_index)) {
+    // the tiles of the map alone make the target unreachable
+    nb_unreachable++;
+  }
+  else if (!to_hero) {
+    PathFinding path_finding(map, source_entity, target_entity);
+    path = path_finding.compute_path();
+  }
+  else {
+    FlowField& field = get_flow_field(source_entity, target_entity, target_index);
+    if (extend_flow_field(field, graph, source_index, source_entity)) {
+      path = get_flow_field_path(field, source_index);
+    }
+  }
+
+  total_time += System::get_real_time_us() - start_time;
+  return path;
+}
+
+/**
+ * @brief Returns the kinds of ground that are obstacles for an entity.
+ * @param entity an entity
+ * @return an OR combination of GroundObstacle values
+ */
+int PathFindingService::get_ground_obstacles(MapEntity& entity) {
+
+  int ground_obstacles = 0;
+  if (entity.is_shallow_water_obstacle()) {
+    ground_obstacles |= GROUND_OBSTACLE_SHALLOW_WATER;
+  }
+  if (entity.is_deep_water_obstacle()) {
+    ground_obstacles |= GROUND_OBSTACLE_DEEP_WATER;
+  }
+  if (entity.is_hole_obstacle()) {
+    ground_obstacles |= GROUND_OBSTACLE_HOLE;
+  }
+  if (entity.is_lava_obstacle()) {
+    ground_obstacles |= GROUND_OBSTACLE_LAVA;
+  }
+  if (entity.is_prickle_obstacle()) {
+    ground_obstacles |= GROUND_OBSTACLE_PRICKLE;
+  }
+  if (entity.is_ladder_obstacle()) {
+    ground_obstacles |= GROUND_OBSTACLE_LADDER;
+  }
+  return ground_obstacles;
+}
+
+/**
+ * @brief Returns whether a tile blocks the transitions that touch it.
+ *
+ * Transition boxes are aligned on the 8*8 grid and Map::test_collision_with_obstacles()
+ * tests the pixels of their border. Each side of a diagonal tile has at least
+ * one obstacle pixel, so diagonal tiles block like full obstacles.
+ *
+ * @param obstacle obstacle property of a tile
+ * @param ground_obstacles the kinds of ground that are obstacles
+ * @return true if a transition touching this tile is invalid
+ */
+bool PathFindingService::is_ground_obstacle(Obstacle obstacle, int ground_obstacles) {
+
+  switch (obstacle) {
+
+    case OBSTACLE_NONE:
+    case OBSTACLE_EMPTY:
+      return false;
+
+    case OBSTACLE_SHALLOW_WATER:
+      return (ground_obstacles & GROUND_OBSTACLE_SHALLOW_WATER) != 0;
+
+    case OBSTACLE_DEEP_WATER:
+      return (ground_obstacles & GROUND_OBSTACLE_DEEP_WATER) != 0;
+
+    case OBSTACLE_HOLE:
+      return (ground_obstacles & GROUND_OBSTACLE_HOLE) != 0;
+
+    case OBSTACLE_LAVA:
+      return (ground_obstacles & GROUND_OBSTACLE_LAVA) != 0;
+
+    case OBSTACLE_PRICKLE:
+      return (ground_obstacles & GROUND_OBSTACLE_PRICKLE) != 0;
+
+    case OBSTACLE_LADDER:
+      return (ground_obstacles & GROUND_OBSTACLE_LADDER) != 0;
+
+    default:
+      return true;
+  }
+}
+
+/**
+ * @brief Returns the region graph of a layer for an entity,
+ * computing it if necessary.
+ * @param layer a layer
+ * @param entity the entity to move
+ * @return the region graph of this layer for the ground obstacles of this entity
+ */
+PathFindingService::RegionGraph& PathFindingService::get_region_graph(Layer layer,
+    MapEntity& entity) {
+
+  const int ground_obstacles = get_ground_obstacles(entity);
+  const int key = ground_obstacles * LAYER_NB + layer;
+
+  std::map<int, RegionGraph*>::iterator it = region_graphs.find(key);
+  if (it != region_graphs.end()) {
+    return *it->second;
+  }
+
+  RegionGraph* graph = new RegionGraph();
+  build_region_graph(*graph, layer, ground_obstacles);
+  region_graphs[key] = graph;
+  return *graph;
+}
+
+/**
+ * @brief Computes the regions of a layer from its tiles.
+ * @param graph the region graph to fill
+ * @param layer a layer
+ * @param ground_obstacles the kinds of ground that are obstacles
+ */
+void PathFindingService::build_region_graph(RegionGraph& graph, Layer layer,
+    int ground_obstacles) {
+
+  const int nb_squares = width8 * height8;
+  MapEntities& entities = map.get_entities();
+
+  graph.blocked_squares.resize(nb_squares);
+  for (int y8 = 0; y8 < height8; y8++) {
+    for (int x8 = 0; x8 < width8; x8++) {
+      Obstacle obstacle = entities.get_obstacle_tile(layer, x8 * 8, y8 * 8);
+      graph.blocked_squares[y8 * width8 + x8] = is_ground_obstacle(obstacle, ground_obstacles);
+    }
+  }
+
+  // a transition only tests the squares entered, so every node of a path
+  // except maybe the source is free: it overlaps no obstacle tile
+  std::vector<bool> free_nodes(nb_squares, false);
+  for (int y8 = 0; y8 < height8 - 1; y8++) {
+    for (int x8 = 0; x8 < width8 - 1; x8++) {
+      free_nodes[y8 * width8 + x8] = !is_square_blocked(graph, x8, y8)
+          && !is_square_blocked(graph, x8 + 1, y8)
+          && !is_square_blocked(graph, x8, y8 + 1)
+          && !is_square_blocked(graph, x8 + 1, y8 + 1);
+    }
+  }
+
+  // links[i] has the bit d set if node i and its neighbour d are free and
+  // connected (between free nodes, transitions are valid in both ways)
+  std::vector<uint8_t> links(nb_squares, 0);
+  for (int index = 0; index < nb_squares; index++) {
+    for (int direction = 0; direction < 8; direction++) {
+      int neighbour_index;
+      if (free_nodes[index]
+          && get_neighbour(index, direction, neighbour_index)
+          && free_nodes[neighbour_index]
+          && is_static_transition_valid(graph, index, direction)) {
+        links[index] |= 1 << direction;
+        links[neighbour_index] |= 1 << ((direction + 4) % 8);
+      }
+    }
+  }
+
+  // regions: nodes connected inside a sector
+  graph.node_regions.assign(nb_squares, -1);
+  std::vector<int> region_parents;
+  std::vector<int> stack;
+  for (int index = 0; index < nb_squares; index++) {
+
+    if (graph.node_regions[index] != -1 || !free_nodes[index]) {
+      continue;
+    }
+
+    const int region = region_parents.size();
+    region_parents.push_back(region);
+    const int sector_x = (index % width8) / sector_size;
+    const int sector_y = (index / width8) / sector_size;
+
+    graph.node_regions[index] = region;
+    stack.push_back(index);
+    while (!stack.empty()) {
+      int current = stack.back();
+      stack.pop_back();
+      for (int direction = 0; direction < 8; direction++) {
+        int neighbour_index;
+        if ((links[current] & (1 << direction)) != 0
+            && get_neighbour(current, direction, neighbour_index)
+            && graph.node_regions[neighbour_index] == -1
+            && (neighbour_index % width8) / sector_size == sector_x
+            && (neighbour_index / width8) / sector_size == sector_y) {
+          graph.node_regions[neighbour_index] = region;
+          stack.push_back(neighbour_index);
+        }
+      }
+    }
+  }
+
+  // link the regions across sector borders and group them into islands
+  for (int index = 0; index < nb_squares; index++) {
+    for (int direction = 0; direction < 8; direction++) {
+      int neighbour_index;
+      if ((links[index] & (1 << direction)) != 0
+          && get_neighbour(index, direction, neighbour_index)) {
+
+        int root1 = graph.node_regions[index];
+        while (region_parents[root1] != root1) {
+          root1 = region_parents[root1];
+        }
+        int root2 = graph.node_regions[neighbour_index];
+        while (region_parents[root2] != root2) {
+          root2 = region_parents[root2];
+        }
+        if (root1 != root2) {
+          region_parents[std::max(root1, root2)] = std::min(root1, root2);
+        }
+      }
+    }
+  }
+
+  graph.region_islands.resize(region_parents.size());
+  for (unsigned int region = 0; region < region_parents.size(); region++) {
+    // parents always have a lower number: they are already resolved
+    int parent = region_parents[region];
+    graph.region_islands[region] = (parent == int(region)) ? region : graph.region_islands[parent];
+  }
+}
+
+/**
+ * @brief Returns whether the tile of an 8*8 square is an obstacle.
+ * @param graph a region graph
+ * @param x8 x coordinate of the square
+ * @param y8 y coordinate of the square
+ * @return true if the square is an obstacle or is outside the map
+ */
+bool PathFindingService::is_square_blocked(const RegionGraph& graph, int x8, int y8) {
+
+  if (x8 < 0 || x8 >= width8 || y8 < 0 || y8 >= height8) {
+    return true;
+  }
+  return graph.blocked_squares[y8 * width8 + x8] != 0;
+}
+
+/**
+ * @brief Returns whether the tiles allow a transition between two nodes.
+ *
+ * This gives the same result as the tile tests of
+ * Map::test_collision_with_obstacles() on the transition box.
+ *
+ * @param graph a region graph
+ * @param index index of the initial node
+ * @param direction the direction to take (0 to 7)
+ * @return true if no tile prevents this transition
+ */
+bool PathFindingService::is_static_transition_valid(const RegionGraph& graph,
+    int index, int direction) {
+
+  const Rectangle& box = PathFinding::transition_collision_boxes[direction];
+  const int x1 = index % width8 + (box.get_x() >> 3);
+  const int y1 = index / width8 + (box.get_y() >> 3);
+  const int x2 = x1 + (box.get_width() >> 3) - 1;
+  const int y2 = y1 + (box.get_height() >> 3) - 1;
+
+  // only the border of the box is tested, like the map does
+  for (int x8 = x1; x8 <= x2; x8++) {
+    if (is_square_blocked(graph, x8, y1) || is_square_blocked(graph, x8, y2)) {
+      return false;
+    }
+  }
+  for (int y8 = y1; y8 <= y2; y8++) {
+    if (is_square_blocked(graph, x1, y8) || is_square_blocked(graph, x2, y8)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Returns whether an entity can go from a node to a neighbour.
+ * @param graph the region graph of the layer
+ * @param index index of the initial node
+ * @param direction the direction to take (0 to 7)
+ * @param entity the entity to move
+ * @return true if there is no collision for this transition
+ */
+bool PathFindingService::is_transition_valid(const RegionGraph& graph,
+    int index, int direction, MapEntity& entity) {
+
+  if (!is_static_transition_valid(graph, index, direction)) {
+    return false;
+  }
+
+  Rectangle collision_box = PathFinding::transition_collision_boxes[direction];
+  collision_box.add_xy((index % width8) * 8, (index / width8) * 8);
+  return !map.test_collision_with_entities(entity.get_layer(), collision_box, entity);
+}
+
+/**
+ * @brief Returns the neighbour of a node in a direction.
+ * @param index index of a node
+ * @param direction a direction (0 to 7)
+ * @param neighbour_index receives the index of the neighbour
+ * @return false if the neighbour is outside the map
+ */
+bool PathFindingService::get_neighbour(int index, int direction, int& neighbour_index) {
+
+  const Rectangle& move = PathFinding::neighbours_locations[direction];
+  const int x8 = index % width8 + move.get_x() / 8;
+  const int y8 = index / width8 + move.get_y() / 8;
+  if (x8 < 0 || x8 >= width8 || y8 < 0 || y8 >= height8) {
+    return false;
+  }
+  neighbour_index = y8 * width8 + x8;
+  return true;
+}
+
+/**
+ * @brief Returns whether the tiles allow a path between two nodes.
+ * @param graph a region graph
+ * @param source_index the starting node
+ * @param target_index the node to reach
+ * @return false if no path can exist between these nodes
+ */
+bool PathFindingService::are_connected(const RegionGraph& graph,
+    int source_index, int target_index) {
+
+  if (source_index == target_index) {
+    return true;
+  }
+
+  int source_region = graph.node_regions[source_index];
+  int target_region = graph.node_regions[target_index];
+  if (source_region == -1) {
+    // the source overlaps an obstacle tile: the regions cannot tell
+    return true;
+  }
+  return target_region != -1
+      && graph.region_islands[source_region] == graph.region_islands[target_region];
+}
+
+/**
+ * @brief Returns a flow field usable by an entity, starting a new one if needed.
+ * @param source_entity the entity to move
+ * @param target_entity the target
+ * @param target_index node of the target
+ * @return the flow field
+ */
+PathFindingService::FlowField& PathFindingService::get_flow_field(
+    MapEntity& source_entity, MapEntity& target_entity, int target_index) {
+
+  const uint32_t now = System::now();
+  const Layer layer = source_entity.get_layer();
+  const EntityType entity_type = source_entity.get_type();
+  const int ground_obstacles = get_ground_obstacles(source_entity);
+  MapEntity* source = (entity_type == ENEMY) ? NULL : &source_entity;
+
+  FlowField* oldest_field = &fields[0];
+  for (int i = 0; i < nb_fields; i++) {
+
+    FlowField& field = fields[i];
+    if (field.valid
+        && now - field.date > max_field_age) {
+      field.valid = false;
+    }
+
+    if (field.valid
+        && field.target == &target_entity
+        && field.source == source
+        && field.target_index == target_index
+        && field.layer == layer
+        && field.entity_type == entity_type
+        && field.ground_obstacles == ground_obstacles) {
+      field.last_used = now;
+      return field;
+    }
+
+    if (oldest_field->valid
+        && (!field.valid || field.last_used < oldest_field->last_used)) {
+      oldest_field = &field;
+    }
+  }
+
+  FlowField& field = *oldest_field;
+  field.valid = true;
+  field.target = &target_entity;
+  field.source = source;
+  field.target_index = target_index;
+  field.layer = layer;
+  field.entity_type = entity_type;
+  field.ground_obstacles = ground_obstacles;
+  field.date = now;
+  field.last_used = now;
+  start_flow_field(field, target_index);
+  return field;
+}
+
+/**
+ * @brief Resets a flow field to its target node only.
+ * @param field the flow field to reset
+ * @param target_index node of the target
+ */
+void PathFindingService::start_flow_field(FlowField& field, int target_index) {
+
+  const unsigned int nb_squares = width8 * height8;
+  if (field.nodes.size() < nb_squares) {
+    FieldNode unvisited_node;
+    unvisited_node.generation = 0;
+    field.nodes.resize(nb_squares, unvisited_node);
+  }
+  field.open_heap.clear();
+
+  field.generation++;
+  if (field.generation == 0) {
+    // the counter has wrapped: make sure that no node looks visited
+    for (unsigned int i = 0; i < field.nodes.size(); i++) {
+      field.nodes[i].generation = 0;
+    }
+    field.generation = 1;
+  }
+
+  FieldNode& target_node = field.nodes[target_index];
+  target_node.generation = field.generation;
+  target_node.cost = 0;
+  target_node.direction = -1;
+  push_open_node(field, target_index);
+  nb_fields_built++;
+}
+
+/**
+ * @brief Continues the search of a flow field until a node is reached.
+ *
+ * Nodes are made final in increasing cost order, from the target.
+ * A node is reached from its neighbour d when the transition from the node
+ * in direction d is valid for the entity.
+ *
+ * @param field a flow field
+ * @param graph the region graph of the layer
+ * @param index the node to reach
+ * @param entity the entity that will move
+ * @return true if the node has a final cost, false if it cannot be reached
+ */
+bool PathFindingService::extend_flow_field(FlowField& field, const RegionGraph& graph,
+    int index, MapEntity& entity) {
+
+  const FieldNode& goal = field.nodes[index];
+  if (goal.generation == field.generation && goal.heap_position == -1) {
+    return true;
+  }
+
+  while (!field.open_heap.empty()) {
+
+    int current = pop_open_node(field);
+    nb_nodes_settled++;
+    const int cost = field.nodes[current].cost;
+
+    for (int direction = 0; direction < 8; direction++) {
+
+      // the node from which this direction leads to the current node
+      int previous;
+      if (!get_neighbour(current, (direction + 4) % 8, previous)) {
+        continue;
+      }
+
+      FieldNode& previous_node = field.nodes[previous];
+      bool visited = (previous_node.generation == field.generation);
+      if (visited && previous_node.heap_position == -1) {
+        continue;
+      }
+
+      int new_cost = cost + ((direction & 1) ? 11 : 8);
+      if (new_cost > max_cost
+          || (visited && new_cost >= previous_node.cost)
+          || !is_transition_valid(graph, previous, direction, entity)) {
+        continue;
+      }
+
+      previous_node.cost = new_cost;
+      previous_node.direction = direction;
+      if (!visited) {
+        previous_node.generation = field.generation;
+        push_open_node(field, previous);
+      }
+      else {
+        move_up(field, previous_node.heap_position);
+      }
+    }
+
+    if (current == index) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief Builds the path from a node to the target of a flow field.
+ * @param field a flow field
+ * @param index a node whose cost is final
+ * @return the path
+ */
+std::string PathFindingService::get_flow_field_path(FlowField& field, int index) {
+
+  std::string path = "";
+  int current = index;
+  while (current != field.target_index) {
+    int direction = field.nodes[current].direction;
+    path += '0' + direction;
+    get_neighbour(current, direction, current);
+  }
+  return path;
+}
+
+/**
+ * @brief Returns whether a node of a flow field should be made final before another one.
+ * @param field a flow field
+ * @param index1 a node of the open heap
+ * @param index2 another node of the open heap
+ * @return true if the first node has a lower cost
+ */
+bool PathFindingService::is_before(const FlowField& field, int index1, int index2) {
+
+  const FieldNode& node1 = field.nodes[index1];
+  const FieldNode& node2 = field.nodes[index2];
+  return node1.cost < node2.cost
+      || (node1.cost == node2.cost && index1 < index2);
+}
+
+/**
+ * @brief Adds a node to the open heap of a flow field.
+ * @param field a flow field
+ * @param index index of the node
+ */
+void PathFindingService::push_open_node(FlowField& field, int index) {
+
+  field.open_heap.push_back(index);
+  field.nodes[index].heap_position = field.open_heap.size() - 1;
+  move_up(field, field.open_heap.size() - 1);
+}
+
+/**
+ * @brief Removes the node with the lowest cost from the open heap of a flow field.
+ * @param field a flow field
+ * @return index of this node, whose cost is now final
+ */
+int PathFindingService::pop_open_node(FlowField& field) {
+
+  int index = field.open_heap[0];
+  int last_index = field.open_heap.back();
+  field.open_heap.pop_back();
+  if (!field.open_heap.empty()) {
+    set_heap_element(field, 0, last_index);
+    move_down(field, 0);
+  }
+  field.nodes[index].heap_position = -1;
+  return index;
+}
+
+/**
+ * @brief Moves an element of an open heap up until its parent has a lower cost.
+ * @param field a flow field
+ * @param position current position of the element in the heap
+ */
+void PathFindingService::move_up(FlowField& field, int position) {
+
+  int index = field.open_heap[position];
+  while (position > 0) {
+    int parent_position = (position - 1) / 2;
+    int parent_index = field.open_heap[parent_position];
+    if (!is_before(field, index, parent_index)) {
+      break;
+    }
+    set_heap_element(field, position, parent_index);
+    position = parent_position;
+  }
+  set_heap_element(field, position, index);
+}
+
+/**
+ * @brief Moves an element of an open heap down until its children have a higher cost.
+ * @param field a flow field
+ * @param position current position of the element in the heap
+ */
+void PathFindingService::move_down(FlowField& field, int position) {
+
+  const int size = field.open_heap.size();
+  int index = field.open_heap[position];
+  while (true) {
+    int child_position = position * 2 + 1;
+    if (child_position >= size) {
+      break;
+    }
+    if (child_position + 1 < size
+        && is_before(field, field.open_heap[child_position + 1], field.open_heap[child_position])) {
+      child_position++;
+    }
+    int child_index = field.open_heap[child_position];
+    if (!is_before(field, child_index, index)) {
+      break;
+    }
+    set_heap_element(field, position, child_index);
+    position = child_position;
+  }
+  set_heap_element(field, position, index);
+}
+
+/**
+ * @brief Puts a node at a position of an open heap.
+ * @param field a flow field
+ * @param position a position in the heap
+ * @param index index of the node to put there
+ */
+void PathFindingService::set_heap_element(FlowField& field, int position, int index) {
+
+  field.open_heap[position] = index;
+  field.nodes[index].heap_position = position;
+}
+
@@ -21,7 +21,6 @@
 #include "lowlevel/System.h"
 #include "lowlevel/Random.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 
 const std::string PathMovement::elementary_moves[] = {
     " 1  0   1  0   1  0   1  0   1  0   1  0   1  0   1  0", // 8 pixels right
@@ -280,8 +279,8 @@ void PathMovement::start_next_elementary_move() {
       // normal case: there is a next trajectory to do
 
       current_direction = remaining_path[0] - '0';
-      Debug::check_assertion(current_direction >= 0 && current_direction < 8,
-          StringConcat() << "Invalid path '" << initial_path << "' (bad direction '" << remaining_path[0] << "')");
+      SOLARUS_ASSERT(current_direction >= 0 && current_direction < 8,
+          "Invalid path '" << initial_path << "' (bad direction '" << remaining_path[0] << "')");
 
       PixelMovement::set_delay(speed_to_delay(speed, current_direction));
       PixelMovement::set_trajectory(elementary_moves[current_direction]);
@@ -21,7 +21,6 @@
 #include "lowlevel/Random.h"
 #include "lowlevel/Geometry.h"
 #include "lowlevel/Debug.h"
-#include "lowlevel/StringConcat.h"
 #include <sstream>
 
 /**
@@ -62,7 +61,7 @@ void RandomMovement::set_entity(MapEntity *entity) {
  */
 void RandomMovement::set_max_distance(int max_distance) {
 
-  Debug::check_assertion(max_distance >= 0, StringConcat() << "Invalid value of max_distance: " << max_distance);
+  SOLARUS_ASSERT(max_distance >= 0, "Invalid value of max_distance: " << max_distance);
   this->max_distance = max_distance;
 
   // restrict the movement in a rectangle
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "lowlevel/Debug.h"
+#include "lowlevel/StringConcat.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+#include <dirent.h>
+#include <sys/time.h>
+
+#if __cplusplus >= 201103L
+#  define SOLARUS_THROW_BAD_ALLOC
+#else
+#  define SOLARUS_THROW_BAD_ALLOC throw(std::bad_alloc)
+#endif
+
+/**
+ * @file
+ * @brief Compares the memory allocations and the time of the former
+ * assertions (Debug::check_assertion() with a StringConcat message) and of
+ * SOLARUS_ASSERT, when the condition is true.
+ *
+ * Usage: assertion_benchmark QUEST_DATA_DIR [NB_CALLS]
+ *
+ * Three assertions called at each cycle by the engine are reproduced with
+ * their exact messages: the ones of MapEntities::get_entity(),
+ * SpriteAnimationSet::get_animation() and Tileset::get_tile_pattern().
+ * Their arguments are the map ids and entity names of the dungeon maps of
+ * the quest, the animation names of its sprites and tile pattern ids.
+ * Each assertion is checked NB_CALLS times (default 1000000) in both forms.
+ */
+
+namespace {
+
+uint64_t nb_allocations = 0;    /**< number of calls to operator new */
+
+/**
+ * @brief The former assertion function, before SOLARUS_ASSERT.
+ * @param assertion the condition to check
+ * @param error_message the message, already built by the caller
+ */
+inline void check_assertion(bool assertion, const std::string& error_message) {
+
+  if (!assertion) {
+    Debug::die(error_message);
+  }
+}
+
+/**
+ * @brief A name and the map or the sprite where it is declared.
+ */
+struct Name {
+  std::string owner;     /**< id of the map or the sprite */
+  std::string name;      /**< name of the entity or of the animation */
+};
+
+/**
+ * @brief Result of an assertion checked many times.
+ */
+struct Result {
+  uint64_t nb_allocations;   /**< number of allocations made */
+  uint64_t time;             /**< time spent in microseconds */
+};
+
+/**
+ * @brief Returns the current time.
+ * @return a date in microseconds
+ */
+uint64_t get_time_us() {
+
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/**
+ * @brief Reads the names of the entities declared in the dungeon maps.
+ * @param data_dir the quest data directory
+ * @param names the names found are added to this list
+ */
+void read_entity_names(const std::string& data_dir, std::vector<Name>& names) {
+
+  std::ifstream dungeons_file((data_dir + "/dungeons.lua").c_str());
+  std::string line;
+  while (std::getline(dungeons_file, line)) {
+
+    if (line.find("maps = {") == std::string::npos) {
+      continue;
+    }
+    size_t position = line.find('"');
+    while (position != std::string::npos) {
+      size_t end = line.find('"', position + 1);
+      Name name;
+      name.owner = line.substr(position + 1, end - position - 1);
+      position = line.find('"', end + 1);
+
+      std::ifstream map_file((data_dir + "/maps/" + name.owner + ".dat").c_str());
+      std::string map_line;
+      while (std::getline(map_file, map_line)) {
+        size_t start = map_line.find("name = \"");
+        if (start != std::string::npos) {
+          start += 8;
+          name.name = map_line.substr(start, map_line.find('"', start) - start);
+          names.push_back(name);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Reads the names of the animations of the sprites of a directory.
+ * @param data_dir the quest data directory
+ * @param directory a directory of sprites, relative to the sprites directory
+ * @param names the names found are added to this list
+ */
+void read_animation_names(const std::string& data_dir, const std::string& directory,
+    std::vector<Name>& names) {
+
+  DIR* dir = opendir((data_dir + "/sprites/" + directory).c_str());
+  if (dir == NULL) {
+    return;
+  }
+
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+
+    const std::string file_name = entry->d_name;
+    if (file_name.size() < 4 || file_name.substr(file_name.size() - 4) != ".dat") {
+      continue;
+    }
+
+    Name name;
+    name.owner = directory + "/" + file_name.substr(0, file_name.size() - 4);
+    std::ifstream file((data_dir + "/sprites/" + directory + "/" + file_name).c_str());
+    std::string line;
+    while (std::getline(file, line)) {
+      // the first line of an animation is "name image_file ..."
+      if (line.find(".png") != std::string::npos) {
+        name.name = line.substr(0, line.find(' '));
+        names.push_back(name);
+      }
+    }
+  }
+  closedir(dir);
+}
+
+/**
+ * @brief Checks the assertion of MapEntities::get_entity() many times.
+ * @param names the entities to find
+ * @param nb_calls number of assertions to check
+ * @param old_form true to use the former assertion
+ * @return the allocations made and the time spent
+ */
+Result check_get_entity(const std::vector<Name>& names, int nb_calls, bool old_form) {
+
+  const uint64_t nb_allocations_before = nb_allocations;
+  const uint64_t start_time = get_time_us();
+  for (int i = 0; i < nb_calls; i++) {
+    const std::string& map_id = names[i % names.size()].owner;
+    const std::string& name = names[i % names.size()].name;
+    const void* entity = &name;
+    if (old_form) {
+      check_assertion(entity != NULL, StringConcat()
+          << "Map '" << map_id
+          << "': Cannot find entity with name '" << name << "'");
+    }
+    else {
+      SOLARUS_ASSERT(entity != NULL,
+          "Map '" << map_id
+          << "': Cannot find entity with name '" << name << "'");
+    }
+  }
+  Result result = { nb_allocations - nb_allocations_before, get_time_us() - start_time };
+  return result;
+}
+
+/**
+ * @brief Checks the assertion of SpriteAnimationSet::get_animation() many times.
+ * @param names the animations to get
+ * @param nb_calls number of assertions to check
+ * @param old_form true to use the former assertion
+ * @return the allocations made and the time spent
+ */
+Result check_get_animation(const std::vector<Name>& names, int nb_calls, bool old_form) {
+
+  const uint64_t nb_allocations_before = nb_allocations;
+  const uint64_t start_time = get_time_us();
+  for (int i = 0; i < nb_calls; i++) {
+    const std::string& animation_name = names[i % names.size()].name;
+    const bool has_animation = !animation_name.empty();
+    if (old_form) {
+      check_assertion(has_animation,
+          StringConcat() << "No animation '" << animation_name << "' in this animation set");
+    }
+    else {
+      SOLARUS_ASSERT(has_animation,
+          "No animation '" << animation_name << "' in this animation set");
+    }
+  }
+  Result result = { nb_allocations - nb_allocations_before, get_time_us() - start_time };
+  return result;
+}
+
+/**
+ * @brief Checks the assertion of Tileset::get_tile_pattern() many times.
+ * @param nb_calls number of assertions to check
+ * @param old_form true to use the former assertion
+ * @return the allocations made and the time spent
+ */
+Result check_get_tile_pattern(int nb_calls, bool old_form) {
+
+  const uint64_t nb_allocations_before = nb_allocations;
+  const uint64_t start_time = get_time_us();
+  for (int i = 0; i < nb_calls; i++) {
+    const int id = 1 + i % 1024;
+    const void* tile_pattern = &id;
+    if (old_form) {
+      check_assertion(tile_pattern != NULL,
+          StringConcat() << "There is not tile pattern with id '" << id << "' in this tileset'");
+    }
+    else {
+      SOLARUS_ASSERT(tile_pattern != NULL,
+          "There is not tile pattern with id '" << id << "' in this tileset'");
+    }
+  }
+  Result result = { nb_allocations - nb_allocations_before, get_time_us() - start_time };
+  return result;
+}
+
+/**
+ * @brief Prints the results of an assertion in both forms.
+ * @param name name of the function that makes the assertion
+ * @param old_result result of the former assertion
+ * @param new_result result of SOLARUS_ASSERT
+ * @param nb_calls number of assertions checked
+ */
+void print_results(const std::string& name, const Result& old_result,
+    const Result& new_result, int nb_calls) {
+
+  std::cout << std::setw(36) << std::left << name << std::right
+      << std::setw(12) << double(old_result.nb_allocations) / nb_calls
+      << std::setw(12) << double(new_result.nb_allocations) / nb_calls
+      << std::setw(10) << old_result.time * 1000.0 / nb_calls
+      << std::setw(10) << new_result.time * 1000.0 / nb_calls << std::endl;
+}
+
+}
+
+/**
+ * @brief Allocates memory and counts the allocation.
+ * @param size number of bytes to allocate
+ * @return the memory allocated
+ */
+void* operator new(std::size_t size) SOLARUS_THROW_BAD_ALLOC {
+
+  nb_allocations++;
+  void* memory = std::malloc(size == 0 ? 1 : size);
+  if (memory == NULL) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+/**
+ * @brief Frees memory allocated by operator new.
+ * @param memory the memory to free
+ */
+void operator delete(void* memory) throw() {
+  std::free(memory);
+}
+
+/**
+ * @brief Entry point of the assertion benchmark.
+ * @param argc number of command-line arguments
+ * @param argv command-line arguments
+ * @return 0 in case of success
+ */
+int main(int argc, char** argv) {
+
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " QUEST_DATA_DIR [NB_CALLS]" << std::endl;
+    return 1;
+  }
+  const std::string data_dir = argv[1];
+  const int nb_calls = (argc >= 3) ? std::atoi(argv[2]) : 1000000;
+
+  std::vector<Name> entity_names;
+  read_entity_names(data_dir, entity_names);
+  std::vector<Name> animation_names;
+  const char* sprite_directories[] = { "enemies", "entities", "hero", "npc", NULL };
+  for (int i = 0; sprite_directories[i] != NULL; i++) {
+    read_animation_names(data_dir, sprite_directories[i], animation_names);
+  }
+  if (entity_names.empty() || animation_names.empty()) {
+    std::cerr << "Cannot read the entities and sprites of '" << data_dir << "'" << std::endl;
+    return 1;
+  }
+
+  std::cout << entity_names.size() << " entity names, "
+      << animation_names.size() << " animation names, "
+      << nb_calls << " calls per assertion" << std::endl;
+  std::cout << std::setw(36) << std::left << "per call" << std::right
+      << std::setw(12) << "old allocs" << std::setw(12) << "new allocs"
+      << std::setw(10) << "old ns" << std::setw(10) << "new ns" << std::endl;
+  std::cout << std::fixed << std::setprecision(2);
+
+  print_results("MapEntities::get_entity()",
+      check_get_entity(entity_names, nb_calls, true),
+      check_get_entity(entity_names, nb_calls, false), nb_calls);
+  print_results("SpriteAnimationSet::get_animation()",
+      check_get_animation(animation_names, nb_calls, true),
+      check_get_animation(animation_names, nb_calls, false), nb_calls);
+  print_results("Tileset::get_tile_pattern()",
+      check_get_tile_pattern(nb_calls, true),
+      check_get_tile_pattern(nb_calls, false), nb_calls);
+
+  return 0;
+}
+
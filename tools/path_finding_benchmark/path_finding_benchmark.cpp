@@ -0,0 +1,565 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "movements/PathFinding.h"
+#include "OldPathFinding.h"
+#include "entities/MapEntity.h"
+#include "Map.h"
+#include "lowlevel/System.h"
+#include <map>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <sys/time.h>
+
+/**
+ * @file
+ * @brief Compares the former A* implementation (OldPathFinding) with the
+ * current one (PathFinding) on the dungeon maps of a quest.
+ *
+ * Usage: path_finding_benchmark QUEST_DATA_DIR [NB_ROUNDS]
+ *
+ * The maps listed in dungeons.lua are read with their tilesets. Each map
+ * is reduced to the 8*8 squares that are obstacles for enemies: tiles
+ * whose ground is a wall, a diagonal wall, deep water, a hole, lava or
+ * prickles, plus walls that stop enemies, chests, doors, blocks,
+ * destructible items, crystal blocks and non-playing characters.
+ * Each enemy of the map then searches paths to 40 free places at most
+ * 96 pixels away in each direction, chosen by a fixed pseudo-random
+ * sequence, so that two runs make the same searches.
+ *
+ * Both implementations compute all paths NB_ROUNDS times (default 5)
+ * and the fastest round of each one is reported. The results of both
+ * implementations are also compared.
+ */
+
+namespace {
+
+/**
+ * @brief An element of a data file, like tile{ ... } or properties{ ... }.
+ */
+struct Element {
+  std::string type;                              /**< name of the element */
+  std::map<std::string, std::string> fields;     /**< value of each field, without quotes */
+};
+
+/**
+ * @brief A path to compute.
+ */
+struct Search {
+  Map* map;                 /**< the map */
+  Layer layer;              /**< layer of the source and the target */
+  Rectangle source;         /**< bounding box of the enemy, aligned on the grid */
+  Rectangle target;         /**< bounding box of the target */
+};
+
+/**
+ * @brief Result of a path computed by both implementations.
+ */
+struct Comparison {
+  int nb_found_by_both;     /**< number of paths found by both implementations */
+  int nb_found_by_old;      /**< number of paths only found by the old one */
+  int nb_found_by_new;      /**< number of paths only found by the new one */
+  int nb_same_cost;         /**< number of paths found by both with the same cost */
+  int nb_cheaper_new;       /**< number of paths cheaper with the new one */
+  int nb_cheaper_old;       /**< number of paths cheaper with the old one */
+};
+
+uint32_t random_state = 12345;
+
+/**
+ * @brief Returns a pseudo-random number, always the same sequence.
+ * @param bound the number returned is lower than this value
+ * @return a number between 0 and bound - 1
+ */
+int next_random(int bound) {
+
+  random_state = random_state * 1103515245 + 12345;
+  return (random_state >> 16) % bound;
+}
+
+/**
+ * @brief Skips spaces and Lua comments in a data file.
+ * @param text content of the file
+ * @param position current position, updated
+ */
+void skip_spaces(const std::string& text, size_t& position) {
+
+  while (position < text.size()) {
+    if (isspace(text[position])) {
+      position++;
+    }
+    else if (text.compare(position, 2, "--") == 0) {
+      position = text.find('\n', position);
+      if (position == std::string::npos) {
+        position = text.size();
+      }
+    }
+    else {
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Reads a value in a data file: a number, a boolean, a string or a table.
+ * @param text content of the file
+ * @param position position of the value, updated to the character after it
+ * @return the value, without the quotes of a string
+ */
+std::string read_value(const std::string& text, size_t& position) {
+
+  size_t start = position;
+  if (text[position] == '"') {
+    size_t end = text.find('"', position + 1);
+    position = end + 1;
+    return text.substr(start + 1, end - start - 1);
+  }
+
+  if (text[position] == '{') {
+    position = text.find('}', position) + 1;
+    return text.substr(start, position - start);
+  }
+
+  while (position < text.size()
+      && text[position] != ',' && text[position] != '}' && !isspace(text[position])) {
+    position++;
+  }
+  return text.substr(start, position - start);
+}
+
+/**
+ * @brief Reads the elements of a map or tileset data file.
+ *
+ * These files are Lua scripts made of calls like tile{ x = 8, y = 16, ... }.
+ * Only this simple syntax is supported.
+ *
+ * @param file_name the file to read
+ * @param elements the elements read are added to this list
+ * @return false if the file could not be opened
+ */
+bool read_elements(const std::string& file_name, std::vector<Element>& elements) {
+
+  std::ifstream file(file_name.c_str());
+  if (!file) {
+    return false;
+  }
+  std::ostringstream oss;
+  oss << file.rdbuf();
+  const std::string text = oss.str();
+
+  size_t position = 0;
+  skip_spaces(text, position);
+  while (position < text.size()) {
+
+    Element element;
+    size_t brace = text.find('{', position);
+    if (brace == std::string::npos) {
+      break;
+    }
+    element.type = text.substr(position, brace - position);
+    position = brace + 1;
+
+    skip_spaces(text, position);
+    while (position < text.size() && text[position] != '}') {
+
+      std::string key = read_value(text, position);
+      skip_spaces(text, position);
+      if (position < text.size() && text[position] == '=') {
+        position++;
+        skip_spaces(text, position);
+        element.fields[key] = read_value(text, position);
+        skip_spaces(text, position);
+      }
+      if (position < text.size() && text[position] == ',') {
+        position++;
+      }
+      skip_spaces(text, position);
+    }
+    position++;
+    elements.push_back(element);
+    skip_spaces(text, position);
+  }
+  return true;
+}
+
+/**
+ * @brief Returns an integer field of an element.
+ * @param element an element
+ * @param key name of the field
+ * @return its value, or 0 if there is no such field
+ */
+int get_int(const Element& element, const std::string& key) {
+
+  std::map<std::string, std::string>::const_iterator it = element.fields.find(key);
+  if (it == element.fields.end()) {
+    return 0;
+  }
+  return std::atoi(it->second.c_str());
+}
+
+/**
+ * @brief Returns a string field of an element.
+ * @param element an element
+ * @param key name of the field
+ * @return its value, or an empty string if there is no such field
+ */
+std::string get_string(const Element& element, const std::string& key) {
+
+  std::map<std::string, std::string>::const_iterator it = element.fields.find(key);
+  if (it == element.fields.end()) {
+    return "";
+  }
+  return it->second;
+}
+
+/**
+ * @brief Returns whether a kind of ground stops enemies.
+ * @param ground name of a ground, as in tileset files
+ * @return true if enemies cannot walk on this ground
+ */
+bool is_ground_obstacle(const std::string& ground) {
+
+  return ground == "wall"
+    || ground.compare(0, 5, "wall_") == 0
+    || ground == "deep_water"
+    || ground == "hole"
+    || ground == "lava"
+    || ground == "prickles";
+}
+
+/**
+ * @brief Makes all squares of a rectangle obstacles.
+ * @param map the map
+ * @param layer layer of the rectangle
+ * @param box the rectangle, in pixels
+ */
+void add_obstacle(Map& map, Layer layer, const Rectangle& box) {
+
+  for (int y = box.get_y(); y < box.get_y() + box.get_height(); y += 8) {
+    for (int x = box.get_x(); x < box.get_x() + box.get_width(); x += 8) {
+      map.set_obstacle(layer, x / 8, y / 8);
+    }
+  }
+}
+
+/**
+ * @brief Reads a map of the quest and prepares the searches of its enemies.
+ * @param data_dir the quest data directory
+ * @param map_id id of the map
+ * @param searches the searches of this map are added to this list
+ * @return the map created, or NULL if it could not be read
+ */
+Map* load_map(const std::string& data_dir, const std::string& map_id,
+    std::vector<Search>& searches) {
+
+  std::vector<Element> map_elements;
+  if (!read_elements(data_dir + "/maps/" + map_id + ".dat", map_elements)
+      || map_elements.empty() || map_elements[0].type != "properties") {
+    std::cerr << "Cannot read map '" << map_id << "'" << std::endl;
+    return NULL;
+  }
+
+  const Element& properties = map_elements[0];
+  std::vector<Element> tileset_elements;
+  read_elements(data_dir + "/tilesets/" + get_string(properties, "tileset") + ".dat",
+      tileset_elements);
+  std::map<std::string, std::string> grounds;
+  for (size_t i = 0; i < tileset_elements.size(); i++) {
+    if (tileset_elements[i].type == "tile_pattern") {
+      grounds[get_string(tileset_elements[i], "id")] =
+          get_string(tileset_elements[i], "ground");
+    }
+  }
+
+  const int width8 = get_int(properties, "width") / 8;
+  const int height8 = get_int(properties, "height") / 8;
+  Map* map = new Map(width8, height8);
+
+  // the ground of a square is the one of the last tile placed on it,
+  // an empty ground showing the ground of the layer below
+  std::vector<std::string> ground_squares[LAYER_NB];
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+    ground_squares[layer].assign(width8 * height8, "empty");
+  }
+
+  std::vector<const Element*> enemies;
+  for (size_t i = 1; i < map_elements.size(); i++) {
+
+    const Element& element = map_elements[i];
+    const Layer layer = Layer(get_int(element, "layer"));
+    const int x = get_int(element, "x");
+    const int y = get_int(element, "y");
+
+    if (element.type == "tile") {
+      const std::string& ground = grounds[get_string(element, "pattern")];
+      if (ground == "empty") {
+        continue;
+      }
+      for (int y8 = y / 8; y8 < (y + get_int(element, "height")) / 8; y8++) {
+        for (int x8 = x / 8; x8 < (x + get_int(element, "width")) / 8; x8++) {
+          if (x8 >= 0 && x8 < width8 && y8 >= 0 && y8 < height8) {
+            ground_squares[layer][y8 * width8 + x8] = ground;
+          }
+        }
+      }
+    }
+    else if (element.type == "wall") {
+      if (get_string(element, "stops_enemies") != "false") {
+        add_obstacle(*map, layer, Rectangle(x, y,
+            get_int(element, "width"), get_int(element, "height")));
+      }
+    }
+    else if (element.type == "crystal_block") {
+      add_obstacle(*map, layer, Rectangle(x, y,
+          get_int(element, "width"), get_int(element, "height")));
+    }
+    else if (element.type == "chest" || element.type == "door") {
+      add_obstacle(*map, layer, Rectangle(x, y, 16, 16));
+    }
+    else if (element.type == "block" || element.type == "destructible"
+        || element.type == "npc") {
+      add_obstacle(*map, layer, Rectangle(x - 8, y - 13, 16, 16));
+    }
+    else if (element.type == "enemy") {
+      enemies.push_back(&element);
+    }
+  }
+
+  for (int layer = 0; layer < LAYER_NB; layer++) {
+    for (int i = 0; i < width8 * height8; i++) {
+      int ground_layer = layer;
+      while (ground_layer > 0 && ground_squares[ground_layer][i] == "empty") {
+        ground_layer--;
+      }
+      if (is_ground_obstacle(ground_squares[ground_layer][i])) {
+        map->set_obstacle(Layer(layer), i % width8, i / width8);
+      }
+    }
+  }
+
+  // enemies have their origin point at (8,13) and start searching
+  // once aligned on the grid
+  for (size_t i = 0; i < enemies.size(); i++) {
+
+    Search search;
+    search.map = map;
+    search.layer = Layer(get_int(*enemies[i], "layer"));
+    const int x = get_int(*enemies[i], "x") - 8;
+    const int y = get_int(*enemies[i], "y") - 13;
+    search.source = Rectangle(x - x % 8, y - y % 8, 16, 16);
+    if (map->is_obstacle(search.layer, search.source)) {
+      continue;
+    }
+
+    int nb_targets = 0;
+    for (int attempt = 0; attempt < 400 && nb_targets < 40; attempt++) {
+      search.target = Rectangle(
+          search.source.get_x() + (next_random(25) - 12) * 8 + next_random(8),
+          search.source.get_y() + (next_random(25) - 12) * 8 + next_random(8),
+          16, 16);
+      if (!map->is_obstacle(search.layer, search.target)) {
+        searches.push_back(search);
+        nb_targets++;
+      }
+    }
+  }
+
+  return map;
+}
+
+/**
+ * @brief Returns the cost of a path, as computed by A*.
+ * @param path a path
+ * @return its cost
+ */
+int get_path_cost(const std::string& path) {
+
+  int cost = 0;
+  for (size_t i = 0; i < path.size(); i++) {
+    cost += ((path[i] - '0') & 1) ? 11 : 8;
+  }
+  return cost;
+}
+
+/**
+ * @brief Computes all paths with one of the implementations.
+ * @param searches the paths to compute
+ * @param paths if not NULL, the paths found are stored here
+ * @param nb_collision_tests the number of collision tests made is stored here
+ * @return the time spent in microseconds
+ */
+template<typename Implementation>
+uint64_t run(const std::vector<Search>& searches, std::vector<std::string>* paths,
+    long& nb_collision_tests) {
+
+  nb_collision_tests = 0;
+  uint64_t start_time = System::get_real_time_us();
+  for (size_t i = 0; i < searches.size(); i++) {
+
+    const Search& search = searches[i];
+    MapEntity source(search.layer, search.source);
+    MapEntity target(search.layer, search.target);
+    search.map->reset_nb_collision_tests();
+    std::string path = Implementation(*search.map, source, target).compute_path();
+    nb_collision_tests += search.map->get_nb_collision_tests();
+    if (paths != NULL) {
+      paths->push_back(path);
+    }
+  }
+  return System::get_real_time_us() - start_time;
+}
+
+/**
+ * @brief Returns the map ids listed in the dungeons file of the quest.
+ * @param data_dir the quest data directory
+ * @return the ids of the dungeon maps
+ */
+std::vector<std::string> read_dungeon_map_ids(const std::string& data_dir) {
+
+  std::vector<std::string> map_ids;
+  std::ifstream file((data_dir + "/dungeons.lua").c_str());
+  std::string line;
+  while (std::getline(file, line)) {
+
+    if (line.find("maps = {") == std::string::npos) {
+      continue;
+    }
+    size_t position = line.find('"');
+    while (position != std::string::npos) {
+      size_t end = line.find('"', position + 1);
+      map_ids.push_back(line.substr(position + 1, end - position - 1));
+      position = line.find('"', end + 1);
+    }
+  }
+  return map_ids;
+}
+
+}
+
+/**
+ * @brief Returns a precise real time.
+ *
+ * This replaces the function of the engine, which needs SDL to be initialized.
+ *
+ * @return a date in microseconds, with an unspecified origin
+ */
+uint64_t System::get_real_time_us() {
+
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/**
+ * @brief Entry point of the path finding benchmark.
+ * @param argc number of command-line arguments
+ * @param argv command-line arguments
+ * @return 0 in case of success
+ */
+int main(int argc, char** argv) {
+
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " QUEST_DATA_DIR [NB_ROUNDS]" << std::endl;
+    return 1;
+  }
+  const std::string data_dir = argv[1];
+  const int nb_rounds = (argc >= 3) ? std::atoi(argv[2]) : 5;
+
+  std::vector<std::string> map_ids = read_dungeon_map_ids(data_dir);
+  std::vector<Map*> maps;
+  std::vector<Search> searches;
+  for (size_t i = 0; i < map_ids.size(); i++) {
+    Map* map = load_map(data_dir, map_ids[i], searches);
+    if (map != NULL) {
+      maps.push_back(map);
+    }
+  }
+
+  std::cout << maps.size() << " dungeon maps, " << searches.size() << " searches, "
+      << nb_rounds << " rounds" << std::endl;
+
+  // compare the results
+  std::vector<std::string> old_paths, new_paths;
+  long old_collision_tests = 0;
+  long new_collision_tests = 0;
+  uint64_t old_time = run<OldPathFinding>(searches, &old_paths, old_collision_tests);
+  uint64_t new_time = run<PathFinding>(searches, &new_paths, new_collision_tests);
+
+  Comparison comparison = { 0, 0, 0, 0, 0, 0 };
+  for (size_t i = 0; i < searches.size(); i++) {
+
+    const bool old_found = !old_paths[i].empty();
+    const bool new_found = !new_paths[i].empty();
+    if (old_found && new_found) {
+      comparison.nb_found_by_both++;
+      const int old_cost = get_path_cost(old_paths[i]);
+      const int new_cost = get_path_cost(new_paths[i]);
+      if (old_cost == new_cost) {
+        comparison.nb_same_cost++;
+      }
+      else if (new_cost < old_cost) {
+        comparison.nb_cheaper_new++;
+      }
+      else {
+        comparison.nb_cheaper_old++;
+      }
+    }
+    else if (old_found) {
+      comparison.nb_found_by_old++;
+    }
+    else if (new_found) {
+      comparison.nb_found_by_new++;
+    }
+  }
+
+  // measure the fastest round of each implementation
+  for (int round = 1; round < nb_rounds; round++) {
+    long nb_collision_tests;
+    old_time = std::min(old_time, run<OldPathFinding>(searches, NULL, nb_collision_tests));
+    new_time = std::min(new_time, run<PathFinding>(searches, NULL, nb_collision_tests));
+  }
+
+  std::cout << "Paths found by both: " << comparison.nb_found_by_both
+      << " (same cost: " << comparison.nb_same_cost
+      << ", cheaper with the new code: " << comparison.nb_cheaper_new
+      << ", cheaper with the old code: " << comparison.nb_cheaper_old << ")" << std::endl;
+  std::cout << "Paths found only by the old code: " << comparison.nb_found_by_old
+      << ", only by the new code: " << comparison.nb_found_by_new << std::endl;
+
+  const size_t nb_searches = std::max(searches.size(), size_t(1));
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "Old code: " << old_time << " us, "
+      << double(old_time) / nb_searches << " us per search, "
+      << old_collision_tests << " collision tests" << std::endl;
+  std::cout << "New code: " << new_time << " us, "
+      << double(new_time) / nb_searches << " us per search, "
+      << new_collision_tests << " collision tests" << std::endl;
+  std::cout << "Speedup: " << double(old_time) / std::max(new_time, uint64_t(1))
+      << "x" << std::endl;
+
+  for (size_t i = 0; i < maps.size(); i++) {
+    delete maps[i];
+  }
+  return 0;
+}
+
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_MAP_H
+#define SOLARUS_MAP_H
+
+#include "Common.h"
+#include "lowlevel/Rectangle.h"
+#include "entities/Layer.h"
+#include <vector>
+
+/**
+ * @brief Stand-in for the Map class of the engine, used by the path
+ * finding benchmark.
+ *
+ * It only knows which 8*8 squares of each layer are obstacles
+ * for enemies, and counts the collision tests made.
+ */
+class Map {
+
+  public:
+
+    Map(int width8, int height8);
+
+    int get_width8();
+    int get_height8();
+
+    void set_obstacle(Layer layer, int x8, int y8);
+    bool is_obstacle(Layer layer, const Rectangle& box);
+    bool test_collision_with_obstacles(Layer layer,
+        const Rectangle& collision_box, MapEntity& entity);
+
+    long get_nb_collision_tests();
+    void reset_nb_collision_tests();
+
+  private:
+
+    int width8;                             /**< number of 8*8 squares on a row */
+    int height8;                            /**< number of 8*8 squares on a column */
+    std::vector<bool> obstacles[LAYER_NB];  /**< obstacle squares of each layer */
+    long nb_collision_tests;                /**< number of calls to test_collision_with_obstacles() */
+};
+
+/**
+ * @brief Creates a map without obstacles.
+ * @param width8 number of 8*8 squares on a row
+ * @param height8 number of 8*8 squares on a column
+ */
+inline Map::Map(int width8, int height8):
+  width8(width8),
+  height8(height8),
+  nb_collision_tests(0) {
+
+  for (int i = 0; i < LAYER_NB; i++) {
+    obstacles[i].assign(width8 * height8, false);
+  }
+}
+
+/**
+ * @brief Returns the number of 8*8 squares on a row of the map.
+ * @return the width of the map in 8*8 squares
+ */
+inline int Map::get_width8() {
+  return width8;
+}
+
+/**
+ * @brief Returns the number of 8*8 squares on a column of the map.
+ * @return the height of the map in 8*8 squares
+ */
+inline int Map::get_height8() {
+  return height8;
+}
+
+/**
+ * @brief Makes a square of the map an obstacle.
+ * @param layer layer of the square
+ * @param x8 x coordinate of the square, in 8*8 squares
+ * @param y8 y coordinate of the square, in 8*8 squares
+ */
+inline void Map::set_obstacle(Layer layer, int x8, int y8) {
+
+  if (x8 >= 0 && x8 < width8 && y8 >= 0 && y8 < height8) {
+    obstacles[layer][y8 * width8 + x8] = true;
+  }
+}
+
+/**
+ * @brief Returns whether a rectangle overlaps an obstacle or the outside of the map.
+ * @param layer layer of the rectangle
+ * @param box the rectangle
+ * @return true if the rectangle is not entirely on free squares
+ */
+inline bool Map::is_obstacle(Layer layer, const Rectangle& box) {
+
+  if (box.get_x() < 0 || box.get_y() < 0
+      || box.get_x() + box.get_width() > width8 * 8
+      || box.get_y() + box.get_height() > height8 * 8) {
+    return true;
+  }
+
+  const int x1 = box.get_x() / 8;
+  const int x2 = (box.get_x() + box.get_width() - 1) / 8;
+  const int y1 = box.get_y() / 8;
+  const int y2 = (box.get_y() + box.get_height() - 1) / 8;
+  for (int y8 = y1; y8 <= y2; y8++) {
+    for (int x8 = x1; x8 <= x2; x8++) {
+      if (obstacles[layer][y8 * width8 + x8]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Tests whether a rectangle overlaps an obstacle, like the engine does
+ * when an entity moves.
+ * @param layer layer of the rectangle
+ * @param collision_box the rectangle to test
+ * @param entity the entity that would move there (unused)
+ * @return true if the rectangle overlaps an obstacle
+ */
+inline bool Map::test_collision_with_obstacles(Layer layer,
+    const Rectangle& collision_box, MapEntity& entity) {
+
+  nb_collision_tests++;
+  return is_obstacle(layer, collision_box);
+}
+
+/**
+ * @brief Returns the number of collision tests made since the last reset.
+ * @return the number of collision tests
+ */
+inline long Map::get_nb_collision_tests() {
+  return nb_collision_tests;
+}
+
+/**
+ * @brief Sets the number of collision tests to zero.
+ */
+inline void Map::reset_nb_collision_tests() {
+  nb_collision_tests = 0;
+}
+
+#endif
+
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2006-2012 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_MAP_ENTITY_H
+#define SOLARUS_MAP_ENTITY_H
+
+#include "Common.h"
+#include "lowlevel/Rectangle.h"
+#include "entities/Layer.h"
+
+/**
+ * @brief Stand-in for the MapEntity class of the engine, used by the path
+ * finding benchmark.
+ *
+ * It is only a bounding box on a layer.
+ */
+class MapEntity {
+
+  public:
+
+    MapEntity(Layer layer, const Rectangle& bounding_box);
+
+    Layer get_layer();
+    const Rectangle& get_bounding_box();
+    bool is_aligned_to_grid();
+
+  private:
+
+    Layer layer;                 /**< layer of the entity */
+    Rectangle bounding_box;      /**< position and size of the entity */
+};
+
+/**
+ * @brief Creates an entity.
+ * @param layer layer of the entity
+ * @param bounding_box position and size of the entity
+ */
+inline MapEntity::MapEntity(Layer layer, const Rectangle& bounding_box):
+  layer(layer),
+  bounding_box(bounding_box) {
+
+}
+
+/**
+ * @brief Returns the layer of the entity.
+ * @return the layer
+ */
+inline Layer MapEntity::get_layer() {
+  return layer;
+}
+
+/**
+ * @brief Returns the position and size of the entity.
+ * @return the bounding box
+ */
+inline const Rectangle& MapEntity::get_bounding_box() {
+  return bounding_box;
+}
+
+/**
+ * @brief Returns whether the top-left corner of the entity is aligned
+ * on the 8*8 grid of the map.
+ * @return true if the entity is aligned
+ */
+inline bool MapEntity::is_aligned_to_grid() {
+  return bounding_box.get_x() % 8 == 0 && bounding_box.get_y() % 8 == 0;
+}
+
+#endif
+